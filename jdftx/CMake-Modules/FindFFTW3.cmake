@@ -5,6 +5,12 @@ find_library(FFTW3_LIBRARY NAMES fftw3)
 find_library(FFTW3_THREADS_LIBRARY NAMES fftw3_threads PATHS ${FFTW3_PATH} ${FFTW3_PATH}/lib ${FFTW3_PATH}/lib64 NO_DEFAULT_PATH)
 find_library(FFTW3_THREADS_LIBRARY NAMES fftw3_threads)
 
+#Optional single-precision libraries (used only for EnableMixedPrecision):
+find_library(FFTW3F_LIBRARY NAMES fftw3f PATHS ${FFTW3_PATH} ${FFTW3_PATH}/lib ${FFTW3_PATH}/lib64 NO_DEFAULT_PATH)
+find_library(FFTW3F_LIBRARY NAMES fftw3f)
+find_library(FFTW3F_THREADS_LIBRARY NAMES fftw3f_threads PATHS ${FFTW3_PATH} ${FFTW3_PATH}/lib ${FFTW3_PATH}/lib64 NO_DEFAULT_PATH)
+find_library(FFTW3F_THREADS_LIBRARY NAMES fftw3f_threads)
+
 if(FFTW3_INCLUDE_DIR AND FFTW3_LIBRARY AND FFTW3_THREADS_LIBRARY)
 	set(FFTW3_FOUND TRUE)
 endif()
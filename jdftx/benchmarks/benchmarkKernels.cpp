@@ -0,0 +1,343 @@
+/*-------------------------------------------------------------------
+Copyright 2017 Ravishankar Sundararaman
+
+This file is part of JDFTx.
+
+JDFTx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+JDFTx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
+-------------------------------------------------------------------*/
+
+#include <electronic/Everything.h>
+#include <electronic/ColumnBundle.h>
+#include <electronic/ExCorr.h>
+#include <electronic/ExactExchange.h>
+#include <fluid/TranslationOperator.h>
+#include <core/Coulomb.h>
+#include <core/Operators.h>
+#include <core/Random.h>
+#include <core/Util.h>
+#include <commands/parser.h>
+#include <functional>
+#include <fstream>
+#include <map>
+#include <algorithm>
+#include <getopt.h>
+
+//! Timing statistics of one benchmark
+struct BenchmarkResult
+{	string name;
+	double median_us, min_us; //!< median and minimum time per call in microseconds
+	int nRepeats; //!< number of timed calls
+};
+
+//! Run and time micro-benchmarks, optionally comparing against a baseline
+class BenchmarkRunner
+{
+public:
+	double minTime; //!< minimum total time in seconds spent on each benchmark (after warm-up)
+	string filter; //!< only run benchmarks whose names contain this string (all if empty)
+	std::vector<BenchmarkResult> results;
+
+	BenchmarkRunner() : minTime(1.) {}
+
+	//! Time calls to func (which must be collective over MPI), with one untimed warm-up call
+	void run(string name, std::function<void()> func)
+	{	if(filter.length() && name.find(filter)==string::npos) return;
+		func(); sync(); //warm-up (plan creation, cache population, lazy initialization etc.)
+		int iSync = 0; mpiUtil->allReduce(iSync, MPIUtil::ReduceMax); //start timing in sync on all processes
+		std::vector<double> times;
+		double tTot = 0.;
+		while(times.size()<3 || (tTot<minTime*1e6 && times.size()<1000))
+		{	double t = clock_us(); //(processes are synced by the reduction below in each pass)
+			func(); sync();
+			t = clock_us() - t;
+			mpiUtil->allReduce(t, MPIUtil::ReduceMax); //slowest process determines time
+			times.push_back(t);
+			tTot += t;
+		}
+		std::sort(times.begin(), times.end());
+		BenchmarkResult result;
+		result.name = name;
+		result.median_us = times[times.size()/2];
+		result.min_us = times.front();
+		result.nRepeats = times.size();
+		results.push_back(result);
+		logPrintf("%-36s  median: %12.1lf us  min: %12.1lf us  (%d calls)\n",
+			name.c_str(), result.median_us, result.min_us, result.nRepeats);
+		logFlush();
+	}
+
+	//! Write results (with details of the run environment) to a json file
+	void writeJSON(string filename) const
+	{	if(!mpiUtil->isHead()) return;
+		FILE* fp = fopen(filename.c_str(), "w");
+		if(!fp) die("Could not open '%s' for writing.\n", filename.c_str())
+		fprintf(fp, "{\n");
+		fprintf(fp, "  \"nProcesses\": %d,\n", mpiUtil->nProcesses());
+		fprintf(fp, "  \"nThreads\": %d,\n", nProcsAvailable);
+		fprintf(fp, "  \"gpu\": %s,\n", isGpuEnabled() ? "true" : "false");
+		fprintf(fp, "  \"benchmarks\": [\n");
+		for(size_t i=0; i<results.size(); i++)
+		{	const BenchmarkResult& r = results[i];
+			//NOTE: one benchmark per line is relied upon by compareBaseline()
+			fprintf(fp, "    { \"name\": \"%s\", \"median_us\": %.3lf, \"min_us\": %.3lf, \"repeats\": %d }%s\n",
+				r.name.c_str(), r.median_us, r.min_us, r.nRepeats, (i+1<results.size() ? "," : ""));
+		}
+		fprintf(fp, "  ]\n}\n");
+		fclose(fp);
+		logPrintf("Wrote benchmark results to '%s'.\n", filename.c_str());
+	}
+
+	//! Compare median times against a baseline json file written by writeJSON.
+	//! Returns the number of benchmarks slower than baseline by more than the fractional tolerance.
+	int compareBaseline(string filename, double tolerance) const
+	{	std::map<string,double> baseline; //median times by benchmark name
+		if(mpiUtil->isHead())
+		{	std::ifstream ifs(filename.c_str());
+			if(!ifs.is_open()) die("Could not open baseline file '%s' for reading.\n", filename.c_str())
+			const string nameKey("\"name\": \""), timeKey("\"median_us\":");
+			while(!ifs.eof())
+			{	string line; getline(ifs, line);
+				size_t namePos = line.find(nameKey);
+				size_t timePos = line.find(timeKey);
+				if(namePos==string::npos || timePos==string::npos) continue;
+				namePos += nameKey.length();
+				size_t nameEnd = line.find('"', namePos);
+				double median_us;
+				if(nameEnd==string::npos || sscanf(line.c_str()+timePos+timeKey.length(), "%lf", &median_us)!=1) continue;
+				baseline[line.substr(namePos, nameEnd-namePos)] = median_us;
+			}
+		}
+		int nRegressions = 0;
+		logPrintf("\nComparison against baseline '%s' (tolerance %lg%%):\n", filename.c_str(), tolerance*100);
+		for(const BenchmarkResult& r: results)
+		{	auto iter = baseline.find(r.name);
+			if(iter == baseline.end())
+			{	logPrintf("%-36s  not in baseline\n", r.name.c_str());
+				continue;
+			}
+			double ratio = r.median_us / iter->second;
+			bool regressed = (ratio > 1.+tolerance);
+			if(regressed) nRegressions++;
+			logPrintf("%-36s  %8.3lfx baseline%s\n", r.name.c_str(), ratio,
+				regressed ? "  <-- REGRESSION" : (ratio < 1.-tolerance ? "  (faster)" : ""));
+		}
+		mpiUtil->bcast(nRegressions);
+		if(nRegressions) logPrintf("%d benchmark(s) regressed beyond tolerance.\n", nRegressions);
+		else logPrintf("No regressions beyond tolerance.\n");
+		return nRegressions;
+	}
+
+private:
+	static void sync()
+	{
+		#ifdef GPU_ENABLED
+		cudaThreadSynchronize();
+		#endif
+	}
+};
+
+//! FCC lattice of given lattice constant, with cubic grids of size Sdim
+void setupGrid(GridInfo& gInfo, int Sdim, double a=10.)
+{	gInfo.S = vector3<int>(Sdim, Sdim, Sdim);
+	gInfo.R.set_col(0, vector3<>(0, 0.5*a, 0.5*a));
+	gInfo.R.set_col(1, vector3<>(0.5*a, 0, 0.5*a));
+	gInfo.R.set_col(2, vector3<>(0.5*a, 0.5*a, 0));
+	gInfo.initialize(true);
+}
+
+//Kernels that only need a grid or matrix:
+void benchmarkStandalone(BenchmarkRunner& bench, const std::vector<int>& gridSizes)
+{
+	//Fourier transforms at several grid sizes:
+	for(int Sdim: gridSizes)
+	{	GridInfo gInfo; setupGrid(gInfo, Sdim);
+		ScalarField r(ScalarFieldData::alloc(gInfo)); initRandom(r);
+		ScalarFieldTilde g = J(r);
+		char suffix[32]; sprintf(suffix, "(%d^3)", Sdim);
+		bench.run(string("I")+suffix, [&](){ I(g); });
+		bench.run(string("Idag")+suffix, [&](){ Idag(r); });
+		bench.run(string("J")+suffix, [&](){ J(r); });
+
+		//Translation operators (as used in rigid-molecule fluids):
+		if(Sdim == gridSizes.front())
+		{	TranslationOperatorSpline tConst(gInfo, TranslationOperatorSpline::Constant);
+			TranslationOperatorSpline tLinear(gInfo, TranslationOperatorSpline::Linear);
+			vector3<> t(0.37, -1.21, 2.03);
+			ScalarField y; nullToZero(y, gInfo);
+			bench.run(string("TranslationConstant::taxpy")+suffix, [&](){ tConst.taxpy(t, 1., r, y); });
+			bench.run(string("TranslationLinear::taxpy")+suffix, [&](){ tLinear.taxpy(t, 1., r, y); });
+		}
+	}
+
+	//Dense hermitian diagonalization:
+	for(int N: std::vector<int>{64, 256, 512})
+	{	matrix M(N, N); randomize(M);
+		mpiUtil->bcast(M.data(), M.nData()); //identical matrix on all processes
+		matrix H = dagger_symmetrize(M);
+		char name[64]; sprintf(name, "matrix::diagonalize(%d)", N);
+		bench.run(name, [&](){ matrix evecs; diagMatrix eigs; H.diagonalize(evecs, eigs); });
+	}
+
+	//Ewald sums for periodic and slab geometries:
+	{	GridInfo gInfo; setupGrid(gInfo, 48, 20.);
+		std::vector<Atom> atoms;
+		Random::seed(0);
+		for(int iAtom=0; iAtom<64; iAtom++)
+			atoms.push_back(Atom(iAtom%2 ? 4. : 6., vector3<>(Random::uniform(), Random::uniform(), Random::uniform())));
+		CoulombParams cpPeriodic; cpPeriodic.geometry = CoulombParams::Periodic;
+		CoulombParams cpSlab; cpSlab.geometry = CoulombParams::Slab; cpSlab.iDir = 2;
+		std::shared_ptr<Coulomb> periodic = cpPeriodic.createCoulomb(gInfo);
+		std::shared_ptr<Coulomb> slab = cpSlab.createCoulomb(gInfo);
+		bench.run("Ewald::energyAndGrad(Periodic)", [&](){ periodic->energyAndGrad(atoms); });
+		bench.run("Ewald::energyAndGrad(Slab)", [&](){ slab->energyAndGrad(atoms); });
+	}
+}
+
+//Kernels that need a complete electronic setup:
+void benchmarkEverything(BenchmarkRunner& bench, const Everything& e)
+{	const ElecInfo& eInfo = e.eInfo;
+	const ElecVars& eVars = e.eVars;
+	ScalarFieldArray n = eVars.calcDensity();
+
+	//Wavefunction kernels (over the states local to each process):
+	bench.run("diagouterI", [&]()
+	{	for(int q=eInfo.qStart; q<eInfo.qStop; q++)
+			diagouterI(eVars.F[q], eVars.C[q], n.size());
+	});
+	bench.run("Idag_DiagV_I", [&]()
+	{	for(int q=eInfo.qStart; q<eInfo.qStop; q++)
+			Idag_DiagV_I(eVars.C[q], n);
+	});
+	bench.run("ColumnBundle::operator^", [&]()
+	{	for(int q=eInfo.qStart; q<eInfo.qStop; q++)
+			eVars.C[q] ^ eVars.C[q];
+	});
+
+	//Exchange-correlation:
+	{	ExCorr gga(ExCorrGGA_PBE); gga.setup(e);
+		ExCorr mgga(ExCorrMGGA_TPSS); mgga.setup(e);
+		ScalarFieldArray tau = eVars.KEdensity();
+		bench.run("ExCorr(GGA-PBE)", [&]()
+		{	ScalarFieldArray Vxc; gga(n, &Vxc);
+		});
+		bench.run("ExCorr(mGGA-TPSS)", [&]()
+		{	ScalarFieldArray Vxc, Vtau; mgga(n, &Vxc, IncludeTXC(), &tau, &Vtau);
+		});
+	}
+
+	//Exact exchange:
+	if(e.exx)
+	{	double aXX = e.exCorr.exxFactor(), omega = e.exCorr.exxRange();
+		bench.run("ExactExchange", [&]()
+		{	std::vector<ColumnBundle> HC(eInfo.nStates);
+			(*e.exx)(aXX, omega, eVars.F, eVars.C, &HC);
+		});
+	}
+	else logPrintf("Skipping ExactExchange: input does not use a hybrid functional.\n");
+
+	//Symmetrization:
+	{	ScalarField x = n[0]->clone();
+		bench.run("Symmetries::symmetrize", [&](){ e.symm.symmetrize(x); });
+	}
+}
+
+void printUsage(const char *name)
+{	printVersionBanner();
+	logPrintf("\nUsage: %s [options]\n", name);
+	logPrintf("\n\tTime core computational kernels, optionally comparing against a baseline.\n");
+	logPrintf("\nOptions:\n");
+	logPrintf("\t-h --help               help (this output)\n");
+	logPrintf("\t-i --input <filename>   JDFTx input file for kernels that need a complete electronic setup (skipped if unspecified)\n");
+	logPrintf("\t-j --json <filename>    write timings to this json file\n");
+	logPrintf("\t-b --baseline <file>    compare against timings in a json file written previously using -j\n");
+	logPrintf("\t-t --tolerance <frac>   fractional slowdown relative to baseline reported as a regression (default: 0.1)\n");
+	logPrintf("\t-m --min-time <sec>     minimum time to spend on each benchmark (default: 1)\n");
+	logPrintf("\t-g --grids <S1,S2,...>  cubic grid sizes for the Fourier transform benchmarks (default: 48,64,96,128)\n");
+	logPrintf("\t-f --filter <string>    only run benchmarks whose names contain string\n");
+	logPrintf("\t-c --cores <n>          number of cores to use per process (default: all available)\n");
+	logPrintf("\n");
+}
+
+int main(int argc, char** argv)
+{	mpiUtil = new MPIUtil(argc, argv);
+
+	//Parse command line:
+	BenchmarkRunner bench;
+	string inputFilename, jsonFilename, baselineFilename;
+	double tolerance = 0.1;
+	std::vector<int> gridSizes{48, 64, 96, 128};
+	int nCores = 0;
+	option long_options[] =
+		{	{"help", no_argument, 0, 'h'},
+			{"input", required_argument, 0, 'i'},
+			{"json", required_argument, 0, 'j'},
+			{"baseline", required_argument, 0, 'b'},
+			{"tolerance", required_argument, 0, 't'},
+			{"min-time", required_argument, 0, 'm'},
+			{"grids", required_argument, 0, 'g'},
+			{"filter", required_argument, 0, 'f'},
+			{"cores", required_argument, 0, 'c'},
+			{0, 0, 0, 0}
+		};
+	while (1)
+	{	int c = getopt_long(argc, argv, "hi:j:b:t:m:g:f:c:", long_options, 0);
+		if (c == -1) break; //end of options
+		#define RUN_HEAD(code) if(mpiUtil->isHead()) { code } delete mpiUtil;
+		switch (c)
+		{	case 'h': RUN_HEAD( printUsage(argv[0]); ) exit(0);
+			case 'i': inputFilename.assign(optarg); break;
+			case 'j': jsonFilename.assign(optarg); break;
+			case 'b': baselineFilename.assign(optarg); break;
+			case 't': if(sscanf(optarg, "%lf", &tolerance)!=1 || tolerance<0.) { RUN_HEAD( printUsage(argv[0]); ) exit(1); } break;
+			case 'm': if(sscanf(optarg, "%lf", &bench.minTime)!=1) { RUN_HEAD( printUsage(argv[0]); ) exit(1); } break;
+			case 'g':
+			{	gridSizes.clear();
+				istringstream iss((string(optarg)));
+				string token;
+				while(getline(iss, token, ','))
+				{	int Sdim;
+					if(sscanf(token.c_str(), "%d", &Sdim)!=1 || Sdim<=0) { RUN_HEAD( printUsage(argv[0]); ) exit(1); }
+					gridSizes.push_back(Sdim);
+				}
+				if(!gridSizes.size()) { RUN_HEAD( printUsage(argv[0]); ) exit(1); }
+				break;
+			}
+			case 'f': bench.filter.assign(optarg); break;
+			case 'c': if(sscanf(optarg, "%d", &nCores)!=1 || nCores<=0) { RUN_HEAD( printUsage(argv[0]); ) exit(1); } break;
+			default: RUN_HEAD( printUsage(argv[0]); ) exit(1);
+		}
+		#undef RUN_HEAD
+	}
+
+	initSystem(argc, argv);
+	if(nCores) nProcsAvailable = nCores;
+
+	logPrintf("\n---------- Standalone kernels ----------\n"); logFlush();
+	benchmarkStandalone(bench, gridSizes);
+
+	if(inputFilename.length())
+	{	logPrintf("\n---------- Setting up '%s' ----------\n", inputFilename.c_str()); logFlush();
+		Everything e;
+		parse(readInputFile(inputFilename), e);
+		e.setup();
+		logPrintf("\n---------- Electronic kernels ----------\n"); logFlush();
+		benchmarkEverything(bench, e);
+	}
+
+	if(jsonFilename.length()) bench.writeJSON(jsonFilename);
+	int nRegressions = baselineFilename.length() ? bench.compareBaseline(baselineFilename, tolerance) : 0;
+
+	finalizeSystem();
+	return nRegressions ? 1 : 0;
+}
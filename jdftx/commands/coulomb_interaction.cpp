@@ -235,3 +235,74 @@ struct CommandExchangeRegularization : public Command
 	}
 }
 commandCoulombParams;
+
+
+struct CommandExchangeDownsample : public Command
+{
+	CommandExchangeDownsample() : Command("exchange-downsample", "jdftx/Coulomb interactions")
+	{
+		format = "<n0> <n1> <n2>";
+		comments =
+			"Restrict exact-exchange pair sums to a sub-mesh of k-point differences,\n"
+			"retaining every <ni>'th k-point along supercell vector i (which coincides\n"
+			"with lattice direction i for ordinary k-point folding). This reduces the\n"
+			"exchange cost by a factor of n0*n1*n2, while the singularity correction\n"
+			"(see exchange-regularization) is consistently computed for the sub-mesh.\n"
+			"Each <ni> must divide the k-point folding along that direction, must be 1\n"
+			"along truncated directions, and the factors must respect the symmetries\n"
+			"of the k-point mesh. Default 1 1 1 (no downsampling).";
+		hasDefault = true;
+		require("exchange-regularization");
+	}
+
+	void process(ParamList& pl, Everything& e)
+	{	vector3<int>& factor = e.coulombParams.exchangeDownsample;
+		const char* dirNames[3] = { "n0", "n1", "n2" };
+		for(int k=0; k<3; k++)
+		{	pl.get(factor[k], 1, dirNames[k]);
+			if(factor[k] < 1) throw string("<") + dirNames[k] + "> must be a positive integer";
+		}
+	}
+	
+	void printStatus(Everything& e, int iRep)
+	{	const vector3<int>& factor = e.coulombParams.exchangeDownsample;
+		logPrintf("%d %d %d", factor[0], factor[1], factor[2]);
+	}
+}
+commandExchangeDownsample;
+
+
+struct CommandExchangeLocalize : public Command
+{
+	CommandExchangeLocalize() : Command("exchange-localize", "jdftx/Coulomb interactions")
+	{
+		format = "<tolerance>";
+		comments =
+			"Evaluate exact exchange for Gamma-point insulators using occupied orbitals\n"
+			"localized by selected columns of the density matrix (SCDM) \\cite SCDM.\n"
+			"Each localized orbital is truncated to a box about its center containing\n"
+			"all but a fraction <tolerance> of its norm, and pair densities are computed\n"
+			"only for orbital pairs with overlapping boxes, on local grids with isolated\n"
+			"Coulomb kernels. The number of pair integrals then scales linearly with\n"
+			"system size for large insulating systems.\n"
+			"\n"
+			"Requires a single Gamma-point state per spin, and WignerSeitzTruncated\n"
+			"exchange-regularization (or Isolated coulomb-interaction). Whenever the\n"
+			"fillings are not those of an insulator (a leading block of fully occupied\n"
+			"bands), the standard delocalized evaluation is used instead.\n"
+			"Default: 0 (disabled); typical tolerance 1e-4.";
+		hasDefault = true;
+		require("exchange-regularization");
+	}
+
+	void process(ParamList& pl, Everything& e)
+	{	pl.get(e.coulombParams.exchangeLocalize, 0., "tolerance");
+		if(e.coulombParams.exchangeLocalize < 0. || e.coulombParams.exchangeLocalize >= 1.)
+			throw string("<tolerance> must be in [0,1)");
+	}
+	
+	void printStatus(Everything& e, int iRep)
+	{	logPrintf("%lg", e.coulombParams.exchangeLocalize);
+	}
+}
+commandExchangeLocalize;
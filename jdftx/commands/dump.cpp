@@ -20,11 +20,14 @@ along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
 #include <commands/command.h>
 #include <electronic/Everything.h>
 #include <electronic/ColumnBundle.h>
+#include <electronic/WavefunctionFile.h>
 #include <electronic/Polarizability.h>
 #include <electronic/ElectronScattering.h>
 #include <electronic/Vibrations.h>
 #include <electronic/Dump_internal.h>
 #include <core/Units.h>
+#include <core/Checkpoint.h>
+#include <core/H5io.h>
 
 struct CommandDumpOnly : public Command
 {
@@ -836,3 +839,139 @@ struct CommandPotentialSubtraction : public Command
 	}
 }
 commandPotentialSubtraction;
+
+
+struct CommandDumpExcitations : public Command
+{
+	CommandDumpExcitations() : Command("dump-excitations", "jdftx/Output")
+	{	format = "[<nMax>=0] [<dEmax>=0]";
+		comments =
+			"Restrict the optical excitations output by dump Excitations to the <nMax> lowest-energy ones,\n"
+			"and/or those with excitation energy at most <dEmax> (in Hartrees); zero disables either limit.\n"
+			"The energy cutoff for the lowest <nMax> excitations is determined collectively from eigenvalues\n"
+			"alone, so that transition matrix elements are computed and stored only for retained excitations.\n"
+			"Each process sorts its own excitations, which are merged and streamed to the file in chunks.";
+	}
+	
+	void process(ParamList& pl, Everything& e)
+	{	pl.get(e.dump.excitationsMax, 0, "nMax");
+		pl.get(e.dump.excitationsEmax, 0., "dEmax");
+		if(e.dump.excitationsMax < 0) throw string("<nMax> must be non-negative");
+		if(e.dump.excitationsEmax < 0.) throw string("<dEmax> must be non-negative");
+	}
+	
+	void printStatus(Everything& e, int iRep)
+	{	logPrintf("%d %lg", e.dump.excitationsMax, e.dump.excitationsEmax);
+	}
+}
+commandDumpExcitations;
+
+
+struct CommandDumpAsync : public Command
+{
+	CommandDumpAsync() : Command("dump-async", "jdftx/Output")
+	{	format = "<enable>=yes|no";
+		comments = 
+			"Whether to write the restart state (wfns, fluidState and scfHistory) in the background,\n"
+			"overlapped with the calculation (default: no). The local wavefunctions are staged in memory\n"
+			"(which requires an additional copy of them on each process) and written by a background thread.\n"
+			"Each file is written to <file>.tmp and renamed into place only after all processes complete it,\n"
+			"along with a checksum manifest <file>.manifest, so that an interrupted run always leaves\n"
+			"the previous complete state intact. Files with manifests are verified when read on restart.";
+	}
+	
+	void process(ParamList& pl, Everything& e)
+	{	bool enable;
+		pl.get(enable, false, boolMap, "enable");
+		if(enable) e.dump.checkpoint = std::make_shared<Checkpoint>();
+	}
+	
+	void printStatus(Everything& e, int iRep)
+	{	logPrintf("%s", boolMap.getString(bool(e.dump.checkpoint)));
+	}
+}
+commandDumpAsync;
+
+
+static EnumStringMap<WfnsCompression> wfnsCompressionMap
+(	WfnsCompressNone, "none",
+	WfnsCompressLossless, "lossless",
+	WfnsCompressSingle, "single"
+);
+
+struct CommandDumpWfnsContainer : public Command
+{
+	CommandDumpWfnsContainer() : Command("dump-wfns-container", "jdftx/Output")
+	{	format = "<compression>=" + wfnsCompressionMap.optionList() + " [<blockBands>=16]";
+		comments =
+			"Write wavefunctions (wfns) in a self-describing container, instead of the raw binary format.\n"
+			"The container records the k-point, basis G-vectors and band count of each state, and stores\n"
+			"bands in independently readable blocks of <blockBands> bands each, so that readers can load\n"
+			"individual (k-point, band range) blocks lazily from a memory-mapped file. The container is\n"
+			"detected automatically by initial-state / wavefunction, without needing nBandsOld or EcutOld.\n"
+			"\n"
+			"<compression> of each block is one of:\n"
+			"+ none: store double-precision coefficients as is.\n"
+			"+ lossless: byte-shuffle and deflate (requires compiling with EnableZlib).\n"
+			"+ single: store single-precision coefficients (relative error < 6e-8 per component).";
+	}
+	
+	void process(ParamList& pl, Everything& e)
+	{	e.dump.wfnsContainer = std::make_shared<WfnsContainerParams>();
+		WfnsContainerParams& params = *(e.dump.wfnsContainer);
+		pl.get(params.compression, WfnsCompressNone, wfnsCompressionMap, "compression", true);
+		pl.get(params.blockBands, 16, "blockBands");
+		if(params.blockBands < 1) throw string("<blockBands> must be positive");
+		#ifndef ZLIB_ENABLED
+		if(params.compression == WfnsCompressLossless)
+			throw string("Lossless compression requires zlib (reconfigure with -D EnableZlib=yes)");
+		#endif
+	}
+	
+	void printStatus(Everything& e, int iRep)
+	{	const WfnsContainerParams& params = *(e.dump.wfnsContainer);
+		logPrintf("%s %d", wfnsCompressionMap.getString(params.compression), params.blockBands);
+	}
+}
+commandDumpWfnsContainer;
+
+
+struct CommandDumpHdf5 : public Command
+{
+	CommandDumpHdf5() : Command("dump-hdf5", "jdftx/Output")
+	{	format = "[<compress>=no] [<writersPerNode>=1] [<blockBands>=16]";
+		comments =
+			"Write wavefunctions (wfns) and all scalar-field outputs (densities, potentials etc.)\n"
+			"collectively in parallel-HDF5 format, instead of writing raw binary files from one process.\n"
+			"Each process writes its own k-points (for wfns) or slab of grid planes (for scalar fields)\n"
+			"in a single collective operation, with MPI-IO aggregation restricted to <writersPerNode>\n"
+			"processes on each node to avoid overloading the file system with small requests.\n"
+			"Wavefunction datasets are chunked by blocks of <blockBands> bands, and if <compress>=yes,\n"
+			"chunks are byte-shuffled and deflated by HDF5 (scalar fields are then chunked by plane).\n"
+			"HDF5 wavefunctions are detected automatically by initial-state / wavefunction, but require\n"
+			"the same number of bands and basis (Ecut and lattice) as the current calculation.\n"
+			"The BerkeleyGW export (dump End BGW) also uses these chunking and aggregation settings.\n"
+			"Requires compiling with EnableHDF5 against an MPI-enabled HDF5 library.\n"
+			"If dump-async is also enabled, wfns are written asynchronously in raw format instead.";
+	}
+	
+	void process(ParamList& pl, Everything& e)
+	{
+		#ifndef HDF5_ENABLED
+		throw string("HDF5 output requires HDF5 support (reconfigure with -D EnableHDF5=yes)");
+		#endif
+		e.dump.hdf5 = std::make_shared<H5writeParams>();
+		H5writeParams& params = *(e.dump.hdf5);
+		pl.get(params.compress, false, boolMap, "compress");
+		pl.get(params.writersPerNode, 1, "writersPerNode");
+		pl.get(params.blockBands, 16, "blockBands");
+		if(params.writersPerNode < 1) throw string("<writersPerNode> must be positive");
+		if(params.blockBands < 1) throw string("<blockBands> must be positive");
+	}
+	
+	void printStatus(Everything& e, int iRep)
+	{	const H5writeParams& params = *(e.dump.hdf5);
+		logPrintf("%s %d %d", boolMap.getString(params.compress), params.writersPerNode, params.blockBands);
+	}
+}
+commandDumpHdf5;
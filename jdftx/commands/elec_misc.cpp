@@ -258,6 +258,37 @@ commandConvergeEmptyStates;
 
 //-------------------------------------------------------------------------------------------------
 
+struct CommandElecMixedPrecision : public Command
+{
+	CommandElecMixedPrecision() : Command("elec-mixed-precision", "jdftx/Electronic/Optimization")
+	{
+		format = "<threshold>";
+		comments =
+			"Perform the wavefunction Fourier transforms in the local potential (Idag_DiagV_I)\n"
+			"and density (diagouterI) of early electronic iterations in single precision, which\n"
+			"halves the memory bandwidth of these operations. Transforms are promoted to double\n"
+			"precision automatically once the residual drops below <threshold>: |grad|_K for\n"
+			"the electronic minimizer, and the RMS eigenvalue change |deigs| for SCF.\n"
+			"Requires compilation with EnableMixedPrecision, and is ignored on GPUs.";
+	}
+
+	void process(ParamList& pl, Everything& e)
+	{	pl.get(e.cntrl.mixedPrecisionThreshold, 0., "threshold", true);
+		if(e.cntrl.mixedPrecisionThreshold <= 0.)
+			throw string("<threshold> must be positive");
+		#ifndef MIXED_PRECISION_ENABLED
+		throw string("Mixed precision requires compilation with EnableMixedPrecision=yes");
+		#endif
+	}
+
+	void printStatus(Everything& e, int iRep)
+	{	logPrintf("%lg", e.cntrl.mixedPrecisionThreshold);
+	}
+}
+commandElecMixedPrecision;
+
+//-------------------------------------------------------------------------------------------------
+
 struct CommandWavefunctionDrag : public Command
 {
 	CommandWavefunctionDrag() : Command("wavefunction-drag", "jdftx/Ionic/Optimization")
@@ -80,11 +80,21 @@ struct CommandFluidGummelLoop : public Command
 {
 	CommandFluidGummelLoop() : Command("fluid-gummel-loop", "jdftx/Fluid/Optimization")
 	{
-		format = "[<maxIterations>=10] [<Atol>=1e-5]";
+		format = "[<maxIterations>=10] [<Atol>=1e-5] [<tolFactor>=0.01] [<history>=0] [<mixFraction>=0.5]";
 		comments =
 			"Settings for the fluid <--> electron self-consistency loop:\n"
 			"+ <maxIterations>: Max number of electron and fluid minimization pairs\n"
 			"+ <Atol>: Free energy convergence criterion for this outer loop.\n"
+			"+ <tolFactor>: Inner fluid and electronic minimization tolerances relative to\n"
+			"   the most recent free energy change of the outer loop. The energy-difference\n"
+			"   thresholds of fluid-minimize and electronic-minimize are raised to <tolFactor>\n"
+			"   times this change (but never below their specified values), and while it exceeds\n"
+			"   <Atol>, their gradient-norm thresholds (if any) are relaxed proportionately,\n"
+			"   so that early loop iterations are inexpensive.\n"
+			"+ <history>: If non-zero, accelerate the loop by Anderson mixing of the fluid inputs\n"
+			"   (explicit charge and cavity-determining density) over this many previous iterations.\n"
+			"   The default 0 selects plain alternation of fluid and electronic minimizations.\n"
+			"+ <mixFraction>: Mixing fraction for the Anderson-accelerated loop.\n"
 			"Use fluid-solve-frequency to control whether such a loop is used at all.";
 		hasDefault = true;
 	}
@@ -92,10 +102,17 @@ struct CommandFluidGummelLoop : public Command
 	void process(ParamList& pl, Everything& e)
 	{	pl.get(e.cntrl.fluidGummel_nIterations, 10, "maxIterations");
 		pl.get(e.cntrl.fluidGummel_Atol, 1e-5, "Atol");
+		pl.get(e.cntrl.fluidGummel_tolFactor, 0.01, "tolFactor");
+		pl.get(e.cntrl.fluidGummel_history, 0, "history");
+		pl.get(e.cntrl.fluidGummel_mixFraction, 0.5, "mixFraction");
+		if(e.cntrl.fluidGummel_tolFactor <= 0.) throw string("<tolFactor> must be positive");
+		if(e.cntrl.fluidGummel_history < 0) throw string("<history> must be non-negative");
+		if(e.cntrl.fluidGummel_mixFraction <= 0. || e.cntrl.fluidGummel_mixFraction > 1.) throw string("<mixFraction> must be in (0,1]");
 	}
 
 	void printStatus(Everything& e, int iRep)
-	{	logPrintf("%d %le", e.cntrl.fluidGummel_nIterations, e.cntrl.fluidGummel_Atol);
+	{	logPrintf("%d %le %lg %d %lg", e.cntrl.fluidGummel_nIterations, e.cntrl.fluidGummel_Atol,
+			e.cntrl.fluidGummel_tolFactor, e.cntrl.fluidGummel_history, e.cntrl.fluidGummel_mixFraction);
 	}
 }
 commandFluidGummelLoop;
@@ -20,6 +20,7 @@ along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
 #include <commands/command.h>
 #include <electronic/Everything.h>
 #include <fluid/Euler.h>
+#include <electronic/Batch.h>
 
 struct CommandIon : public Command
 {
@@ -234,3 +235,78 @@ struct CommandCoreOverlapCheck : public Command
 	}
 }
 commandCoreOverlapCheck;
+
+
+struct CommandBatchStructure : public Command
+{
+	CommandBatchStructure() : Command("batch-structure", "jdftx/Ionic/Geometry")
+	{
+		format = "<name> <filename>";
+		comments =
+			"Add a structure named <name>, with ionic positions from <filename>, to a batch of structures\n"
+			"evaluated in one run (eg. for high-throughput screening). The file contains ion commands\n"
+			"(such as the ionpos output of dump), in the coordinate system selected by coords-type;\n"
+			"other lines and any move scale factors / constraints in the file are ignored.\n"
+			"\n"
+			"The ion commands of the input file specify the initial structure, which is used for\n"
+			"all setup: pseudopotentials, FFT grids and plans, Coulomb kernels, symmetries and k-points\n"
+			"are set up once and reused for every structure in the batch. Therefore, all structures\n"
+			"must have the same number of atoms of each species (on the same lattice), and must respect\n"
+			"the symmetries of the initial structure (use symmetries none for unrelated structures);\n"
+			"structures violating these are skipped with a note in the results.\n"
+			"\n"
+			"Each structure is evaluated with an electronic (and fluid) minimization, starting from\n"
+			"the converged state of the previous structure, followed by a force calculation.\n"
+			"The energy and Cartesian forces of all structures are streamed in order to the dump\n"
+			"output with variable name 'batch'. Ionic minimization and the final dump are bypassed.\n"
+			"See batch-groups to evaluate structures concurrently on groups of processes.";
+		allowMultiple = true;
+		
+		require("coords-type");
+		forbid("vibrations");
+	}
+
+	void process(ParamList& pl, Everything& e)
+	{	if(!e.batch) e.batch = std::make_shared<Batch>();
+		Batch::Structure structure;
+		pl.get(structure.name, string(), "name", true);
+		pl.get(structure.filename, string(), "filename", true);
+		e.batch->structures.push_back(structure);
+	}
+
+	void printStatus(Everything& e, int iRep)
+	{	const Batch::Structure& structure = e.batch->structures[iRep];
+		logPrintf("%s %s", structure.name.c_str(), structure.filename.c_str());
+	}
+}
+commandBatchStructure;
+
+
+struct CommandBatchGroups : public Command
+{
+	CommandBatchGroups() : Command("batch-groups", "jdftx/Ionic/Geometry")
+	{
+		format = "<nGroups>";
+		comments =
+			"Divide the processes into <nGroups> groups (of contiguous MPI ranks) that evaluate\n"
+			"different structures of the batch concurrently (see batch-structure); all parallelization\n"
+			"over k-points and bands then happens within each group. Structures are assigned to groups\n"
+			"round-robin, and results are still collected in order into a single output file.\n"
+			"The log only shows the calculations of the first group. With more than one group,\n"
+			"dumps at frequencies other than End, and dump-async checkpoints, are not supported\n"
+			"(they would be written concurrently by each group). (Default: 1)";
+		
+		require("batch-structure");
+	}
+
+	void process(ParamList& pl, Everything& e)
+	{	int nGroups; pl.get(nGroups, 1, "nGroups");
+		if(nGroups < 1) throw string("<nGroups> must be positive");
+		e.batch->nGroups = nGroups;
+	}
+
+	void printStatus(Everything& e, int iRep)
+	{	logPrintf("%d", e.batch->nGroups);
+	}
+}
+commandBatchGroups;
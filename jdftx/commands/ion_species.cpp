@@ -121,6 +121,32 @@ struct CommandIonSpecies : public Command
 }
 commandIonSpecies;
 
+struct CommandPseudopotentialCache : public Command
+{
+	CommandPseudopotentialCache() : Command("pseudopotential-cache", "jdftx/Ionic/Species")
+	{
+		format = "<directory>";
+		comments =
+			"Cache fully processed pseudopotential data (radial tables of the local potential, core density,\n"
+			"projectors, augmentation functions and atomic orbitals, and projector matrices) in <directory>,\n"
+			"which is created if necessary. Each cache file is tagged by a checksum of the pseudopotential\n"
+			"file contents together with all parameters that affect processing (radial grid spacing and\n"
+			"extents set by the cutoffs, core KE density settings etc.), and is memory-mapped and used\n"
+			"in place of parsing and transforming the pseudopotential in subsequent runs only if these match.\n"
+			"The cache may be shared by many runs; files are written atomically by the first run to need them.";
+	}
+
+	void process(ParamList& pl, Everything& e)
+	{	pl.get(e.iInfo.pspCacheDir, string(), "directory", true);
+	}
+
+	void printStatus(Everything& e, int iRep)
+	{	logPrintf("%s", e.iInfo.pspCacheDir.c_str());
+	}
+}
+commandPseudopotentialCache;
+
+
 const std::vector<string>& getPseudopotentialPrefixes()
 {	static std::vector<string> prefixes;
 	if(!prefixes.size())
@@ -230,6 +230,35 @@ struct CommandLattMoveScale : public Command
 }
 commandLattMoveScale;
 
+EnumStringMap<bool> stressMethodMap(
+	false, "Analytic",
+	true, "FiniteDifference" );
+
+struct CommandLattStressMethod : public Command
+{
+	CommandLattStressMethod() : Command("latt-stress-method", "jdftx/Ionic/Optimization")
+	{
+		format = "<method>=" + stressMethodMap.optionList();
+		comments = "Method used to compute the stress tensor for lattice minimization and dumps (default: Analytic).\n"
+			"+ Analytic: differentiate each energy term with respect to strain directly,\n"
+			"  requiring a single evaluation per lattice step. Calculations with features\n"
+			"  that do not yet support analytic stress fall back to finite differences.\n"
+			"+ FiniteDifference: fourth-order central differences of the energy along each\n"
+			"  independent strain direction, which is considerably more expensive and is\n"
+			"  mainly useful for validating the analytic stress.";
+		hasDefault = true;
+	}
+
+	void process(ParamList& pl, Everything& e)
+	{	pl.get(e.cntrl.stressFiniteDifference, false, stressMethodMap, "method");
+	}
+
+	void printStatus(Everything& e, int iRep)
+	{	fputs(stressMethodMap.getString(e.cntrl.stressFiniteDifference), globalLog);
+	}
+}
+commandLattStressMethod;
+
 EnumStringMap<CoordsType> coordsMap(
 	CoordsLattice, "Lattice",
 	CoordsCartesian, "Cartesian" );
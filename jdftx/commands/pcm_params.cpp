@@ -218,6 +218,62 @@ struct CommandPcmNonlinearDebug : public Command
 commandPcmNonlinearDebug;
 
 
+struct CommandPcmNonlinearNewton : public Command
+{
+	CommandPcmNonlinearNewton() : Command("pcm-nonlinear-newton", "jdftx/Fluid/Optimization")
+	{
+		format = "[<nInner>=50]";
+		comments =
+			"Converge nonlinear PCM fluids using an inexact Newton-Krylov method instead of\n"
+			"nonlinear conjugate gradients. Each Newton step is solved by preconditioned\n"
+			"linear CG (at most <nInner> iterations) to a tolerance set by the current\n"
+			"gradient norm, using analytic Hessian-vector products of the free energy\n"
+			"(about one gradient evaluation each), followed by a backtracking line search\n"
+			"with an Armijo sufficient-decrease condition on the free energy.\n"
+			"The initial state is obtained from a similar LinearPCM as usual.\n"
+			"Outer iteration count and thresholds are controlled by fluid-minimize.\n"
+			"Useful for strong ionic screening, where nonlinear CG needs many iterations.";
+		forbid("pcm-nonlinear-scf");
+	}
+	
+	void process(ParamList& pl, Everything& e)
+	{	FluidSolverParams& fsp = e.eVars.fluidParams;
+		fsp.nonlinearNewton = true;
+		pl.get(fsp.nonlinearNewtonInner, 50, "nInner");
+		if(fsp.nonlinearNewtonInner < 1) throw string("<nInner> must be positive");
+	}
+	
+	void printStatus(Everything& e, int iRep)
+	{	logPrintf("%d", e.eVars.fluidParams.nonlinearNewtonInner);
+	}
+}
+commandPcmNonlinearNewton;
+
+
+struct CommandPcmMultigrid : public Command
+{
+	CommandPcmMultigrid() : Command("pcm-multigrid", "jdftx/Fluid/Parameters")
+	{
+		format = "<enable>=" + boolMap.optionList();
+		comments =
+			"Precondition the linear solves of LinearPCM and SaLSA fluids with a geometric multigrid\n"
+			"V-cycle for the variable-coefficient Poisson-Boltzmann operator in the cavity (default: no).\n"
+			"The iteration count is then nearly independent of grid size and dielectric contrast,\n"
+			"unlike the default reciprocal-space preconditioner. Multigrid is most effective when\n"
+			"the fftbox dimensions contain several factors of 2.";
+	}
+	
+	void process(ParamList& pl, Everything& e)
+	{	pl.get(e.eVars.fluidParams.multigrid, false, boolMap, "enable");
+	}
+	
+	void printStatus(Everything& e, int iRep)
+	{	logPrintf("%s", boolMap.getString(e.eVars.fluidParams.multigrid));
+	}
+}
+commandPcmMultigrid;
+
+
 
 struct CommandIonWidth : public Command
 {
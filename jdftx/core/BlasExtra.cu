@@ -153,10 +153,13 @@ void eblas_symmetrize_phase_kernel(int N, int n, const int* symmIndex, const int
 		for(int j=0; j<n; j++)
 			xSum += x[symmIndex[n*i+j]] * phase[n*i+j];
 		xSum *= 1./(n*symmMult[i]); //average n in the equivalence class, with weight for accumulation below accounted)
-		for(int j=0; j<n; j++)
-			x[symmIndex[n*i+j]] = 0.;
-		for(int j=0; j<n; j++)
-			x[symmIndex[n*i+j]] += xSum * phase[n*i+j].conj();
+		for(int j=0; j<n;)
+		{	//Accumulate phases over the run of repetitions of this index (stored adjacently), and write once:
+			int index = symmIndex[n*i+j];
+			complex phaseSum = 0.;
+			do phaseSum += phase[n*i+j].conj(); while(++j<n && symmIndex[n*i+j]==index);
+			x[index] = xSum * phaseSum;
+		}
 	}
 }
 void eblas_symmetrize_gpu(int N, int n, const int* symmIndex, const int* symmMult, const complex* phase, complex* x)
@@ -214,7 +214,8 @@ void eblas_symmetrize_gpu(int N, int n, const int* symmIndex, complex* x);
 //! (useful for space group symmetrization in reciprocal space)
 //! @param N Length of array x
 //! @param n Length of symmetry equivalence classes
-//! @param symmIndex Every consecutive set of n indices in this array forms an equivalence class
+//! @param symmIndex Every consecutive set of n indices in this array forms an equivalence class,
+//!   with repeated indices within a class stored adjacently (e.g. sorted within each class)
 //! @param symmMult Multiplicity per equivalence class (number of repetitions of each element in orbit)
 //! @param phase Phase factors corresponding to each entry in symmIndex
 //! @param x Data array to be symmetrized in place
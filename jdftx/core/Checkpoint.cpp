@@ -0,0 +1,223 @@
+/*-------------------------------------------------------------------
+Copyright 2017 Ravishankar Sundararaman
+
+This file is part of JDFTx.
+
+JDFTx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+JDFTx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
+-------------------------------------------------------------------*/
+
+#include <core/Checkpoint.h>
+#include <core/Util.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+inline string tmpFilename(const string& fname) { return fname + ".tmp"; }
+inline string manifestFilename(const string& fname) { return fname + ".manifest"; }
+
+
+Checkpoint::~Checkpoint()
+{	for(Job& job: jobs)
+		if(job.thread.joinable())
+			job.thread.join();
+}
+
+void Checkpoint::write(string fname, std::vector<char>&& data)
+{	for(const Job& job: jobs)
+		if(job.fname == fname)
+		{	finish(); //previous version of same file still pending
+			break;
+		}
+	jobs.emplace_back();
+	Job& job = jobs.back();
+	job.fname = fname;
+	job.data.swap(data);
+	job.length = job.data.size();
+	job.checksum = fnv1aInit;
+	job.failed = false;
+	//Compute offset of current process:
+	std::vector<unsigned long> nBytes(mpiUtil->nProcesses(), 0);
+	nBytes[mpiUtil->iProcess()] = job.length;
+	mpiUtil->allReduce(nBytes.data(), nBytes.size(), MPIUtil::ReduceSum);
+	job.offset = 0;
+	for(int iSrc=0; iSrc<mpiUtil->iProcess(); iSrc++)
+		job.offset += nBytes[iSrc];
+	//Create / truncate temporary file on head before other processes write to it:
+	bool createFailed = false;
+	if(mpiUtil->isHead())
+	{	FILE* fp = fopen(tmpFilename(fname).c_str(), "w");
+		if(fp) fclose(fp); else createFailed = true;
+	}
+	mpiUtil->allReduce(createFailed, MPIUtil::ReduceLOr);
+	if(createFailed) die("Error opening %s for writing.\n", tmpFilename(fname).c_str());
+	//Write in background:
+	job.thread = std::thread(writeThread, &job);
+}
+
+void Checkpoint::writeHead(string fname, std::function<void(const char*)> writeFunc)
+{	for(const Job& job: jobs)
+		if(job.fname == fname)
+		{	finish(); //previous version of same file still pending
+			break;
+		}
+	jobs.emplace_back();
+	Job& job = jobs.back();
+	job.fname = fname;
+	job.offset = 0;
+	job.length = 0;
+	job.checksum = fnv1aInit;
+	job.failed = false;
+	if(mpiUtil->isHead())
+	{	string fnameTmp = tmpFilename(fname);
+		writeFunc(fnameTmp.c_str());
+		job.thread = std::thread(checksumThread, &job);
+	}
+}
+
+void Checkpoint::writeThread(Checkpoint::Job* job)
+{	fnv1a(job->checksum, job->data.data(), job->length);
+	if(!job->length) return;
+	int fd = open(tmpFilename(job->fname).c_str(), O_WRONLY);
+	if(fd < 0) { job->failed = true; return; }
+	size_t nDone = 0;
+	while(nDone < job->length)
+	{	ssize_t nWritten = pwrite(fd, job->data.data()+nDone, job->length-nDone, job->offset+nDone);
+		if(nWritten <= 0) { job->failed = true; break; }
+		nDone += nWritten;
+	}
+	if(fsync(fd)) job->failed = true;
+	close(fd);
+	std::vector<char>().swap(job->data); //release staging buffer
+}
+
+void Checkpoint::checksumThread(Checkpoint::Job* job)
+{	FILE* fp = fopen(tmpFilename(job->fname).c_str(), "r");
+	if(!fp) { job->failed = true; return; }
+	std::vector<char> buf(1<<20);
+	size_t nRead;
+	while((nRead = fread(buf.data(), 1, buf.size(), fp)))
+	{	fnv1a(job->checksum, buf.data(), nRead);
+		job->length += nRead;
+	}
+	if(ferror(fp)) job->failed = true;
+	fclose(fp);
+}
+
+void Checkpoint::finish()
+{	if(!jobs.size()) return;
+	int nProcs = mpiUtil->nProcesses(), iProc = mpiUtil->iProcess();
+	for(Job& job: jobs)
+	{	if(job.thread.joinable())
+			job.thread.join();
+		//Collect segment details from all processes:
+		std::vector<unsigned long> offsets(nProcs, 0), lengths(nProcs, 0), checksums(nProcs, 0);
+		offsets[iProc] = job.offset;
+		lengths[iProc] = job.length;
+		checksums[iProc] = job.checksum;
+		mpiUtil->allReduce(offsets.data(), nProcs, MPIUtil::ReduceSum);
+		mpiUtil->allReduce(lengths.data(), nProcs, MPIUtil::ReduceSum);
+		mpiUtil->allReduce(checksums.data(), nProcs, MPIUtil::ReduceBOr);
+		mpiUtil->allReduce(job.failed, MPIUtil::ReduceLOr);
+		if(job.failed)
+		{	if(mpiUtil->isHead()) remove(tmpFilename(job.fname).c_str());
+			die("Error writing checkpoint %s (previous version, if any, left intact).\n", job.fname.c_str());
+		}
+		//Commit on head:
+		if(mpiUtil->isHead())
+		{	string fnameManifest = manifestFilename(job.fname);
+			string fnameManifestTmp = tmpFilename(fnameManifest);
+			FILE* fp = fopen(fnameManifestTmp.c_str(), "w");
+			if(!fp) die("Error opening %s for writing.\n", fnameManifestTmp.c_str());
+			fprintf(fp, "#Checkpoint manifest for '%s'\n", job.fname.c_str());
+			fprintf(fp, "#Offset Length FNV-1a-checksum for each segment:\n");
+			for(int iSrc=0; iSrc<nProcs; iSrc++)
+				if(lengths[iSrc] || !iSrc)
+					fprintf(fp, "%lu %lu %016lx\n", offsets[iSrc], lengths[iSrc], checksums[iSrc]);
+			fclose(fp);
+			//Commit: data is unverified (but consistent) while neither manifest is in place
+			remove(fnameManifest.c_str()); //old manifest describes old data
+			if(rename(tmpFilename(job.fname).c_str(), job.fname.c_str()))
+				die("Error renaming %s to %s.\n", tmpFilename(job.fname).c_str(), job.fname.c_str());
+			if(rename(fnameManifestTmp.c_str(), fnameManifest.c_str()))
+				die("Error renaming %s to %s.\n", fnameManifestTmp.c_str(), fnameManifest.c_str());
+		}
+	}
+	jobs.clear();
+	//Make sure committed files are visible to all processes on return:
+	bool done = true;
+	mpiUtil->allReduce(done, MPIUtil::ReduceLAnd);
+}
+
+void Checkpoint::invalidate(string fname)
+{	if(mpiUtil->isHead())
+		remove(manifestFilename(fname).c_str()); //ignore errors: usually absent
+}
+
+void Checkpoint::verify(string fname)
+{	string errMsg;
+	if(mpiUtil->isHead())
+	{	string fnameManifest = manifestFilename(fname);
+		FILE* fpManifest = fopen(fnameManifest.c_str(), "r");
+		if(fpManifest) //nothing to verify otherwise
+		{	FILE* fp = fopen(fname.c_str(), "r");
+			if(!fp) errMsg = "Could not open '" + fname + "' for verification against '" + fnameManifest + "'.\n";
+			std::vector<char> buf(1<<20);
+			size_t fsizeExpected = 0;
+			char line[4096];
+			//Check that the manifest was written for this file (compare names without directory):
+			if(fgets(line, sizeof(line), fpManifest))
+			{	string header(line);
+				const string prefix = "#Checkpoint manifest for '";
+				size_t nameEnd = header.rfind('\'');
+				if(header.compare(0, prefix.length(), prefix.c_str()) || nameEnd==string::npos || nameEnd<prefix.length())
+					errMsg = "Could not parse manifest '" + fnameManifest + "'.\n";
+				else
+				{	auto baseName = [](string name) { size_t pos = name.rfind('/'); return pos==string::npos ? name : name.substr(pos+1); };
+					string nameManifest = header.substr(prefix.length(), nameEnd-prefix.length());
+					if(baseName(nameManifest) != baseName(fname))
+						errMsg = "Manifest '" + fnameManifest + "' was written for '" + nameManifest + "' rather than '" + fname + "'.\n";
+				}
+			}
+			while(fp && errMsg.empty() && fgets(line, sizeof(line), fpManifest))
+			{	if(line[0]=='#') continue;
+				unsigned long offset, length, checksum;
+				if(sscanf(line, "%lu %lu %lx", &offset, &length, &checksum) != 3)
+				{	errMsg = "Could not parse manifest '" + fnameManifest + "'.\n";
+					break;
+				}
+				fsizeExpected = std::max(fsizeExpected, size_t(offset+length));
+				//Compute checksum of segment:
+				uint64_t hash = fnv1aInit;
+				fseek(fp, offset, SEEK_SET);
+				size_t nRemaining = length;
+				while(nRemaining)
+				{	size_t nRead = fread(buf.data(), 1, std::min(nRemaining, buf.size()), fp);
+					if(!nRead) break;
+					fnv1a(hash, buf.data(), nRead);
+					nRemaining -= nRead;
+				}
+				if(nRemaining || hash!=checksum)
+				{	char offsetStr[32]; sprintf(offsetStr, "%lu", offset);
+					errMsg = "Checksum mismatch in '" + fname + "' at byte offset " + offsetStr
+						+ " (file is truncated or corrupted, or does not match '" + fnameManifest + "').\n";
+				}
+			}
+			if(errMsg.empty() && off_t(fsizeExpected)!=fileSize(fname.c_str()))
+				errMsg = "Length of '" + fname + "' does not match manifest '" + fnameManifest + "'.\n";
+			if(fp) fclose(fp);
+			fclose(fpManifest);
+		}
+	}
+	mpiUtil->bcast(errMsg);
+	if(errMsg.length()) die("%s", errMsg.c_str());
+}
@@ -0,0 +1,82 @@
+/*-------------------------------------------------------------------
+Copyright 2017 Ravishankar Sundararaman
+
+This file is part of JDFTx.
+
+JDFTx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+JDFTx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
+-------------------------------------------------------------------*/
+
+#ifndef JDFTX_CORE_CHECKPOINT_H
+#define JDFTX_CORE_CHECKPOINT_H
+
+#include <core/string.h>
+#include <vector>
+#include <list>
+#include <thread>
+#include <functional>
+#include <stdint.h>
+
+//! @addtogroup Utilities
+//! @{
+
+//! @file Checkpoint.h Asynchronous, atomic checkpoint output with checksum manifests
+
+//! Writes restart files in the background, overlapped with the calculation.
+//! Each file is first written to fname.tmp and only renamed into place (along with
+//! a checksum manifest fname.manifest) once all processes have completed it,
+//! so that an interrupted run always leaves the previous complete version intact.
+//! The old manifest is removed before the data is replaced, and the new one is put in place
+//! only after, so that any manifest present always describes the data file next to it.
+class Checkpoint
+{
+public:
+	~Checkpoint(); //!< waits for pending writes, but does not commit them (not collective)
+	
+	//! Write data from each process, concatenated in process order, to fname in the background.
+	//! The data is staged by taking over the contents of the vector (collective call).
+	void write(string fname, std::vector<char>&& data);
+	
+	//! Write fname on the head process synchronously using writeFunc, which is passed the temporary filename,
+	//! and commit it atomically along with the other pending files in finish() (collective call).
+	void writeHead(string fname, std::function<void(const char*)> writeFunc);
+	
+	//! Wait for all pending writes to complete, rename the temporary files into place and write manifests (collective call).
+	//! Must be called before the next checkpoint and at the end of the run.
+	void finish();
+	
+	//! Check fname against its manifest (if any) and quit with an error on mismatch (collective call)
+	static void verify(string fname);
+	
+	//! Remove the manifest of fname (if any) before fname is written outside Checkpoint, so that a
+	//! manifest never describes data other than the one it was written for (call on all processes; acts on head)
+	static void invalidate(string fname);
+	
+private:
+	struct Job
+	{	string fname; //!< final filename
+		std::vector<char> data; //!< staged data on current process (empty for writeHead jobs)
+		size_t offset; //!< offset of current process's data in file
+		size_t length; //!< length of current process's data in file
+		uint64_t checksum; //!< checksum of current process's data
+		bool failed; //!< whether the write failed on current process
+		std::thread thread; //!< background writer / checksum thread
+	};
+	std::list<Job> jobs; //!< pending writes
+	
+	static void writeThread(Job* job); //!< write staged data to temporary file and compute checksum
+	static void checksumThread(Job* job); //!< compute checksum of temporary file written by writeHead
+};
+
+//! @}
+#endif //JDFTX_CORE_CHECKPOINT_H
@@ -29,7 +29,7 @@ along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
 #include <core/Operators.h>
 #include "LatticeUtils.h"
 
-CoulombParams::CoulombParams() : ionMargin(5.), embed(false), embedFluidMode(false)
+CoulombParams::CoulombParams() : ionMargin(5.), embed(false), embedFluidMode(false), exchangeLocalize(0.), exchangeDownsample(1,1,1)
 {
 }
 
@@ -174,8 +174,13 @@ complexScalarFieldTilde Coulomb::operator()(const complexScalarFieldTilde& in, v
 	return (*this)((complexScalarFieldTilde&&)out, kDiff, omega);
 }
 
-double Coulomb::energyAndGrad(std::vector<Atom>& atoms) const
-{	if(!ewald) ((Coulomb*)this)->ewald = createEwald(gInfo.R, atoms.size());
+matrix3<> Coulomb::latticeGradient(const ScalarFieldTilde& X, const ScalarFieldTilde& Y) const
+{	die("Lattice derivatives of the Coulomb interaction are only supported in periodic geometry.\n");
+}
+
+double Coulomb::energyAndGrad(std::vector<Atom>& atoms, matrix3<>* E_RRT) const
+{	assert(!E_RRT || !(params.embed || params.Efield.length_squared())); //lattice derivatives not supported with embedding / electric fields
+	if(!ewald) ((Coulomb*)this)->ewald = createEwald(gInfo.R, atoms.size());
 	double Eewald = 0.;
 	if(params.embed)
 	{	matrix3<> embedScaleMat = Diag(embedScale);
@@ -219,7 +224,7 @@ double Coulomb::energyAndGrad(std::vector<Atom>& atoms) const
 			a.force = embedScaleMat * a.force;
 		}
 	}
-	else Eewald = ewald->energyAndGrad(atoms);
+	else Eewald = ewald->energyAndGrad(atoms, E_RRT);
 	//Electric field contributions if any:
 	if(params.Efield.length_squared())
 	{	vector3<> RT_Efield_ramp, RT_Efield_wave;
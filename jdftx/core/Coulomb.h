@@ -65,6 +65,8 @@ struct CoulombParams
 	ExchangeRegularization exchangeRegularization; //!< exchange regularization method
 	std::set<double> omegaSet; //!< set of exchange erf-screening parameters
 	std::shared_ptr<struct Supercell> supercell; //!< Description of k-point supercell for exchange
+	double exchangeLocalize; //!< if non-zero, norm tolerance for truncating SCDM-localized orbitals in Gamma-point exact exchange
+	vector3<int> exchangeDownsample; //!< retain every exchangeDownsample[i]'th k-point along supercell vector i in exchange sums (1 => full mesh)
 	
 	CoulombParams();
 	
@@ -102,7 +104,8 @@ public:
 	//!Get the energy of a point charge configurtaion, and accumulate corresponding forces
 	//!The implementation will shift each Atom::pos by lattice vectors to bring it to
 	//!the fundamental zone (or Wigner-Seitz cell as appropriate)
-	virtual double energyAndGrad(std::vector<Atom>& atoms) const=0;
+	//!If E_RRT is non-null, accumulate the derivative w.r.t. Cartesian strain (only supported in periodic geometry)
+	virtual double energyAndGrad(std::vector<Atom>& atoms, matrix3<>* E_RRT=0) const=0;
 };
 
 
@@ -127,11 +130,16 @@ public:
 	
 	//! Create the appropriate Ewald class, if required, and call Ewald::energyAndGrad
 	//! Includes interaction with Efield, if present (Requires embedded truncation)
-	double energyAndGrad(std::vector<Atom>& atoms) const; 
+	//! If E_RRT is non-null, accumulate the derivative w.r.t. Cartesian strain (periodic geometry only)
+	double energyAndGrad(std::vector<Atom>& atoms, matrix3<>* E_RRT=0) const; 
 
 	//! Generate the potential due to the Efield (if any) (Requires embedded truncation)
 	ScalarField getEfieldPotential() const;
 	
+	//! Derivative of dot(X, O((*this)(Y))) w.r.t Cartesian strain, at fixed Fourier coefficients of X and Y.
+	//! Only supported in periodic geometry (without embedding); the other geometries die with an error.
+	virtual matrix3<> latticeGradient(const ScalarFieldTilde& X, const ScalarFieldTilde& Y) const;
+	
 	//! Apply regularized coulomb kernel for exchange integral with k-point difference kDiff
 	//! and optionally screened with range parameter omega (destructible input)
 	complexScalarFieldTilde operator()(complexScalarFieldTilde&&, vector3<> kDiff, double omega) const;
@@ -38,8 +38,9 @@ struct EwaldIsolated : public Ewald
 	{
 	}
 	
-	double energyAndGrad(std::vector<Atom>& atoms) const
-	{	if(!atoms.size()) return 0.;
+	double energyAndGrad(std::vector<Atom>& atoms, matrix3<>* E_RRT) const
+	{	assert(!E_RRT); //lattice derivatives only supported in periodic geometry
+		if(!atoms.size()) return 0.;
 		double E = 0.;
 		//Shift all points into a Wigner-Seitz cell centered on one of the atoms; choice of this atom
 		//is irrelevant if every atom lies in the WS cell of the other with a consistent translation:
@@ -21,6 +21,8 @@ along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
 #include <core/Coulomb_internal.h>
 #include <core/CoulombKernel.h>
 #include <core/BlasExtra.h>
+#include <core/LoopMacros.h>
+#include <core/Thread.h>
 
 //! Standard 3D Ewald sum
 class EwaldPeriodic : public Ewald
@@ -57,7 +59,7 @@ public:
 		Nrecip.print(globalLog, " %d ");
 	}
 
-	double energyAndGrad(std::vector<Atom>& atoms) const
+	double energyAndGrad(std::vector<Atom>& atoms, matrix3<>* E_RRT) const
 	{	double eta = sqrt(0.5)/sigma, etaSq=eta*eta;
 		double sigmaSq = sigma * sigma;
 		double detR = fabs(det(R)); //cell volume
@@ -67,9 +69,10 @@ public:
 		{	Ztot += a.Z;
 			ZsqTot += a.Z * a.Z;
 		}
-		double E
-			= 0.5 * 4*M_PI * Ztot*Ztot * (-0.5*sigmaSq) / detR //G=0 correction
+		double E0 = 0.5 * 4*M_PI * Ztot*Ztot * (-0.5*sigmaSq) / detR; //G=0 correction
+		double E = E0
 			- 0.5 * ZsqTot * eta * (2./sqrt(M_PI)); //Self-energy correction
+		if(E_RRT) *E_RRT -= E0 * matrix3<>(1.,1.,1.); //G=0 correction scales as 1/detR
 		//Reduce positions to first centered unit cell:
 		for(Atom& a: atoms)
 			for(int k=0; k<3; k++)
@@ -86,8 +89,12 @@ public:
 							if(!rSq) continue; //exclude self-interaction
 							double r = sqrt(rSq);
 							E += 0.5 * a1.Z * a2.Z * erfc(eta*r)/r;
-							a1.force += (RTR * x) *
-								(a1.Z * a2.Z * (erfc(eta*r)/r + (2./sqrt(M_PI))*eta*exp(-etaSq*rSq))/rSq);
+							double E_r_over_r = -a1.Z * a2.Z * (erfc(eta*r)/r + (2./sqrt(M_PI))*eta*exp(-etaSq*rSq))/rSq; //(dE/dr)/r summed over both orderings of this pair
+							a1.force -= (RTR * x) * E_r_over_r;
+							if(E_RRT)
+							{	vector3<> rVec = R * x; //Cartesian separation
+								*E_RRT += (0.5*E_r_over_r) * outer(rVec,rVec);
+							}
 						}
 		//Reciprocal space sum:
 		vector3<int> iG; //integer reciprocal cell number
@@ -102,7 +109,13 @@ public:
 						SG += a.Z * cis(-2*M_PI*dot(iG,a.pos));
 					//Accumulate energy:
 					double eG = 4*M_PI * exp(-0.5*sigmaSq*Gsq)/(Gsq * detR);
-					E += 0.5 * eG * SG.norm();
+					double EG = 0.5 * eG * SG.norm();
+					E += EG;
+					//Accumulate strain derivative:
+					if(E_RRT)
+					{	vector3<> Gvec = iG * G; //Cartesian wave-vector
+						*E_RRT += EG * ((sigmaSq + 2./Gsq) * outer(Gvec,Gvec) - matrix3<>(1.,1.,1.));
+					}
 					//Accumulate forces:
 					for(Atom& a: atoms)
 						a.force -= (eG * a.Z * 2*M_PI * (SG.conj() * cis(-2*M_PI*dot(iG,a.pos))).imag()) * iG;
@@ -125,6 +138,28 @@ ScalarFieldTilde CoulombPeriodic::apply(ScalarFieldTilde&& in) const
 	return in;
 }
 
+inline void coulombLatticeGradient_calc(size_t i, const vector3<int>& iG, const vector3<int>& S, const matrix3<>& G,
+	const complex* X, const complex* Y, matrix3<>& result)
+{	vector3<> Gvec = iG * G; //Cartesian wave-vector
+	double Gsq = Gvec.length_squared();
+	if(!Gsq) return; //G=0 excluded from periodic kernel
+	double weight = (iG[2]==0||2*iG[2]==S[2]) ? 1 : 2; //weight of half-space point
+	double XKY = weight * (X[i].conj() * Y[i]).real() * (4*M_PI)/Gsq;
+	result += XKY * (matrix3<>(1.,1.,1.) + (2./Gsq)*outer(Gvec,Gvec));
+}
+void coulombLatticeGradient_sub(size_t iStart, size_t iStop, const vector3<int> S, const matrix3<> G,
+	const complex* X, const complex* Y, matrix3<>* result, std::mutex* m)
+{	matrix3<> resultLocal;
+	THREAD_halfGspaceLoop( coulombLatticeGradient_calc(i, iG, S, G, X, Y, resultLocal); )
+	m->lock(); *result += resultLocal; m->unlock();
+}
+
+matrix3<> CoulombPeriodic::latticeGradient(const ScalarFieldTilde& X, const ScalarFieldTilde& Y) const
+{	matrix3<> result; std::mutex m;
+	threadLaunch(coulombLatticeGradient_sub, gInfo.nG, gInfo.S, gInfo.G, X->data(), Y->data(), &result, &m);
+	return gInfo.detR * result;
+}
+
 std::shared_ptr<Ewald> CoulombPeriodic::createEwald(matrix3<> R, size_t nAtoms) const
 {	return std::make_shared<EwaldPeriodic>(R, nAtoms);
 }
@@ -202,8 +202,18 @@ ExchangeEval::ExchangeEval(const GridInfo& gInfo, const CoulombParams& params, c
 	
 	//Obtain supercell parameters, and adjust for mesh embedding where necessary:
 	assert(params.supercell);
-	const matrix3<int>& super = params.supercell->super;
-	const std::vector< vector3<> >& kmesh = params.supercell->kmesh;
+	matrix3<int> super = params.supercell->super;
+	std::vector< vector3<> > kmesh = params.supercell->kmesh;
+	if(!(params.exchangeDownsample == vector3<int>(1,1,1)))
+	{	//Regularize consistently with the sub-mesh of k-points retained in the exchange sums:
+		super = params.supercell->downsampledSuper(params.exchangeDownsample);
+		std::vector< vector3<> > kmeshSub;
+		for(const vector3<>& k: kmesh)
+			if(Supercell::onSubmesh(k - kmesh.front(), super))
+				kmeshSub.push_back(k);
+		kmesh.swap(kmeshSub);
+		logPrintf("Exchange kernel on downsampled k-mesh with %lu of %lu k-points.\n", kmesh.size(), params.supercell->kmesh.size());
+	}
 	matrix3<> Rsuper = gInfo.R * super; //this could differ from supercell->Rsuper, because the embedding gInfo.R is scaled up from the original gInfo.R
 	
 	//Check supercell:
@@ -476,10 +486,16 @@ ExchangeEval::ExchangeEval(const GridInfo& gInfo, const CoulombParams& params, c
 			//Split supercell kernel into one for each k-point difference:
 			logPrintf("Splitting supercell kernel to unit-cell with k-points ... "); logFlush();
 			size_t nKernelData = dkArr.size() * gInfo.nr;
-			kernelData.init(nKernelData);
-			for(size_t i=0; i<dkArr.size(); i++)
+			kernelData.initShared(nKernelData); //one copy per node (if available)
+			int iProcNode = 0, nProcsNode = 1; //split extraction over processes sharing kernelData
+			if(kernelData.isShared())
+			{	iProcNode = mpiUtil->iProcessNode();
+				nProcsNode = mpiUtil->nProcessesNode();
+			}
+			for(size_t i=iProcNode; i<dkArr.size(); i+=nProcsNode)
 				threadLaunch(extractExchangeKernel_thread, gInfo.nr, dkArr[i],
 					gInfo.S, Ssuper, super, dataSuper, kernelData.data() + i*gInfo.nr);
+			if(kernelData.isShared()) mpiUtil->barrierNode();
 			delete[] dataSuper;
 			logPrintf("Done.\n");
 			break;
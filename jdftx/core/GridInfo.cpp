@@ -30,7 +30,7 @@ along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
 
 const double GridInfo::maxAllowedStrain = 0.35;
 
-GridInfo::GridInfo():Gmax(0),GmaxRho(0),nr(0),initialized(false)
+GridInfo::GridInfo():Gmax(0),GmaxRho(0),nr(0),singlePrecisionFFT(false),initialized(false)
 {
 }
 
@@ -40,6 +40,10 @@ GridInfo::~GridInfo()
 	{	//Destroy cached FFTW plans, if any:
 		for(auto entry: planCache)
 			fftw_destroy_plan(entry.second);
+		#ifdef MIXED_PRECISION_ENABLED
+		for(auto entry: planCacheSingle)
+			fftwf_destroy_plan(entry.second);
+		#endif
 		//Destroy GPU plans, if any:
 		#ifdef GPU_ENABLED
 		cufftDestroy(planZ2Z);
@@ -317,3 +321,33 @@ fftw_plan GridInfo::getPlan(GridInfo::PlanType planType, int nThreads) const
 	planLock.unlock();
 	return plan;
 }
+
+#ifdef MIXED_PRECISION_ENABLED
+fftwf_plan GridInfo::getPlanSingle(GridInfo::PlanType planType, int nThreads) const
+{	assert(planType==PlanForwardInPlace || planType==PlanInverseInPlace);
+	//Return cached plan if available:
+	auto key = std::make_pair(planType, nThreads);
+	planLock.lock();
+	auto iter = planCacheSingle.find(key);
+	if(iter != planCacheSingle.end())
+	{	planLock.unlock();
+		return iter->second;
+	}
+	//Create plan:
+	#ifdef MKL_PROVIDES_FFT
+	fftw3_mkl.number_of_user_threads = ceildiv(nProcsAvailable, nThreads);
+	#endif
+	fftwf_init_threads();
+	fftwf_plan_with_nthreads(nThreads);
+	ManagedArray<fftwf_complex> testMem;
+	testMem.init(nr);
+	fftwf_complex* testData = testMem.data();
+	int sign = (planType==PlanForwardInPlace) ? FFTW_FORWARD : FFTW_BACKWARD;
+	fftwf_plan plan = fftwf_plan_dft_3d(S[0], S[1], S[2], testData, testData, sign, PLANNER_FLAGS);
+	if(!plan) die("Failed to create single-precision FFT plan with %d threads",  nThreads);
+	//--- cache and return plan:
+	((GridInfo*)this)->planCacheSingle.insert(std::make_pair(key, plan));
+	planLock.unlock();
+	return plan;
+}
+#endif
@@ -119,6 +119,10 @@ public:
 		PlanCtoR, //!< Complex to real transform
 	};
 	fftw_plan getPlan(PlanType planType, int nThreads) const; //get an FFTW plan of specified type with specified thread count
+	#ifdef MIXED_PRECISION_ENABLED
+	fftwf_plan getPlanSingle(PlanType planType, int nThreads) const; //get a single-precision FFTW plan (in-place complex types only) with specified thread count
+	#endif
+	bool singlePrecisionFFT; //!< if set, wavefunction transforms in Idag_DiagV_I and diagouterI use single precision (see elec-mixed-precision; CPU only)
 	#ifdef GPU_ENABLED
 	cufftHandle planZ2Z; //!< CUFFT plan for all the complex transforms
 	cufftHandle planD2Z; //!< CUFFT plan for R -> G
@@ -144,13 +148,17 @@ public:
 		return iGwrapped[2] + (S[2]/2+1)*(iGwrapped[1] + S[1]*iGwrapped[0]);
 	}
 
+	static std::mutex planLock; //!< global lock for FFTW planner routines, which are not thread safe (use for any plan creation / destruction)
+	
 private:
 	bool initialized; //!< keep track of whether initialize() has been called
 	void updateSdependent();
 	
 	//FFTW plans by thread count and type:
 	std::map<std::pair<PlanType,int>,fftw_plan> planCache;
-	static std::mutex planLock; //Global lock since planner routines are not thread safe
+	#ifdef MIXED_PRECISION_ENABLED
+	std::map<std::pair<PlanType,int>,fftwf_plan> planCacheSingle;
+	#endif
 };
 
 //! @}
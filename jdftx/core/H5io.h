@@ -30,9 +30,23 @@ along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
 #include <core/Util.h>
 #include <array>
 
+//! Parameters for collective parallel-HDF5 output (see command dump-hdf5)
+struct H5writeParams
+{	bool compress; //!< whether to apply shuffle and deflate filters to chunked datasets
+	int writersPerNode; //!< number of MPI-IO aggregators (processes that actually write) per node
+	int blockBands; //!< number of bands per chunk in wavefunction datasets
+	H5writeParams() : compress(false), writersPerNode(1), blockBands(16) {}
+};
+
 #ifdef HDF5_ENABLED
 #include "hdf5.h"
 
+inline hid_t h5createFile(const char* fname, const H5writeParams* params=0); //Collectively create (truncate) file for parallel access, with MPI-IO aggregation hints from params (if any)
+inline hid_t h5openFile(const char* fname); //Collectively open existing file for parallel read access
+inline bool h5isFile(const char* fname); //Check whether fname exists and is an HDF5 file
+inline hid_t h5createDataset(hid_t parent, const char* dname, hid_t dataType, const hsize_t* dims, int rank, const hsize_t* chunkDims=0, bool compress=false); //Collectively create an nD dataset, chunked if chunkDims is non-null (required for compress)
+template<typename T> void h5writeSlab(hid_t did, const T* data, const hsize_t* offset, const hsize_t* count, int rank); //Collectively write a contiguous hyperslab of an nD dataset (processes without data pass count with any zero entry)
+template<typename T> void h5readSlab(hid_t did, T* data, const hsize_t* offset, const hsize_t* count, int rank); //Collectively read a contiguous hyperslab of an nD dataset (processes without data pass count with any zero entry)
 inline hid_t h5createGroup(hid_t parent, const char* name);
 template<typename T> void h5writeScalar(hid_t fid, const char* dname, const T& data); //Write scalar to a rank-0 dataset
 template<typename T> void h5writeVector(hid_t fid, const char* dname, const std::vector<T>& data); //Collectively write contiguous array to a 1D dataset when all the data is available on all the processes
@@ -48,6 +62,100 @@ template<typename T> struct h5type;
 template<> struct h5type<int> { static hid_t get() { return H5T_NATIVE_INT; } };
 template<> struct h5type<double> { static hid_t get() { return H5T_NATIVE_DOUBLE; } };
 
+inline hid_t h5createFile(const char* fname, const H5writeParams* params)
+{	hid_t plid = H5Pcreate(H5P_FILE_ACCESS);
+	MPI_Info info;
+	MPI_Info_create(&info);
+	if(params)
+	{	//Collective buffering with a limited number of aggregators per node:
+		char cbConfig[32]; sprintf(cbConfig, "*:%d", params->writersPerNode);
+		MPI_Info_set(info, (char*)"romio_cb_write", (char*)"enable");
+		MPI_Info_set(info, (char*)"cb_config_list", cbConfig);
+	}
+	H5Pset_fapl_mpio(plid, mpiUtil->communicator(), info);
+	#if H5_VERSION_GE(1,10,0)
+	H5Pset_coll_metadata_write(plid, true); //metadata written collectively by few processes, rather than by all
+	#endif
+	hid_t fid = H5Fcreate(fname, H5F_ACC_TRUNC, H5P_DEFAULT, plid);
+	if(fid<0) die("Could not open/create output HDF5 file '%s'\n", fname);
+	H5Pclose(plid);
+	MPI_Info_free(&info);
+	return fid;
+}
+
+inline hid_t h5openFile(const char* fname)
+{	hid_t plid = H5Pcreate(H5P_FILE_ACCESS);
+	H5Pset_fapl_mpio(plid, mpiUtil->communicator(), MPI_INFO_NULL);
+	hid_t fid = H5Fopen(fname, H5F_ACC_RDONLY, plid);
+	if(fid<0) die("Could not open HDF5 file '%s' for reading.\n", fname);
+	H5Pclose(plid);
+	return fid;
+}
+
+inline bool h5isFile(const char* fname)
+{	if(fileSize(fname) <= 0) return false;
+	htri_t isHDF5 = -1;
+	H5E_BEGIN_TRY { isHDF5 = H5Fis_hdf5(fname); } H5E_END_TRY //must not return within the try block, which would leave error printing disabled
+	return isHDF5 > 0;
+}
+
+inline hid_t h5createDataset(hid_t parent, const char* dname, hid_t dataType, const hsize_t* dims, int rank, const hsize_t* chunkDims, bool compress)
+{	hid_t sid = H5Screate_simple(rank, dims, NULL);
+	hid_t plid = H5Pcreate(H5P_DATASET_CREATE);
+	if(chunkDims)
+	{	H5Pset_chunk(plid, rank, chunkDims);
+		if(compress)
+		{	H5Pset_shuffle(plid);
+			H5Pset_deflate(plid, 1); //low compression level: most of the gain from shuffle at a fraction of the cost
+		}
+	}
+	else assert(!compress); //filters require chunked storage
+	hid_t did = H5Dcreate(parent, dname, dataType, sid, H5P_DEFAULT, plid, H5P_DEFAULT);
+	H5Pclose(plid);
+	H5Sclose(sid);
+	if(did<0) die("Could not create dataset '%s' in HDF5 file.\n", dname);
+	return did;
+}
+
+//Select hyperslab in file and corresponding memory space (empty selection if count has a zero entry)
+inline void h5selectSlab(hid_t did, const hsize_t* offset, const hsize_t* count, int rank, hid_t& sidFile, hid_t& sidMem)
+{	bool empty = false;
+	for(int i=0; i<rank; i++) if(!count[i]) empty = true;
+	sidFile = H5Dget_space(did);
+	if(empty)
+	{	H5Sselect_none(sidFile);
+		sidMem = H5Screate(H5S_NULL);
+	}
+	else
+	{	H5Sselect_hyperslab(sidFile, H5S_SELECT_SET, offset, NULL, count, NULL);
+		sidMem = H5Screate_simple(rank, count, NULL);
+	}
+}
+
+template<typename T> void h5writeSlab(hid_t did, const T* data, const hsize_t* offset, const hsize_t* count, int rank)
+{	hid_t sidFile, sidMem;
+	h5selectSlab(did, offset, count, rank, sidFile, sidMem);
+	hid_t plid = H5Pcreate(H5P_DATASET_XFER);
+	H5Pset_dxpl_mpio(plid, H5FD_MPIO_COLLECTIVE);
+	if(H5Dwrite(did, h5type<T>::get(), sidMem, sidFile, plid, data) < 0)
+		die("Error writing hyperslab to HDF5 dataset.\n");
+	H5Pclose(plid);
+	H5Sclose(sidMem);
+	H5Sclose(sidFile);
+}
+
+template<typename T> void h5readSlab(hid_t did, T* data, const hsize_t* offset, const hsize_t* count, int rank)
+{	hid_t sidFile, sidMem;
+	h5selectSlab(did, offset, count, rank, sidFile, sidMem);
+	hid_t plid = H5Pcreate(H5P_DATASET_XFER);
+	H5Pset_dxpl_mpio(plid, H5FD_MPIO_COLLECTIVE);
+	if(H5Dread(did, h5type<T>::get(), sidMem, sidFile, plid, data) < 0)
+		die("Error reading hyperslab from HDF5 dataset.\n");
+	H5Pclose(plid);
+	H5Sclose(sidMem);
+	H5Sclose(sidFile);
+}
+
 inline hid_t h5createGroup(hid_t parent, const char* name)
 {	hid_t gid = H5Gcreate(parent, name, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
 	if(gid<0) die("Error creating group '%s' in HDF5 file.\n", name);
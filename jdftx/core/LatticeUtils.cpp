@@ -237,6 +237,25 @@ Supercell::Supercell(const GridInfo& gInfo,
 	Rsuper.print(globalLog, " %lg ");
 }
 
+matrix3<int> Supercell::downsampledSuper(const vector3<int>& factor) const
+{	matrix3<int> superSub;
+	for(int k=0; k<3; k++)
+	{	vector3<int> col = super.column(k);
+		for(int i=0; i<3; i++)
+		{	if(col[i] % factor[k])
+				die("Exchange downsampling factor %d is incommensurate with supercell vector %d.\n", factor[k], k+1);
+			col[i] /= factor[k];
+		}
+		superSub.set_col(k, col);
+	}
+	return superSub;
+}
+
+bool Supercell::onSubmesh(const vector3<>& dk, const matrix3<int>& superSub)
+{	double err; round(dk * superSub, &err);
+	return err < symmThreshold;
+}
+
 
 std::map<vector3<int>, matrix> getCellMap(const matrix3<>& R, const matrix3<>& Rsup, const vector3<bool>& isTruncated,
 	const std::vector<vector3<>>& x1, const std::vector<vector3<>>& x2, double rSmooth, string fname)
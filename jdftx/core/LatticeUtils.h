@@ -70,6 +70,13 @@ struct Supercell
 	Supercell(const GridInfo& gInfo,
 		const std::vector<vector3<>>& kmeshReduced,
 		const std::vector<SpaceGroupOp>& sym, const std::vector<int>& invertList);
+	
+	//! Supercell for the sub-mesh of k-point differences obtained by retaining every factor[i]'th
+	//! k-point along supercell vector i (columns of super are divided by factor; dies if not divisible)
+	matrix3<int> downsampledSuper(const vector3<int>& factor) const;
+	
+	//! Check whether k-point difference dk belongs to the sub-mesh described by superSub (see downsampledSuper)
+	static bool onSubmesh(const vector3<>& dk, const matrix3<int>& superSub);
 };
 
 //! Get a list of unit cells in a supercell, with padding at the boundaries to maintain a Wigner-Seitz
@@ -21,29 +21,85 @@ along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
 #include <core/Util.h>
 #include <core/scalar.h>
 #include <algorithm>
+#include <list>
 #include <climits>
 #include <core/Random.h>
 
-MPIUtil::MPIUtil(int argc, char** argv)
+MPIUtil::MPIUtil(int argc, char** argv) : ownsMPI(true)
 {
 	#ifdef MPI_ENABLED
 	int rc = MPI_Init(&argc, &argv);
 	if(rc != MPI_SUCCESS) { printf("Error starting MPI program. Terminating.\n"); MPI_Abort(MPI_COMM_WORLD, rc); }
-	MPI_Comm_size(MPI_COMM_WORLD, &nProcs);
-	MPI_Comm_rank(MPI_COMM_WORLD, &iProc);
+	comm = MPI_COMM_WORLD;
+	#endif
+	initComm();
+	Random::seed(iProc);
+}
+
+MPIUtil::MPIUtil(const MPIUtil& parent, int iGroup) : ownsMPI(false)
+{
+	#ifdef MPI_ENABLED
+	MPI_Comm_split(parent.comm, iGroup, parent.iProc, &comm);
+	#endif
+	initComm();
+}
+
+void MPIUtil::initComm()
+{
+	#ifdef MPI_ENABLED
+	MPI_Comm_size(comm, &nProcs);
+	MPI_Comm_rank(comm, &iProc);
+	#if MPI_VERSION >= 3
+	//Group processes by node for shared memory:
+	MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, iProc, MPI_INFO_NULL, &commNode);
+	MPI_Comm_size(commNode, &nProcsNode);
+	MPI_Comm_rank(commNode, &iProcNode);
+	MPI_Comm_split(comm, iProcNode ? MPI_UNDEFINED : 0, iProc, &commHeads);
+	int iNode = 0;
+	if(!iProcNode) MPI_Comm_rank(commHeads, &iNode);
+	MPI_Bcast(&iNode, 1, MPI_INT, 0, commNode);
+	nodeOfProcess.resize(nProcs);
+	MPI_Allgather(&iNode, 1, MPI_INT, nodeOfProcess.data(), 1, MPI_INT, comm);
+	#else
+	commNode = MPI_COMM_SELF;
+	commHeads = comm;
+	nProcsNode = 1;
+	iProcNode = 0;
+	for(int jProc=0; jProc<nProcs; jProc++)
+		nodeOfProcess.push_back(jProc);
+	#endif
 	#else
 	//No MPI:
 	nProcs = 1;
 	iProc = 0;
+	nProcsNode = 1;
+	iProcNode = 0;
+	nodeOfProcess.assign(1, 0);
 	#endif
-	
-	Random::seed(iProc);
 }
 
+#if defined(MPI_ENABLED) && (MPI_VERSION >= 3)
+//Node-shared windows that are currently allocated, in order of allocation (accessor avoids file-level static variable):
+std::list<MPI_Win*>& sharedWindows() { static std::list<MPI_Win*> windows; return windows; }
+#endif
+
 MPIUtil::~MPIUtil()
 {
 	#ifdef MPI_ENABLED
-	MPI_Finalize();
+	#if MPI_VERSION >= 3
+	if(ownsMPI)
+	{	//Release node-shared windows of objects that outlive MPI (in the same order on all processes, since MPI_Win_free is collective):
+		for(MPI_Win* win: sharedWindows())
+		{	MPI_Win_free(win);
+			delete win;
+		}
+		sharedWindows().clear(); //subsequent freeShared calls on these windows do nothing
+	}
+	MPI_Comm_free(&commNode);
+	if(commHeads != MPI_COMM_NULL) MPI_Comm_free(&commHeads);
+	#endif
+	if(ownsMPI) MPI_Finalize();
+	else MPI_Comm_free(&comm);
 	#endif
 }
 
@@ -81,6 +137,68 @@ void MPIUtil::checkErrors(const ostringstream& oss) const
 }
 
 
+//----------------------- Node-shared memory -------------------------------
+
+void MPIUtil::barrierNode() const
+{
+	#ifdef MPI_ENABLED
+	if(nProcsNode>1) MPI_Barrier(commNode);
+	#endif
+}
+
+void* MPIUtil::allocShared(size_t nBytes, void*& window) const
+{	window = 0;
+	#if defined(MPI_ENABLED) && (MPI_VERSION >= 3)
+	if(nProcsNode<2 || !nBytes) return 0;
+	MPI_Win* win = new MPI_Win;
+	void* base = 0;
+	//Entire allocation belongs to the node head, and other processes map it:
+	if(MPI_Win_allocate_shared(MPI_Aint(isNodeHead() ? nBytes : 0), 1, MPI_INFO_NULL, commNode, &base, win) != MPI_SUCCESS)
+		die("Failed to allocate %.1lf MB of node-shared memory.\n", nBytes*1e-6);
+	if(!isNodeHead())
+	{	MPI_Aint size; int dispUnit;
+		MPI_Win_shared_query(*win, 0, &size, &dispUnit, &base);
+	}
+	sharedWindows().push_back(win);
+	window = win;
+	return base;
+	#else
+	return 0;
+	#endif
+}
+
+void MPIUtil::freeShared(void*& window)
+{	if(!window) return;
+	#if defined(MPI_ENABLED) && (MPI_VERSION >= 3)
+	MPI_Win* win = (MPI_Win*)window;
+	std::list<MPI_Win*>& windows = sharedWindows();
+	auto iter = std::find(windows.begin(), windows.end(), win);
+	if(iter != windows.end()) //else already released when MPI was finalized
+	{	windows.erase(iter);
+		MPI_Win_free(win);
+		delete win;
+	}
+	#endif
+	window = 0;
+}
+
+void MPIUtil::bcastShared(void* data, size_t nBytes, int root) const
+{
+	#ifdef MPI_ENABLED
+	barrierNode(); //make sure data from root is complete
+	if(commHeads != MPI_COMM_NULL)
+	{	int nHeads; MPI_Comm_size(commHeads, &nHeads);
+		if(nHeads>1)
+		{	size_t blockSize = size_t(INT_MAX);
+			for(size_t offset=0; offset<nBytes; offset+=blockSize)
+				MPI_Bcast(((char*)data)+offset, int(std::min(blockSize, nBytes-offset)), MPI_BYTE, nodeOfProcess[root], commHeads);
+		}
+	}
+	barrierNode(); //make sure data received by head is visible to the rest of the node
+	#endif
+}
+
+
 //----------------------- Point-to-point routines -------------------------------
 
 void MPIUtil::send(const complex* data, size_t nData, int dest, int tag) const
@@ -158,6 +276,32 @@ void MPIUtil::allReduce(bool* data, size_t nData, MPIUtil::ReduceOp op, bool saf
 	}
 }
 
+//----------------------- Non-blocking collectives -------------------------------
+
+void MPIUtil::ibcast(complex* data, size_t nData, Request& request, int root) const
+{	ibcast((double*)data, 2*nData, request, root);
+}
+
+void MPIUtil::iallReduce(complex* data, size_t nData, MPIUtil::ReduceOp op, Request& request) const
+{	assert(op!=MPIUtil::ReduceMax && op!=MPIUtil::ReduceMin && op!=MPIUtil::ReduceProd);
+	iallReduce((double*)data, 2*nData, op, request);
+}
+
+void MPIUtil::wait(Request& request) const
+{
+	#ifdef MPI_ENABLED
+	MPI_Wait(&request, MPI_STATUS_IGNORE);
+	#endif
+}
+
+void MPIUtil::waitAll(std::vector<Request>& requests) const
+{
+	#ifdef MPI_ENABLED
+	if(requests.size()) MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+	#endif
+}
+
+
 
 //----------------------- File I/O routines -------------------------------
 
@@ -168,7 +312,7 @@ void MPIUtil::fopenRead(File& fp, const char* fname, size_t fsizeExpected, const
 			die("Length of '%s' was %" PRIdPTR " instead of the expected %zu bytes.\n%s\n", fname, fsize, fsizeExpected, fsizeErrMsg ? fsizeErrMsg : "");
 	}
 	#ifdef MPI_ENABLED
-	if(MPI_File_open(MPI_COMM_WORLD, (char*)fname, MPI_MODE_RDONLY, MPI_INFO_NULL, &fp) != MPI_SUCCESS)
+	if(MPI_File_open(comm, (char*)fname, MPI_MODE_RDONLY, MPI_INFO_NULL, &fp) != MPI_SUCCESS)
 	#else
 	fp = ::fopen(fname, "rb");
 	if(!fp)
@@ -179,9 +323,9 @@ void MPIUtil::fopenRead(File& fp, const char* fname, size_t fsizeExpected, const
 void MPIUtil::fopenWrite(File& fp, const char* fname) const
 {
 	#ifdef MPI_ENABLED
-	if(mpiUtil->isHead()) MPI_File_delete((char*)fname, MPI_INFO_NULL); //delete existing file, if any
-	MPI_Barrier(MPI_COMM_WORLD);
-	if(MPI_File_open(MPI_COMM_WORLD, (char*)fname, MPI_MODE_WRONLY|MPI_MODE_CREATE, MPI_INFO_NULL, &fp) != MPI_SUCCESS)
+	if(isHead()) MPI_File_delete((char*)fname, MPI_INFO_NULL); //delete existing file, if any
+	MPI_Barrier(comm);
+	if(MPI_File_open(comm, (char*)fname, MPI_MODE_WRONLY|MPI_MODE_CREATE, MPI_INFO_NULL, &fp) != MPI_SUCCESS)
 	#else
 	fp = ::fopen(fname, "wb");
 	if(!fp)
@@ -192,14 +336,14 @@ void MPIUtil::fopenWrite(File& fp, const char* fname) const
 void MPIUtil::fopenAppend(File& fp, const char* fname) const
 {
 	#ifdef MPI_ENABLED
-	if(MPI_File_open(MPI_COMM_WORLD, (char*)fname, MPI_MODE_APPEND|MPI_MODE_WRONLY|MPI_MODE_CREATE, MPI_INFO_NULL, &fp) != MPI_SUCCESS)
+	if(MPI_File_open(comm, (char*)fname, MPI_MODE_APPEND|MPI_MODE_WRONLY|MPI_MODE_CREATE, MPI_INFO_NULL, &fp) != MPI_SUCCESS)
 	#else
 	fp = ::fopen(fname, "a");
 	if(!fp)
 	#endif
 		 die("Error opening file '%s' for writing.\n", fname);
 	#ifdef MPI_ENABLED
-	MPI_Barrier(MPI_COMM_WORLD);
+	MPI_Barrier(comm);
 	#endif
 }
 
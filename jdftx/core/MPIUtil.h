@@ -39,17 +39,39 @@ along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
 class MPIUtil
 {
 	int nProcs, iProc;
+	int nProcsNode, iProcNode; //number of processes and rank within the current node (shared-memory domain)
+	std::vector<int> nodeOfProcess; //index of the node containing each process
+	bool ownsMPI; //whether this object initialized MPI (and hence should finalize it)
+	#ifdef MPI_ENABLED
+	MPI_Comm comm; //communicator for all processes of this object (MPI_COMM_WORLD, or a group created by splitting another MPIUtil)
+	MPI_Comm commNode; //communicator for processes on the current node
+	MPI_Comm commHeads; //communicator between the first process of each node (MPI_COMM_NULL on other processes)
+	#endif
+	void initComm(); //set process counts, ranks and node communicators from comm
 public:
 	int iProcess() const { return iProc; } //!< rank of current process
 	int nProcesses() const { return nProcs; }  //!< number of processes
 	bool isHead() const { return iProc==0; } //!< whether this is the root process (makes code more readable)
 
 	MPIUtil(int argc, char** argv);
+	MPIUtil(const MPIUtil& parent, int iGroup); //!< split parent into groups of processes with the same iGroup (collective on parent); process order within groups follows parent
 	~MPIUtil();
+	#ifdef MPI_ENABLED
+	MPI_Comm communicator() const { return comm; } //!< underlying communicator (for external libraries such as parallel HDF5)
+	#endif
 	void exit(int errCode) const; //!< global exit (kill other MPI processes as well)
 
 	void checkErrors(const ostringstream&) const; //!< collect error messages from all processes; if any, display them and quit
 	
+	//Node-local shared memory (MPI-3 shared windows; unavailable i.e. nProcessesNode()=1 otherwise):
+	int iProcessNode() const { return iProcNode; } //!< rank of current process within its node
+	int nProcessesNode() const { return nProcsNode; } //!< number of processes on the current node
+	bool isNodeHead() const { return iProcNode==0; } //!< whether this is the first process on its node
+	void barrierNode() const; //!< synchronize processes (and hence their view of shared memory) within the current node
+	void* allocShared(size_t nBytes, void*& window) const; //!< allocate nBytes of memory shared by all processes of the node (collective within node); returns null (and window=0) if unavailable
+	static void freeShared(void*& window); //!< free memory allocated by allocShared (collective within node); safe after the MPIUtil that allocated it is destroyed
+	void bcastShared(void* data, size_t nBytes, int root=0) const; //!< broadcast node-shared data written by process root to the other nodes (collective)
+	
 	//Point-to-point functions:
 	template<typename T> void send(const T* data, size_t nData, int dest, int tag) const; //!< generic array send
 	template<typename T> void recv(T* data, size_t nData, int src, int tag) const; //!< generic array receive
@@ -77,6 +99,20 @@ public:
 	void allReduce(bool* data, size_t nData, ReduceOp op, bool safeMode=false) const;  //!< specialization for bool which is not natively supported by MPI
 	template<typename T> void allReduce(T& data, int& index, ReduceOp op) const; //!< maximum / minimum with index location (MAXLOC / MINLOC modes); use op = ReduceMin or ReduceMax
 	
+	//Non-blocking collectives (MPI-3; blocking fallback otherwise): data must not be accessed till the request completes (see wait).
+	//As with blocking collectives, all processes must initiate these in the same order; results are identical to the blocking versions.
+	#ifdef MPI_ENABLED
+	typedef MPI_Request Request;
+	#else
+	typedef int Request;
+	#endif
+	template<typename T> void ibcast(T* data, size_t nData, Request& request, int root=0) const; //!< generic array non-blocking broadcast
+	void ibcast(complex* data, size_t nData, Request& request, int root=0) const; //!< specialization for complex which is not natively supported by MPI
+	template<typename T> void iallReduce(T* data, size_t nData, ReduceOp op, Request& request) const; //!< generic array non-blocking reduction
+	void iallReduce(complex* data, size_t nData, ReduceOp op, Request& request) const; //!< specialization for complex which is not natively supported by MPI
+	void wait(Request& request) const; //!< wait for a non-blocking operation to complete
+	void waitAll(std::vector<Request>& requests) const; //!< wait for several non-blocking operations to complete
+	
 	//File access (tiny subset of MPI-IO, using byte offsets alone, and made to closely resemble stdio):
 	#ifdef MPI_ENABLED
 	typedef MPI_File File;
@@ -172,14 +208,14 @@ namespace MPIUtilPrivate
 template<typename T> void MPIUtil::send(const T* data, size_t nData, int dest, int tag) const
 {	using namespace MPIUtilPrivate;
 	#ifdef MPI_ENABLED
-	if(nProcs>1) MPI_Send((T*)data, nData, DataType<T>::get(), dest, tag, MPI_COMM_WORLD);
+	if(nProcs>1) MPI_Send((T*)data, nData, DataType<T>::get(), dest, tag, comm);
 	#endif
 }
 
 template<typename T> void MPIUtil::recv(T* data, size_t nData, int src, int tag) const
 {	using namespace MPIUtilPrivate;
 	#ifdef MPI_ENABLED
-	if(nProcs>1) MPI_Recv(data, nData, DataType<T>::get(), src, tag, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+	if(nProcs>1) MPI_Recv(data, nData, DataType<T>::get(), src, tag, comm, MPI_STATUS_IGNORE);
 	#endif
 }
 
@@ -194,7 +230,7 @@ template<typename T> void MPIUtil::recv(T& data, int src, int tag) const
 template<typename T> void MPIUtil::bcast(T* data, size_t nData, int root) const
 {	using namespace MPIUtilPrivate;
 	#ifdef MPI_ENABLED
-	if(nProcs>1) MPI_Bcast(data, nData, DataType<T>::get(), root, MPI_COMM_WORLD);
+	if(nProcs>1) MPI_Bcast(data, nData, DataType<T>::get(), root, comm);
 	#endif
 }
 
@@ -207,11 +243,11 @@ template<typename T> void MPIUtil::allReduce(T* data, size_t nData, MPIUtil::Red
 	#ifdef MPI_ENABLED
 	if(nProcs>1)
 	{	if(safeMode) //Reduce to root node and then broadcast result (to ensure identical values)
-		{	MPI_Reduce(isHead()?MPI_IN_PLACE:data, data, nData, DataType<T>::get(), mpiOp(op), 0, MPI_COMM_WORLD);
+		{	MPI_Reduce(isHead()?MPI_IN_PLACE:data, data, nData, DataType<T>::get(), mpiOp(op), 0, comm);
 			bcast(data, nData, 0);
 		}
 		else //standard Allreduce
-			MPI_Allreduce(MPI_IN_PLACE, data, nData, DataType<T>::get(), mpiOp(op), MPI_COMM_WORLD);
+			MPI_Allreduce(MPI_IN_PLACE, data, nData, DataType<T>::get(), mpiOp(op), comm);
 	}
 	#endif
 }
@@ -226,11 +262,45 @@ template<typename T> void MPIUtil::allReduce(T& data, int& index, MPIUtil::Reduc
 	if(nProcs>1)
 	{	struct Pair { T data; int index; } pair;
 		pair.data = data; pair.index = index;
-		MPI_Allreduce(MPI_IN_PLACE, &pair, 1, DataTypeIntPair<T>::get(), mpiLocOp(op), MPI_COMM_WORLD);
+		MPI_Allreduce(MPI_IN_PLACE, &pair, 1, DataTypeIntPair<T>::get(), mpiLocOp(op), comm);
 		data = pair.data; index = pair.index;
 	}
 	#endif
 }
 
+template<typename T> void MPIUtil::ibcast(T* data, size_t nData, Request& request, int root) const
+{	using namespace MPIUtilPrivate;
+	#ifdef MPI_ENABLED
+	request = MPI_REQUEST_NULL;
+	if(nProcs>1)
+	{
+		#if MPI_VERSION >= 3
+		MPI_Ibcast(data, nData, DataType<T>::get(), root, comm, &request);
+		#else
+		bcast(data, nData, root);
+		#endif
+	}
+	#else
+	request = 0;
+	#endif
+}
+
+template<typename T> void MPIUtil::iallReduce(T* data, size_t nData, MPIUtil::ReduceOp op, Request& request) const
+{	using namespace MPIUtilPrivate;
+	#ifdef MPI_ENABLED
+	request = MPI_REQUEST_NULL;
+	if(nProcs>1)
+	{
+		#if MPI_VERSION >= 3
+		MPI_Iallreduce(MPI_IN_PLACE, data, nData, DataType<T>::get(), mpiOp(op), comm, &request);
+		#else
+		allReduce(data, nData, op);
+		#endif
+	}
+	#else
+	request = 0;
+	#endif
+}
+
 //!@endcond
 #endif // JDFTX_CORE_MPIUTIL_H
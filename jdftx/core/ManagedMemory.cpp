@@ -266,6 +266,16 @@ void ManagedMemoryBase::reportUsage()
 //Free memory
 void ManagedMemoryBase::memFree()
 {	if(!nBytes) return; //nothing to free
+	if(shmWindow)
+	{	//Note: mpiUtil may no longer exist here for objects destroyed after finalizeSystem()
+		if(shmNodeHead) MemUsageReport::manager(MemUsageReport::Remove, category, nBytes);
+		MPIUtil::freeShared(shmWindow);
+		shmNodeHead = false;
+		c = 0;
+		nBytes = 0;
+		category.clear();
+		return;
+	}
 	if(onGpu)
 	{
 		#ifdef GPU_ENABLED
@@ -283,7 +293,7 @@ void ManagedMemoryBase::memFree()
 
 //Allocate memory
 void ManagedMemoryBase::memInit(string category, size_t nBytes, bool onGpu)
-{	if(category==this->category && nBytes==this->nBytes && onGpu==this->onGpu) return; //already in required state
+{	if(category==this->category && nBytes==this->nBytes && onGpu==this->onGpu && !shmWindow) return; //already in required state
 	memFree();
 	this->category = category;
 	this->nBytes = nBytes;
@@ -300,11 +310,42 @@ void ManagedMemoryBase::memInit(string category, size_t nBytes, bool onGpu)
 	MemUsageReport::manager(MemUsageReport::Add, category, nBytes);
 }
 
+bool ManagedMemoryBase::canShare()
+{
+	#ifdef GPU_ENABLED
+	return false; //data could move to the GPU at any point
+	#else
+	return mpiUtil->nProcessesNode() > 1;
+	#endif
+}
+
+void ManagedMemoryBase::memInitShared(string category, size_t nBytes)
+{	if(!(canShare() && nBytes)) { memInit(category, nBytes); return; } //fall back to private memory
+	memFree();
+	this->category = category;
+	this->nBytes = nBytes;
+	this->onGpu = false;
+	c = mpiUtil->allocShared(nBytes, shmWindow);
+	shmNodeHead = mpiUtil->isNodeHead();
+	if(shmNodeHead) MemUsageReport::manager(MemUsageReport::Add, category, nBytes); //count once per node
+}
+
+void ManagedMemoryBase::memShare()
+{	if(shmWindow || !canShare()) return; //already shared, or not possible
+	toCpu();
+	ManagedMemoryBase priv; priv.memMove((ManagedMemoryBase&&)(*this)); //steal private data
+	memInitShared(priv.category, priv.nBytes);
+	if(mpiUtil->isNodeHead() && nBytes) memcpy(c, priv.c, nBytes);
+	mpiUtil->barrierNode();
+}
+
 void ManagedMemoryBase::memMove(ManagedMemoryBase&& mOther)
 {	std::swap(category, mOther.category);
 	std::swap(nBytes, mOther.nBytes);
 	std::swap(onGpu, mOther.onGpu);
 	std::swap(c, mOther.c);
+	std::swap(shmWindow, mOther.shmWindow);
+	std::swap(shmNodeHead, mOther.shmNodeHead);
 	//Now mOther will be empty, while *this will have all its contents
 }
 
@@ -327,6 +368,7 @@ void ManagedMemoryBase::toGpu() const
 {	if(onGpu || !c) return; //already on gpu, or no data
 #ifdef GPU_ENABLED
 	assert(isGpuMine());
+	assert(!shmWindow); //never shared in GPU builds
 	ManagedMemoryBase& me = *((ManagedMemoryBase*)this);
 	void* cGpu = MemPool::GPU().alloc(nBytes);
 	cudaMemcpy(cGpu, me.c, nBytes, cudaMemcpyHostToDevice);
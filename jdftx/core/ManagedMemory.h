@@ -36,17 +36,27 @@ public:
 	static void reportUsage(); //!< print memory usage report
 
 protected:
-	ManagedMemoryBase(): nBytes(0),c(0),onGpu(false) {} //!< Initialize a valid state, but don't allocate anything
+	ManagedMemoryBase(): nBytes(0),c(0),onGpu(false),shmWindow(0),shmNodeHead(false) {} //!< Initialize a valid state, but don't allocate anything
 	~ManagedMemoryBase() { memFree(); }
 
 	void memFree(); //!< Free memory
 	void memInit(string category, size_t nBytes, bool onGpu=false); //!< Allocate memory
 	void memMove(ManagedMemoryBase&&); //!< Steal the other object's data (used for move constructors/assignment)
+	
+	//! Allocate memory shared by all processes on a node, falling back to memInit when unavailable (see MPIUtil::allocShared).
+	//! This is collective over all processes, as is the eventual memFree, so use only for objects created and destroyed
+	//! identically on all processes. The data must be written only by one process, followed by MPIUtil::barrierNode(),
+	//! and is read-only thereafter. Node-shared memory is never used in GPU builds.
+	void memInitShared(string category, size_t nBytes);
+	void memShare(); //!< Move current data (identical on all processes) to node-shared memory, if available (collective)
+	static bool canShare(); //!< whether node-shared memory is available
 
 	string category; //!< category of managed memory objects to report memory usage under
 	size_t nBytes; //!< Size of stored data
 	void* c; //!< Actual data storage
 	bool onGpu; //!< For reduced #ifdef's, this flag is retained even in the absence of gpu support
+	void* shmWindow; //!< MPI window handle if data is in node-shared memory (null otherwise)
+	bool shmNodeHead; //!< whether this process owns (and accounts for) the node-shared memory, recorded so that memFree need not access mpiUtil
 	void toCpu() const; //!< move data to the CPU (does nothing without GPU_ENABLED); logically const, but data location may change
 	void toGpu() const; //!< move data to the GPU (does nothing without GPU_ENABLED); logically const, but data location may change
 };
@@ -61,6 +71,7 @@ protected:
 	void memFree(); //!< Free memory
 	void memInit(string category, size_t nElem, bool onGpu=false); //!< Allocate memory
 	void memMove(ManagedMemory<T>&&); //!< Steal the other object's data (used for move constructors/assignment)
+	void memInitShared(string category, size_t nElem); //!< Allocate node-shared memory (see ManagedMemoryBase::memInitShared)
 
 private:
 	size_t nElem;
@@ -87,6 +98,8 @@ public:
 
 	size_t nData() const { return nElem; } //!< number of data points
 	bool isOnGpu() const { return onGpu; } //!< Check where the data is (for #ifdef simplicity exposed even when no GPU_ENABLED)
+	bool isShared() const { return shmWindow; } //!< Check whether data is in node-shared (read-only) memory
+	void share() { memShare(); } //!< Move data (which must be identical on all processes) to read-only node-shared memory, if available (collective)
 
 	//Iterator access on CPU:
 	T* begin() { return data(); } //!< pointer to start of array
@@ -109,8 +122,10 @@ public:
 	//Inter-process communication:
 	void send(int dest, int tag=0) const; //!< send to another process
 	void recv(int src, int tag=0); //!< receive from another process
-	void bcast(int root=0); //!< synchronize across processes (using value on specified root process)
+	void bcast(int root=0); //!< synchronize across processes (using value on specified root process; only between nodes if isShared())
 	void allReduce(MPIUtil::ReduceOp op, bool safeMode=false); //!< apply all-to-all reduction (see MPIUtil::allReduce)
+	void ibcast(MPIUtil::Request& request, int root=0); //!< non-blocking version of bcast (not for node-shared data); see MPIUtil::ibcast
+	void iallReduce(MPIUtil::ReduceOp op, MPIUtil::Request& request); //!< non-blocking version of allReduce (not in safe mode); see MPIUtil::iallReduce
 
 	void read(const char *fname); //!< binary read from a file
 	void read(FILE *filep); //!< binary read from a stream
@@ -129,6 +144,7 @@ public:
 //! ManagedMemory and implement operators; do not use this wrapper.
 template<typename T> struct ManagedArray : public ManagedMemory<T>
 {	void init(size_t size, bool onGpu=false); //!< calls memInit with category "misc"
+	void initShared(size_t size); //!< calls memInitShared with category "misc"
 	ManagedArray(const T* ptr=0, size_t N=0); //!< optionally initialize N elements from a pointer
 	ManagedArray(const std::vector<T>&); //!< initialize from an std::vector
 	ManagedArray& operator=(const ManagedArray&); //!< copy-assignment
@@ -178,6 +194,11 @@ template<typename T> void ManagedMemory<T>::memMove(ManagedMemory<T>&& mOther)
 	std::swap(nElem, mOther.nElem);
 }
 
+template<typename T> void ManagedMemory<T>::memInitShared(string category, size_t nElem)
+{	this->nElem = nElem;
+	ManagedMemoryBase::memInitShared(category, nElem*sizeof(T));
+}
+
 template<typename T> void ManagedMemory<T>::read(const char *fname)
 {	intptr_t fsizeExpected = nData() * sizeof(T);
 	intptr_t fsize = fileSize(fname);
@@ -274,12 +295,23 @@ template<typename T> void ManagedMemory<T>::recv(int src, int tag)
 }
 template<typename T> void ManagedMemory<T>::bcast(int root)
 {	if(mpiUtil->nProcesses()>1)
-		mpiUtil->bcast(data(), nData(), root); //bcast fails from GPU pointers as of OpenMPI 2.1.1 (Needs extensive MPI testing)
+	{	if(isShared()) mpiUtil->bcastShared(c, nBytes, root); //only one copy per node
+		else mpiUtil->bcast(data(), nData(), root); //bcast fails from GPU pointers as of OpenMPI 2.1.1 (Needs extensive MPI testing)
+	}
 }
 template<typename T> void ManagedMemory<T>::allReduce(MPIUtil::ReduceOp op, bool safeMode)
 {	if(mpiUtil->nProcesses()>1)
 		mpiUtil->allReduce(dataMPI(), nData(), op, safeMode);
 }
+template<typename T> void ManagedMemory<T>::ibcast(MPIUtil::Request& request, int root)
+{	assert(!isShared());
+	T* dataPtr = (mpiUtil->nProcesses()>1) ? data() : 0; //avoid moving data when there is nothing to communicate
+	mpiUtil->ibcast(dataPtr, nData(), request, root);
+}
+template<typename T> void ManagedMemory<T>::iallReduce(MPIUtil::ReduceOp op, MPIUtil::Request& request)
+{	T* dataPtr = (mpiUtil->nProcesses()>1) ? dataMPI() : 0; //avoid moving data when there is nothing to communicate
+	mpiUtil->iallReduce(dataPtr, nData(), op, request);
+}
 #undef dataMPI
 
 template<typename T> void memcpy(ManagedMemory<T>& a, const ManagedMemory<T>& b)
@@ -293,6 +325,10 @@ template<typename T> void ManagedArray<T>::init(size_t size, bool onGpu)
 {	ManagedMemory<T>::memInit("misc", size, onGpu);
 }
 
+template<typename T> void ManagedArray<T>::initShared(size_t size)
+{	ManagedMemory<T>::memInitShared("misc", size);
+}
+
 template<typename T> ManagedArray<T>::ManagedArray(const T* ptr, size_t N)
 {	if(ptr && N)
 	{	init(N);
@@ -57,6 +57,8 @@ template<typename Vector> struct Minimizable
 	virtual bool report(int iter) { return false; }
 	
 	//! Constrain search directions to the space of free directions for minimize.
+	//! The direction passed to step() is always the one passed to the latest constrain(), unmodified since
+	//! (implementations may therefore cache quantities that depend on the direction here, for use in step()).
 	virtual void constrain(Vector&) {}
 	
 	//! Override to synchronize scalars over MPI processes (if the same minimization is happening in sync over many processes)
@@ -268,6 +270,7 @@ template<typename Vector> void Minimizable<Vector>::fdTest(const MinimizeParams&
 		randomize(dx);
 		constrain(dx);
 		dx *= p.alphaTstart * sqrt(sync(dot(Kg,Kg))/sync(dot(dx,dx)));
+		constrain(dx); //no-op on the direction, but keeps constrain() the last modification before step()
 	}
 	double dE_ddelta = sync(dot(dx, g)); //directional derivative at delta=0
 
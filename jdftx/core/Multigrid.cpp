@@ -0,0 +1,224 @@
+/*-------------------------------------------------------------------
+Copyright 2017 Ravishankar Sundararaman
+
+This file is part of JDFTx.
+
+JDFTx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+JDFTx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
+-------------------------------------------------------------------*/
+
+#include <core/Multigrid.h>
+#include <core/GridInfo.h>
+#include <core/Thread.h>
+#include <core/Util.h>
+#include <cmath>
+
+//Index into a level's grid, and periodic wrapping of grid coordinates:
+inline size_t levelIndex(const vector3<int>& S, int i0, int i1, int i2)
+{	return i2 + S[2]*size_t(i1 + S[1]*i0);
+}
+inline int wrap(int i, int S) { return i<0 ? i+S : (i>=S ? i-S : i); }
+
+//Loop over all points of a level in the plane range [i0start,i0stop), with neighbour indices along each direction:
+#define LEVEL_LOOP(...) \
+	const vector3<int>& S = level->S; \
+	for(int i0=int(i0start); i0<int(i0stop); i0++) \
+	for(int i1=0; i1<S[1]; i1++) \
+	for(int i2=0; i2<S[2]; i2++) \
+	{	size_t i = levelIndex(S, i0, i1, i2); \
+		size_t iPlus[3] = { levelIndex(S, wrap(i0+1,S[0]), i1, i2), levelIndex(S, i0, wrap(i1+1,S[1]), i2), levelIndex(S, i0, i1, wrap(i2+1,S[2])) }; \
+		size_t iMinus[3] = { levelIndex(S, wrap(i0-1,S[0]), i1, i2), levelIndex(S, i0, wrap(i1-1,S[1]), i2), levelIndex(S, i0, i1, wrap(i2-1,S[2])) }; \
+		__VA_ARGS__ \
+	}
+
+//Operator application A x (without the 1/4pi, which is included in diagInv and residual scale factors):
+inline double applyOperator(const Multigrid::Level* level, const double* x, size_t i, const size_t* iPlus, const size_t* iMinus)
+{	double result = level->kappaSq.size() ? level->kappaSq[i] * x[i] : 0.;
+	for(int k=0; k<3; k++)
+		result += level->c[k] * (level->epsFace[k][i] * (x[i] - x[iPlus[k]]) + level->epsFace[k][iMinus[k]] * (x[i] - x[iMinus[k]]));
+	return result * (1./(4*M_PI));
+}
+
+//Set face coefficients and inverse diagonal of a level:
+void setupLevel_sub(size_t i0start, size_t i0stop, Multigrid::Level* level)
+{	LEVEL_LOOP(
+		double diag = level->kappaSq.size() ? level->kappaSq[i] : 0.;
+		for(int k=0; k<3; k++)
+		{	double eps = level->epsilon[i], epsPlus = level->epsilon[iPlus[k]];
+			level->epsFace[k][i] = 2.*eps*epsPlus / (eps + epsPlus);
+		}
+		for(int k=0; k<3; k++)
+		{	double epsMinus = level->epsilon[iMinus[k]], eps = level->epsilon[i];
+			diag += level->c[k] * (level->epsFace[k][i] + 2.*eps*epsMinus/(eps + epsMinus));
+		}
+		level->diagInv[i] = diag ? 4*M_PI/diag : 0.;
+	)
+}
+
+//Damped Jacobi sweep: xOut = x + omega Dinv (b - A x)
+void jacobi_sub(size_t i0start, size_t i0stop, const Multigrid::Level* level, double omega,
+	const double* b, const double* x, double* xOut)
+{	LEVEL_LOOP( xOut[i] = x[i] + omega * level->diagInv[i] * (b[i] - applyOperator(level, x, i, iPlus, iMinus)); )
+}
+
+//Residual r = b - A x
+void residual_sub(size_t i0start, size_t i0stop, const Multigrid::Level* level,
+	const double* b, const double* x, double* r)
+{	LEVEL_LOOP( r[i] = b[i] - applyOperator(level, x, i, iPlus, iMinus); )
+}
+
+//1D restriction / prolongation weights for offset d in {-1,0,1} and coarsening ratio:
+inline double restrictWeight(int d, int ratio)
+{	if(ratio==1) return d ? 0. : 1.;
+	return d ? 0.25 : 0.5;
+}
+
+//Full-weighting restriction from fine to coarse (threaded over coarse planes):
+void restrict_sub(size_t i0start, size_t i0stop, const Multigrid::Level* fine, const Multigrid::Level* coarse,
+	const double* in, double* out)
+{	const vector3<int>& Sc = coarse->S;
+	const vector3<int>& Sf = fine->S;
+	const vector3<int>& ratio = fine->ratio;
+	for(int j0=int(i0start); j0<int(i0stop); j0++)
+	for(int j1=0; j1<Sc[1]; j1++)
+	for(int j2=0; j2<Sc[2]; j2++)
+	{	double result = 0.;
+		for(int d0=-1; d0<=1; d0++) { double w0 = restrictWeight(d0, ratio[0]); if(!w0) continue;
+		for(int d1=-1; d1<=1; d1++) { double w1 = restrictWeight(d1, ratio[1]); if(!w1) continue;
+		for(int d2=-1; d2<=1; d2++) { double w2 = restrictWeight(d2, ratio[2]); if(!w2) continue;
+			result += w0*w1*w2 * in[levelIndex(Sf, wrap(j0*ratio[0]+d0,Sf[0]), wrap(j1*ratio[1]+d1,Sf[1]), wrap(j2*ratio[2]+d2,Sf[2]))];
+		}}}
+		out[levelIndex(Sc, j0, j1, j2)] = result;
+	}
+}
+
+//Trilinear prolongation from coarse and accumulate to fine (threaded over fine planes):
+void prolongAccum_sub(size_t i0start, size_t i0stop, const Multigrid::Level* fine, const Multigrid::Level* coarse,
+	const double* in, double* out)
+{	const vector3<int>& Sc = coarse->S;
+	const vector3<int>& Sf = fine->S;
+	const vector3<int>& ratio = fine->ratio;
+	for(int i0=int(i0start); i0<int(i0stop); i0++)
+	for(int i1=0; i1<Sf[1]; i1++)
+	for(int i2=0; i2<Sf[2]; i2++)
+	{	vector3<int> iFine(i0, i1, i2);
+		//Coarse points and weights along each direction:
+		int j[3][2]; double w[3][2]; int nj[3];
+		for(int k=0; k<3; k++)
+		{	if(ratio[k]==1 || iFine[k]%2==0)
+			{	j[k][0] = iFine[k]/ratio[k]; w[k][0] = 1.; nj[k] = 1;
+			}
+			else
+			{	j[k][0] = iFine[k]/2; j[k][1] = wrap(iFine[k]/2+1, Sc[k]);
+				w[k][0] = w[k][1] = 0.5; nj[k] = 2;
+			}
+		}
+		double result = 0.;
+		for(int a0=0; a0<nj[0]; a0++)
+		for(int a1=0; a1<nj[1]; a1++)
+		for(int a2=0; a2<nj[2]; a2++)
+			result += w[0][a0]*w[1][a1]*w[2][a2] * in[levelIndex(Sc, j[0][a0], j[1][a1], j[2][a2])];
+		out[levelIndex(Sf, i0, i1, i2)] += result;
+	}
+}
+
+
+Multigrid::Multigrid(const GridInfo& gInfo) : nSmooth(2), nCoarseSweeps(32), omega(0.8), gInfo(gInfo), screened(false)
+{	//Construct hierarchy of grid dimensions:
+	Level level;
+	level.S = gInfo.S;
+	for(int k=0; k<3; k++)
+		level.c[k] = gInfo.GGT(k,k) * std::pow(gInfo.S[k]/(2*M_PI), 2);
+	while(true)
+	{	level.nr = level.S[0] * size_t(level.S[1]) * level.S[2];
+		bool coarsen = false;
+		for(int k=0; k<3; k++)
+		{	level.ratio[k] = (level.S[k]%2==0 && level.S[k]>=4) ? 2 : 1;
+			if(level.ratio[k]==2) coarsen = true;
+		}
+		if(level.nr <= 64) coarsen = false;
+		if(!coarsen) level.ratio = vector3<int>(1,1,1);
+		levels.push_back(level);
+		if(!coarsen) break;
+		//Next level:
+		for(int k=0; k<3; k++)
+		{	level.S[k] /= level.ratio[k];
+			level.c[k] /= std::pow(level.ratio[k], 2);
+		}
+	}
+	logPrintf("Initialized multigrid with %d levels (coarsest grid: %d x %d x %d).\n",
+		int(levels.size()), levels.back().S[0], levels.back().S[1], levels.back().S[2]);
+}
+
+void Multigrid::setCoefficients(const ScalarField& epsilon, const ScalarField& kappaSq)
+{	screened = bool(kappaSq);
+	for(size_t iLevel=0; iLevel<levels.size(); iLevel++)
+	{	Level& level = levels[iLevel];
+		level.epsilon.resize(level.nr);
+		if(screened) level.kappaSq.resize(level.nr); else level.kappaSq.clear();
+		if(iLevel==0)
+		{	eblas_copy(level.epsilon.data(), epsilon->data(), level.nr);
+			if(screened) eblas_copy(level.kappaSq.data(), kappaSq->data(), level.nr);
+		}
+		else
+		{	const Level& fine = levels[iLevel-1];
+			threadLaunch(restrict_sub, level.S[0], &fine, &level, fine.epsilon.data(), level.epsilon.data());
+			if(screened) threadLaunch(restrict_sub, level.S[0], &fine, &level, fine.kappaSq.data(), level.kappaSq.data());
+		}
+		for(int k=0; k<3; k++) level.epsFace[k].resize(level.nr);
+		level.diagInv.resize(level.nr);
+		threadLaunch(setupLevel_sub, level.S[0], &level);
+	}
+}
+
+void Multigrid::vCycle(int iLevel, const std::vector<double>& b, std::vector<double>& x) const
+{	const Level& level = levels[iLevel];
+	std::vector<double> xTmp(level.nr);
+	x.assign(level.nr, 0.);
+	bool coarsest = (iLevel+1 == int(levels.size()));
+	//Pre-smoothing (or coarse-level solve):
+	for(int iSweep=0; iSweep<(coarsest ? nCoarseSweeps : nSmooth); iSweep++)
+	{	threadLaunch(jacobi_sub, level.S[0], &level, omega, b.data(), x.data(), xTmp.data());
+		std::swap(x, xTmp);
+	}
+	if(coarsest) return;
+	//Coarse-grid correction:
+	const Level& coarse = levels[iLevel+1];
+	std::vector<double>& r = xTmp; //reuse memory
+	threadLaunch(residual_sub, level.S[0], &level, b.data(), x.data(), r.data());
+	std::vector<double> bCoarse(coarse.nr), xCoarse;
+	threadLaunch(restrict_sub, coarse.S[0], &level, &coarse, r.data(), bCoarse.data());
+	vCycle(iLevel+1, bCoarse, xCoarse);
+	threadLaunch(prolongAccum_sub, level.S[0], &level, &coarse, xCoarse.data(), x.data());
+	//Post-smoothing:
+	for(int iSweep=0; iSweep<nSmooth; iSweep++)
+	{	threadLaunch(jacobi_sub, level.S[0], &level, omega, b.data(), x.data(), xTmp.data());
+		std::swap(x, xTmp);
+	}
+}
+
+ScalarField Multigrid::solve(const ScalarField& rho) const
+{	const Level& level = levels[0];
+	std::vector<double> b(rho->data(), rho->data()+level.nr), x;
+	if(!screened) //project out null space
+	{	double bMean = 0.; for(double bi: b) bMean += bi; bMean /= level.nr;
+		for(double& bi: b) bi -= bMean;
+	}
+	vCycle(0, b, x);
+	ScalarField phi(ScalarFieldData::alloc(gInfo));
+	double xMean = 0.;
+	if(!screened) { for(double xi: x) xMean += xi; xMean /= level.nr; }
+	double* phiData = phi->data();
+	for(size_t i=0; i<level.nr; i++) phiData[i] = x[i] - xMean;
+	return phi;
+}
@@ -0,0 +1,77 @@
+/*-------------------------------------------------------------------
+Copyright 2017 Ravishankar Sundararaman
+
+This file is part of JDFTx.
+
+JDFTx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+JDFTx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
+-------------------------------------------------------------------*/
+
+#ifndef JDFTX_CORE_MULTIGRID_H
+#define JDFTX_CORE_MULTIGRID_H
+
+#include <core/Operators.h>
+#include <vector>
+
+//! @addtogroup Algorithms
+//! @{
+//! @file Multigrid.h Geometric multigrid for variable-coefficient Poisson-Boltzmann operators
+
+//! Geometric multigrid V-cycle for A phi = -(1/4pi) [div(epsilon grad phi) - kappaSq phi]
+//! on the real-space mesh of a GridInfo. The operator is discretized by finite differences
+//! along the lattice directions (neglecting off-diagonal metric terms for non-orthogonal lattices)
+//! with harmonic-mean face coefficients, so that the Jacobi smoother follows sharp cavity
+//! shape functions. Grids are coarsened by two along each direction with even sample count
+//! (semi-coarsening otherwise), using full-weighting restriction and trilinear prolongation.
+//! A symmetric V-cycle is a symmetric positive (semi-)definite approximate inverse, and is
+//! therefore suitable as a conjugate-gradients preconditioner with grid-independent convergence.
+class Multigrid
+{
+public:
+	Multigrid(const GridInfo& gInfo);
+	
+	//! Set the coefficient fields of the operator (kappaSq may be null for no screening)
+	void setCoefficients(const ScalarField& epsilon, const ScalarField& kappaSq);
+	
+	//! Approximately solve A phi = rho using a single V-cycle (starting from phi = 0).
+	//! Without screening, the G=0 component of rho and of the result is projected out.
+	ScalarField solve(const ScalarField& rho) const;
+	
+	//! Preconditioner for linear solves of the corresponding reciprocal-space hessian
+	ScalarFieldTilde precondition(const ScalarFieldTilde& rTilde) const { return J(solve(I(rTilde))); }
+	
+	int nSmooth; //!< number of pre- and post-smoothing Jacobi sweeps on each level
+	int nCoarseSweeps; //!< number of Jacobi sweeps on the coarsest level
+	double omega; //!< Jacobi damping factor
+
+	//! One level of the multigrid hierarchy
+	struct Level
+	{	vector3<int> S; //!< sample counts
+		size_t nr; //!< total number of samples
+		vector3<> c; //!< inverse squared sample spacing along each lattice direction
+		vector3<int> ratio; //!< coarsening ratio (1 or 2) along each direction to the next level
+		std::vector<double> epsilon; //!< epsilon at grid points (used to construct the next level)
+		std::vector<double> epsFace[3]; //!< harmonic-mean epsilon on the face between i and i + e_k
+		std::vector<double> kappaSq; //!< screening coefficient (empty if none)
+		std::vector<double> diagInv; //!< inverse diagonal of the discretized operator
+	};
+private:
+	const GridInfo& gInfo;
+	std::vector<Level> levels;
+	bool screened; //!< whether kappaSq is present (otherwise operator has a constant null space)
+	
+	void vCycle(int iLevel, const std::vector<double>& b, std::vector<double>& x) const;
+};
+
+//! @}
+#endif //JDFTX_CORE_MULTIGRID_H
@@ -21,6 +21,9 @@ along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
 #include <core/SphericalHarmonics.h>
 #include <core/GpuUtil.h>
 #include <core/Thread.h>
+#include <gsl/gsl_sf_gamma.h>
+#include <fftw3.h>
+#include <core/GridInfo.h>
 
 RadialFunctionG::RadialFunctionG() : dGinv(0), nCoeff(0),
 #ifdef GPU_ENABLED
@@ -61,7 +64,13 @@ void RadialFunctionG::set(const std::vector<double>& coeff, double dGinv)
 void RadialFunctionG::updateGmax(int l, int nSamples)
 {	if(!rFunc) return; //don't have the information necessary to update
 	if(nSamples+4 <= nCoeff) return; //already have enough samples
-	rFunc->transform(l, 1./dGinv, nSamples, *this);
+	//Compute only the additional samples (with some headroom to avoid repeating this for small lattice changes):
+	int nOld = samples.size();
+	int nNew = nSamples + nSamples/8;
+	samples.resize(nNew);
+	rFunc->transformSamples(l, 1./dGinv, nOld, nNew, samples.data()+nOld);
+	free(false);
+	init(l, samples, 1./dGinv);
 }
 
 void RadialFunctionG::free(bool rFuncDelete)
@@ -158,19 +167,127 @@ double RadialFunctionR::transform(int l, double G) const
 	return (4*M_PI/3) * sum;
 }
 
-static void RadialFunction_transform_sub(int iGstart, int iGstop, int l, double dG, const RadialFunctionR* rFunc, double* fTilde)
-{	for(int iG=iGstart; iG<iGstop; iG++)
-		fTilde[iG] = rFunc->transform(l, iG*dG);
+static void RadialFunction_transform_sub(int iStart, int iStop, int l, double dG, int iGstart, const RadialFunctionR* rFunc, double* fTilde)
+{	for(int i=iStart; i<iStop; i++)
+		fTilde[i] = rFunc->transform(l, (iGstart+i)*dG);
+}
+
+bool RadialFunctionR::isLogGrid(double& dlogr) const
+{	int nSamples = r.size();
+	if(nSamples<3 || r[0]<=0. || r[1]<=r[0]) return false;
+	dlogr = log(r[nSamples-1]/r[0]) / (nSamples-1);
+	for(int i=1; i<nSamples; i++)
+		if(fabs(log(r[i]/r[0]) - i*dlogr) > 1e-7)
+			return false;
+	return true;
+}
+
+double RadialFunctionR::transformTol = 1e-7;
+
+//In-place backward (exp(+i...)) complex FFT of length N
+static void fftBackward(std::vector<complex>& data)
+{	GridInfo::planLock.lock(); //FFTW planner is not thread-safe (transforms may be launched from threads)
+	fftw_plan plan = fftw_plan_dft_1d(data.size(), (fftw_complex*)data.data(), (fftw_complex*)data.data(), FFTW_BACKWARD, FFTW_ESTIMATE);
+	GridInfo::planLock.unlock();
+	fftw_execute(plan);
+	GridInfo::planLock.lock();
+	fftw_destroy_plan(plan);
+	GridInfo::planLock.unlock();
+}
+
+//Fast spherical Bessel transform on a logarithmic grid (J. D. Talman, Comput. Phys. Commun. 180, 332 (2009)).
+//For the quadrature fTilde(G) = sum_i W_i f_i j_l(G r_i) of RadialFunctionR::transform (Simpson weights W_i including dr_i r_i^2),
+//with rho = log(r) and kappa = log(G), G^(3/2) fTilde(G) = sum_i F_i K(kappa + rho_i), where F_i = W_i r_i^(-3/2) f_i
+//and K(x) = exp(3x/2) j_l(exp(x)); this correlation is evaluated with FFTs using the analytic Fourier transform of K,
+//on a log(G) grid oversampled to resolve the uniform G grid, followed by cubic interpolation.
+//Computes iGstart <= iG < iGstop excluding G=0, and returns false if more expensive than direct summation.
+static bool transformLogGrid(const RadialFunctionR& rFunc, int l, double dlogr, double dG, int iGstart, int iGstop, double* fTilde)
+{	int iGmin = std::max(iGstart, 1);
+	if(iGmin >= iGstop) return false;
+	const std::vector<double>& r = rFunc.r;
+	const std::vector<double>& f = rFunc.f;
+	int nSamples = r.size();
+	
+	//Determine transform sizes:
+	double kappaMin = log(iGmin*dG) - dlogr; //start of output log(G) grid (margin for interpolation)
+	double kappaRange = log(double(iGstop)/iGmin) + 3*dlogr;
+	int N = 1; while(N < 2*nSamples + int(ceil(kappaRange/dlogr))) N *= 2; //zero-padded length (avoids wrap-around)
+	int p = 1; while(p < iGstop*dlogr) p *= 2; //oversampling in log(G) so that sample spacing <= dG at Gmax
+	int pN = p*N;
+	if(pN > (1<<24)) return false; //excessive memory
+	if(double(iGstop-iGmin)*nSamples < pN*log2(double(pN))) return false; //direct summation is cheaper
+	
+	//Transform of weighted input:
+	std::vector<complex> Fhat(N, 0.);
+	int Nhlf = (nSamples-1)/2; //same Simpson's rule as RadialFunctionR::transform (trailing sample unused if nSamples is even)
+	for(int i=0; i<=2*Nhlf; i++)
+	{	double W = (4*M_PI/3) * (rFunc.dr[i] * r[i]*r[i]) * ( (i==0 || i==2*Nhlf) ? 1 : 2*((i%2)+1) );
+		Fhat[i] = W * pow(r[i],-1.5) * f[i];
+	}
+	fftBackward(Fhat);
+	
+	//Multiply by transform of kernel and invert on oversampled output grid:
+	std::vector<complex> Gkappa(pN, 0.);
+	double phaseOffset = log(r[0]) + kappaMin;
+	double a = 0.5*(l+1.5);
+	for(int n=1-N/2; n<N/2; n++)
+	{	double t = (2*M_PI/(N*dlogr)) * n;
+		gsl_sf_result lnGammaAbs, lnGammaArg;
+		gsl_sf_lngamma_complex_e(a, 0.5*t, &lnGammaAbs, &lnGammaArg);
+		complex Kt = sqrt(0.5*M_PI) * cis(-(t*log(2.) + 2*lnGammaArg.val)); //int dx K(x) exp(-itx), which has constant magnitude
+		Gkappa[(n+pN)%pN] = (1./(N*dlogr)) * Fhat[(n+N)%N] * Kt * cis(t*phaseOffset);
+	}
+	fftBackward(Gkappa);
+	
+	//Interpolate to the uniform G grid:
+	double dkappaInv = p/dlogr;
+	for(int iG=iGmin; iG<iGstop; iG++)
+	{	double G = iG*dG;
+		double x = (log(G) - kappaMin) * dkappaInv;
+		int j = int(floor(x)); double t = x - j;
+		double result = //cubic Lagrange interpolation using nodes j-1 to j+2
+			( (-1./6)*t*(t-1)*(t-2) * Gkappa[j-1].real()
+			+ 0.5*(t+1)*(t-1)*(t-2) * Gkappa[j].real()
+			- 0.5*(t+1)*t*(t-2) * Gkappa[j+1].real()
+			+ (1./6)*(t+1)*t*(t-1) * Gkappa[j+2].real() );
+		fTilde[iG-iGstart] = result * pow(G, -1.5);
+	}
+	return true;
+}
+
+void RadialFunctionR::transformSamples(int l, double dG, int iGstart, int iGstop, double* fTilde) const
+{	if(iGstop <= iGstart) return;
+	double dlogr;
+	if(!isLogGrid(dlogr))
+	{	threadLaunch(RadialFunction_transform_sub, iGstop-iGstart, l, dG, iGstart, this, fTilde);
+		return;
+	}
+	//Logarithmic grid: same quadrature as transform(), evaluated by FFTs where possible:
+	if(transformLogGrid(*this, l, dlogr, dG, iGstart, iGstop, fTilde))
+	{	if(iGstart==0) fTilde[0] = transform(l, 0.);
+		//Accuracy control: spot-check logarithmically spaced samples against direct summation
+		double scale = 0.;
+		for(int iG=iGstart; iG<iGstop; iG++)
+			scale = std::max(scale, fabs(fTilde[iG-iGstart]));
+		int iGfail = 0; //largest failing test sample
+		for(int iG=std::max(iGstart,1); iG<iGstop; iG=(iG==iGstop-1 ? iGstop : std::min(2*iG, iGstop-1)))
+			if(fabs(fTilde[iG-iGstart] - transform(l, iG*dG)) > transformTol*scale)
+				iGfail = iG;
+		if(!iGfail) return; //fast transform sufficiently accurate
+		if(iGfail < iGstart + (iGstop-iGstart)/8)
+			iGstop = std::min(2*iGfail+1, iGstop); //only the low-G end is inaccurate: redo that by direct summation below
+	}
+	threadLaunch(RadialFunction_transform_sub, iGstop-iGstart, l, dG, iGstart, this, fTilde);
 }
 
 // Initialize a uniform G radial function from the log-grid function
 void RadialFunctionR::transform(int l, double dG, int nGrid, RadialFunctionG& func) const
 {	static StopWatch watch("RadialFunctionR::transform"); watch.start();
 	std::vector<double> fTilde(nGrid);
-	threadLaunch(RadialFunction_transform_sub, nGrid, l, dG, this, fTilde.data());
+	transformSamples(l, dG, 0, nGrid, fTilde.data());
 	func.free(this!=func.rFunc);
 	func.init(l, fTilde, dG);
+	func.samples.swap(fTilde);
 	if(this!=func.rFunc) func.rFunc = new RadialFunctionR(*this);
 	watch.stop();
 }
-
@@ -55,7 +55,7 @@ struct RadialFunctionG
 	void init(int l, int nSamples, double dG, const char* filename, double scale=1.0); //!< read and initialize from an ascii file (DFT PSP format)
 	void init(int l, const std::vector<double>& samples, double dG); //!< initialize from an array of samples in memory
 	void set(const std::vector<double>& coeff, double dGInv); //!< set the coefficients (and update the GPU versions etc.)
-	void updateGmax(int l, int nSamples); //!< if created from a RadialFunctionR, increase nCoeff if necessary (call when lattice is modified)
+	void updateGmax(int l, int nSamples); //!< if created from a RadialFunctionR, increase nCoeff if necessary (call when lattice is modified); only the new samples are computed
 	void free(bool rFuncDelete=true);
 	
 	//! Blip (quintic spline evaluation)
@@ -65,7 +65,15 @@ struct RadialFunctionG
 		else return QuinticSpline::value(getCoeff(), Gindex);
 	}
 	
+	//! Derivative of blip w.r.t G
+	__hostanddev__ double deriv(double G) const
+	{	double Gindex = G * dGinv;
+		if(Gindex >= nCoeff-5) return 0.;
+		else return dGinv * QuinticSpline::deriv(getCoeff(), Gindex);
+	}
+	
 	RadialFunctionR* rFunc; //!< copy of the real-space radial version (if created from one)
+	std::vector<double> samples; //!< uniform-grid samples (retained if created from a RadialFunctionR, for incremental extension in updateGmax)
 	
 	#ifndef __in_a_cu_file__
 	//! Helper functional for initializing using a function
@@ -123,6 +131,14 @@ struct RadialFunctionR
 	//! Initialize a uniform G radial function from the logPrintf grid function according to
 	//! @$ func(G) = \int dr 4\pi r^2 j_l(G r) f(r) @$
 	void transform(int l, double dG, int nGrid, RadialFunctionG& func) const;
+	
+	//! Compute samples fTilde[iG-iGstart] = transform(l, iG*dG) for iGstart <= iG < iGstop.
+	//! Uses an O(N log N) FFT-based transform on logarithmic grids (spot-checked against direct summation
+	//! to relative accuracy transformTol), and falls back to direct summation otherwise.
+	void transformSamples(int l, double dG, int iGstart, int iGstop, double* fTilde) const;
+	
+	bool isLogGrid(double& dlogr) const; //!< check whether r is a logarithmic grid, and if so, retrieve its spacing in log(r)
+	static double transformTol; //!< relative accuracy threshold for the fast log-grid transform
 };
 
 //! @}
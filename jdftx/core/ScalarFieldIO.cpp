@@ -21,6 +21,7 @@ along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
 #include <core/GridInfo.h>
 #include <core/Operators.h>
 #include <core/WignerSeitz.h>
+#include <core/H5io.h>
 #include <string.h>
 #include <algorithm>
 
@@ -67,6 +68,31 @@ void saveDX(const ScalarField& X, const char* filenamePrefix)
 }
 
 
+#ifdef HDF5_ENABLED
+void saveHDF5(const ScalarField& X, const char* fname, const H5writeParams* params)
+{	const GridInfo& g = X->gInfo;
+	hid_t fid = h5createFile(fname, params);
+	//Lattice vectors (for interpretation of the grid):
+	hsize_t dimsR[2] = { 3, 3 };
+	h5writeVector(fid, "R", &g.R(0,0), dimsR, 2);
+	//Grid data, divided into planes along the first lattice direction:
+	hsize_t dims[3] = { hsize_t(g.S[0]), hsize_t(g.S[1]), hsize_t(g.S[2]) };
+	hsize_t chunkDims[3] = { 1, dims[1], dims[2] };
+	bool chunked = params && params->compress; //chunking only needed for filters
+	hid_t did = h5createDataset(fid, "data", H5T_NATIVE_DOUBLE, dims, 3, chunked ? chunkDims : 0, chunked);
+	TaskDivision planeDivision(g.S[0], mpiUtil);
+	hsize_t offset[3] = { hsize_t(planeDivision.start()), 0, 0 };
+	hsize_t count[3] = { hsize_t(planeDivision.stop()-planeDivision.start()), dims[1], dims[2] };
+	h5writeSlab(did, X->data() + offset[0]*g.S[1]*g.S[2], offset, count, 3);
+	H5Dclose(did);
+	H5Fclose(fid);
+}
+#else
+void saveHDF5(const ScalarField& X, const char* fname, const H5writeParams* params)
+{	die("HDF5 output requires HDF5 support (recompile with EnableHDF5).\n");
+}
+#endif
+
 std::vector< std::vector<double> > sphericalize(const ScalarField* dataR, int nColumns, double drFac, vector3< double >* center)
 {	assert(nColumns > 0); assert(dataR[0]);
 	const GridInfo& gInfo = dataR[0]->gInfo;
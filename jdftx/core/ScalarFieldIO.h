@@ -73,6 +73,13 @@ template<typename T> void loadRawBinary(Tptr& X, const char* filename)
 */
 void saveDX(const ScalarField&, const char* filenamePrefix);
 
+/** Save data to an HDF5 file collectively, with each process writing a slab of planes (requires HDF5 support)
+@param X The data to save, stored as dataset "data" of dimensions S[0] x S[1] x S[2] alongside lattice vectors "R"
+@param fname Output filename
+@param params Chunking, compression and aggregation options (default: contiguous, uncompressed)
+*/
+void saveHDF5(const ScalarField& X, const char* fname, const struct H5writeParams* params=0);
+
 /** Spherically average scalar fields about an arbitrary center (with Wigner-Seitz wrapping)
 @param dataR The data to sphericalize and save
 @param nColumns Number of ScalarField's in dataR[]
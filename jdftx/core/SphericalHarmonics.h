@@ -62,6 +62,7 @@ inline double bessel_jl(int l, double x)
 namespace YlmInternal
 {
 	template<int lm> __hostanddev__ double Ylm(double x, double y, double z); //flat-indexed by lm := l*(l+1) + m
+	template<int lm> __hostanddev__ vector3<> YlmPrime(double x, double y, double z); //gradient of above (as a homogeneous polynomial)
 	#define Power pow //For code auto-generated by Mathematica
 	#define DECLARE_Ylm(lm,code) \
 		template<> __hostanddev__ double Ylm<lm>(double x, double y, double z) { return code; }
@@ -115,6 +116,60 @@ namespace YlmInternal
 	DECLARE_Ylm(47, 2.366619162231752*x*(Power(x,4) - 10.*Power(x,2)*Power(y,2) + 5.*Power(y,4))*z)
 	DECLARE_Ylm(48, 0.6831841051919143*(Power(x,6) - 15.*Power(x,4)*Power(y,2) + 15.*Power(x,2)*Power(y,4) - Power(y,6)))
 	#undef DECLARE_Ylm
+
+	//Gradients of the above homogeneous polynomials (auto-generated from the Ylm expressions above)
+	#define DECLARE_YlmPrime(lm,dx,dy,dz) \
+		template<> __hostanddev__ vector3<> YlmPrime<lm>(double x, double y, double z) { return vector3<>(dx,dy,dz); }
+	DECLARE_YlmPrime(0, 0., 0., 0.)
+	DECLARE_YlmPrime(1, 0., 0.4886025119029199, 0.)
+	DECLARE_YlmPrime(2, 0., 0., 0.4886025119029199)
+	DECLARE_YlmPrime(3, 0.4886025119029199, 0., 0.)
+	DECLARE_YlmPrime(4, 1.0925484305920792*y, 1.0925484305920792*x, 0.)
+	DECLARE_YlmPrime(5, 0., 1.0925484305920792*z, 1.0925484305920792*y)
+	DECLARE_YlmPrime(6, -0.6307831305050401*x, -0.6307831305050401*y, 1.2615662610100802*z)
+	DECLARE_YlmPrime(7, 1.0925484305920792*z, 0., 1.0925484305920792*x)
+	DECLARE_YlmPrime(8, 1.0925484305920792*x, -1.0925484305920792*y, 0.)
+	DECLARE_YlmPrime(9, 3.540261539559861*x*y, 1.7701307697799305*(x - y)*(x + y), 0.)
+	DECLARE_YlmPrime(10, 2.890611442640554*y*z, 2.890611442640554*x*z, 2.890611442640554*x*y)
+	DECLARE_YlmPrime(11, -0.9140915989289316*x*y, -1.8281831978578632*(0.25*Power(x,2) + 0.75*Power(y,2) - 1.0*Power(z,2)), 3.6563663957157264*y*z)
+	DECLARE_YlmPrime(12, -2.2390579955406924*x*z, -2.2390579955406924*y*z, -2.2390579955406924*(0.5*Power(x,2) + 0.5*Power(y,2) - 1.0*Power(z,2)))
+	DECLARE_YlmPrime(13, -1.8281831978578632*(0.75*Power(x,2) + 0.25*Power(y,2) - 1.0*Power(z,2)), -0.9140915989289316*x*y, 3.6563663957157264*x*z)
+	DECLARE_YlmPrime(14, 2.890611442640554*x*z, -2.890611442640554*y*z, 1.445305721320277*(x - y)*(x + y))
+	DECLARE_YlmPrime(15, 1.7701307697799305*(x - y)*(x + y), -3.540261539559861*x*y, 0.)
+	DECLARE_YlmPrime(16, 7.5100288253901138*y*(1.0*Power(x,2) - 0.33333333333333333*Power(y,2)), 7.5100288253901138*x*(0.33333333333333333*Power(x,2) - 1.0*Power(y,2)), 0.)
+	DECLARE_YlmPrime(17, 10.620784618679582*x*y*z, 5.3103923093397912*z*(x - y)*(x + y), 5.3103923093397912*y*(1.0*Power(x,2) - 0.33333333333333333*Power(y,2)))
+	DECLARE_YlmPrime(18, -5.6770481745453606*y*(0.49999999999999999*Power(x,2) + 0.16666666666666666*Power(y,2) - 1.0*Power(z,2)), -5.6770481745453606*x*(0.16666666666666666*Power(x,2) + 0.49999999999999999*Power(y,2) - 1.0*Power(z,2)), 11.354096349090721*x*y*z)
+	DECLARE_YlmPrime(19, -4.0142792613437351*x*y*z, -6.0214188920156027*z*(0.33333333333333334*Power(x,2) + 1.0*Power(y,2) - 0.44444444444444445*Power(z,2)), -8.0285585226874703*y*(0.25*Power(x,2) + 0.25*Power(y,2) - 1.0*Power(z,2)))
+	DECLARE_YlmPrime(20, 5.0777062519298068*x*(0.25*Power(x,2) + 0.25*Power(y,2) - 1.0*Power(z,2)), 5.0777062519298068*y*(0.25*Power(x,2) + 0.25*Power(y,2) - 1.0*Power(z,2)), -5.0777062519298068*z*(1.0*Power(x,2) + 1.0*Power(y,2) - 0.66666666666666666*Power(z,2)))
+	DECLARE_YlmPrime(21, -6.0214188920156027*z*(1.0*Power(x,2) + 0.33333333333333334*Power(y,2) - 0.44444444444444445*Power(z,2)), -4.0142792613437351*x*y*z, -8.0285585226874703*x*(0.25*Power(x,2) + 0.25*Power(y,2) - 1.0*Power(z,2)))
+	DECLARE_YlmPrime(22, -5.6770481745453605*x*(0.33333333333333333*Power(x,2) - 1.0*Power(z,2)), 5.6770481745453605*y*(0.33333333333333333*Power(y,2) - 1.0*Power(z,2)), 5.6770481745453605*z*(x - y)*(x + y))
+	DECLARE_YlmPrime(23, 5.3103923093397912*z*(x - y)*(x + y), -10.620784618679582*x*y*z, 5.3103923093397912*x*(0.33333333333333333*Power(x,2) - 1.0*Power(y,2)))
+	DECLARE_YlmPrime(24, 7.5100288253901133*x*(0.33333333333333333*Power(x,2) - 1.0*Power(y,2)), -7.5100288253901133*y*(1.0*Power(x,2) - 0.33333333333333333*Power(y,2)), 0.)
+	DECLARE_YlmPrime(25, 13.127641136803402*x*y*(x - y)*(x + y), 13.127641136803402*(0.5*Power(x,2) - 1.0*x*y - 0.5*Power(y,2))*(0.5*Power(x,2) + 1.0*x*y - 0.5*Power(y,2)), 0.)
+	DECLARE_YlmPrime(26, 24.907947778572498*y*z*(1.0*Power(x,2) - 0.33333333333333334*Power(y,2)), 24.907947778572498*x*z*(0.33333333333333334*Power(x,2) - 1.0*Power(y,2)), 8.3026492595241661*x*y*(x - y)*(x + y))
+	DECLARE_YlmPrime(27, -23.483438372892019*x*y*(0.25*Power(x,2) + 0.083333333333333334*Power(y,2) - 1.0*Power(z,2)), -11.74171918644601*(0.125*Power(x,4) + 0.25*Power(x,2)*Power(y,2) - 1.0*Power(x,2)*Power(z,2) - 0.20833333333333334*Power(y,4) + 1.0*Power(y,2)*Power(z,2)), 23.483438372892019*y*z*(1.0*Power(x,2) - 0.33333333333333334*Power(y,2)))
+	DECLARE_YlmPrime(28, -14.380610354919972*y*z*(1.0*Power(x,2) + 0.33333333333333334*Power(y,2) - 0.66666666666666667*Power(z,2)), -14.380610354919972*x*z*(0.33333333333333334*Power(x,2) + 1.0*Power(y,2) - 0.66666666666666667*Power(z,2)), -28.761220709839944*x*y*(0.16666666666666667*Power(x,2) + 0.16666666666666667*Power(y,2) - 1.0*Power(z,2)))
+	DECLARE_YlmPrime(29, 10.870719628696727*x*y*(0.16666666666666667*Power(x,2) + 0.16666666666666667*Power(y,2) - 1.0*Power(z,2)), 16.30607944304509*(0.027777777777777778*Power(x,4) + 0.16666666666666667*Power(x,2)*Power(y,2) - 0.33333333333333333*Power(x,2)*Power(z,2) + 0.13888888888888889*Power(y,4) - 1.0*Power(y,2)*Power(z,2) + 0.22222222222222222*Power(z,4)), -14.494292838262302*y*z*(0.75*Power(x,2) + 0.75*Power(y,2) - 1.0*Power(z,2)))
+	DECLARE_YlmPrime(30, 9.356025796273888*x*z*(0.75*Power(x,2) + 0.75*Power(y,2) - 1.0*Power(z,2)), 9.356025796273888*y*z*(0.75*Power(x,2) + 0.75*Power(y,2) - 1.0*Power(z,2)), 14.034038694410832*(0.125*Power(x,4) + 0.25*Power(x,2)*Power(y,2) - 1.0*Power(x,2)*Power(z,2) + 0.125*Power(y,4) - 1.0*Power(y,2)*Power(z,2) + 0.33333333333333334*Power(z,4)))
+	DECLARE_YlmPrime(31, 16.30607944304509*(0.13888888888888889*Power(x,4) + 0.16666666666666667*Power(x,2)*Power(y,2) - 1.0*Power(x,2)*Power(z,2) + 0.027777777777777778*Power(y,4) - 0.33333333333333333*Power(y,2)*Power(z,2) + 0.22222222222222222*Power(z,4)), 10.870719628696727*x*y*(0.16666666666666667*Power(x,2) + 0.16666666666666667*Power(y,2) - 1.0*Power(z,2)), -14.494292838262302*x*z*(0.75*Power(x,2) + 0.75*Power(y,2) - 1.0*Power(z,2)))
+	DECLARE_YlmPrime(32, -9.5870735699466481*x*z*(x - z)*(x + z), 9.5870735699466481*y*z*(y - z)*(y + z), -14.380610354919972*(1.0*x - 1.0*y)*(1.0*x + 1.0*y)*(0.16666666666666667*Power(x,2) + 0.16666666666666667*Power(y,2) - 1.0*Power(z,2)))
+	DECLARE_YlmPrime(33, -11.74171918644601*(0.20833333333333334*Power(x,4) - 0.25*Power(x,2)*Power(y,2) - 1.0*Power(x,2)*Power(z,2) - 0.125*Power(y,4) + 1.0*Power(y,2)*Power(z,2)), 23.483438372892019*x*y*(0.083333333333333334*Power(x,2) + 0.25*Power(y,2) - 1.0*Power(z,2)), 23.483438372892019*x*z*(0.33333333333333334*Power(x,2) - 1.0*Power(y,2)))
+	DECLARE_YlmPrime(34, 24.907947778572499*x*z*(0.33333333333333333*Power(x,2) - 1.0*Power(y,2)), -24.907947778572499*y*z*(1.0*Power(x,2) - 0.33333333333333333*Power(y,2)), 12.45397388928625*(0.16666666666666667*Power(x,4) - 1.0*Power(x,2)*Power(y,2) + 0.16666666666666667*Power(y,4)))
+	DECLARE_YlmPrime(35, 13.127641136803402*(0.5*Power(x,2) - 1.0*x*y - 0.5*Power(y,2))*(0.5*Power(x,2) + 1.0*x*y - 0.5*Power(y,2)), -13.127641136803402*x*y*(x - y)*(x + y), 0.)
+	DECLARE_YlmPrime(36, 40.991046311514858*y*(0.5*Power(x,4) - 1.0*Power(x,2)*Power(y,2) + 0.1*Power(y,4)), 40.991046311514858*x*(0.1*Power(x,4) - 1.0*Power(x,2)*Power(y,2) + 0.5*Power(y,4)), 0.)
+	DECLARE_YlmPrime(37, 47.33238324463504*x*y*z*(x - y)*(x + y), 70.998574866952561*z*(0.16666666666666667*Power(x,4) - 1.0*Power(x,2)*Power(y,2) + 0.16666666666666667*Power(y,4)), 23.66619162231752*y*(0.5*Power(x,4) - 1.0*Power(x,2)*Power(y,2) + 0.1*Power(y,4)))
+	DECLARE_YlmPrime(38, -60.547788087446901*y*(0.16666666666666667*Power(x,4) - 1.0*Power(x,2)*Power(z,2) - 0.033333333333333333*Power(y,4) + 0.33333333333333333*Power(y,2)*Power(z,2)), -60.547788087446901*x*(0.033333333333333333*Power(x,4) - 0.33333333333333333*Power(x,2)*Power(z,2) - 0.16666666666666667*Power(y,4) + 1.0*Power(y,2)*Power(z,2)), 40.365192058297934*x*y*z*(x - y)*(x + y))
+	DECLARE_YlmPrime(39, -44.217852456716333*x*y*z*(0.75*Power(x,2) + 0.25*Power(y,2) - 1.0*Power(z,2)), -22.108926228358166*z*(0.375*Power(x,4) + 0.75*Power(x,2)*Power(y,2) - 1.0*Power(x,2)*Power(z,2) - 0.625*Power(y,4) + 1.0*Power(y,2)*Power(z,2)), -66.326778685074499*y*(0.125*Power(x,4) + 0.083333333333333334*Power(x,2)*Power(y,2) - 1.0*Power(x,2)*Power(z,2) - 0.041666666666666667*Power(y,4) + 0.33333333333333334*Power(y,2)*Power(z,2)))
+	DECLARE_YlmPrime(40, 44.217852456716333*y*(0.10416666666666667*Power(x,4) + 0.125*Power(x,2)*Power(y,2) - 1.0*Power(x,2)*Power(z,2) + 0.020833333333333333*Power(y,4) - 0.33333333333333334*Power(y,2)*Power(z,2) + 0.33333333333333334*Power(z,4)), 44.217852456716333*x*(0.020833333333333333*Power(x,4) + 0.125*Power(x,2)*Power(y,2) - 0.33333333333333334*Power(x,2)*Power(z,2) + 0.10416666666666667*Power(y,4) - 1.0*Power(y,2)*Power(z,2) + 0.33333333333333334*Power(z,4)), -58.957136608955111*x*y*z*(0.5*Power(x,2) + 0.5*Power(y,2) - 1.0*Power(z,2)))
+	DECLARE_YlmPrime(41, 23.304854500749256*x*y*z*(0.49999999999999999*Power(x,2) + 0.49999999999999999*Power(y,2) - 1.0*Power(z,2)), 34.957281751123884*z*(0.083333333333333334*Power(x,4) + 0.5*Power(x,2)*Power(y,2) - 0.33333333333333334*Power(x,2)*Power(z,2) + 0.41666666666666666*Power(y,4) - 1.0*Power(y,2)*Power(z,2) + 0.13333333333333333*Power(z,4)), 34.957281751123884*y*(0.083333333333333334*Power(x,4) + 0.16666666666666667*Power(x,2)*Power(y,2) - 1.0*Power(x,2)*Power(z,2) + 0.083333333333333334*Power(y,4) - 1.0*Power(y,2)*Power(z,2) + 0.66666666666666667*Power(z,4)))
+	DECLARE_YlmPrime(42, -22.884912816346231*x*(0.083333333333333334*Power(x,4) + 0.16666666666666667*Power(x,2)*Power(y,2) - 1.0*Power(x,2)*Power(z,2) + 0.083333333333333334*Power(y,4) - 1.0*Power(y,2)*Power(z,2) + 0.66666666666666667*Power(z,4)), -22.884912816346231*y*(0.083333333333333334*Power(x,4) + 0.16666666666666667*Power(x,2)*Power(y,2) - 1.0*Power(x,2)*Power(z,2) + 0.083333333333333334*Power(y,4) - 1.0*Power(y,2)*Power(z,2) + 0.66666666666666667*Power(z,4)), 30.513217088461641*z*(0.375*Power(x,4) + 0.75*Power(x,2)*Power(y,2) - 1.0*Power(x,2)*Power(z,2) + 0.375*Power(y,4) - 1.0*Power(y,2)*Power(z,2) + 0.2*Power(z,4)))
+	DECLARE_YlmPrime(43, 34.957281751123884*z*(0.41666666666666666*Power(x,4) + 0.5*Power(x,2)*Power(y,2) - 1.0*Power(x,2)*Power(z,2) + 0.083333333333333334*Power(y,4) - 0.33333333333333334*Power(y,2)*Power(z,2) + 0.13333333333333333*Power(z,4)), 23.304854500749256*x*y*z*(0.49999999999999999*Power(x,2) + 0.49999999999999999*Power(y,2) - 1.0*Power(z,2)), 34.957281751123884*x*(0.083333333333333334*Power(x,4) + 0.16666666666666667*Power(x,2)*Power(y,2) - 1.0*Power(x,2)*Power(z,2) + 0.083333333333333334*Power(y,4) - 1.0*Power(y,2)*Power(z,2) + 0.66666666666666667*Power(z,4)))
+	DECLARE_YlmPrime(44, 29.478568304477555*x*(0.09375*Power(x,4) + 0.0625*Power(x,2)*Power(y,2) - 1.0*Power(x,2)*Power(z,2) - 0.03125*Power(y,4) + 0.5*Power(z,4)), 29.478568304477555*y*(0.03125*Power(x,4) - 0.0625*Power(x,2)*Power(y,2) - 0.09375*Power(y,4) + 1.0*Power(y,2)*Power(z,2) - 0.5*Power(z,4)), -29.478568304477555*z*(1.0*x - 1.0*y)*(1.0*x + 1.0*y)*(0.5*Power(x,2) + 0.5*Power(y,2) - 1.0*Power(z,2)))
+	DECLARE_YlmPrime(45, -22.108926228358166*z*(0.625*Power(x,4) - 0.75*Power(x,2)*Power(y,2) - 1.0*Power(x,2)*Power(z,2) - 0.375*Power(y,4) + 1.0*Power(y,2)*Power(z,2)), 44.217852456716333*x*y*z*(0.25*Power(x,2) + 0.75*Power(y,2) - 1.0*Power(z,2)), -66.326778685074499*x*(0.041666666666666667*Power(x,4) - 0.083333333333333334*Power(x,2)*Power(y,2) - 0.33333333333333334*Power(x,2)*Power(z,2) - 0.125*Power(y,4) + 1.0*Power(y,2)*Power(z,2)))
+	DECLARE_YlmPrime(46, -60.547788087446905*x*(0.05*Power(x,4) - 0.16666666666666666*Power(x,2)*Power(y,2) - 0.33333333333333333*Power(x,2)*Power(z,2) - 0.083333333333333332*Power(y,4) + 1.0*Power(y,2)*Power(z,2)), 60.547788087446905*y*(0.083333333333333332*Power(x,4) + 0.16666666666666666*Power(x,2)*Power(y,2) - 1.0*Power(x,2)*Power(z,2) - 0.05*Power(y,4) + 0.33333333333333333*Power(y,2)*Power(z,2)), 60.547788087446905*z*(0.16666666666666666*Power(x,4) - 1.0*Power(x,2)*Power(y,2) + 0.16666666666666666*Power(y,4)))
+	DECLARE_YlmPrime(47, 70.998574866952561*z*(0.16666666666666667*Power(x,4) - 1.0*Power(x,2)*Power(y,2) + 0.16666666666666667*Power(y,4)), -47.33238324463504*x*y*z*(x - y)*(x + y), 23.66619162231752*x*(0.1*Power(x,4) - 1.0*Power(x,2)*Power(y,2) + 0.5*Power(y,4)))
+	DECLARE_YlmPrime(48, 40.991046311514858*x*(0.1*Power(x,4) - 1.0*Power(x,2)*Power(y,2) + 0.5*Power(y,4)), -40.991046311514858*y*(0.5*Power(x,4) - 1.0*Power(x,2)*Power(y,2) + 0.1*Power(y,4)), 0.)
+	#undef DECLARE_YlmPrime
 	#undef Power
 }
 
@@ -128,6 +183,17 @@ template<int l, int m> __hostanddev__ double Ylm(const vector3<>& qhat)
 {	return Ylm<l*(l+1)+m>(qhat);
 }
 
+//! Gradient of the degree-l homogeneous polynomial extension of Ylm (indexed by combined lm).
+//! For unit qhat, the derivative of Ylm(q/|q|) w.r.t. q is (YlmPrime - l*qhat*Ylm)/|q|.
+template<int lm> __hostanddev__ vector3<> YlmPrime(const vector3<>& qhat)
+{	return YlmInternal::YlmPrime<lm>(qhat[0],qhat[1],qhat[2]);
+}
+
+//! Gradient of homogeneous polynomial extension of Ylm, indexed by l and m separately
+template<int l, int m> __hostanddev__ vector3<> YlmPrime(const vector3<>& qhat)
+{	return YlmPrime<l*(l+1)+m>(qhat);
+}
+
 //! Switch a function templated over l,m for all supported l,m with parenthesis enclosed argument list argList
 #define SwitchTemplate_lm(l,m,fTemplate,argList) \
 	switch(l*(l+1)+m) \
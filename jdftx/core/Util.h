@@ -160,6 +160,15 @@ void convertFromLE(void* ptr, size_t size, size_t nmemb); //!< Convert data from
 size_t freadLE(void *ptr, size_t size, size_t nmemb, FILE* fp); //!< Read from a little-endian binary file, regardless of operating endianness
 size_t fwriteLE(const void *ptr, size_t size, size_t nmemb, FILE *fp); //!< Write to a little-endian binary file, regardless of operating endianness
 
+//! 64-bit FNV-1a hash of n bytes at data, continued from a previous value of hash (start from fnv1aInit)
+inline void fnv1a(uint64_t& hash, const char* data, size_t n)
+{	for(size_t i=0; i<n; i++)
+	{	hash ^= (unsigned char)data[i];
+		hash *= 0x100000001b3ULL;
+	}
+}
+static const uint64_t fnv1aInit = 0xcbf29ce484222325ULL; //!< initial value for fnv1a()
+
 //! For any x and y>0, compute z = x % y such that 0 <= z < y
 inline uint16_t positiveRemainder(int16_t x, uint16_t y)
 {	int16_t xMody = x % y;
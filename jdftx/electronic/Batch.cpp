@@ -0,0 +1,181 @@
+/*-------------------------------------------------------------------
+Copyright 2017 Ravishankar Sundararaman
+
+This file is part of JDFTx.
+
+JDFTx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+JDFTx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
+-------------------------------------------------------------------*/
+
+#include <electronic/Batch.h>
+#include <electronic/Everything.h>
+#include <electronic/ElecMinimizer.h>
+#include <electronic/IonicMinimizer.h>
+
+Batch::Batch() : nGroups(1), e(0), mpiWorld(0), mpiGroup(0), iGroup(0)
+{
+}
+
+void Batch::splitProcesses()
+{	mpiWorld = mpiUtil;
+	int nProcs = mpiWorld->nProcesses();
+	nGroups = std::max(1, std::min(nGroups, std::min(nProcs, int(structures.size()))));
+	//Divide processes into contiguous groups:
+	iGroup = (mpiWorld->iProcess() * nGroups) / nProcs;
+	groupHead.assign(nGroups, nProcs);
+	for(int jProc=nProcs-1; jProc>=0; jProc--)
+		groupHead[(jProc * nGroups) / nProcs] = jProc;
+	if(nGroups > 1)
+	{	mpiGroup = new MPIUtil(*mpiWorld, iGroup);
+		mpiUtil = mpiGroup; //all subsequent setup and calculations are local to the group
+		logPrintf("Divided %d processes into %d groups for %lu batch structures.\n", nProcs, nGroups, structures.size());
+		logPrintf("Note: log below is from group 0 alone; results of all groups are collected in the batch output.\n");
+	}
+}
+
+void Batch::setup(Everything* e)
+{	this->e = e;
+	if(nGroups > 1)
+	{	//Group heads would write the same dump / checkpoint filenames concurrently during minimization:
+		for(const auto& entry: e->dump)
+			if(entry.first != DumpFreq_End)
+				die("Dumps at frequencies other than End are not supported with batch-groups > 1.\n");
+		if(e->dump.checkpoint)
+			die("Asynchronous checkpointing (dump-async) is not supported with batch-groups > 1.\n");
+	}
+	logPrintf("Batch of %lu structures will reuse this setup (lattice, species, symmetries and k-points).\n", structures.size());
+}
+
+void Batch::calculate()
+{	logPrintf("\n---------- Batch evaluation of %lu structures ----------\n", structures.size());
+	//Results file (written by the head of the first group):
+	string fname = e->dump.getFilename("batch");
+	FILE* fp = 0;
+	if(mpiWorld->isHead())
+	{	fp = fopen(fname.c_str(), "w");
+		if(!fp) die("Error opening %s for writing.\n", fname.c_str());
+	}
+	
+	//Round-robin structures over groups, streaming results of each round in structure order:
+	int nRounds = (structures.size() + nGroups - 1) / nGroups;
+	for(int iRound=0; iRound<nRounds; iRound++)
+	{	size_t iStructure = size_t(iRound)*nGroups + iGroup;
+		string result;
+		if(iStructure < structures.size())
+			result = evaluate(structures[iStructure]);
+		for(int jGroup=0; jGroup<nGroups; jGroup++)
+		{	if(size_t(iRound)*nGroups + jGroup >= structures.size()) break;
+			int jHead = groupHead[jGroup];
+			if(jHead == 0)
+			{	if(fp) fputs(result.c_str(), fp);
+			}
+			else if(mpiWorld->iProcess() == jHead) mpiWorld->send(result, 0, iRound);
+			else if(mpiWorld->isHead())
+			{	string resultOther;
+				mpiWorld->recv(resultOther, jHead, iRound);
+				fputs(resultOther.c_str(), fp);
+			}
+		}
+		if(fp) fflush(fp);
+	}
+	if(fp) fclose(fp);
+	logPrintf("Wrote results of %lu structures to '%s'.\n", structures.size(), fname.c_str());
+	
+	mergeProcesses();
+}
+
+void Batch::mergeProcesses()
+{	if(!mpiWorld) return; //not split
+	mpiUtil = mpiWorld;
+	if(mpiGroup)
+	{	delete mpiGroup;
+		mpiGroup = 0;
+	}
+}
+
+string Batch::readStructure(const string& filename, std::vector<std::vector<vector3<>>>& atpos) const
+{	const IonInfo& iInfo = e->iInfo;
+	ifstream ifs(filename);
+	if(!ifs.is_open()) return "could not open '" + filename + "' for reading";
+	while(!ifs.eof())
+	{	string line; getline(ifs, line);
+		istringstream iss(line);
+		string cmd; iss >> cmd;
+		if(cmd != "ion") continue; //ignore comments and other commands (eg. from dump ionpos)
+		string spName; vector3<> pos;
+		iss >> spName >> pos[0] >> pos[1] >> pos[2];
+		if(iss.fail()) return "invalid ion command '" + line + "'";
+		int iSp = 0;
+		for(; iSp<int(iInfo.species.size()); iSp++)
+			if(iInfo.species[iSp]->name == spName) break;
+		if(iSp == int(iInfo.species.size())) return "species '" + spName + "' not present in the initial structure";
+		if(iInfo.coordsType == CoordsCartesian) pos = e->gInfo.invR * pos; //store in lattice coordinates
+		atpos[iSp].push_back(pos);
+	}
+	for(size_t iSp=0; iSp<iInfo.species.size(); iSp++)
+		if(atpos[iSp].size() != iInfo.species[iSp]->atpos.size())
+			return "number of " + iInfo.species[iSp]->name + " atoms differs from the initial structure";
+	return string();
+}
+
+string Batch::evaluate(const Structure& structure)
+{	IonInfo& iInfo = e->iInfo;
+	const ElecInfo& eInfo = e->eInfo;
+	logPrintf("\n#--- Structure '%s' (from '%s') ---\n", structure.name.c_str(), structure.filename.c_str());
+	
+	//Read positions on head and distribute within group:
+	std::vector<std::vector<vector3<>>> atpos(iInfo.species.size());
+	string error;
+	if(mpiUtil->isHead()) error = readStructure(structure.filename, atpos);
+	mpiUtil->bcast(error);
+	if(!error.length())
+	{	for(size_t iSp=0; iSp<iInfo.species.size(); iSp++)
+		{	SpeciesInfo& sp = *(iInfo.species[iSp]);
+			atpos[iSp].resize(sp.atpos.size());
+			mpiUtil->bcast((double*)atpos[iSp].data(), 3*atpos[iSp].size());
+			sp.atpos = atpos[iSp];
+		}
+		//Map atoms (symmetrizing positions) before syncing them; marginal cases are skipped rather than fatal:
+		if(!e->symm.updateAtomMaps()) error = "positions break (or are marginal within symmetry-threshold for) symmetries of the initial structure (use symmetries none)";
+		else if(!iInfo.checkPositions()) error = "pseudopotential cores overlap";
+		for(auto sp: iInfo.species)
+			sp->sync_atpos();
+	}
+	if(error.length())
+	{	logPrintf("Skipping structure: %s.\n", error.c_str());
+		return "# Structure " + structure.name + " skipped: " + error + "\n\n";
+	}
+	
+	//Minimize electrons (and fluid) starting from the state of the previous structure:
+	for(int q=eInfo.qStart; q<eInfo.qStop; q++)
+		e->eVars.orthonormalize(q); //overlap depends on atpos for ultrasoft pseudopotentials
+	iInfo.update(e->ener);
+	elecFluidMinimize(*e);
+	iInfo.ionicEnergyAndGrad(iInfo.forces); //forces in lattice coordinates
+	IonicGradient forcesCart = e->gInfo.invRT * iInfo.forces;
+	logPrintf("# Energy components:\n"); e->ener.print(); logPrintf("\n"); logFlush();
+	
+	//Result record:
+	ostringstream oss;
+	char buf[256];
+	oss << "# Structure " << structure.name << " (from " << structure.filename << ")\n";
+	sprintf(buf, "%s = %.15lf\n", relevantFreeEnergyName(*e), relevantFreeEnergy(*e)); oss << buf;
+	oss << "# Forces in Cartesian coordinates:\n";
+	for(size_t iSp=0; iSp<iInfo.species.size(); iSp++)
+		for(const vector3<>& f: forcesCart[iSp])
+		{	sprintf(buf, "force %s %19.15lf %19.15lf %19.15lf\n", iInfo.species[iSp]->name.c_str(), f[0], f[1], f[2]);
+			oss << buf;
+		}
+	oss << "\n";
+	return oss.str();
+}
@@ -0,0 +1,65 @@
+/*-------------------------------------------------------------------
+Copyright 2017 Ravishankar Sundararaman
+
+This file is part of JDFTx.
+
+JDFTx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+JDFTx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
+-------------------------------------------------------------------*/
+
+#ifndef JDFTX_ELECTRONIC_BATCH_H
+#define JDFTX_ELECTRONIC_BATCH_H
+
+#include <core/vector3.h>
+#include <core/string.h>
+#include <vector>
+
+class Everything;
+class MPIUtil;
+
+//! @addtogroup IonicSystem
+//! @{
+
+//! Batch evaluation of many structures (ionic positions) that share species, cutoffs, lattice and symmetries.
+//! All structure-independent setup (pseudopotentials, grids and FFT plans, Coulomb kernels, k-points)
+//! is performed once and reused; structures are divided over groups of processes (see command batch-structure)
+class Batch
+{
+public:
+	//! Structure to evaluate
+	struct Structure
+	{	string name; //!< label in the results file
+		string filename; //!< file containing ion commands for the positions (eg. ionpos from dump)
+	};
+	std::vector<Structure> structures; //!< structures to evaluate, in order
+	int nGroups; //!< number of process groups evaluating different structures concurrently
+	
+	Batch();
+	void splitProcesses(); //!< divide processes into groups (must be called before Everything::setup, so that all setup is group-local)
+	void setup(Everything* e);
+	void calculate(); //!< evaluate structures assigned to this group, streaming results to a single output file (calls mergeProcesses on return)
+	void mergeProcesses(); //!< restore the world communicator (required before finalizeSystem)
+	
+private:
+	Everything* e;
+	MPIUtil* mpiWorld; //!< all processes (mpiUtil points to the current group between splitProcesses and mergeProcesses)
+	MPIUtil* mpiGroup; //!< group communicator (null if all processes form one group)
+	int iGroup; //!< group of current process
+	std::vector<int> groupHead; //!< world rank of the first process of each group
+	
+	string readStructure(const string& filename, std::vector<std::vector<vector3<>>>& atpos) const; //!< read positions (in lattice coordinates); returns error message if any
+	string evaluate(const Structure& structure); //!< evaluate one structure (collective within group), and return its record for the results file
+};
+
+//! @}
+#endif //JDFTX_ELECTRONIC_BATCH_H
@@ -19,11 +19,13 @@ along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <electronic/Everything.h>
 #include <electronic/ColumnBundle.h>
+#include <electronic/WavefunctionFile.h>
 #include <core/matrix.h>
 #include <core/vector3.h>
 #include <core/Random.h>
 #include <core/BlasExtra.h>
 #include <core/ScalarFieldIO.h>
+#include <core/H5io.h>
 #include <fftw3.h>
 
 // Called by other constructors to do the work
@@ -39,6 +41,17 @@ void ColumnBundle::init(int nc, size_t len, const Basis *b, const QuantumNumber*
 	memInit("ColumnBundle", nCols()*colLength(), onGpu); //in base class ManagedMemory
 }
 
+void ColumnBundle::initShared(int nc, size_t len, const Basis *b, const QuantumNumber* q)
+{	ncols = nc;
+	col_length = len;
+	basis = b;
+	qnum = q;
+	
+	if(nCols() == 0) { memFree(); return; }
+	assert(colLength() != 0);
+	memInitShared("ColumnBundle", nCols()*colLength()); //in base class ManagedMemory
+}
+
 void ColumnBundle::free()
 {	ncols = 0;
 	col_length = 0;
@@ -205,6 +218,97 @@ void write(const std::vector<ColumnBundle>& Y, const char* fname, const ElecInfo
 	mpiUtil->fclose(fp);
 }
 
+#ifdef HDF5_ENABLED
+//Number of collective rounds needed to cover local states on all processes (one state per process per round)
+inline int hdf5nRounds(const ElecInfo& eInfo)
+{	int nRounds = 0;
+	for(int iProc=0; iProc<mpiUtil->nProcesses(); iProc++)
+		nRounds = std::max(nRounds, eInfo.qStopOther(iProc)-eInfo.qStartOther(iProc));
+	return nRounds;
+}
+
+void writeHDF5(const std::vector<ColumnBundle>& Y, const char* fname, const ElecInfo& eInfo, const H5writeParams* params)
+{	//Collect column lengths of all states:
+	std::vector<int> colLength(eInfo.nStates, 0);
+	for(int q=eInfo.qStart; q<eInfo.qStop; q++)
+		colLength[q] = Y[q].colLength();
+	mpiUtil->allReduce(colLength.data(), colLength.size(), MPIUtil::ReduceSum);
+	int colLengthMax = *std::max_element(colLength.begin(), colLength.end());
+	//Create file and dataset chunked by blocks of bands:
+	H5writeParams paramsDefault;
+	if(!params) params = &paramsDefault;
+	hid_t fid = h5createFile(fname, params);
+	h5writeVector(fid, "colLength", colLength);
+	hsize_t dims[4] = { hsize_t(eInfo.nStates), hsize_t(eInfo.nBands), hsize_t(colLengthMax), 2 };
+	hsize_t chunkDims[4] = { 1, hsize_t(std::min(eInfo.nBands, params->blockBands)), hsize_t(colLengthMax), 2 };
+	hid_t did = h5createDataset(fid, "wfns", H5T_NATIVE_DOUBLE, dims, 4, chunkDims, params->compress);
+	//Write one state from each process per collective call:
+	int nRounds = hdf5nRounds(eInfo);
+	for(int iRound=0; iRound<nRounds; iRound++)
+	{	int q = eInfo.qStart + iRound;
+		hsize_t offset[4] = { hsize_t(q), 0, 0, 0 };
+		hsize_t count[4] = { 0, 0, 0, 0 }; //empty selection on processes without a state this round
+		const double* data = 0;
+		if(q < eInfo.qStop)
+		{	count[0] = 1; count[1] = Y[q].nCols(); count[2] = Y[q].colLength(); count[3] = 2;
+			data = (const double*)Y[q].data();
+		}
+		h5writeSlab(did, data, offset, count, 4);
+	}
+	H5Dclose(did);
+	H5Fclose(fid);
+}
+
+//Read wavefunctions written by writeHDF5 (number of bands and basis must match)
+void readHDF5(std::vector<ColumnBundle>& Y, const char* fname, const ElecInfo& eInfo)
+{	hid_t fid = h5openFile(fname);
+	hid_t did = H5Dopen(fid, "wfns", H5P_DEFAULT);
+	if(did<0) die("HDF5 file '%s' does not contain wavefunctions.\n", fname);
+	hsize_t dims[4];
+	hid_t sid = H5Dget_space(did);
+	if(H5Sget_simple_extent_ndims(sid) != 4) die("Wavefunction dataset in '%s' has wrong rank.\n", fname);
+	H5Sget_simple_extent_dims(sid, dims, NULL);
+	H5Sclose(sid);
+	if(int(dims[0]) != eInfo.nStates)
+		die("Number of states in '%s' (%d) does not match current calculation (%d).\n", fname, int(dims[0]), eInfo.nStates);
+	if(int(dims[1]) != eInfo.nBands)
+		die("Number of bands in '%s' (%d) does not match current calculation (%d).\n", fname, int(dims[1]), eInfo.nBands);
+	std::vector<int> colLength(eInfo.nStates);
+	hid_t didLength = H5Dopen(fid, "colLength", H5P_DEFAULT);
+	if(didLength<0) die("HDF5 file '%s' does not contain wavefunction basis sizes.\n", fname);
+	H5Dread(didLength, H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, colLength.data());
+	H5Dclose(didLength);
+	int qMismatch = -1; //first state with mismatched basis (collected from all processes before the collective reads)
+	for(int q=eInfo.qStart; q<eInfo.qStop; q++)
+		if(int(Y[q].colLength()) != colLength[q])
+		{	qMismatch = q;
+			break;
+		}
+	mpiUtil->allReduce(qMismatch, MPIUtil::ReduceMax);
+	if(qMismatch >= 0)
+		die("Basis of state %d in '%s' does not match current calculation.\n"
+			"Hint: HDF5 wavefunctions can only be read with the same Ecut and lattice.\n", qMismatch, fname);
+	int nRounds = hdf5nRounds(eInfo);
+	for(int iRound=0; iRound<nRounds; iRound++)
+	{	int q = eInfo.qStart + iRound;
+		hsize_t offset[4] = { hsize_t(q), 0, 0, 0 };
+		hsize_t count[4] = { 0, 0, 0, 0 };
+		double* data = 0;
+		if(q < eInfo.qStop)
+		{	count[0] = 1; count[1] = Y[q].nCols(); count[2] = Y[q].colLength(); count[3] = 2;
+			data = (double*)Y[q].data();
+		}
+		h5readSlab(did, data, offset, count, 4);
+	}
+	H5Dclose(did);
+	H5Fclose(fid);
+}
+#else
+void writeHDF5(const std::vector<ColumnBundle>& Y, const char* fname, const ElecInfo& eInfo, const H5writeParams* params)
+{	die("HDF5 output requires HDF5 support (recompile with EnableHDF5).\n");
+}
+#endif
+
 
 ColumnBundleReadConversion::ColumnBundleReadConversion()
 : realSpace(false), nBandsOld(0), Ecut(0), EcutOld(0)
@@ -237,6 +341,17 @@ void read(std::vector<ColumnBundle>& Y, const char *fname, const ElecInfo& eInfo
 			}
 		}
 	}
+#ifdef HDF5_ENABLED
+	else if(h5isFile(fname)) readHDF5(Y, fname, eInfo); //written by dump-hdf5
+#endif
+	else if(WavefunctionFile::isContainer(fname))
+	{	//Self-describing container: read available bands, converting basis by G-vector as needed
+		WavefunctionFile wfnsFile(fname);
+		if(wfnsFile.nStates() != eInfo.nStates)
+			die("Number of states in '%s' (%d) does not match current calculation (%d).\n", fname, wfnsFile.nStates(), eInfo.nStates);
+		for(int q=eInfo.qStart; q<eInfo.qStop; q++)
+			wfnsFile.read(q, Y[q], 0, std::min(Y[q].nCols(), wfnsFile.state(q).nBands));
+	}
 	else
 	{	//Check if a conversion is actually needed:
 		std::vector<ColumnBundle> Ytmp(eInfo.qStop);
@@ -54,6 +54,7 @@ public:
 	const Basis *basis;
 
 	void init(int nc, size_t len, const Basis* b, const QuantumNumber* q, bool onGpu=false); //!< constructor helper
+	void initShared(int nc, size_t len, const Basis* b, const QuantumNumber* q); //!< like init, but in node-shared memory if available: for data written by one process and distributed using bcast (see ManagedMemoryBase::memInitShared)
 	void free(); //!< Force cleanup
 	ColumnBundle(int nc=0, size_t len=0, const Basis* b=NULL, const QuantumNumber* q=NULL, bool onGpu=false);
 	ColumnBundle(const ColumnBundle&); //!< copy constructor
@@ -82,6 +83,7 @@ void init(std::vector<ColumnBundle>&, int nbundles, int ncols=0, const Basis* ba
 
 void randomize(std::vector<ColumnBundle>&, const ElecInfo& eInfo); //!< randomize an array of columnbundles
 void write(const std::vector<ColumnBundle>&, const char *fname, const ElecInfo& eInfo); //!< write an array of columnbundles to file
+void writeHDF5(const std::vector<ColumnBundle>&, const char *fname, const ElecInfo& eInfo, const struct H5writeParams* params=0); //!< collectively write an array of columnbundles to an HDF5 file, chunked by bands (requires HDF5 support)
 
 //! Utility to convert columnbundle basis / bands
 struct ColumnBundleReadConversion
@@ -94,6 +96,7 @@ struct ColumnBundleReadConversion
 };
 
 //! Read array of columnbundles, optionally with conversion
+//! (conversion is unnecessary and ignored for self-describing containers, see WavefunctionFile)
 void read(std::vector<ColumnBundle>&, const char *fname, const ElecInfo& eInfo, const ColumnBundleReadConversion* conversion=0);
 
 // Used in the CG template Minimize.h
@@ -158,6 +158,64 @@ matrix operator^(const scaled<ColumnBundle> &sY1, const scaled<ColumnBundle> &sY
 
 //------------------------------ Other operators ---------------------------------
 
+#ifdef MIXED_PRECISION_ENABLED
+#include <complex>
+
+//Single-precision versions of the wavefunction transforms in Idag_DiagV_I and diagouterI (see elec-mixed-precision).
+//Columns are scattered from the reduced basis directly into a single-precision full-G box, avoiding the double-precision intermediate.
+typedef std::complex<float> complexf;
+
+inline bool useSinglePrecision(const ColumnBundle& C)
+{	return C.basis->gInfo->singlePrecisionFFT && !isGpuEnabled();
+}
+
+//Expand i'th column and s'th spinor component of C into real space in single precision:
+void ISingle(const ColumnBundle& C, int i, int s, complexf* out)
+{	const Basis& basis = *(C.basis);
+	const GridInfo& gInfo = *(basis.gInfo);
+	const int* index = basis.index.data();
+	const complex* Ccol = C.data() + C.index(i, s*basis.nbasis);
+	eblas_zero(gInfo.nr, out);
+	for(size_t j=0; j<basis.nbasis; j++)
+		out[index[j]] = complexf(Ccol[j].real(), Ccol[j].imag());
+	fftwf_execute_dft(gInfo.getPlanSingle(GridInfo::PlanInverseInPlace, 1), (fftwf_complex*)out, (fftwf_complex*)out);
+}
+
+void Idag_DiagV_I_sub_single(int colStart, int colEnd, const ColumnBundle* C, const float* V, ColumnBundle* VC)
+{	const Basis& basis = *(C->basis);
+	const GridInfo& gInfo = *(basis.gInfo);
+	const int* index = basis.index.data();
+	fftwf_plan planIdag = gInfo.getPlanSingle(GridInfo::PlanForwardInPlace, 1);
+	ManagedArray<complexf> buf; buf.init(gInfo.nr);
+	complexf* bufData = buf.data();
+	int nSpinor = VC->spinorLength();
+	for(int col=colStart; col<colEnd; col++)
+		for(int s=0; s<nSpinor; s++)
+		{	ISingle(*C, col, s, bufData);
+			for(int i=0; i<gInfo.nr; i++) bufData[i] *= V[i];
+			fftwf_execute_dft(planIdag, (fftwf_complex*)bufData, (fftwf_complex*)bufData);
+			complex* VCcol = VC->data() + VC->index(col, s*basis.nbasis);
+			for(size_t j=0; j<basis.nbasis; j++)
+			{	const complexf& b = bufData[index[j]];
+				VCcol[j] += complex(b.real(), b.imag());
+			}
+		}
+}
+
+void diagouterI_sub_single(int colStart, int colStop, const diagMatrix* F, const ColumnBundle* X, double* n)
+{	const GridInfo& gInfo = *(X->basis->gInfo);
+	ManagedArray<complexf> buf; buf.init(gInfo.nr);
+	complexf* bufData = buf.data();
+	int nSpinor = X->spinorLength();
+	for(int col=colStart; col<colStop; col++)
+		for(int s=0; s<nSpinor; s++)
+		{	ISingle(*X, col, s, bufData);
+			double Fcol = (*F)[col];
+			for(int i=0; i<gInfo.nr; i++) n[i] += Fcol * std::norm(bufData[i]);
+		}
+}
+#endif
+
 void Idag_DiagV_I_sub(int colStart, int colEnd, const ColumnBundle* C, const ScalarFieldArray* V, ColumnBundle* VC)
 {	const ScalarField& Vs = V->at(V->size()==1 ? 0 : C->qnum->index());
 	int nSpinor = VC->spinorLength();
@@ -190,6 +248,17 @@ ColumnBundle Idag_DiagV_I(const ColumnBundle& C, const ScalarFieldArray& V)
 	const ScalarFieldArray& Vwfns = Vtmp.size() ? Vtmp : V;
 	assert(Vwfns.size()==1 || Vwfns.size()==2 || Vwfns.size()==4);
 	if(Vwfns.size()==2) assert(!C.isSpinor());
+	#ifdef MIXED_PRECISION_ENABLED
+	if((Vwfns.size()==1 || Vwfns.size()==2) && useSinglePrecision(C))
+	{	const ScalarField& Vs = Vwfns[Vwfns.size()==1 ? 0 : C.qnum->index()];
+		ManagedArray<float> Vsingle; Vsingle.init(gInfoWfns.nr);
+		const double* VsData = Vs->data();
+		float* VsingleData = Vsingle.data();
+		for(int i=0; i<gInfoWfns.nr; i++) VsingleData[i] = float(VsData[i]);
+		threadLaunch(0, Idag_DiagV_I_sub_single, C.nCols(), &C, (const float*)VsingleData, &VC);
+	}
+	else
+	#endif
 	if(Vwfns.size()==1 || Vwfns.size()==2)
 	{	threadLaunch(isGpuEnabled()?1:0, Idag_DiagV_I_sub, C.nCols(), &C, &Vwfns, &VC);
 	}
@@ -429,6 +498,12 @@ void diagouterI_sub(int iThread, int nThreads, const diagMatrix *F, const Column
 	ScalarFieldArray& nLocal = (*nSub)[iThread];
 	nullToZero(nLocal, *(X->basis->gInfo)); //sets to zero
 	int nDensities = nLocal.size();
+	#ifdef MIXED_PRECISION_ENABLED
+	if(nDensities==1 && useSinglePrecision(*X))
+	{	diagouterI_sub_single(colStart, colStop, F, X, nLocal[0]->data());
+		return;
+	}
+	#endif
 	if(nDensities==1) //Note that nDensities==2 below will also enter this branch sinc eonly one component is non-zero
 	{	int nSpinor = X->spinorLength();
 		for(int i=colStart; i<colStop; i++)
@@ -22,7 +22,10 @@ along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
 #include <electronic/Symmetries.h>
 #include <core/LatticeUtils.h>
 #include <core/BlasExtra.h>
+#include <core/Thread.h>
 #include <algorithm>
+#include <list>
+#include <map>
 
 ColumnBundleTransform::BasisWrapper::BasisWrapper(const Basis& basis) : basis(basis)
 {	//Determine bounds on iG:
@@ -86,6 +89,7 @@ ColumnBundleTransform::ColumnBundleTransform(const vector3<>& kC, const Basis& b
 		}
 		default: assert(!"Invalid value for nSpinor");
 	}
+	spinorRotInv = (invert<0) ? transpose(spinorRot) : dagger(spinorRot);
 }
 
 void ColumnBundleTransform::scatterAxpy(complex alpha, const ColumnBundle& C_C, int bC, ColumnBundle& C_D, int bD) const
@@ -95,10 +99,13 @@ void ColumnBundleTransform::scatterAxpy(complex alpha, const ColumnBundle& C_C,
 	//Scatter:
 	for(int sD=0; sD<nSpinor; sD++)
 		for(int sC=0; sC<nSpinor; sC++)
-			callPref(eblas_scatter_zaxpy)(index.nData(), alpha*spinorRot(sD,sC), index.dataPref(),
+		{	complex coeff = alpha*spinorRot(sD,sC);
+			if(!coeff.norm()) continue; //skip vanishing spinor components
+			callPref(eblas_scatter_zaxpy)(index.nData(), coeff, index.dataPref(),
 				C_C.dataPref() + C_C.index(bC, sC*C_C.basis->nbasis),
 				C_D.dataPref() + C_D.index(bD, sD*C_D.basis->nbasis), invert<0,
 				phase.dataPref(), false);
+		}
 }
 
 void ColumnBundleTransform::gatherAxpy(complex alpha, const ColumnBundle& C_D, int bD, ColumnBundle& C_C, int bC) const
@@ -106,20 +113,135 @@ void ColumnBundleTransform::gatherAxpy(complex alpha, const ColumnBundle& C_D, i
 	assert(C_C.colLength() == nSpinor*basisC.nbasis); assert(bC >= 0 && bC < C_C.nCols());
 	assert(C_D.colLength() == nSpinor*basisD.nbasis); assert(bD >= 0 && bD < C_D.nCols());
 	//Gather:
-	matrix spinorRotInv = (invert<0) ? transpose(spinorRot) : dagger(spinorRot);
 	for(int sD=0; sD<nSpinor; sD++)
 		for(int sC=0; sC<nSpinor; sC++)
-			callPref(eblas_gather_zaxpy)(index.nData(), alpha*spinorRotInv(sC,sD), index.dataPref(),
+		{	complex coeff = alpha*spinorRotInv(sC,sD);
+			if(!coeff.norm()) continue; //skip vanishing spinor components
+			callPref(eblas_gather_zaxpy)(index.nData(), coeff, index.dataPref(),
 				C_D.dataPref() + C_D.index(bD, sD*C_D.basis->nbasis),
 				C_C.dataPref() + C_C.index(bC, sC*C_C.basis->nbasis), invert<0,
 				phase.dataPref(), !(invert < 0));
+		}
+}
+
+//Thread over columns: each thread handles complete columns (the per-column sparse axpy's then run single-threaded)
+void scatterAxpyBlock_sub(size_t bCstart, size_t bCstop, const ColumnBundleTransform* transform,
+	complex alpha, const ColumnBundle* C_C, ColumnBundle* C_D, int bDstart, int bDstep)
+{	for(size_t bC=bCstart; bC<bCstop; bC++) transform->scatterAxpy(alpha, *C_C,bC, *C_D,bDstart+bDstep*bC);
+}
+void gatherAxpyBlock_sub(size_t bCstart, size_t bCstop, const ColumnBundleTransform* transform,
+	complex alpha, const ColumnBundle* C_D, int bDstart, int bDstep, ColumnBundle* C_C)
+{	for(size_t bC=bCstart; bC<bCstop; bC++) transform->gatherAxpy(alpha, *C_D,bDstart+bDstep*bC, *C_C,bC);
 }
 
 void ColumnBundleTransform::scatterAxpy(complex alpha, const ColumnBundle& C_C, ColumnBundle& C_D, int bDstart, int bDstep) const
-{	for(int bC=0; bC<C_C.nCols(); bC++) scatterAxpy(alpha, C_C,bC, C_D,bDstart+bDstep*bC);
+{
+	#ifdef GPU_ENABLED
+	bool threadColumns = false; //GPU kernels already parallelize over each column
+	#else
+	bool threadColumns = (C_C.nCols()>1 && bDstep); //bDstep=0 would accumulate several columns into one destination
+	#endif
+	if(threadColumns)
+		threadLaunch(scatterAxpyBlock_sub, C_C.nCols(), this, alpha, &C_C, &C_D, bDstart, bDstep);
+	else
+		scatterAxpyBlock_sub(0, C_C.nCols(), this, alpha, &C_C, &C_D, bDstart, bDstep);
 }
 
 void ColumnBundleTransform::gatherAxpy(complex alpha, const ColumnBundle& C_D, int bDstart, int bDstep, ColumnBundle& C_C) const
-{	for(int bC=0; bC<C_C.nCols(); bC++) gatherAxpy(alpha, C_D,bDstart+bDstep*bC, C_C,bC);
+{
+	#ifdef GPU_ENABLED
+	bool threadColumns = false; //GPU kernels already parallelize over each column
+	#else
+	bool threadColumns = (C_C.nCols()>1); //destination columns are always distinct
+	#endif
+	if(threadColumns)
+		threadLaunch(gatherAxpyBlock_sub, C_C.nCols(), this, alpha, &C_D, bDstart, bDstep, &C_C);
+	else
+		gatherAxpyBlock_sub(0, C_C.nCols(), this, alpha, &C_D, bDstart, bDstep, &C_C);
+}
+
+//--------------- class ColumnBundleTransform::Cache implementation ----------------------
+
+//! Entries of all ColumnBundleTransform::Cache instances, sharing one memory budget
+struct ColumnBundleTransformCacheRegistry
+{	typedef std::pair<const ColumnBundleTransform*, const ColumnBundle*> Key;
+	typedef std::pair<const ColumnBundleTransform::Cache*, Key> OwnedKey;
+	struct Entry
+	{	OwnedKey key;
+		std::shared_ptr<const ColumnBundle> data;
+		size_t nBytes;
+	};
+	std::list<Entry> entries; //in order of most to least recently used
+	std::map<OwnedKey, std::list<Entry>::iterator> lookup;
+	size_t nBytes, nBytesMax; //current and maximum memory usage
+	std::mutex m;
+	
+	ColumnBundleTransformCacheRegistry() : nBytes(0), nBytesMax(size_t(1024) << 20)
+	{	const char* cacheSizeStr = getenv("JDFTX_WFNS_CACHE_SIZE");
+		if(cacheSizeStr)
+		{	int cacheSizeMB;
+			if(sscanf(cacheSizeStr, "%d", &cacheSizeMB)==1 && cacheSizeMB>=0)
+				nBytesMax = ((size_t)cacheSizeMB) << 20; //convert to bytes
+			else
+				logPrintf("Could not determine wavefunction cache size from JDFTX_WFNS_CACHE_SIZE=\"%s\".\n", cacheSizeStr);
+		}
+	}
+	
+	void erase(std::list<Entry>::iterator iter) //remove an entry (must hold m)
+	{	nBytes -= iter->nBytes;
+		lookup.erase(iter->key);
+		entries.erase(iter);
+	}
+	
+	static ColumnBundleTransformCacheRegistry& get()
+	{	static ColumnBundleTransformCacheRegistry registry;
+		return registry;
+	}
+};
+
+std::shared_ptr<const ColumnBundle> ColumnBundleTransform::Cache::get(const ColumnBundleTransform& transform, const ColumnBundle& C_C, const QuantumNumber* qnumD) const
+{	static StopWatch watch("ColumnBundleTransform::Cache");
+	ColumnBundleTransformCacheRegistry& registry = ColumnBundleTransformCacheRegistry::get();
+	ColumnBundleTransformCacheRegistry::OwnedKey key(this, std::make_pair(&transform, &C_C));
+	//Check for an existing entry:
+	{	std::lock_guard<std::mutex> lock(registry.m);
+		auto iter = registry.lookup.find(key);
+		if(iter != registry.lookup.end())
+		{	registry.entries.splice(registry.entries.begin(), registry.entries, iter->second); //mark most recently used
+			return iter->second->data;
+		}
+	}
+	//Compute (outside lock, so that independent entries may be computed concurrently):
+	watch.start();
+	const Basis& basisD = transform.basisD;
+	std::shared_ptr<ColumnBundle> result = std::make_shared<ColumnBundle>(C_C.nCols(), basisD.nbasis*transform.nSpinor, &basisD, qnumD, isGpuEnabled());
+	result->zero();
+	transform.scatterAxpy(1., C_C, *result, 0,1);
+	watch.stop();
+	//Add to cache, evicting least-recently-used entries as needed:
+	ColumnBundleTransformCacheRegistry::Entry entry;
+	entry.key = key;
+	entry.data = result;
+	entry.nBytes = result->nData() * sizeof(complex);
+	std::lock_guard<std::mutex> lock(registry.m);
+	if(registry.lookup.count(key)) //computed concurrently by another thread
+		return registry.lookup[key]->data;
+	if(entry.nBytes > registry.nBytesMax) return result; //too large to cache
+	while(registry.nBytes + entry.nBytes > registry.nBytesMax)
+		registry.erase(std::prev(registry.entries.end()));
+	registry.entries.push_front(entry);
+	registry.lookup[key] = registry.entries.begin();
+	registry.nBytes += entry.nBytes;
+	return result;
+}
+
+void ColumnBundleTransform::Cache::clear() const
+{	ColumnBundleTransformCacheRegistry& registry = ColumnBundleTransformCacheRegistry::get();
+	std::lock_guard<std::mutex> lock(registry.m);
+	for(auto iter=registry.entries.begin(); iter!=registry.entries.end();)
+	{	auto next = std::next(iter);
+		if(iter->key.first == this) registry.erase(iter);
+		iter = next;
+	}
 }
 
@@ -22,8 +22,10 @@ along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <electronic/Basis.h>
 #include <core/matrix.h>
+#include <memory>
 
 class ColumnBundle;
+class QuantumNumber;
 
 //! @addtogroup Operators
 //! @{
@@ -62,8 +64,30 @@ public:
 	void scatterAxpy(complex alpha, const ColumnBundle& C_C, int bC, ColumnBundle& C_D, int bD) const; //!< scatter-accumulate a single column
 	void gatherAxpy(complex alpha, const ColumnBundle& C_D, int bD, ColumnBundle& C_C, int bC) const; //!< gather-accumulate a single column
 	
-	void scatterAxpy(complex alpha, const ColumnBundle& C_C, ColumnBundle& C_D, int bDstart, int bDstep) const; //!< scatter-accumulate all columns of C_C
-	void gatherAxpy(complex alpha, const ColumnBundle& C_D, int bDstart, int bDstep, ColumnBundle& C_C) const; //!< gather-accumulate all columns of C_C
+	void scatterAxpy(complex alpha, const ColumnBundle& C_C, ColumnBundle& C_D, int bDstart, int bDstep) const; //!< scatter-accumulate all columns of C_C (threaded over columns)
+	void gatherAxpy(complex alpha, const ColumnBundle& C_D, int bDstart, int bDstep, ColumnBundle& C_C) const; //!< gather-accumulate all columns of C_C (threaded over columns)
+	
+	/**
+	Cache of ColumnBundles obtained by scattering all columns of a source with a transform,
+	eg. wavefunctions unfolded from the reduced k-point set to the full k-mesh, for consumers
+	that repeatedly need the same k-points. All caches in a process share one memory budget,
+	set by the environment variable JDFTX_WFNS_CACHE_SIZE (in MB, default 1024), and evict
+	the least-recently-used entries (across all caches) first when it is exceeded.
+	*/
+	class Cache
+	{
+	public:
+		Cache() {}
+		~Cache() { clear(); }
+		Cache(const Cache&)=delete;
+		Cache& operator=(const Cache&)=delete;
+		
+		//! Return transform applied to all columns of C_C (into a zero ColumnBundle with the D basis and quantum number qnumD).
+		//! Entries are identified by the addresses of transform and C_C: call clear() whenever the contents of a source change.
+		std::shared_ptr<const ColumnBundle> get(const ColumnBundleTransform& transform, const ColumnBundle& C_C, const QuantumNumber* qnumD) const;
+		
+		void clear() const; //!< discard all entries of this cache
+	};
 
 private:
 	const Basis& basisC;
@@ -75,6 +99,7 @@ private:
 	ManagedArray<complex> phase; //Bloch phase for space-group translation
 
 	matrix spinorRot; //spinor space rotation
+	matrix spinorRotInv; //inverse spinor space rotation (used for gather)
 };
 
 //! @}
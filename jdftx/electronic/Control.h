@@ -48,15 +48,21 @@ public:
 	
 	bool dragWavefunctions; //!< whether to drag wavefunctions using atomic orbital projections on ionic steps
 	vector3<> lattMoveScale; //!< preconditioning factor for each lattice vector during lattice minimization
+	bool stressFiniteDifference; //!< whether to compute stress by finite differences even when the analytic stress is available
 	
 	int fluidGummel_nIterations; //!< max iterations of the fluid<->electron self-consistency loop
 	double fluidGummel_Atol; //!< stopping free-energy tolerance for the fluid<->electron self-consistency loop
+	double fluidGummel_tolFactor; //!< inner minimization tolerances relative to the latest free-energy change of the fluid<->electron loop
+	int fluidGummel_history; //!< Anderson acceleration history for the fluid<->electron loop (0 => plain alternation)
+	double fluidGummel_mixFraction; //!< Anderson mixing fraction for the fluid<->electron loop
 
 	bool shouldPrintEigsFillings; //!< whether eigenvalues and fillings should be printed at each iteration
 	bool shouldPrintEcomponents; //!< whether energy components should be printed at each iteration
 	bool shouldPrintMuSearch; //!< whether mu bisection progress should be printed
 	bool shouldPrintKpointsBasis; //!< whether individual kpoint and basis details should be printed at the beginning
 	
+	double mixedPrecisionThreshold; //!< residual below which wavefunction transforms are promoted from single to double precision (0 => always double)
+	
 	double subspaceRotationFactor; //!< preconditioning factor for subspace rotations / aux hamiltonian relative to wavefunctions
 	bool subspaceRotationAdjust; //!< whether to automatically tune subspace rotation factor
 	
@@ -67,9 +73,10 @@ public:
 	Control()
 	:	fixed_H(false),
 		cacheProjectors(true), davidsonBandRatio(1.1),
-		elecEigenAlgo(ElecEigenDavidson), basisKdep(BasisKpointDep), Ecut(0), EcutRho(0), dragWavefunctions(true),
-		fluidGummel_nIterations(10), fluidGummel_Atol(1e-5),
+		elecEigenAlgo(ElecEigenDavidson), basisKdep(BasisKpointDep), Ecut(0), EcutRho(0), dragWavefunctions(true), stressFiniteDifference(false),
+		fluidGummel_nIterations(10), fluidGummel_Atol(1e-5), fluidGummel_tolFactor(0.01), fluidGummel_history(0), fluidGummel_mixFraction(0.5),
 		shouldPrintEigsFillings(false), shouldPrintEcomponents(false), shouldPrintMuSearch(false), shouldPrintKpointsBasis(false),
+		mixedPrecisionThreshold(0.),
 		subspaceRotationFactor(1.), subspaceRotationAdjust(true), scf(false), convergeEmptyStates(false), dumpOnly(false)
 	{
 	}
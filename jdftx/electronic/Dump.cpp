@@ -21,6 +21,7 @@ along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
 #include <electronic/Dump_internal.h>
 #include <electronic/Everything.h>
 #include <electronic/ColumnBundle.h>
+#include <electronic/WavefunctionFile.h>
 #include <electronic/SpeciesInfo.h>
 #include <electronic/ExactExchange.h>
 #include <electronic/DOS.h>
@@ -30,10 +31,11 @@ along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
 #include <fluid/FluidSolver.h>
 #include <core/VectorField.h>
 #include <core/ScalarFieldIO.h>
+#include <core/Checkpoint.h>
 #include <ctime>
 
 Dump::Dump()
-: potentialSubtraction(true)
+: potentialSubtraction(true), excitationsMax(0), excitationsEmax(0.)
 {
 }
 
@@ -66,6 +68,7 @@ void Dump::setup(const Everything& everything)
 
 void Dump::operator()(DumpFrequency freq, int iter)
 {
+	if(freq==DumpFreq_End && checkpoint) checkpoint->finish(); //commit pending state before final dump
 	if(!checkInterval(freq, iter)) return; // => don't dump this time
 	
 	bool foundVars = false; //whether any variables are to be dumped at this frequency
@@ -97,7 +100,8 @@ void Dump::operator()(DumpFrequency freq, int iter)
 
 	#define DUMP_nocheck(object, prefix) \
 		{	StartDump(prefix) \
-			if(mpiUtil->isHead()) saveRawBinary(object, fname.c_str()); \
+			if(hdf5) saveHDF5(object, fname.c_str(), hdf5.get()); \
+			else if(mpiUtil->isHead()) saveRawBinary(object, fname.c_str()); \
 			EndDump \
 		}
 	
@@ -138,15 +142,43 @@ void Dump::operator()(DumpFrequency freq, int iter)
 	
 	if(ShouldDump(State))
 	{
+		if(checkpoint) checkpoint->finish(); //commit previous checkpoint before starting next one
+		
 		//Dump wave functions
 		StartDump("wfns")
-		write(eVars.C, fname.c_str(), eInfo);
+		if(checkpoint && wfnsContainer)
+			checkpoint->write(fname, WavefunctionFile::pack(eVars.C, eInfo, *wfnsContainer));
+		else if(checkpoint)
+		{	//Stage local wavefunctions and write them in the background:
+			size_t nBytes = 0;
+			for(int q=eInfo.qStart; q<eInfo.qStop; q++)
+				nBytes += eVars.C[q].nData()*sizeof(complex);
+			std::vector<char> data(nBytes);
+			char* dataPtr = data.data();
+			for(int q=eInfo.qStart; q<eInfo.qStop; q++)
+			{	size_t nBytesQ = eVars.C[q].nData()*sizeof(complex);
+				memcpy(dataPtr, eVars.C[q].data(), nBytesQ);
+				dataPtr += nBytesQ;
+			}
+			convertToLE(data.data(), sizeof(double), nBytes/sizeof(double));
+			checkpoint->write(fname, std::move(data));
+		}
+		else
+		{	Checkpoint::invalidate(fname); //in case left over from a previous checkpointed run
+			if(hdf5) writeHDF5(eVars.C, fname.c_str(), eInfo, hdf5.get());
+			else if(wfnsContainer) WavefunctionFile::write(eVars.C, fname.c_str(), eInfo, *wfnsContainer);
+			else write(eVars.C, fname.c_str(), eInfo);
+		}
 		EndDump
 		
 		if(hasFluid)
 		{	//Dump state of fluid:
 			StartDump("fluidState")
-			if(mpiUtil->isHead()) eVars.fluidSolver->saveState(fname.c_str());
+			if(checkpoint) checkpoint->writeHead(fname, [&](const char* fnameTmp){ eVars.fluidSolver->saveState(fnameTmp); });
+			else
+			{	Checkpoint::invalidate(fname);
+				if(mpiUtil->isHead()) eVars.fluidSolver->saveState(fname.c_str());
+			}
 			EndDump
 		}
 	}
@@ -608,6 +640,8 @@ void Dump::operator()(DumpFrequency freq, int iter)
 	if(freq==DumpFreq_End && ShouldDump(ElectronScattering))
 	{	electronScattering->dump(*e);
 	}
+	
+	if(freq==DumpFreq_End && checkpoint) checkpoint->finish(); //commit final state
 }
 
 bool Dump::checkInterval(DumpFrequency freq, int iter) const
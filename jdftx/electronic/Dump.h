@@ -82,6 +82,11 @@ public:
 	std::shared_ptr<struct BulkEpsilon> bulkEpsilon; //!< bulk dielectric constant calculator
 	std::shared_ptr<struct ChargedDefect> chargedDefect; //!< charged defect correction calculator
 	bool potentialSubtraction; //!< whether to subtract neutral-atom potentials in Dvac and Dtot output
+	int excitationsMax; //!< if non-zero, number of lowest-energy excitations to output in dump Excitations
+	double excitationsEmax; //!< if non-zero, maximum excitation energy to output in dump Excitations
+	std::shared_ptr<struct WfnsContainerParams> wfnsContainer; //!< if non-null, write wfns in the self-describing container format
+	std::shared_ptr<struct H5writeParams> hdf5; //!< if non-null, write wfns and scalar fields collectively in parallel HDF5 format
+	std::shared_ptr<class Checkpoint> checkpoint; //!< if non-null, write state (wfns, fluidState, scfHistory) asynchronously and atomically
 private:
 	const Everything* e;
 	string format; //!< Filename format containing $VAR, $STAMP, $FREQ etc.
@@ -51,11 +51,7 @@ void Dump::dumpBGW()
 	const double Ryd = 0.5; //in Hartrees
 	
 	//Open file:
-	hid_t plid = H5Pcreate(H5P_FILE_ACCESS);
-    H5Pset_fapl_mpio(plid, MPI_COMM_WORLD, MPI_INFO_NULL);
-	hid_t fid = H5Fcreate(fname.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, plid);
-	if(fid<0) die("Could not open/create output HDF5 file '%s'\n", fname.c_str());
-	H5Pclose(plid);
+	hid_t fid = h5createFile(fname.c_str(), hdf5.get());
 	
 	//======== Header ========
 	hid_t gidHeader = h5createGroup(fid, "mf_header");
@@ -180,38 +176,32 @@ void Dump::dumpBGW()
 	//--- Coefficients:
 	{	//Create dataset (must happen on all processes together):
 		hsize_t dims[4] = { hsize_t(eInfo.nBands), hsize_t(nSpins*nSpinor), iGarr.size(), 2 };
-		hid_t sid = H5Screate_simple(4, dims, NULL);
-		hid_t did = H5Dcreate(gidWfns, "coeffs", H5T_NATIVE_DOUBLE, sid, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-		hid_t plid = H5Pcreate(H5P_DATASET_XFER);
-		H5Sclose(sid);
-		//Loop over k, bands and spin/spinors:
-		hsize_t offset[4] = { 0, 0, 0, 0 };
-		hsize_t count[4] = { 1, 1, 1, 2 };
-		std::vector<complex> buffer(*std::max_element(nBasis.begin(), nBasis.end()));
+		hsize_t chunkDims[4] = { hsize_t(std::min(eInfo.nBands, hdf5 ? hdf5->blockBands : 1)), 1, hsize_t(nBasisMax), 2 };
+		hid_t did = h5createDataset(gidWfns, "coeffs", H5T_NATIVE_DOUBLE, dims, 4, hdf5 ? chunkDims : 0, hdf5 && hdf5->compress);
+		//Write all bands of one local state and spinor component per collective call:
+		int nRounds = 0; //maximum number of states on any process
+		for(int iProc=0; iProc<mpiUtil->nProcesses(); iProc++)
+			nRounds = std::max(nRounds, eInfo.qStopOther(iProc)-eInfo.qStartOther(iProc));
+		std::vector<complex> buffer(eInfo.nBands * nBasisMax);
 		double volScaleFac = sqrt(gInfo.detR);
-		for(int iSpin=0; iSpin<nSpins; iSpin++)
 		for(int iSpinor=0; iSpinor<nSpinor; iSpinor++)
-		{	offset[1] = iSpin*nSpinor + iSpinor;
-			for(int ik=0; ik<nReducedKpts; ik++)
-			{	int q=iSpin*nReducedKpts+ik;
-				if(!eInfo.isMine(q)) continue;
-				count[2] = nBasis[ik];
+		for(int iRound=0; iRound<nRounds; iRound++)
+		{	int q = eInfo.qStart + iRound;
+			hsize_t offset[4] = { 0, 0, 0, 0 };
+			hsize_t count[4] = { 0, 0, 0, 0 }; //empty selection on processes without a state this round
+			if(q < eInfo.qStop)
+			{	int iSpin = q / nReducedKpts;
+				int ik = q % nReducedKpts;
+				offset[1] = iSpin*nSpinor + iSpinor;
 				offset[2] = nBasisPrev[ik];
-				hid_t sidMem = H5Screate_simple(4, count, NULL);
+				count[0] = eInfo.nBands; count[1] = 1; count[2] = nBasis[ik]; count[3] = 2;
+				//Copy to buffer and scale:
 				for(int b=0; b<eInfo.nBands; b++)
-				{	offset[0] = b;
-					sid = H5Dget_space(did);
-					H5Sselect_hyperslab(sid, H5S_SELECT_SET, offset, NULL, count, NULL);
-					//Copy to buffer and scale:
-					eblas_copy(buffer.data(), eVars.C[q].data()+eVars.C[q].index(b, iSpinor*nBasis[ik]), nBasis[ik]);
-					eblas_zdscal(nBasis[ik], volScaleFac, buffer.data(), 1);
-					//Write buffer to HDF5:
-					H5Dwrite(did, H5T_NATIVE_DOUBLE, sidMem, sid, plid, buffer.data());
-				}
-				H5Sclose(sidMem);
+					eblas_copy(buffer.data()+b*nBasis[ik], eVars.C[q].data()+eVars.C[q].index(b, iSpinor*nBasis[ik]), nBasis[ik]);
+				eblas_zdscal(eInfo.nBands*nBasis[ik], volScaleFac, buffer.data(), 1);
 			}
+			h5writeSlab(did, (const double*)buffer.data(), offset, count, 4);
 		}
-		H5Pclose(plid);
 		H5Dclose(did);
 	}
 	H5Gclose(gidWfns);
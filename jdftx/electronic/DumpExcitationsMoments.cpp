@@ -24,12 +24,14 @@ along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
 #include <core/WignerSeitz.h>
 #include <core/Operators.h>
 #include <core/Units.h>
+#include <queue>
 
 //---------------------- Excitations -----------------------------------------------
 
 void dumpExcitations(const Everything& e, const char* filename)
 {
 	const GridInfo& g = e.gInfo;
+	const ElecInfo& eInfo = e.eInfo;
 
 	struct excitation
 	{	int q,o,u;
@@ -41,7 +43,6 @@ void dumpExcitations(const Everything& e, const char* filename)
 		inline bool operator<(const excitation& other) const {return dE<other.dE;}
 		void print(FILE* fp) const { fprintf(fp, "%5i %3i %3i %12.5e %12.5e %12.5e %12.5e\n", q, o, u, dE, dreal, dimag, dnorm); }
 	};
-	std::vector<excitation> excitations;
 
 	double maxHOMO=-DBL_MAX, minLUMO=DBL_MAX; // maximum (minimum) of all HOMOs (LUMOs) in all qnums
 	int maxHOMOq=0, minLUMOq=0, maxHOMOn=0, minLUMOn=0; //Indices and energies for the indirect gap
@@ -54,12 +55,72 @@ void dumpExcitations(const Everything& e, const char* filename)
 		FILE* fp = fopen(fname.c_str(), "r");
 		if(fp)
 		{	fclose(fp);
-			eigsQP.resize(e.eInfo.nStates);
-			e.eInfo.read(eigsQP, fname.c_str());
+			eigsQP.resize(eInfo.nStates);
+			eInfo.read(eigsQP, fname.c_str());
 		}
 	}
 	const std::vector<diagMatrix>& eigs = eigsQP.size() ? eigsQP : e.eVars.Hsub_eigs;
 	
+	//Find local HOMOs, band edges and range of excitation energies (from eigenvalues alone):
+	bool insufficientBands = false;
+	std::vector<int> HOMO(eInfo.nStates, -1);
+	std::vector< std::vector<double> > eigsUnocc(eInfo.nStates); //sorted unoccupied eigenvalues (to count excitations below an energy)
+	double dEmin=DBL_MAX, dEmax=-DBL_MAX; int qOpt=0, oOpt=0, uOpt=0; //range of excitation energies and lowest excitation
+	for(int q=eInfo.qStart; q<eInfo.qStop; q++)
+	{	HOMO[q] = eInfo.findHOMO(q);
+		if(HOMO[q]+1>=eInfo.nBands) { insufficientBands=true; break; }
+		
+		//Update global HOMO and LUMO of current process:
+		if(eigs[q][HOMO[q]]   > maxHOMO) { maxHOMOq = q; maxHOMOn = HOMO[q];   maxHOMO = eigs[q][HOMO[q]];   }
+		if(eigs[q][HOMO[q]+1] < minLUMO) { minLUMOq = q; minLUMOn = HOMO[q]+1; minLUMO = eigs[q][HOMO[q]+1]; }
+		
+		eigsUnocc[q].assign(eigs[q].begin()+HOMO[q]+1, eigs[q].end());
+		std::sort(eigsUnocc[q].begin(), eigsUnocc[q].end());
+		for(int o=HOMO[q]; o>=0; o--)
+			for(int u=(HOMO[q]+1); u<eInfo.nBands; u++)
+			{	double dE = eigs[q][u]-eigs[q][o]; //Excitation energy
+				if(dE < dEmin) { dEmin = dE; qOpt = q; oOpt = o; uOpt = u; }
+				dEmax = std::max(dEmax, dE);
+			}
+	}
+	mpiUtil->allReduce(insufficientBands, MPIUtil::ReduceLOr);
+	if(insufficientBands)
+	{	logPrintf("Insufficient bands to calculate excited states!\n");
+		logPrintf("Increase the number of bands (elec-n-bands) and try again!\n");
+		return;
+	}
+	
+	//Global band edges and lowest (optical) excitation:
+	int maxHOMOindex = maxHOMOq*eInfo.nBands + maxHOMOn; mpiUtil->allReduce(maxHOMO, maxHOMOindex, MPIUtil::ReduceMax);
+	int minLUMOindex = minLUMOq*eInfo.nBands + minLUMOn; mpiUtil->allReduce(minLUMO, minLUMOindex, MPIUtil::ReduceMin);
+	maxHOMOq = maxHOMOindex / eInfo.nBands; maxHOMOn = maxHOMOindex % eInfo.nBands;
+	minLUMOq = minLUMOindex / eInfo.nBands; minLUMOn = minLUMOindex % eInfo.nBands;
+	int optProcess = mpiUtil->iProcess(); mpiUtil->allReduce(dEmin, optProcess, MPIUtil::ReduceMin);
+	int optIndices[3] = { qOpt, oOpt, uOpt }; mpiUtil->bcast(optIndices, 3, optProcess);
+	mpiUtil->allReduce(dEmax, MPIUtil::ReduceMax);
+	
+	//Select energy cutoff of retained excitations:
+	//--- energy window:
+	double dEcut = e.dump.excitationsEmax ? std::min(e.dump.excitationsEmax, dEmax) : dEmax;
+	//--- distributed top-K selection by bisection on the cutoff, counting excitations from eigenvalues alone:
+	size_t nMax = e.dump.excitationsMax;
+	auto countExcitations = [&](double dEthreshold)
+	{	size_t nExcitations = 0;
+		for(int q=eInfo.qStart; q<eInfo.qStop; q++)
+			for(int o=HOMO[q]; o>=0; o--)
+				nExcitations += std::upper_bound(eigsUnocc[q].begin(), eigsUnocc[q].end(), eigs[q][o]+dEthreshold) - eigsUnocc[q].begin();
+		mpiUtil->allReduce(nExcitations, MPIUtil::ReduceSum);
+		return nExcitations;
+	};
+	if(nMax && countExcitations(dEcut) > nMax)
+	{	double dElo = dEmin, dEhi = dEcut; //countExcitations(dEhi) >= nMax throughout
+		for(int iBisect=0; iBisect<64 && dEhi-dElo > 1e-12*std::max(1., fabs(dEhi)); iBisect++)
+		{	double dEmid = 0.5*(dElo + dEhi);
+			if(countExcitations(dEmid) >= nMax) dEhi = dEmid; else dElo = dEmid;
+		}
+		dEcut = dEhi;
+	}
+	
 	// Integral kernel's for Fermi's golden rule
 	ScalarField r0, r1, r2;
 	nullToZero(r0, g); 	nullToZero(r1, g); 	nullToZero(r2, g);
@@ -67,99 +128,122 @@ void dumpExcitations(const Everything& e, const char* filename)
 	applyFunc_r(g, Moments::rn_pow_x, 1, g.R, 1, vector3<>(0.,0.,0.), r1->data());
 	applyFunc_r(g, Moments::rn_pow_x, 2, g.R, 1, vector3<>(0.,0.,0.), r2->data());
 	
-	//Find and cache all excitations in system (between same qnums)
-	bool insufficientBands = false;
-	for(int q=e.eInfo.qStart; q<e.eInfo.qStop; q++)
-	{	//Find local HOMO and check band sufficiency:
-		int HOMO = e.eInfo.findHOMO(q);
-		if(HOMO+1>=e.eInfo.nBands) { insufficientBands=true; break; }
-		
-		//Update global HOMO and LUMO of current process:
-		if(eigs[q][HOMO]   > maxHOMO) { maxHOMOq = q; maxHOMOn = HOMO;   maxHOMO = eigs[q][HOMO];   }
-		if(eigs[q][HOMO+1] < minLUMO) { minLUMOq = q; minLUMOn = HOMO+1; minLUMO = eigs[q][HOMO+1]; }
-		
-		for(int o=HOMO; o>=0; o--)
-		{	for(int u=(HOMO+1); u<e.eInfo.nBands; u++)
-			{	complex x = integral(I(e.eVars.C[q].getColumn(u,0))*r0*I(e.eVars.C[q].getColumn(o,0)));
-				complex y = integral(I(e.eVars.C[q].getColumn(u,0))*r1*I(e.eVars.C[q].getColumn(o,0)));
-				complex z = integral(I(e.eVars.C[q].getColumn(u,0))*r2*I(e.eVars.C[q].getColumn(o,0)));
+	//Compute matrix elements only for the retained excitations on this process (between same qnums):
+	std::vector<excitation> excitations;
+	for(int q=eInfo.qStart; q<eInfo.qStop; q++)
+	{	const ColumnBundle& C = e.eVars.C[q];
+		for(int o=HOMO[q]; o>=0; o--)
+		{	complexScalarField r0psiO, r1psiO, r2psiO; //kernels times occupied orbital (computed once per o, if needed)
+			for(int u=(HOMO[q]+1); u<eInfo.nBands; u++)
+			{	double dE = eigs[q][u]-eigs[q][o]; //Excitation energy
+				if(dE > dEcut) continue;
+				if(!r0psiO)
+				{	complexScalarField psiO = I(C.getColumn(o,0));
+					r0psiO = r0*psiO; r1psiO = r1*psiO; r2psiO = r2*psiO;
+				}
+				complexScalarField psiU = I(C.getColumn(u,0));
+				complex x = integral(psiU*r0psiO);
+				complex y = integral(psiU*r1psiO);
+				complex z = integral(psiU*r2psiO);
 				vector3<> dreal(x.real(), y.real(),z.real());
 				vector3<> dimag(x.imag(), y.imag(),z.imag());
 				vector3<> dnorm(sqrt(x.norm()), sqrt(y.norm()),sqrt(z.norm()));
-				double dE = eigs[q][u]-eigs[q][o]; //Excitation energy
 				excitations.push_back(excitation(q, o, u, dE, dreal.length_squared(), dimag.length_squared(), dnorm.length_squared()));
 			}
 		}
 	}
-	mpiUtil->allReduce(insufficientBands, MPIUtil::ReduceLOr);
-	if(insufficientBands)
-	{	logPrintf("Insufficient bands to calculate excited states!\n");
-		logPrintf("Increase the number of bands (elec-n-bands) and try again!\n");
-		return;
-	}
+	std::sort(excitations.begin(), excitations.end());
 	
-	//Transmit results to head process:
+	//Merge sorted lists of all processes, streaming to file from head in chunks (bounded memory on head):
+	const size_t chunkSize = 1024; //number of excitations per message
 	if(mpiUtil->isHead())
-	{	excitations.reserve(excitations.size() * mpiUtil->nProcesses());
-		for(int jProcess=1; jProcess<mpiUtil->nProcesses(); jProcess++)
-		{	//Receive data:
-			size_t nExcitations; mpiUtil->recv(nExcitations, jProcess, 0);
-			std::vector<int> msgInt(4 + nExcitations*3); 
-			std::vector<double> msgDbl(2 + nExcitations*4);
-			mpiUtil->recv(msgInt.data(), msgInt.size(), jProcess, 1);
-			mpiUtil->recv(msgDbl.data(), msgDbl.size(), jProcess, 2);
+	{	FILE* fp = fopen(filename, "w");
+		if(!fp) die("Error opening %s for writing.\n", filename);
+		
+		fprintf(fp, "Using %s eigenvalues.      HOMO: %.5f   LUMO: %.5f  \n", eigsQP.size() ? "discontinuity-corrected QP" : "KS", maxHOMO, minLUMO);
+		fprintf(fp, "Optical (direct) gap: %.5e (from n = %i to %i in qnum = %i)\n", dEmin, optIndices[1], optIndices[2], optIndices[0]);
+		fprintf(fp, "Indirect gap: %.5e (from (%i, %i) to (%i, %i))\n\n", minLUMO-maxHOMO, maxHOMOq, maxHOMOn, minLUMOq, minLUMOn);
+		
+		fprintf(fp, "Optical excitation energies and corresponding electric dipole transition strengths\n");
+		fprintf(fp, "qnum   i   f      dE        |<psi1|r|psi2>|^2 (real, imag, norm)\n");
+		
+		//Current chunk and position in it from each process:
+		int nProcesses = mpiUtil->nProcesses();
+		std::vector< std::vector<excitation> > chunk(nProcesses);
+		std::vector<size_t> pos(nProcesses, 0);
+		chunk[0].swap(excitations);
+		auto fetchChunk = [&](int jProcess)
+		{	//Request and receive:
+			int request = 1; mpiUtil->send(request, jProcess, 0);
+			size_t nExcitations; mpiUtil->recv(nExcitations, jProcess, 1);
+			std::vector<int> msgInt(nExcitations*3);
+			std::vector<double> msgDbl(nExcitations*4);
+			if(nExcitations)
+			{	mpiUtil->recv(msgInt.data(), msgInt.size(), jProcess, 2);
+				mpiUtil->recv(msgDbl.data(), msgDbl.size(), jProcess, 3);
+			}
 			//Unpack:
+			chunk[jProcess].clear();
+			pos[jProcess] = 0;
 			std::vector<int>::const_iterator intPtr = msgInt.begin();
 			std::vector<double>::const_iterator dblPtr = msgDbl.begin();
-			//--- globals:
-			int j_maxHOMOq = *(intPtr++); int j_maxHOMOn = *(intPtr++); double j_maxHOMO = *(dblPtr++);
-			int j_minLUMOq = *(intPtr++); int j_minLUMOn = *(intPtr++); double j_minLUMO = *(dblPtr++);
-			if(j_maxHOMO > maxHOMO) { maxHOMOq=j_maxHOMOq; maxHOMOn=j_maxHOMOn; maxHOMO=j_maxHOMO; }
-			if(j_minLUMO < minLUMO) { minLUMOq=j_minLUMOq; minLUMOn=j_minLUMOn; minLUMO=j_minLUMO; }
-			//--- excitation array:
 			for(size_t iExcitation=0; iExcitation<nExcitations; iExcitation++)
 			{	int q = *(intPtr++); int o = *(intPtr++); int u = *(intPtr++);
 				double dE = *(dblPtr++);
 				double dreal = *(dblPtr++); double dimag = *(dblPtr++); double dnorm = *(dblPtr++);
-				excitations.push_back(excitation(q, o, u, dE, dreal, dimag, dnorm));
+				chunk[jProcess].push_back(excitation(q, o, u, dE, dreal, dimag, dnorm));
 			}
+		};
+		
+		//k-way merge with a heap of the current lowest energy from each process:
+		typedef std::pair<double,int> HeapEntry; //energy and process
+		std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry> > heap;
+		for(int jProcess=0; jProcess<nProcesses; jProcess++)
+		{	if(jProcess) fetchChunk(jProcess);
+			if(chunk[jProcess].size()) heap.push(HeapEntry(chunk[jProcess].front().dE, jProcess));
+		}
+		size_t nWritten = 0;
+		while(heap.size() && (!nMax || nWritten<nMax))
+		{	int jProcess = heap.top().second; heap.pop();
+			chunk[jProcess][pos[jProcess]++].print(fp);
+			nWritten++;
+			if(jProcess && pos[jProcess]==chunk[jProcess].size()) fetchChunk(jProcess);
+			if(pos[jProcess]<chunk[jProcess].size()) heap.push(HeapEntry(chunk[jProcess][pos[jProcess]].dE, jProcess));
+		}
+		fclose(fp);
+		
+		//Release other processes:
+		for(int jProcess=1; jProcess<nProcesses; jProcess++)
+		{	int request = 0; mpiUtil->send(request, jProcess, 0);
 		}
 	}
 	else
-	{	//Pack data:
-		std::vector<int> msgInt; std::vector<double> msgDbl;
-		size_t nExcitations = excitations.size();
-		msgInt.reserve(4 + nExcitations*3);
-		msgDbl.reserve(2 + nExcitations*4);
-		msgInt.push_back(maxHOMOq); msgInt.push_back(maxHOMOn); msgDbl.push_back(maxHOMO);
-		msgInt.push_back(minLUMOq); msgInt.push_back(minLUMOn); msgDbl.push_back(minLUMO);
-		for(const excitation& e: excitations)
-		{	msgInt.push_back(e.q); msgInt.push_back(e.o); msgInt.push_back(e.u);
-			msgDbl.push_back(e.dE);
-			msgDbl.push_back(e.dreal); msgDbl.push_back(e.dimag); msgDbl.push_back(e.dnorm);
+	{	//Send chunks of sorted list on request from head:
+		size_t iStart = 0;
+		while(true)
+		{	int request; mpiUtil->recv(request, 0, 0);
+			if(!request) break;
+			size_t iStop = std::min(iStart+chunkSize, excitations.size());
+			size_t nExcitations = iStop - iStart;
+			//Pack data:
+			std::vector<int> msgInt; std::vector<double> msgDbl;
+			msgInt.reserve(nExcitations*3);
+			msgDbl.reserve(nExcitations*4);
+			for(size_t iExcitation=iStart; iExcitation<iStop; iExcitation++)
+			{	const excitation& e = excitations[iExcitation];
+				msgInt.push_back(e.q); msgInt.push_back(e.o); msgInt.push_back(e.u);
+				msgDbl.push_back(e.dE);
+				msgDbl.push_back(e.dreal); msgDbl.push_back(e.dimag); msgDbl.push_back(e.dnorm);
+			}
+			//Send data:
+			mpiUtil->send(nExcitations, 0, 1);
+			if(nExcitations)
+			{	mpiUtil->send(msgInt.data(), msgInt.size(), 0, 2);
+				mpiUtil->send(msgDbl.data(), msgDbl.size(), 0, 3);
+			}
+			iStart = iStop;
 		}
-		//Send data:
-		mpiUtil->send(nExcitations, 0, 0);
-		mpiUtil->send(msgInt.data(), msgInt.size(), 0, 1);
-		mpiUtil->send(msgDbl.data(), msgDbl.size(), 0, 2);
 	}
-
-	//Process and print excitations:
-	if(!mpiUtil->isHead()) return;
-	
-	FILE* fp = fopen(filename, "w");
-	if(!fp) die("Error opening %s for writing.\n", filename);
-	
-	std::sort(excitations.begin(), excitations.end());
-	const excitation& opt = excitations.front();
-	fprintf(fp, "Using %s eigenvalues.      HOMO: %.5f   LUMO: %.5f  \n", eigsQP.size() ? "discontinuity-corrected QP" : "KS", maxHOMO, minLUMO);
-	fprintf(fp, "Optical (direct) gap: %.5e (from n = %i to %i in qnum = %i)\n", opt.dE, opt.o, opt.u, opt.q);
-	fprintf(fp, "Indirect gap: %.5e (from (%i, %i) to (%i, %i))\n\n", minLUMO-maxHOMO, maxHOMOq, maxHOMOn, minLUMOq, minLUMOn);
-	
-	fprintf(fp, "Optical excitation energies and corresponding electric dipole transition strengths\n");
-	fprintf(fp, "qnum   i   f      dE        |<psi1|r|psi2>|^2 (real, imag, norm)\n");
-	for(const excitation& e: excitations) e.print(fp);
-	fclose(fp);
 }
 
 
@@ -28,39 +28,101 @@ DumpSelfInteractionCorrection::DumpSelfInteractionCorrection(const Everything& e
 	e = &everything;	
 }
 
-double DumpSelfInteractionCorrection::operator()(std::vector<diagMatrix>* correctedEigenvalues)
-{
-	// Loop over all quantum numbers (spin+kpoint) and bands; and corrects their eigenvalues
-	double selfInteractionEnergy = 0;
-	DC.resize(3);
-	for(int q=0; q<e->eInfo.nStates; q++) //need to loop over all states since XC is MPI parallelized
-	{	if(e->exCorr.needsKEdensity() && e->eInfo.isMine(q))
+//Compute densities (and KE densities if DC is non-empty) of orbitals [bOffset+iStart, bOffset+iStop) of C on grid gInfo
+void orbitalDensities_sub(size_t iStart, size_t iStop, const ColumnBundle* C, const std::vector<ColumnBundle>* DC,
+	int bOffset, const GridInfo* gInfo, ScalarField* nOrb, ScalarField* tauOrb)
+{	const GridInfo& gInfoWfns = *(C->basis->gInfo);
+	for(size_t i=iStart; i<iStop; i++)
+	{	int b = bOffset + i;
+		ScalarField n; nullToZero(n, gInfoWfns);
+		for(int s=0; s<C->spinorLength(); s++) //total density of all spinor components
+			callPref(eblas_accumNorm)(gInfoWfns.nr, 1., I(C->getColumn(b,s))->dataPref(), n->dataPref());
+		nOrb[i] = (&gInfoWfns==gInfo) ? n : changeGrid(n, *gInfo);
+		if(DC->size())
+		{	ScalarField tau; nullToZero(tau, gInfoWfns);
 			for(int iDir=0; iDir<3; iDir++)
-				DC[iDir] = D(e->eVars.C[q], iDir);
-		if(e->eInfo.isMine(q) && correctedEigenvalues)
-			(*correctedEigenvalues)[q].resize(e->eInfo.nBands);
-		for(int n=0; n<e->eInfo.nBands; n++)
-		{	double selfInteractionError = calcSelfInteractionError(q,n);
-			if(e->eInfo.isMine(q))
-			{	if(correctedEigenvalues)
-					(*correctedEigenvalues)[q][n] = e->eVars.Hsub_eigs[q][n] - selfInteractionError;
-				selfInteractionEnergy += e->eVars.F[q][n]*e->eInfo.qnums[q].weight*selfInteractionError;
+				for(int s=0; s<C->spinorLength(); s++)
+					callPref(eblas_accumNorm)(gInfoWfns.nr, 0.5, I(DC->at(iDir).getColumn(b,s))->dataPref(), tau->dataPref());
+			tauOrb[i] = (&gInfoWfns==gInfo) ? tau : changeGrid(tau, *gInfo);
+		}
+	}
+}
+
+double DumpSelfInteractionCorrection::operator()(std::vector<diagMatrix>* correctedEigenvalues)
+{	const ElecInfo& eInfo = e->eInfo;
+	const int nBands = eInfo.nBands;
+	const int iProcess = mpiUtil->iProcess();
+	
+	//Divide all orbitals (q,n) evenly over processes, independent of the k-point division:
+	TaskDivision orbitalDivision(eInfo.nStates*nBands, mpiUtil);
+	auto bandRange = [&](int iProc, int q, int& bStart, int& bStop)
+	{	bStart = std::max(int(orbitalDivision.start(iProc)) - q*nBands, 0);
+		bStop = std::min(int(orbitalDivision.stop(iProc)) - q*nBands, nBands);
+		return bStart < bStop;
+	};
+	
+	//Collect wavefunctions of the orbitals assigned to this process from the owners of their states
+	//(all processes traverse the transfers in the same order, so blocking send/recv cannot deadlock):
+	std::vector<ColumnBundle> Corb(eInfo.nStates); //assigned bands of each state
+	std::vector<int> bOffset(eInfo.nStates, 0); //first assigned band of each state
+	for(int q=0; q<eInfo.nStates; q++)
+	{	int src = eInfo.whose(q);
+		int dstStart = orbitalDivision.whose(q*nBands);
+		int dstStop = orbitalDivision.whose((q+1)*nBands-1) + 1;
+		for(int dst=dstStart; dst<dstStop; dst++)
+		{	int bStart, bStop;
+			if(!bandRange(dst, q, bStart, bStop)) continue;
+			if(dst == iProcess)
+			{	bOffset[q] = bStart;
+				if(src == iProcess) Corb[q] = e->eVars.C[q].getSub(bStart, bStop);
+				else
+				{	Corb[q].init(bStop-bStart, e->basis[q].nbasis*eInfo.spinorLength(), &e->basis[q], &eInfo.qnums[q], isGpuEnabled());
+					Corb[q].recv(src);
+				}
 			}
+			else if(src == iProcess)
+				e->eVars.C[q].getSub(bStart, bStop).send(dst);
+		}
+	}
+	
+	//Evaluate self-interaction errors of assigned orbitals locally, with densities computed in blocks (one orbital per thread):
+	std::vector<double> selfInteractionError(eInfo.nStates*nBands, 0.);
+	int nBlock = isGpuEnabled() ? 1 : nProcsAvailable;
+	for(int q=0; q<eInfo.nStates; q++)
+		if(Corb[q])
+		{	std::vector<ColumnBundle> DC;
+			if(e->exCorr.needsKEdensity())
+				for(int iDir=0; iDir<3; iDir++)
+					DC.push_back(D(Corb[q], iDir));
+			for(int bStart=0; bStart<Corb[q].nCols(); bStart+=nBlock)
+			{	int bStop = std::min(bStart+nBlock, Corb[q].nCols());
+				ScalarFieldArray nOrb(bStop-bStart), tauOrb(bStop-bStart);
+				threadLaunch(isGpuEnabled() ? 1 : 0, orbitalDensities_sub, bStop-bStart, &Corb[q], &DC, bStart, &e->gInfo, nOrb.data(), tauOrb.data());
+				for(int b=bStart; b<bStop; b++)
+					selfInteractionError[q*nBands + bOffset[q] + b] = calcSelfInteractionError(nOrb[b-bStart], tauOrb[b-bStart]);
+			}
+			Corb[q].free();
+		}
+	mpiUtil->allReduce(selfInteractionError.data(), selfInteractionError.size(), MPIUtil::ReduceSum);
+	
+	//Correct eigenvalues of local states:
+	double selfInteractionEnergy = 0;
+	for(int q=eInfo.qStart; q<eInfo.qStop; q++)
+	{	if(correctedEigenvalues)
+			(*correctedEigenvalues)[q].resize(nBands);
+		for(int n=0; n<nBands; n++)
+		{	double err = selfInteractionError[q*nBands+n];
+			if(correctedEigenvalues)
+				(*correctedEigenvalues)[q][n] = e->eVars.Hsub_eigs[q][n] - err;
+			selfInteractionEnergy += e->eVars.F[q][n]*eInfo.qnums[q].weight*err;
 		}
 	}
-	DC.clear();
 	mpiUtil->allReduce(selfInteractionEnergy, MPIUtil::ReduceSum);
 	return selfInteractionEnergy;
-	
 }
 
-double DumpSelfInteractionCorrection::calcSelfInteractionError(int q, int n)
+double DumpSelfInteractionCorrection::calcSelfInteractionError(const ScalarField& orbitalDensity, const ScalarField& orbitalKEdensity)
 {
-	// Get the real-space orbital density
-	ScalarField orbitalDensity; nullToZero(orbitalDensity, e->gInfo);
-	if(e->eInfo.isMine(q))
-		orbitalDensity = diagouterI(eye(1), e->eVars.C[q].getSub(n,n+1), 1, &e->gInfo)[0];
-	orbitalDensity->bcast(e->eInfo.whose(q));
 	ScalarFieldTilde orbitalDensityTilde = J(orbitalDensity);
 	
 	// Calculate the Coulomb energy
@@ -72,17 +134,15 @@ double DumpSelfInteractionCorrection::calcSelfInteractionError(int q, int n)
 	orbitalSpinDensity[0] = orbitalDensity;
 	nullToZero(orbitalSpinDensity[1], e->gInfo);
 	
-	// Calculate the orbital KE if needed
+	// Orbital KE density if needed
 	ScalarFieldArray KEdensity(2);
-	if(e->exCorr.needsKEdensity())
-	{	nullToZero(KEdensity, e->gInfo);
-		if(e->eInfo.isMine(q))
-			for(int iDir=0; iDir<3; iDir++)
-				KEdensity[0] += 0.5 * diagouterI(eye(1), DC[iDir].getSub(n,n+1), 1, &e->gInfo)[0];
-		KEdensity[0]->bcast(e->eInfo.whose(q));
+	if(orbitalKEdensity)
+	{	KEdensity[0] = orbitalKEdensity;
+		nullToZero(KEdensity[1], e->gInfo);
 	}
-
-	double xcEnergy = e->exCorr(orbitalSpinDensity, 0, IncludeTXC(), &KEdensity, 0);
+	
+	//Evaluate XC on this process alone, since each process handles different orbitals:
+	double xcEnergy = e->exCorr(orbitalSpinDensity, 0, IncludeTXC(), &KEdensity, 0, 0, true);
 	
 	return coulombEnergy + xcEnergy;
 }
@@ -44,8 +44,7 @@ public:
 	bool needsTau;  //!< The kinetic energy density is needed for meta-gga functionals.
 private:
 	const Everything* e;
-	double calcSelfInteractionError(int q, int n); //!< Calculates the self-interaction error of the KS orbital atthe n'th band at q'th quantum number
-	std::vector<ColumnBundle> DC; //!< ColumnBundle for the derivative of the wavefunctions in each cartesian direction
+	double calcSelfInteractionError(const ScalarField& orbitalDensity, const ScalarField& orbitalKEdensity); //!< Calculates the self-interaction error of a KS orbital from its density (and KE density for meta-GGAs, null otherwise) on the current process alone
 };
 
 //---------------- Implemented in DumpExcitationsMoments.cpp -----------------
@@ -26,6 +26,8 @@ along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
 #include <fluid/FluidSolver.h>
 #include <core/Random.h>
 #include <core/ScalarField.h>
+#include <core/ScalarFieldIO.h>
+#include <core/Pulay.h>
 #include <ctime>
 #include <electronic/SCF.h>
 
@@ -142,7 +144,8 @@ struct SubspaceRotationAdjust
 
 
 ElecMinimizer::ElecMinimizer(Everything& e)
-: e(e), eVars(e.eVars), eInfo(e.eInfo), rotPrev(eInfo.nStates), rotPrevC(eInfo.nStates), rotPrevCinv(eInfo.nStates)
+: e(e), eVars(e.eVars), eInfo(e.eInfo), rotPrev(eInfo.nStates), rotPrevC(eInfo.nStates), rotPrevCinv(eInfo.nStates),
+	dirCached(0), CdagOdir(eInfo.nStates), dirdagOdir(eInfo.nStates), Vdagdir(eInfo.nStates)
 {
 	for(int q=eInfo.qStart; q<eInfo.qStop; q++)
 	{	rotPrev[q] = eye(eInfo.nBands);
@@ -151,6 +154,11 @@ ElecMinimizer::ElecMinimizer(Everything& e)
 	}
 	rotExists = false; //rotation is identity
 	
+	//Start in single precision if requested (promoted in report once residual is small enough):
+	residualMixed = NAN;
+	if(e.cntrl.mixedPrecisionThreshold)
+		setMixedPrecision(e, true);
+	
 	//Initialize subspace rotation adjuster if required:
 	if(e.cntrl.subspaceRotationAdjust && ( eInfo.fillingsUpdate==ElecInfo::FillingsHsub || !eInfo.scalarFillings) )
 		sra = std::make_shared<SubspaceRotationAdjust>(e);
@@ -158,11 +166,26 @@ ElecMinimizer::ElecMinimizer(Everything& e)
 
 void ElecMinimizer::step(const ElecGradient& dir, double alpha)
 {	assert(dir.eInfo == &eInfo);
+	bool incremental = (&dir == dirCached); //overlaps cached by the preceding constrain(dir), if any
+	if(!incremental) dirCached = 0;
 	for(int q=eInfo.qStart; q<eInfo.qStop; q++)
 	{	axpy(alpha, rotExists ? dir.C[q]*rotPrevC[q] : dir.C[q], eVars.C[q]);
+		//Update overlap and projections of C incrementally from those of C and dir (C is orthonormal before the step):
+		matrix CdagOC, RdagQ;
+		if(incremental)
+		{	const matrix& R = rotPrevC[q]; //transformation of direction applied above
+			RdagQ = rotExists ? dagger(R) * dirdagOdir[q] : dirdagOdir[q];
+			matrix PR = rotExists ? CdagOdir[q] * R : CdagOdir[q];
+			CdagOC = eye(eInfo.nBands) + alpha*(PR + dagger(PR)) + (alpha*alpha)*(rotExists ? RdagQ * R : RdagQ);
+			for(unsigned sp=0; sp<Vdagdir[q].size(); sp++)
+				if(Vdagdir[q][sp])
+					eVars.VdagC[q][sp] += alpha * (rotExists ? Vdagdir[q][sp] * R : Vdagdir[q][sp]);
+		}
+		matrix rotC; //net transformation applied by orthonormalize (only set if incremental or rotations required)
 		if(eInfo.fillingsUpdate==ElecInfo::FillingsConst && eInfo.scalarFillings)
 		{	//Constant scalar fillings: no rotations required
-			eVars.orthonormalize(q);
+			if(incremental) rotC = eye(eInfo.nBands);
+			eVars.orthonormalize(q, incremental ? &rotC : 0, incremental ? &CdagOC : 0);
 		}
 		else
 		{	//Haux or non-scalar fillings: rotations required
@@ -179,13 +202,16 @@ void ElecMinimizer::step(const ElecGradient& dir, double alpha)
 				assert(!eInfo.scalarFillings);
 				rot = cis(alpha * dir.Haux[q]); //auxiliary matrix directly generates rotations
 			}
-			matrix rotC = rot;
-			eVars.orthonormalize(q, &rotC);
+			rotC = rot;
+			eVars.orthonormalize(q, &rotC, incremental ? &CdagOC : 0);
 			rotPrev[q] = rotPrev[q] * rot;
 			rotPrevC[q] = rotPrevC[q] * rotC;
 			rotPrevCinv[q] = inv(rotC) * rotPrevCinv[q];
 			rotExists = true; //rotation is no longer identity
 		}
+		//Overlap of direction with the new wavefunctions:
+		if(incremental)
+			CdagOdir[q] = dagger(rotC) * (CdagOdir[q] + alpha * RdagQ);
 	}
 }
 
@@ -219,12 +245,17 @@ double ElecMinimizer::compute(ElecGradient* grad, ElecGradient* Kgrad)
 		//Cache gradient overlaps, if needed, for subspace rotation handling:
 		if(sra) sra->cacheGradientOverlaps(*grad, *Kgrad);
 		KgradHaux = Kgrad->Haux;
+		
+		//Track residual for promotion to double precision, if needed:
+		if(e.gInfoWfns ? e.gInfoWfns->singlePrecisionFFT : e.gInfo.singlePrecisionFFT)
+			residualMixed = sqrt(sync(dot(*grad, *Kgrad)) / e.elecMinParams.nDim);
 	}
 	return ener;
 }
 
 bool ElecMinimizer::report(int iter)
-{
+{	dirCached = 0; //wavefunctions may be modified below; overlaps are recached by the next constrain()
+	
 	if(e.cntrl.shouldPrintEcomponents)
 	{	//Print the iteration header
 		time_t timenow = time(0);
@@ -253,6 +284,13 @@ bool ElecMinimizer::report(int iter)
 			rotPrevCinv[q] = dagger(rotPrev[q]);
 		}
 	
+	//Promote to double precision once residual is small enough:
+	if(residualMixed < e.cntrl.mixedPrecisionThreshold && setMixedPrecision(e, false))
+	{	logPrintf("%s\tMixedPrecision: |grad|_K = %le below threshold; switching to double precision.\n", e.elecMinParams.linePrefix, residualMixed);
+		residualMixed = NAN;
+		return true; //energy and gradient need to be recomputed (resets CG)
+	}
+	
 	//Subspace rotation preconditioner handling:
 	if(sra) return sra->report(KgradHaux);
 	return false;
@@ -263,6 +301,19 @@ void ElecMinimizer::constrain(ElecGradient& dir)
 	//Project component of search direction along current wavefunctions:
 	for(int q=eInfo.qStart; q<eInfo.qStop; q++)
 		dir.C[q] -= eVars.C[q] * (eVars.C[q]^O(dir.C[q]));
+	//Cache overlaps of the constrained direction, so that the line search in step() does not need C^O(C):
+	for(int q=eInfo.qStart; q<eInfo.qStop; q++)
+	{	Vdagdir[q].clear();
+		dirdagOdir[q] = dir.C[q]^O(dir.C[q], &Vdagdir[q]); //sets projections only for species with augmentation
+		Vdagdir[q].resize(e.iInfo.species.size());
+		for(unsigned sp=0; sp<e.iInfo.species.size(); sp++)
+			if(!Vdagdir[q][sp]) //remaining (eg. norm-conserving) species with projectors
+			{	auto V = e.iInfo.species[sp]->getV(dir.C[q]);
+				if(V) Vdagdir[q][sp] = (*V) ^ dir.C[q];
+			}
+		CdagOdir[q] = zeroes(eInfo.nBands, eInfo.nBands); //direction is now orthogonal to the (orthonormal) wavefunctions
+	}
+	dirCached = &dir;
 }
 
 double ElecMinimizer::sync(double x) const
@@ -360,6 +411,8 @@ void elecMinimize(Everything& e)
 	else
 	{	ElecMinimizer emin(e);
 		emin.minimize(e.elecMinParams);
+		if(setMixedPrecision(e, false)) //stopped before promotion: final energy in double precision
+			e.eVars.elecEnergyAndGrad(e.ener, 0, 0, true);
 		if (!e.ionDynamicsParams.tMax) e.eVars.setEigenvectors(); //Don't spend time with this if running MD
 	}
 	e.eVars.isRandom = false; //wavefunctions are no longer random
@@ -368,6 +421,78 @@ void elecMinimize(Everything& e)
 		convergeEmptyStates(e);
 }
 
+//Set inner minimization tolerances of the fluid <-> electron loop from the latest outer free energy change dAtyp,
+//relaxing thresholds of the original minimize parameters (fluidOrig, elecOrig) while far from self-consistency
+void setGummelTolerances(Everything& e, const MinimizeParams& fluidOrig, const MinimizeParams& elecOrig, double dAtyp)
+{	const Control& cntrl = e.cntrl;
+	double Etarget = cntrl.fluidGummel_tolFactor*dAtyp; //inner energy accuracy needed at this stage of the outer loop
+	double knormScale = std::max(1., Etarget/cntrl.fluidGummel_Atol);
+	e.fluidMinParams.energyDiffThreshold = std::max(fluidOrig.energyDiffThreshold, Etarget);
+	e.fluidMinParams.knormThreshold = fluidOrig.knormThreshold * knormScale;
+	e.elecMinParams.energyDiffThreshold = std::max(elecOrig.energyDiffThreshold, Etarget);
+	e.elecMinParams.knormThreshold = elecOrig.knormThreshold * knormScale;
+}
+
+//Anderson (Pulay) acceleration of the fluid <-> electron loop,
+//mixing the fluid inputs (net explicit charge and cavity-determining density)
+class FluidGummelAnderson : public Pulay<ScalarFieldTildeArray>
+{
+public:
+	FluidGummelAnderson(Everything& e, const PulayParams& pp, const MinimizeParams& fluidOrig, const MinimizeParams& elecOrig)
+	: Pulay<ScalarFieldTildeArray>(pp), e(e), fluidOrig(fluidOrig), elecOrig(elecOrig), iCycle(0)
+	{	updateInputs();
+	}
+	
+protected:
+	double cycle(double dEprev, std::vector<double>& extraValues)
+	{	ElecVars& eVars = e.eVars;
+		setGummelTolerances(e, fluidOrig, elecOrig, std::min(1., fabs(dEprev)));
+		//Fluid-side (from mixed inputs):
+		logPrintf("\n---------------------- Fluid Minimization # %d -----------------------\n", iCycle+1); logFlush();
+		eVars.fluidSolver->minimizeFluid();
+		e.ener.E["A_diel"] = eVars.fluidSolver->get_Adiel_and_grad(&eVars.d_fluid, &eVars.V_cavity);
+		//Electron-side:
+		logPrintf("\n-------------------- Electronic Minimization # %d ---------------------\n", iCycle+1); logFlush();
+		elecMinimize(e);
+		updateInputs();
+		e.dump(DumpFreq_Gummel, iCycle);
+		iCycle++;
+		return relevantFreeEnergy(e);
+	}
+	
+	void axpy(double alpha, const ScalarFieldTildeArray& X, ScalarFieldTildeArray& Y) const
+	{	if(Y.size() != X.size()) Y.resize(X.size());
+		::axpy(alpha, X, Y);
+	}
+	double dot(const ScalarFieldTildeArray& X, const ScalarFieldTildeArray& Y) const { return ::dot(X, Y); }
+	size_t variableSize() const { return 2 * e.gInfo.nG * sizeof(complex); }
+	void readVariable(ScalarFieldTildeArray& X, FILE* fp) const
+	{	nullToZero(X, e.gInfo, 2);
+		for(ScalarFieldTilde& x: X) loadRawBinary(x, fp);
+	}
+	void writeVariable(const ScalarFieldTildeArray& X, FILE* fp) const
+	{	for(const ScalarFieldTilde& x: X) saveRawBinary(x, fp);
+	}
+	ScalarFieldTildeArray getVariable() const { return clone(inputs); }
+	void setVariable(const ScalarFieldTildeArray& X)
+	{	inputs = clone(X);
+		e.eVars.fluidSolver->set(inputs[0], inputs[1]);
+	}
+	ScalarFieldTildeArray precondition(const ScalarFieldTildeArray& X) const { return e.cntrl.fluidGummel_mixFraction * X; }
+	ScalarFieldTildeArray applyMetric(const ScalarFieldTildeArray& X) const { return clone(X); }
+	
+private:
+	Everything& e;
+	const MinimizeParams &fluidOrig, &elecOrig;
+	int iCycle;
+	ScalarFieldTildeArray inputs; //fluid inputs: net explicit charge and cavity-determining density
+	
+	void updateInputs() //update fluid inputs from current electronic state
+	{	inputs.resize(2);
+		e.eVars.getFluidInputs(J(e.eVars.get_nTot()), inputs[0], inputs[1]);
+	}
+};
+
 void elecFluidMinimize(Everything &e)
 {	Control &cntrl = e.cntrl;
 	ElecVars &eVars = e.eVars;
@@ -431,48 +556,75 @@ void elecFluidMinimize(Everything &e)
 	if(eVars.fluidParams.fluidType!=FluidNone && eVars.fluidSolver->useGummel())
 	{	//gummel loop
 		logPrintf("\n-------- Electron <-> Fluid self-consistency loop -----------\n"); logFlush();
-		double dAtyp = 1.;
-		bool converged = false;
-		for(int iGummel=0; iGummel<cntrl.fluidGummel_nIterations && !killFlag; iGummel++)
-		{
-			//Fluid-side:
-			logPrintf("\n---------------------- Fluid Minimization # %d -----------------------\n", iGummel+1); logFlush();
-			double A_diel_prev = ener.E["A_diel"];
-			e.fluidMinParams.energyDiffThreshold = std::min(1e-5, 0.01*dAtyp);
-			eVars.fluidSolver->minimizeFluid();
-			ener.E["A_diel"] = eVars.fluidSolver->get_Adiel_and_grad(&eVars.d_fluid, &eVars.V_cavity);
-			double dAfluid = ener.E["A_diel"] - A_diel_prev;
-			logPrintf("\nFluid minimization # %d changed total free energy by %le at t[s]: %9.2lf\n", iGummel+1, dAfluid, clock_sec());
-
-			//Electron-side:
-			logPrintf("\n-------------------- Electronic Minimization # %d ---------------------\n", iGummel+1); logFlush();
-			double A_JDFT_prev = relevantFreeEnergy(e);
-			e.elecMinParams.energyDiffThreshold = std::min(1e-5, 0.01*dAtyp);
-			elecMinimize(e);
-			double dAelec = relevantFreeEnergy(e) - A_JDFT_prev;
-			logPrintf("\nElectronic minimization # %d changed total free energy by %le at t[s]: %9.2lf\n", iGummel+1, dAelec, clock_sec());
-			
-			//Dump:
-			e.dump(DumpFreq_Gummel, iGummel);
-
-			//Check self-consistency:
-			dAtyp = std::max(fabs(dAfluid), fabs(dAelec));
-			if(dAtyp<cntrl.fluidGummel_Atol)
-			{	logPrintf("\nFluid<-->Electron self-consistency loop converged to %le hartrees after %d minimization pairs at t[s]: %9.2lf.\n",
-					cntrl.fluidGummel_Atol, iGummel+1, clock_sec());
-				converged = true;
-				break;
+		const MinimizeParams fluidOrig = e.fluidMinParams, elecOrig = e.elecMinParams; //restored after loop
+		if(cntrl.fluidGummel_history)
+		{	//Anderson-accelerated version:
+			PulayParams pp;
+			pp.fpLog = globalLog;
+			pp.linePrefix = "FluidGummel: ";
+			pp.energyLabel = relevantFreeEnergyName(e);
+			pp.energyFormat = "%+.15lf";
+			pp.nIterations = cntrl.fluidGummel_nIterations;
+			pp.energyDiffThreshold = cntrl.fluidGummel_Atol;
+			pp.residualThreshold = 0.; //converge on free energy alone (as for the plain version)
+			pp.history = cntrl.fluidGummel_history;
+			pp.mixFraction = cntrl.fluidGummel_mixFraction;
+			FluidGummelAnderson fga(e, pp, fluidOrig, elecOrig);
+			fga.minimize(relevantFreeEnergy(e));
+		}
+		else
+		{	//Plain alternation:
+			double dAtyp = 1.;
+			bool converged = false;
+			for(int iGummel=0; iGummel<cntrl.fluidGummel_nIterations && !killFlag; iGummel++)
+			{
+				//Fluid-side:
+				logPrintf("\n---------------------- Fluid Minimization # %d -----------------------\n", iGummel+1); logFlush();
+				double A_diel_prev = ener.E["A_diel"];
+				setGummelTolerances(e, fluidOrig, elecOrig, dAtyp);
+				eVars.fluidSolver->minimizeFluid();
+				ener.E["A_diel"] = eVars.fluidSolver->get_Adiel_and_grad(&eVars.d_fluid, &eVars.V_cavity);
+				double dAfluid = ener.E["A_diel"] - A_diel_prev;
+				logPrintf("\nFluid minimization # %d changed total free energy by %le at t[s]: %9.2lf\n", iGummel+1, dAfluid, clock_sec());
+
+				//Electron-side:
+				logPrintf("\n-------------------- Electronic Minimization # %d ---------------------\n", iGummel+1); logFlush();
+				double A_JDFT_prev = relevantFreeEnergy(e);
+				elecMinimize(e);
+				double dAelec = relevantFreeEnergy(e) - A_JDFT_prev;
+				logPrintf("\nElectronic minimization # %d changed total free energy by %le at t[s]: %9.2lf\n", iGummel+1, dAelec, clock_sec());
+				
+				//Dump:
+				e.dump(DumpFreq_Gummel, iGummel);
+
+				//Check self-consistency:
+				dAtyp = std::max(fabs(dAfluid), fabs(dAelec));
+				if(dAtyp<cntrl.fluidGummel_Atol)
+				{	logPrintf("\nFluid<-->Electron self-consistency loop converged to %le hartrees after %d minimization pairs at t[s]: %9.2lf.\n",
+						cntrl.fluidGummel_Atol, iGummel+1, clock_sec());
+					converged = true;
+					break;
+				}
 			}
+			if(!converged)
+				logPrintf("\nFluid<-->Electron self-consistency loop not yet converged to %le hartrees after %d minimization pairs at t[s]: %9.2lf.\n",
+					cntrl.fluidGummel_Atol, cntrl.fluidGummel_nIterations, clock_sec());
 		}
-		if(!converged)
-			logPrintf("\nFluid<-->Electron self-consistency loop not yet converged to %le hartrees after %d minimization pairs at t[s]: %9.2lf.\n",
-				cntrl.fluidGummel_Atol, cntrl.fluidGummel_nIterations, clock_sec());
+		e.fluidMinParams = fluidOrig;
+		e.elecMinParams = elecOrig;
 	}
 	
 	if(!std::isnan(Evac0))
 		logPrintf("Single-point solvation energy estimate, Delta%s = %+.15f\n", relevantFreeEnergyName(e), relevantFreeEnergy(e)-Evac0);
 }
 
+bool setMixedPrecision(Everything& e, bool singlePrecision)
+{	GridInfo& gInfoWfns = e.gInfoWfns ? *e.gInfoWfns : e.gInfo;
+	if(gInfoWfns.singlePrecisionFFT == singlePrecision) return false;
+	gInfoWfns.singlePrecisionFFT = singlePrecision;
+	return true;
+}
+
 void convergeEmptyStates(Everything& e)
 {	logPrintf("Converging empty states (this may take a while): "); logFlush();
 	std::vector<diagMatrix> eigsPrev = e.eVars.Hsub_eigs;
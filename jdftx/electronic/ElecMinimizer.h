@@ -71,13 +71,21 @@ private:
 	std::vector<matrix> rotPrevCinv; //!< inverse of rotPrevC (which is not just dagger, since these are not exactly unitary)
 	
 	bool rotExists; //!< whether rotPrev is non-trivial (not identity)
+	double residualMixed; //!< latest |grad|_K, tracked while wavefunction transforms are in single precision (see elec-mixed-precision)
 	std::shared_ptr<struct SubspaceRotationAdjust> sra; //!< Subspace rotation adjustment helper
+	
+	//Overlaps of the constrained search direction, cached for incremental orthonormalization in step():
+	const ElecGradient* dirCached; //!< direction passed to the latest constrain(), for which the cached overlaps below are valid (null if invalidated)
+	std::vector<matrix> CdagOdir; //!< overlap of current wavefunctions with direction, C^O(dir.C)
+	std::vector<matrix> dirdagOdir; //!< self-overlap of direction, dir.C^O(dir.C)
+	std::vector< std::vector<matrix> > Vdagdir; //!< pseudopotential projections of direction (for all species with projectors)
 };
 
 void bandMinimize(Everything& e); //!< band structure minimization
 void elecMinimize(Everything& e); //!< minimize electonic system
 void elecFluidMinimize(Everything& e); //!< minimize electrons and fluid in a gummel loop if necessary
 void convergeEmptyStates(Everything& e); //!< run bandMinimize to converge empty states (usually called from SCF / total energy calculations)
+bool setMixedPrecision(Everything& e, bool singlePrecision); //!< switch precision of wavefunction transforms, returning whether it changed (see elec-mixed-precision)
 
 //! @}
 #endif // JDFTX_ELECTRONIC_ELECMINIMIZER_H
@@ -21,12 +21,14 @@ along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
 #include <electronic/Everything.h>
 #include <electronic/ElecMinimizer.h>
 #include <electronic/ColumnBundle.h>
+#include <electronic/WavefunctionFile.h>
 #include <electronic/ExCorr.h>
 #include <electronic/ExactExchange.h>
 #include <fluid/FluidSolver.h>
 #include <core/matrix.h>
 #include <core/Units.h>
 #include <core/ScalarFieldIO.h>
+#include <core/Checkpoint.h>
 #include <cstdio>
 #include <cmath>
 #include <limits.h>
@@ -194,8 +196,15 @@ void ElecVars::setup(const Everything &everything)
 		if(wfnsFilename.length())
 		{	logPrintf("reading from '%s'\n", wfnsFilename.c_str()); logFlush();
 			if(readConversion) readConversion->Ecut = e->cntrl.Ecut;
+			Checkpoint::verify(wfnsFilename);
 			read(C, wfnsFilename.c_str(), eInfo, readConversion.get());
 			nBandsInited = (readConversion && readConversion->nBandsOld) ? readConversion->nBandsOld : eInfo.nBands;
+			if(WavefunctionFile::isContainer(wfnsFilename.c_str()))
+			{	WavefunctionFile wfnsFile(wfnsFilename.c_str()); //container specifies number of bands
+				nBandsInited = eInfo.nBands;
+				for(int q=0; q<wfnsFile.nStates(); q++)
+					nBandsInited = std::min(nBandsInited, wfnsFile.state(q).nBands);
+			}
 			isRandom = (nBandsInited<eInfo.nBands);
 		}
 		else if(initLCAO)
@@ -238,6 +247,7 @@ void ElecVars::setup(const Everything &everything)
 		if(!fluidSolver) die("Failed to create fluid solver.\n");
 		if(fluidInitialStateFilename.length())
 		{	logPrintf("Reading fluid state from '%s'\n", fluidInitialStateFilename.c_str()); logFlush();
+			Checkpoint::verify(fluidInitialStateFilename);
 			fluidSolver->loadState(fluidInitialStateFilename.c_str());
 		}
 	}
@@ -268,6 +278,18 @@ ScalarFieldArray ElecVars::get_nXC() const
 }
 
 //Electronic density functional and gradient
+void ElecVars::getFluidInputs(const ScalarFieldTilde& nTilde, ScalarFieldTilde& rhoExplicitTilde, ScalarFieldTilde& nCavityTilde) const
+{	const IonInfo& iInfo = e->iInfo;
+	//Compute n considered for cavity formation (i.e-> include chargeball and partial cores)
+	nCavityTilde = clone(nTilde);
+	if(iInfo.nCore) nCavityTilde += J(iInfo.nCore);
+	if(iInfo.nChargeball) nCavityTilde += iInfo.nChargeball;
+	
+	//Net electric charge:
+	rhoExplicitTilde = nTilde + iInfo.rhoIon + rhoExternal;
+	if(!fluidSolver->k2factor) rhoExplicitTilde->setGzero(0.); //No screening => apply neutralizing background charge
+}
+
 void ElecVars::EdensityAndVscloc(Energies& ener, const ExCorr* alternateExCorr)
 {	static StopWatch watch("EdensityAndVscloc"); watch.start();
 	const ElecInfo& eInfo = e->eInfo;
@@ -297,14 +319,8 @@ void ElecVars::EdensityAndVscloc(Energies& ener, const ExCorr* alternateExCorr)
 	//Fluid contributions
 	ScalarFieldTilde VtauTilde;
 	if(fluidParams.fluidType != FluidNone)
-	{	//Compute n considered for cavity formation (i.e-> include chargeball and partial cores)
-		ScalarFieldTilde nCavityTilde = clone(nTilde);
-		if(iInfo.nCore) nCavityTilde += J(iInfo.nCore);
-		if(iInfo.nChargeball) nCavityTilde += iInfo.nChargeball;
-
-		//Net electric charge:
-		ScalarFieldTilde rhoExplicitTilde = nTilde + iInfo.rhoIon + rhoExternal;
-		if(!fluidSolver->k2factor) rhoExplicitTilde->setGzero(0.); //No screening => apply neutralizing background charge
+	{	ScalarFieldTilde rhoExplicitTilde, nCavityTilde;
+		getFluidInputs(nTilde, rhoExplicitTilde, nCavityTilde);
 		fluidSolver->set(rhoExplicitTilde, nCavityTilde);
 		// If the fluid doesn't have a gummel loop, minimize it each time:
 		if(!fluidSolver->useGummel()) fluidSolver->minimizeFluid();
@@ -421,8 +437,9 @@ double ElecVars::elecEnergyAndGrad(Energies& ener, ElecGradient* grad, ElecGradi
 			}
 		}
 	}
-	mpiUtil->allReduce(ener.E["KE"], MPIUtil::ReduceSum);
-	mpiUtil->allReduce(ener.E["Enl"], MPIUtil::ReduceSum);
+	double KEnl[2] = { ener.E["KE"], ener.E["Enl"] };
+	MPIUtil::Request KEnlRequest;
+	mpiUtil->iallReduce(KEnl, 2, MPIUtil::ReduceSum, KEnlRequest); //completed below, after local work of mu/Bz gradient
 	
 	double dmuContrib = 0., dBzContrib = 0.;
 	if(grad and eInfo.fillingsUpdate==ElecInfo::FillingsHsub and (std::isnan(eInfo.mu) or eInfo.Mconstrain)) //contribution due to N/M constraint via the mu/Bz gradient 
@@ -467,6 +484,9 @@ double ElecVars::elecEnergyAndGrad(Energies& ener, ElecGradient* grad, ElecGradi
 		}
 	}
 	
+	mpiUtil->wait(KEnlRequest);
+	ener.E["KE"] = KEnl[0];
+	ener.E["Enl"] = KEnl[1];
 	return relevantFreeEnergy(*e);
 }
 
@@ -548,11 +568,13 @@ ScalarFieldArray ElecVars::KEdensity() const
 	for(int q=e->eInfo.qStart; q<e->eInfo.qStop; q++)
 		for(int iDir=0; iDir<3; iDir++)
 			tau += (0.5*C[q].qnum->weight) * diagouterI(F[q], D(C[q],iDir), tau.size(), &e->gInfo);
-	for(ScalarField& tau_s: tau)
-	{	nullToZero(tau_s, e->gInfo);
-		e->symm.symmetrize(tau_s); //Symmetrize
-		tau_s->allReduce(MPIUtil::ReduceSum);
+	std::vector<MPIUtil::Request> requests(tau.size());
+	for(unsigned s=0; s<tau.size(); s++)
+	{	nullToZero(tau[s], e->gInfo);
+		e->symm.symmetrize(tau[s]); //Symmetrize (overlapped with reduction of previous components)
+		tau[s]->iallReduce(MPIUtil::ReduceSum, requests[s]);
 	}
+	mpiUtil->waitAll(requests);
 	//Add core KE density model:
 	if(e->iInfo.tauCore)
 	{	for(unsigned s=0; s<tau.size(); s++)
@@ -571,18 +593,25 @@ ScalarFieldArray ElecVars::calcDensity() const
 	}
 	e->iInfo.augmentDensityGrid(density);
 	
-	for(ScalarField& ns: density)
-	{	nullToZero(ns, e->gInfo);
-		e->symm.symmetrize(ns); //Symmetrize
-		ns->allReduce(MPIUtil::ReduceSum);
-	}
+	//Symmetrize each component while the reduction of previous ones is in progress:
+	std::vector<MPIUtil::Request> requests(density.size());
+	for(unsigned s=0; s<density.size(); s++)
+	{	nullToZero(density[s], e->gInfo);
+		e->symm.symmetrize(density[s]); //Symmetrize
+		density[s]->iallReduce(MPIUtil::ReduceSum, requests[s]);
+	}
+	mpiUtil->waitAll(requests);
 	return density;
 }
 
-void ElecVars::orthonormalize(int q, matrix* extraRotation)
+void ElecVars::orthonormalize(int q, matrix* extraRotation, const matrix* CdagOC)
 {	assert(e->eInfo.isMine(q));
-	VdagC[q].clear();
-	matrix rot = invsqrt(C[q]^O(C[q], &VdagC[q])); //Compute U:
+	matrix rot;
+	if(CdagOC) rot = invsqrt(*CdagOC); //overlap and projections supplied by caller
+	else
+	{	VdagC[q].clear();
+		rot = invsqrt(C[q]^O(C[q], &VdagC[q])); //Compute U:
+	}
 	if(extraRotation) *extraRotation = (rot = rot * (*extraRotation)); //set rot and extraRotation to the net transformation
 	C[q] = C[q] * rot;
 	e->iInfo.project(C[q], VdagC[q], &rot); //update the atomic projections
@@ -101,6 +101,9 @@ public:
 	//! If supplied, alternateExCorr replaces the main exchange and correlaton functional
 	void EdensityAndVscloc(Energies& ener, const ExCorr* alternateExCorr=0);
 	
+	//! Get the inputs to the fluid solver (net explicit charge and cavity-determining density) given total electron density nTilde
+	void getFluidInputs(const ScalarFieldTilde& nTilde, ScalarFieldTilde& rhoExplicitTilde, ScalarFieldTilde& nCavityTilde) const;
+	
 	//! Update and return the electronic system energy.
 	//! Optionally compute the gradient, preconditioned gradient and/or the subspace hamiltonian
 	double elecEnergyAndGrad(Energies& ener, ElecGradient* grad=0, ElecGradient* Kgrad=0, bool calc_Hsub=false); 
@@ -117,7 +120,9 @@ public:
 	//! Orthonormalise wavefunctions, with an optional extra rotation
 	//! If extraRotation is present, it is applied after symmetric orthononormalization,
 	//! and on output extraRotation contains the net transformation applied to the wavefunctions.
-	void orthonormalize(int q, matrix* extraRotation=0);
+	//! If CdagOC is present, it is used as the overlap C[q]^O(C[q]) instead of recomputing it,
+	//! and VdagC[q] must already be consistent with C[q] (see ElecMinimizer::step).
+	void orthonormalize(int q, matrix* extraRotation=0, const matrix* CdagOC=0);
 	
 	//! Applies the Kohn-Sham Hamiltonian on the orthonormal wavefunctions C, and computes Hsub if necessary, for a single quantum number
 	//! Returns the Kinetic energy contribution from q, which can be used for the inverse kinetic preconditioner
@@ -341,6 +341,7 @@ void ElectronScattering::dump(const Everything& everything)
 		logPrintf("done.\n"); logFlush();
 	}
 	logPrintf("\n");
+	wfnsCache.clear();
 	
 	ImKscrHead.allReduce(MPIUtil::ReduceSum);
 	for(diagMatrix& IS: ImSigma)
@@ -428,18 +429,18 @@ std::vector<ElectronScattering::Event> ElectronScattering::getEvents(bool chiMod
 	if(!events.size()) return events;
 	
 	//Get wavefunctions in real space:
-	ColumnBundle Ci, Cj; if(!slabResponse) { Ci = getWfns(ik, ki); Cj = getWfns(jk, kj); }
+	std::shared_ptr<const ColumnBundle> Ci, Cj; if(!slabResponse) { Ci = getWfns(ik, ki); Cj = getWfns(jk, kj); }
 	std::vector< std::vector<complexScalarField> > conjICi(nBands), ICj(nBands);
 	watchI.start();
 	for(int i=0; i<nBands; i++) if(iUsed[i])
 	{	conjICi[i].resize(nSpinor);
 		for(int s=0; s<nSpinor; s++)
-			conjICi[i][s] = conj(I((slabResponse ? C[ik] : Ci).getColumn(i,s))); 
+			conjICi[i][s] = conj(I((slabResponse ? C[ik] : *Ci).getColumn(i,s))); 
 	}
 	for(int j=0; j<nBands; j++) if(jUsed[j])
 	{	ICj[j].resize(nSpinor);
 		for(int s=0; s<nSpinor; s++)
-			ICj[j][s] = I((slabResponse ? C[jk] : Cj).getColumn(j,s));
+			ICj[j][s] = I((slabResponse ? C[jk] : *Cj).getColumn(j,s));
 	}
 	watchI.stop();
 	
@@ -461,16 +462,11 @@ std::vector<ElectronScattering::Event> ElectronScattering::getEvents(bool chiMod
 	return events;
 }
 
-ColumnBundle ElectronScattering::getWfns(size_t ik, const vector3<>& k) const
-{	static StopWatch watch("ElectronScattering::getWfns"); watch.start();
-	double roundErr;
+std::shared_ptr<const ColumnBundle> ElectronScattering::getWfns(size_t ik, const vector3<>& k) const
+{	double roundErr;
 	vector3<int> kSup = round((k - supercell->kmesh[0]) * supercell->super, &roundErr);
 	assert(roundErr < symmThreshold);
-	ColumnBundle result(nBands, basis.nbasis * nSpinor, &basis, &qnumMesh.find(kSup)->second, isGpuEnabled());
-	result.zero();
-	transform.find(kSup)->second->scatterAxpy(1., C[supercell->kmeshTransform[ik].iReduced], result,0,1);
-	watch.stop();
-	return result;
+	return wfnsCache.get(*(transform.find(kSup)->second), C[supercell->kmeshTransform[ik].iReduced], &qnumMesh.find(kSup)->second);
 }
 
 matrix ElectronScattering::coulombMatrix(size_t iq) const
@@ -21,6 +21,7 @@ along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
 #define JDFTX_ELECTRONIC_ELECTRONSCATTERING_H
 
 #include <electronic/Basis.h>
+#include <electronic/ColumnBundleTransform.h>
 #include <core/LatticeUtils.h>
 #include <memory>
 
@@ -56,7 +57,8 @@ private:
 	std::vector<QuantumNumber> qmesh; //reduced momentum-transfer mesh
 	std::vector<Basis> basisChi; //polarizability bases for qmesh
 	Basis basis; //common wavefunction  basis
-	std::map< vector3<int>, std::shared_ptr<class ColumnBundleTransform> > transform; //k-mesh transformations
+	std::map< vector3<int>, std::shared_ptr<ColumnBundleTransform> > transform; //k-mesh transformations
+	ColumnBundleTransform::Cache wfnsCache; //wavefunctions unfolded to the k-mesh (reused across momentum transfers)
 	std::map< vector3<int>, QuantumNumber > qnumMesh; //equivalent of eInfo.qnums for entire k-mesh
 	
 	struct Event
@@ -73,7 +75,7 @@ private:
 		matrix& nij //!< set pair densities for each event, one per column
 	) const;
 	
-	ColumnBundle getWfns(size_t ik, const vector3<>& k) const; //get wavefunctions at an arbitrary point in k-mesh
+	std::shared_ptr<const ColumnBundle> getWfns(size_t ik, const vector3<>& k) const; //get wavefunctions at an arbitrary point in k-mesh
 	matrix coulombMatrix(size_t iq) const; //retrieve the Coulomb operator for a specific momentum transfer
 	void dumpSlabResponse(Everything& e, const diagMatrix& omegaGrid);
 };
@@ -21,6 +21,7 @@ along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
 #include <electronic/ExactExchange.h>
 #include <electronic/VanDerWaals.h>
 #include <electronic/Vibrations.h>
+#include <electronic/Batch.h>
 #include <electronic/DOS.h>
 #include <core/LatticeUtils.h>
 #include <fluid/FluidSolver.h>
@@ -131,6 +132,9 @@ void Everything::setup()
 	//Setup vibrations module:
 	if(vibrations) vibrations->setup(this);
 	
+	//Setup batch driver:
+	if(batch) batch->setup(this);
+	
 	//Setup electronic minimization parameters:
 	elecMinParams.nDim = 0;
 	for(int q=eInfo.qStart; q<eInfo.qStop; q++)
@@ -72,6 +72,7 @@ public:
 
 	std::shared_ptr<VanDerWaals> vanDerWaals; //! Pair potential for vdw correction
 	std::shared_ptr<class Vibrations> vibrations; //! Vibrational mode calculator
+	std::shared_ptr<class Batch> batch; //! Multi-structure batch driver
 
 	//! Call the setup/initialize routines of all the above in the necessray order
 	void setup();
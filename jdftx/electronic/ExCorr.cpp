@@ -579,7 +579,7 @@ template<typename Func> bool shouldInclude(const std::shared_ptr<Func>& function
 }
 
 double ExCorr::operator()(const ScalarFieldArray& n, ScalarFieldArray* Vxc, IncludeTXC includeTXC,
-		const ScalarFieldArray* tauPtr, ScalarFieldArray* Vtau) const
+		const ScalarFieldArray* tauPtr, ScalarFieldArray* Vtau, matrix3<>* E_RRT, bool localEval) const
 {
 	static StopWatch watch("ExCorrTotal"), watchComm("ExCorrCommunication"), watchFunc("ExCorrFunctional");
 	watch.start();
@@ -588,6 +588,8 @@ double ExCorr::operator()(const ScalarFieldArray& n, ScalarFieldArray* Vxc, Incl
 	const int nCount = std::min(nInCount, 2); //Number of spin-densities used in the parametrization of the functional
 	const int sigmaCount = 2*nCount-1;
 	const GridInfo& gInfo = n[0]->gInfo;
+	const size_t irStart = localEval ? 0 : gInfo.irStart; //range of grid points evaluated on this process
+	const size_t irStop = localEval ? gInfo.nr : gInfo.irStop;
 	
 	//------- Prepare inputs, allocate outputs -------
 	
@@ -620,8 +622,8 @@ double ExCorr::operator()(const ScalarFieldArray& n, ScalarFieldArray* Vxc, Incl
 	
 	//Calculate spatial gradients for GGA (if needed)
 	std::vector<VectorField> Dn(nInCount);
-	int iDirStart, iDirStop;
-	TaskDivision(3, mpiUtil).myRange(iDirStart, iDirStop);
+	int iDirStart = 0, iDirStop = 3;
+	if(!localEval) TaskDivision(3, mpiUtil).myRange(iDirStart, iDirStop);
 	if(needsSigma)
 	{	//Compute the gradients of the (spin-)densities:
 		for(int s=0; s<nInCount; s++)
@@ -698,7 +700,7 @@ double ExCorr::operator()(const ScalarFieldArray& n, ScalarFieldArray* Vxc, Incl
 					sigma[s1+s2] += Dn[s1][i] * Dn[s2][i];
 				watchComm.start();
 				nullToZero(sigma[s1+s2], gInfo);
-				sigma[s1+s2]->allReduce(MPIUtil::ReduceSum);
+				if(!localEval) sigma[s1+s2]->allReduce(MPIUtil::ReduceSum);
 				watchComm.stop();
 			}
 		//Allocate gradient if required:
@@ -740,7 +742,7 @@ double ExCorr::operator()(const ScalarFieldArray& n, ScalarFieldArray* Vxc, Incl
 		watchFunc.start();
 		for(auto func: functionals->libXC)
 			if(shouldInclude(func, includeTXC))
-				func->evaluateSub(nCount, gInfo.irStart, gInfo.irStop, nData, sigmaData, lapData, tauData,
+				func->evaluateSub(nCount, irStart, irStop, nData, sigmaData, lapData, tauData,
 					eData, E_nData, E_sigmaData, E_lapData, E_tauData);
 		watchFunc.stop();
 		
@@ -767,7 +769,7 @@ double ExCorr::operator()(const ScalarFieldArray& n, ScalarFieldArray* Vxc, Incl
 	watchFunc.start();
 	for(auto func: functionals->internal)
 		if(shouldInclude(func, includeTXC))
-			func->evaluateSub(gInfo.irStart, gInfo.irStop,
+			func->evaluateSub(irStart, irStop,
 				constDataPref(nCapped), constDataPref(sigma), constDataPref(lap), constDataPref(tau),
 				E->dataPref(), dataPref(E_n), dataPref(E_sigma), dataPref(E_lap), dataPref(E_tau));
 	watchFunc.stop();
@@ -780,13 +782,48 @@ double ExCorr::operator()(const ScalarFieldArray& n, ScalarFieldArray* Vxc, Incl
 	tau.clear();
 	
 	//---------------- Collect results over processes ----------------
-	watchComm.start();
-	mpiUtil->allReduce(Exc, MPIUtil::ReduceSum);
-	for(ScalarField& x: E_n) if(x) x->allReduce(MPIUtil::ReduceSum);
-	for(ScalarField& x: E_sigma) if(x) x->allReduce(MPIUtil::ReduceSum);
-	for(ScalarField& x: E_lap) if(x) x->allReduce(MPIUtil::ReduceSum);
-	for(ScalarField& x: E_tau) if(x) x->allReduce(MPIUtil::ReduceSum);
-	watchComm.stop();
+	if(!localEval)
+	{	watchComm.start();
+		mpiUtil->allReduce(Exc, MPIUtil::ReduceSum);
+		for(ScalarField& x: E_n) if(x) x->allReduce(MPIUtil::ReduceSum);
+		for(ScalarField& x: E_sigma) if(x) x->allReduce(MPIUtil::ReduceSum);
+		for(ScalarField& x: E_lap) if(x) x->allReduce(MPIUtil::ReduceSum);
+		for(ScalarField& x: E_tau) if(x) x->allReduce(MPIUtil::ReduceSum);
+		watchComm.stop();
+	}
+	
+	//--------------- Strain derivative (if required) ---------------
+	if(E_RRT)
+	{	assert(Vxc); //needs gradients w.r.t sigma, lap
+		assert(nCount == nInCount); //not supported for noncollinear magnetism
+		*E_RRT += Exc * matrix3<>(1.,1.,1.); //volume element
+		//Gradient contribution: d(sigma_s1s2)/d(strain_ab) = -(Dn_s1_a Dn_s2_b + Dn_s1_b Dn_s2_a)
+		if(needsSigma)
+		{	std::vector<VectorField> DnAll(nCount); //all directions (Dn above may be split over processes)
+			for(int s=0; s<nCount; s++)
+				DnAll[s] = gradient(n[s]);
+			for(int s1=0; s1<nCount; s1++)
+				for(int s2=s1; s2<nCount; s2++)
+					for(int a=0; a<3; a++)
+						for(int b=a; b<3; b++)
+						{	double E_ab = integral(E_sigma[s1+s2] * (DnAll[s1][a]*DnAll[s2][b] + DnAll[s1][b]*DnAll[s2][a]));
+							(*E_RRT)(a,b) -= E_ab;
+							if(b>a) (*E_RRT)(b,a) -= E_ab;
+						}
+		}
+		//Laplacian contribution: d(lap n)/d(strain_ab) = -2 D_a D_b n
+		if(needsLap)
+		{	for(int s=0; s<nCount; s++)
+			{	ScalarFieldTilde Jn = J(n[s]);
+				for(int a=0; a<3; a++)
+					for(int b=a; b<3; b++)
+					{	double E_ab = 2.*integral(E_lap[s] * I(D(D(Jn,a),b)));
+						(*E_RRT)(a,b) -= E_ab;
+						if(b>a) (*E_RRT)(b,a) -= E_ab;
+					}
+			}
+		}
+	}
 
 	//--------------- Gradient propagation ---------------------
 	if(Vxc)
@@ -848,7 +885,7 @@ double ExCorr::operator()(const ScalarFieldArray& n, ScalarFieldArray* Vxc, Incl
 			for(int s=0; s<nInCount; s++)
 			{	watchComm.start();
 				nullToZero(E_nTilde[s], gInfo);
-				E_nTilde[s]->allReduce(MPIUtil::ReduceSum);
+				if(!localEval) E_nTilde[s]->allReduce(MPIUtil::ReduceSum);
 				watchComm.stop();
 				E_n[s] += Jdag(E_nTilde[s],true);
 			}
@@ -863,11 +900,11 @@ double ExCorr::operator()(const ScalarFieldArray& n, ScalarFieldArray* Vxc, Incl
 
 //Unpolarized wrapper to above function:
 double ExCorr::operator()(const ScalarField& n, ScalarField* Vxc, IncludeTXC includeTXC,
-		const ScalarField* tau, ScalarField* Vtau) const
+		const ScalarField* tau, ScalarField* Vtau, matrix3<>* E_RRT) const
 {	ScalarFieldArray VxcArr(1), tauArr(1), VtauArr(1);
 	if(tau) tauArr[0] = *tau;
 	double Exc =  (*this)(ScalarFieldArray(1, n), Vxc ? &VxcArr : 0, includeTXC,
-		tau ? &tauArr :0, Vtau ? &VtauArr : 0);
+		tau ? &tauArr :0, Vtau ? &VtauArr : 0, E_RRT);
 	if(Vxc) *Vxc = VxcArr[0];
 	if(Vtau) *Vtau = VtauArr[0];
 	return Exc;
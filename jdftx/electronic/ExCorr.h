@@ -85,8 +85,12 @@ public:
 	//! Orbital KE density tau must be provided if needsKEdensity() is true (for meta GGAs)
 	//! and the corresponding gradient will be returned in Vtau if non-null
 	//! For metaGGAs, Vtau should be non-null if Vxc is non-null
+	//! If E_RRT is non-null, accumulate the derivative w.r.t Cartesian strain at fixed density coefficients
+	//! (requires Vxc, and excludes the orbital KE-density dependence, which must be handled by the caller)
+	//! If localEval, evaluate the whole grid on the current process without any MPI communication
+	//! (for densities that differ between processes); otherwise the grid is divided over processes.
 	double operator()(const ScalarFieldArray& n, ScalarFieldArray* Vxc=0, IncludeTXC includeTXC=IncludeTXC(),
-		const ScalarFieldArray* tau=0, ScalarFieldArray* Vtau=0) const;
+		const ScalarFieldArray* tau=0, ScalarFieldArray* Vtau=0, matrix3<>* E_RRT=0, bool localEval=false) const;
 	
 	//! Compute the exchange-correlation energy (and optionally gradient) for a unpolarized density n
 	//! includeTXC selects which components to include in result (XC without kinetic by default).
@@ -94,7 +98,7 @@ public:
 	//! and the corresponding gradient will be returned in Vtau if non-null.
 	//! For metaGGAs, Vtau should be non-null if Vxc is non-null
 	double operator()(const ScalarField& n, ScalarField* Vxc=0, IncludeTXC includeTXC=IncludeTXC(),
-		const ScalarField* tau=0, ScalarField* Vtau=0) const;
+		const ScalarField* tau=0, ScalarField* Vtau=0, matrix3<>* E_RRT=0) const;
 
 	double exxFactor() const; //!< retrieve the exact exchange scale factor (0 if no exact exchange)
 	double exxRange() const; //!< range parameter (omega) for screened exchange (0 for long-range exchange)
@@ -25,7 +25,11 @@ along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
 #include <core/GpuUtil.h>
 #include <core/Operators.h>
 #include <core/LatticeUtils.h>
+#include <core/CoulombKernel.h>
+#include <core/Coulomb_internal.h>
+#include <core/Thread.h>
 #include <list>
+#include <map>
 
 //! Internal computation object for ExactExchange
 class ExactExchangeEval
@@ -37,6 +41,12 @@ public:
 	double calc(int iSpin, unsigned iReduced, unsigned iInvert, unsigned iSym, 
 		double aXX, double omega, const std::vector<diagMatrix>& F, const std::vector<ColumnBundle>& C, std::vector<ColumnBundle>* HC) const;
 	
+	//! Calculate for one spin (Gamma-point only) using SCDM-localized occupied orbitals, with pair densities
+	//! restricted to overlapping orbital pairs on local boxes. Returns false without computing anything
+	//! if the fillings are not those of an insulator (leading block of fully occupied bands).
+	bool calcLocalized(int iSpin, double aXX, double omega, const std::vector<diagMatrix>& F,
+		const std::vector<ColumnBundle>& C, std::vector<ColumnBundle>* HC, double& EXX) const;
+	
 private:
 	friend class ExactExchange;
 	const Everything& e;
@@ -45,14 +55,26 @@ private:
 	int nSpins;
 	int nSpinor;
 	int qCount; //!< number of states of each spin
+	bool downsampled; //!< whether pair sums are restricted to a sub-mesh of k-point differences
+	matrix3<int> superSub; //!< supercell of the sub-mesh (if downsampled)
+	int downsampleCount; //!< number of k-points in the full mesh per k-point in the sub-mesh
 	//Symmetry rotation map:
 	struct KmapEntry
 	{	vector3<> k;
 		Basis basis;
 		std::shared_ptr<ColumnBundleTransform> transform; //wavefunction transformation from reduced set
+		bool hasPartners; //whether any state pairs with this one on the (sub-)mesh
 	};
 	std::vector<KmapEntry> kmap;
+	mutable ColumnBundle CkShared; //!< node-shared buffer for the rotated state in calc, reallocated (collectively) only when its size changes
 	inline int kmapIndex(int iReduced, int iInvert, int iSym) const { return (iReduced*invertList.size() + iInvert)*sym.size() + iSym; }
+	
+	//Local boxes for localized exchange:
+	bool localized; //!< whether to use SCDM-localized orbitals (see CoulombParams::exchangeLocalize)
+	mutable vector3<int> Sbox; //!< sample count of local box for pair Coulomb integrals
+	mutable std::shared_ptr<GridInfo> gInfoBox; //!< grid for local box (same spacing as e.gInfo)
+	mutable std::map<double, std::shared_ptr<RealKernel>> boxKernel; //!< truncated Coulomb kernels on local box for each omega
+	const RealKernel& getBoxKernel(const vector3<int>& Lmax, double omega) const; //!< get box kernel, growing box to fit regions of size Lmax if necessary
 };
 
 
@@ -83,10 +105,16 @@ double ExactExchange::operator()(double aXX, double omega,
 	//Calculate:
 	double EXX = 0.0;
 	for(int iSpin=0; iSpin<eval->nSpins; iSpin++)
+	{	double EXXspin;
+		if(eval->localized && eval->calcLocalized(iSpin, aXX, omega, F, C, HC, EXXspin))
+		{	EXX += EXXspin;
+			continue;
+		}
 		for(int iReduced=0; iReduced<eval->qCount; iReduced++)
 		for(unsigned iInvert=0; iInvert<eval->invertList.size(); iInvert++)
 		for(unsigned iSym=0; iSym<eval->sym.size(); iSym++)
 			EXX += eval->calc(iSpin, iReduced, iInvert, iSym, aXX, omega, F, C, HC);
+	}
 	watch.stop();
 	return EXX;
 }
@@ -102,13 +130,57 @@ ExactExchangeEval::ExactExchangeEval(const Everything& e)
 	nSpins(e.eInfo.nSpins()),
 	nSpinor(e.eInfo.spinorLength()),
 	qCount(e.eInfo.nStates/nSpins),
-	kmap(qCount * invertList.size() * sym.size())
+	downsampled(!(e.coulombParams.exchangeDownsample == vector3<int>(1,1,1))),
+	downsampleCount(1),
+	kmap(qCount * invertList.size() * sym.size()),
+	localized(e.coulombParams.exchangeLocalize > 0.),
+	Sbox(0,0,0)
 {
+	//Check applicability of localized exchange:
+	if(localized)
+	{	if(qCount>1 || e.eInfo.qnums[0].k.length_squared())
+			die("Localized exact exchange (exchange-localize) requires Gamma-point only calculations.\n");
+		if(nSpinor > 1)
+			die("Localized exact exchange (exchange-localize) is not supported for spinor wavefunctions.\n");
+		if(isGpuEnabled())
+			die("Localized exact exchange (exchange-localize) is not yet supported on GPUs.\n");
+		if(e.coulombParams.geometry!=CoulombParams::Isolated
+			&& e.coulombParams.exchangeRegularization!=CoulombParams::WignerSeitzTruncated)
+			die("Localized exact exchange (exchange-localize) requires WignerSeitzTruncated exchange-regularization.\n");
+		logPrintf("Using SCDM-localized occupied orbitals with norm tolerance %lg for exact exchange.\n", e.coulombParams.exchangeLocalize);
+		Citations::add("Localized orbitals by selected columns of the density matrix (SCDM)",
+			"A. Damle, L. Lin and L. Ying, J. Chem. Theory Comput. 11, 1463 (2015)");
+	}
+	
+	//Initialize sub-mesh for downsampled pair sums:
+	if(downsampled)
+	{	const vector3<int>& factor = e.coulombParams.exchangeDownsample;
+		superSub = e.coulombParams.supercell->downsampledSuper(factor);
+		downsampleCount = factor[0]*factor[1]*factor[2];
+		//Check that the sub-mesh is invariant under the symmetries used to unfold k-points:
+		matrix3<> superSubD(superSub), superSubInv = inv(superSubD);
+		for(const SpaceGroupOp& op: sym)
+			for(int invert: invertList)
+			{	matrix3<> rotSub = superSubInv * matrix3<>(op.rot) * superSubD * invert; //must be integral
+				double errMax = 0.;
+				for(int k=0; k<3; k++)
+				{	double err; round(rotSub.column(k), &err);
+					errMax = std::max(errMax, err);
+				}
+				if(errMax > symmThreshold)
+					die("Exchange downsampling factors [%d %d %d] break the symmetries of the k-point mesh.\n"
+						"HINT: use equal factors along symmetry-equivalent directions, or reduce symmetries.\n",
+						factor[0], factor[1], factor[2]);
+			}
+		logPrintf("Downsampling exchange pair sums by [%d %d %d] (%d times fewer k-point pairs).\n",
+			factor[0], factor[1], factor[2], downsampleCount);
+	}
+	
 	//Print cost estimate to give the user some idea of how long it might take!
 	double costFFT = e.eInfo.nStates * e.eInfo.nBands * 9.*e.gInfo.nr*log(e.gInfo.nr);
 	double costBLAS3 = e.eInfo.nStates * pow(e.eInfo.nBands,2) * e.basis[0].nbasis;
 	double costSemiLocal = 8 * costBLAS3 + 3 * costFFT; //very rough estimates of course!
-	double costEXX = costFFT * ( sym.size() * invertList.size() * qCount * e.eInfo.nBands );
+	double costEXX = costFFT * ( sym.size() * invertList.size() * qCount * e.eInfo.nBands ) / downsampleCount;
 	double relativeCost = 1+costEXX/costSemiLocal;
 	double relativeCostOrder = pow(10, floor(log(relativeCost)/log(10)));
 	relativeCost = round(relativeCost/relativeCostOrder) * relativeCostOrder; //eliminate extra sigfigs
@@ -127,6 +199,9 @@ ExactExchangeEval::ExactExchangeEval(const Everything& e)
 		if(e.eInfo.isMine(iReduced) || e.eInfo.isMine(iReduced + qCount))
 			ki.transform = std::make_shared<ColumnBundleTransform>(e.eInfo.qnums[iReduced].k, e.basis[iReduced],
 				ki.k, ki.basis, nSpinor, sym[iSym], invertList[iInvert]);
+		ki.hasPartners = !downsampled;
+		for(int q=0; q<qCount && !ki.hasPartners; q++)
+			ki.hasPartners = Supercell::onSubmesh(e.eInfo.qnums[q].k - ki.k, superSub);
 	}
 	logResume();
 }
@@ -136,10 +211,21 @@ double ExactExchangeEval::calc(int iSpin, unsigned iReduced, unsigned iInvert, u
 {
 	//Prepare ik state and gradient on all processes:
 	const KmapEntry& ki = kmap[kmapIndex(iReduced, iInvert, iSym)];
+	if(!ki.hasPartners) return 0.; //no pairs on downsampled mesh (same decision on all processes)
 	int ikSrc = iReduced + iSpin*qCount; //source state number
 	const Basis& basis_k = ki.basis;
 	QuantumNumber qnum_k = e.eInfo.qnums[ikSrc]; qnum_k.k =  ki.k;
-	ColumnBundle Ck(e.eInfo.nBands, basis_k.nbasis*nSpinor, &basis_k, &qnum_k, isGpuEnabled()), HCk;
+	ColumnBundle CkGpu, HCk;
+	if(isGpuEnabled()) CkGpu.init(e.eInfo.nBands, basis_k.nbasis*nSpinor, &basis_k, &qnum_k, true);
+	else
+	{	//One copy per node, read-only after bcast. Symmetry images of a reduced k-point have equal basis sizes,
+		//so the collective shared-window allocation happens at most once per reduced k-point, not once per call:
+		if(CkShared.nCols()!=e.eInfo.nBands || CkShared.colLength()!=basis_k.nbasis*nSpinor)
+			CkShared.initShared(e.eInfo.nBands, basis_k.nbasis*nSpinor, &basis_k, &qnum_k);
+		CkShared.basis = &basis_k;
+		CkShared.qnum = &qnum_k;
+	}
+	ColumnBundle& Ck = isGpuEnabled() ? CkGpu : CkShared;
 	diagMatrix Fk(e.eInfo.nBands);
 	if(e.eInfo.isMine(ikSrc))
 	{	Ck.zero();
@@ -151,7 +237,7 @@ double ExactExchangeEval::calc(int iSpin, unsigned iReduced, unsigned iInvert, u
 	if(HC) { HCk = Ck.similar(); HCk.zero(); }
 	
 	//Calculate energy (and gradient):
-	const double prefac = -0.5*aXX / (sym.size()*invertList.size()*e.eInfo.spinWeight);
+	const double prefac = -0.5*aXX*downsampleCount / (sym.size()*invertList.size()*e.eInfo.spinWeight);
 	double EXX = 0.;
 	for(int bk=0; bk<e.eInfo.nBands; bk++)
 	{	//Put this state in real space:
@@ -164,6 +250,7 @@ double ExactExchangeEval::calc(int iSpin, unsigned iReduced, unsigned iInvert, u
 		for(int q=e.eInfo.qStart; q<e.eInfo.qStop; q++)
 		{	const QuantumNumber& qnum_q = e.eInfo.qnums[q];
 			if(qnum_k.spin != qnum_q.spin) continue;
+			if(downsampled && !Supercell::onSubmesh(qnum_q.k - qnum_k.k, superSub)) continue; //not on the sub-mesh
 			for(int bq=0; bq<e.eInfo.nBands; bq++)
 			{	double wFq = qnum_q.weight * F[q][bq];
 				if(!wFk && !wFq) continue; //at least one of the orbitals must be occupied
@@ -201,5 +288,301 @@ double ExactExchangeEval::calc(int iSpin, unsigned iReduced, unsigned iInvert, u
 		if(e.eInfo.isMine(ikSrc))
 			ki.transform->gatherAxpy(1., HCk,0,1, (*HC)[ikSrc]);
 	}
+	CkShared.qnum = 0; //qnum_k goes out of scope
 	return EXX;
 }
+
+
+//--------------- Localized (SCDM) exact exchange ----------------------
+
+//Squared norm of orbital values at each grid point (columns of orbital matrix)
+void scdmNorms_thread(size_t iStart, size_t iStop, const std::vector<const complex*>* A, double* norms)
+{	for(size_t r=iStart; r<iStop; r++)
+	{	norms[r] = 0.;
+		for(const complex* Ab: *A)
+			norms[r] += Ab[r].norm();
+	}
+}
+
+//Remove projection of each column of orbital matrix along qt from the remaining column norms
+void scdmDowndate_thread(size_t iStart, size_t iStop, const std::vector<const complex*>* A, const complex* qt, double* norms)
+{	for(size_t r=iStart; r<iStop; r++)
+	{	complex proj = 0.;
+		for(size_t b=0; b<A->size(); b++)
+			proj += qt[b].conj() * (*A)[b][r];
+		norms[r] = std::max(0., norms[r] - proj.norm());
+	}
+}
+
+//Select grid points by column-pivoted QR of the matrix of orbital values A(b,r) = Ipsi[b](r)
+std::vector<int> scdmPivots(const std::vector<complexScalarField>& Ipsi)
+{	int nOcc = Ipsi.size();
+	size_t nr = Ipsi[0]->nElem;
+	std::vector<const complex*> A(nOcc);
+	for(int b=0; b<nOcc; b++) A[b] = Ipsi[b]->data();
+	std::vector<double> norms(nr);
+	threadLaunch(scdmNorms_thread, nr, &A, norms.data());
+	std::vector<int> pivots(nOcc);
+	std::vector<complex> Q(nOcc*nOcc); //orthonormal vectors from QR (columns)
+	for(int t=0; t<nOcc; t++)
+	{	//Select column with largest residual norm:
+		size_t rt = std::max_element(norms.begin(), norms.end()) - norms.begin();
+		pivots[t] = rt;
+		//Orthogonalize column against previous ones:
+		complex* qt = Q.data() + t*nOcc;
+		for(int b=0; b<nOcc; b++) qt[b] = A[b][rt];
+		for(int s=0; s<t; s++)
+		{	const complex* qs = Q.data() + s*nOcc;
+			complex proj = 0.;
+			for(int b=0; b<nOcc; b++) proj += qs[b].conj() * qt[b];
+			for(int b=0; b<nOcc; b++) qt[b] -= proj * qs[b];
+		}
+		double qtNorm = 0.;
+		for(int b=0; b<nOcc; b++) qtNorm += qt[b].norm();
+		if(!qtNorm) die("Orbitals are linearly dependent in SCDM localization.\n");
+		for(int b=0; b<nOcc; b++) qt[b] *= 1./sqrt(qtNorm);
+		threadLaunch(scdmDowndate_thread, nr, &A, (const complex*)qt, norms.data());
+		norms[rt] = 0.;
+	}
+	return pivots;
+}
+
+//Half-width (in grid points, along each lattice direction) about center that contains
+//all but a fraction tol of the norm of orbital phi
+vector3<int> supportHalfWidth(const complexScalarField& phi, const vector3<int>& center, double tol)
+{	const vector3<int>& S = phi->gInfo.S;
+	const complex* phiData = phi->data();
+	std::vector<double> hist[3];
+	for(int k=0; k<3; k++) hist[k].assign(S[k], 0.);
+	vector3<int> iv; size_t i=0;
+	for(iv[0]=0; iv[0]<S[0]; iv[0]++)
+	for(iv[1]=0; iv[1]<S[1]; iv[1]++)
+	for(iv[2]=0; iv[2]<S[2]; iv[2]++)
+	{	double w = phiData[i++].norm();
+		for(int k=0; k<3; k++)
+			hist[k][(iv[k] - center[k] + S[k]) % S[k]] += w;
+	}
+	vector3<int> halfWidth;
+	for(int k=0; k<3; k++)
+	{	double total = 0.; for(double h: hist[k]) total += h;
+		double inside = hist[k][0];
+		int w = 0;
+		while(2*w+1 < S[k] && (total - inside) > (tol/3) * total)
+		{	w++;
+			inside += hist[k][w];
+			if(S[k]-w != w) inside += hist[k][S[k]-w];
+		}
+		halfWidth[k] = w;
+	}
+	return halfWidth;
+}
+
+//Loop over a periodic region of the full grid (of size L starting at start) mapped to a local box (starting at pad)
+template<typename Func> void boxRegionLoop(const vector3<int>& S, const vector3<int>& Sbox,
+	const vector3<int>& start, const vector3<int>& pad, const vector3<int>& L, const Func& f)
+{	vector3<int> iv;
+	for(iv[0]=0; iv[0]<L[0]; iv[0]++)
+	for(iv[1]=0; iv[1]<L[1]; iv[1]++)
+	for(iv[2]=0; iv[2]<L[2]; iv[2]++)
+	{	size_t iFull=0, iBox=0;
+		for(int k=0; k<3; k++)
+		{	iFull = iFull*S[k] + (((start[k] + iv[k]) % S[k]) + S[k]) % S[k];
+			iBox = iBox*Sbox[k] + pad[k] + iv[k];
+		}
+		f(iFull, iBox);
+	}
+}
+
+const RealKernel& ExactExchangeEval::getBoxKernel(const vector3<int>& Lmax, double omega) const
+{	//Determine box size:
+	const vector3<int>& S = e.gInfo.S;
+	vector3<int> Snew;
+	for(int k=0; k<3; k++)
+	{	int N = 2*Lmax[k]; //room for all separations within a region (for Wigner-Seitz truncation)
+		while(N<S[k] && !fftSuitable(N)) N++;
+		Snew[k] = std::max(std::min(N, S[k]), Sbox[k]); //only grow box, to avoid frequent kernel regeneration
+	}
+	if(!(Snew == Sbox))
+	{	Sbox = Snew;
+		boxKernel.clear();
+		gInfoBox = std::make_shared<GridInfo>();
+		gInfoBox->S = Sbox;
+		gInfoBox->R = e.gInfo.R * Diag(vector3<>(Sbox[0]/double(S[0]), Sbox[1]/double(S[1]), Sbox[2]/double(S[2])));
+		logSuspend();
+		gInfoBox->initialize(true);
+		logResume();
+		logPrintf("Localized exchange pair box sample count: %d %d %d\n", Sbox[0], Sbox[1], Sbox[2]);
+	}
+	//Create kernel if necessary:
+	auto iter = boxKernel.find(omega);
+	if(iter == boxKernel.end())
+	{	std::shared_ptr<RealKernel> kernel = std::make_shared<RealKernel>(*gInfoBox);
+		CoulombKernel(gInfoBox->R, Sbox, vector3<bool>(true, true, true), omega).compute(kernel->data(), WignerSeitz(gInfoBox->R));
+		iter = boxKernel.insert(std::make_pair(omega, kernel)).first;
+	}
+	return *(iter->second);
+}
+
+bool ExactExchangeEval::calcLocalized(int iSpin, double aXX, double omega, const std::vector<diagMatrix>& F,
+	const std::vector<ColumnBundle>& C, std::vector<ColumnBundle>* HC, double& EXX) const
+{	static StopWatch watchSCDM("ExactExchange::SCDM"), watchPairs("ExactExchange::pairs");
+	int q = iSpin*qCount; //single state per spin at Gamma
+	int qSrc = e.eInfo.whose(q);
+	const GridInfo& gInfo = e.gInfo;
+	const vector3<int>& S = gInfo.S;
+	const double tol = e.coulombParams.exchangeLocalize;
+	const double fillingThreshold = 1e-6;
+	
+	//Check for insulating fillings (leading block of fully occupied bands):
+	int nOcc = 0;
+	if(e.eInfo.isMine(q))
+	{	const diagMatrix& Fq = F[q];
+		while(nOcc<e.eInfo.nBands && fabs(Fq[nOcc]-1.)<fillingThreshold) nOcc++;
+		for(int b=nOcc; b<e.eInfo.nBands; b++)
+			if(fabs(Fq[b]) > fillingThreshold) { nOcc = 0; break; }
+	}
+	mpiUtil->bcast(nOcc, qSrc);
+	if(!nOcc) return false; //fall back to delocalized evaluation
+	
+	//SCDM localization of occupied orbitals (on the process owning this state):
+	watchSCDM.start();
+	const QuantumNumber& qnum = e.eInfo.qnums[q];
+	const Basis& basis = e.basis[q];
+	ColumnBundle Cloc(nOcc, basis.nbasis, &basis, &qnum);
+	matrix U; //unitary rotation from occupied orbitals to localized ones
+	std::vector<int> pivots(nOcc);
+	if(e.eInfo.isMine(q))
+	{	ColumnBundle Cocc = C[q].getSub(0, nOcc);
+		std::vector<complexScalarField> Ipsi(nOcc);
+		for(int b=0; b<nOcc; b++)
+			Ipsi[b] = I(Cocc.getColumn(b,0));
+		pivots = scdmPivots(Ipsi);
+		matrix U0(nOcc, nOcc); //projectors onto selected points within occupied subspace
+		for(int b=0; b<nOcc; b++)
+			for(int t=0; t<nOcc; t++)
+				U0.set(b,t, Ipsi[b]->data()[pivots[t]].conj());
+		matrix W, Vdag; diagMatrix sigma;
+		U0.svd(W, sigma, Vdag);
+		U = W * Vdag; //closest unitary matrix to U0
+		Cloc = Cocc * U;
+	}
+	Cloc.bcast(qSrc);
+	mpiUtil->bcast(pivots.data(), nOcc, qSrc);
+	
+	//Real-space localized orbitals and their supports:
+	std::vector<complexScalarField> Iphi(nOcc);
+	std::vector<vector3<int>> center(nOcc), halfWidth(nOcc);
+	for(int i=0; i<nOcc; i++)
+	{	size_t r = pivots[i]; //each localized orbital is centered on its selected point
+		center[i] = vector3<int>(r/(S[1]*S[2]), (r/S[2])%S[1], r%S[2]);
+	}
+	TaskDivision orbDiv(nOcc, mpiUtil);
+	for(int i=0; i<nOcc; i++)
+	{	if(orbDiv.isMine(i))
+		{	Iphi[i] = I(Cloc.getColumn(i,0));
+			halfWidth[i] = supportHalfWidth(Iphi[i], center[i], tol);
+		}
+		else Iphi[i] = complexScalarFieldData::alloc(gInfo);
+		Iphi[i]->bcast(orbDiv.whose(i));
+	}
+	for(int i=0; i<nOcc; i++)
+		mpiUtil->bcast(&halfWidth[i][0], 3, orbDiv.whose(i));
+	watchSCDM.stop();
+	
+	//List orbital pairs with overlapping support, and the union of their supports:
+	watchPairs.start();
+	struct PairRegion { int i, j; vector3<int> start, L; };
+	std::vector<PairRegion> pairs;
+	vector3<int> Lmax(1,1,1);
+	for(int i=0; i<nOcc; i++)
+		for(int j=i; j<nOcc; j++)
+		{	PairRegion pr; pr.i = i; pr.j = j;
+			bool overlap = true;
+			for(int k=0; k<3; k++)
+			{	int d = (((center[j][k] - center[i][k]) % S[k]) + S[k]) % S[k];
+				if(2*d > S[k]) d -= S[k]; //periodic separation in (-S/2, S/2]
+				if(abs(d) > halfWidth[i][k] + halfWidth[j][k]) { overlap = false; break; }
+				int lo = std::min(-halfWidth[i][k], d-halfWidth[j][k]);
+				int hi = std::max(halfWidth[i][k], d+halfWidth[j][k]);
+				pr.start[k] = center[i][k] + lo;
+				pr.L[k] = std::min(hi-lo+1, S[k]);
+				Lmax[k] = std::max(Lmax[k], pr.L[k]);
+			}
+			if(overlap) pairs.push_back(pr);
+		}
+	const RealKernel& kernel = getBoxKernel(Lmax, omega);
+	
+	//Pair Coulomb integrals on local boxes (distributed over processes):
+	const double prefac = -0.5*aXX / e.eInfo.spinWeight;
+	const double w = qnum.weight; //all fillings are 1
+	std::vector<complexScalarField> gradI(nOcc);
+	EXX = 0.;
+	TaskDivision pairDiv(pairs.size(), mpiUtil);
+	for(size_t iPair=pairDiv.start(); iPair<pairDiv.stop(); iPair++)
+	{	const PairRegion& pr = pairs[iPair];
+		const complex* phi1 = Iphi[pr.i]->data();
+		const complex* phi2 = Iphi[pr.j]->data();
+		vector3<int> pad; for(int k=0; k<3; k++) pad[k] = (Sbox[k]-pr.L[k])/2;
+		//Pair density on box:
+		complexScalarField In = complexScalarFieldData::alloc(*gInfoBox);
+		In->zero();
+		complex* InData = In->data();
+		boxRegionLoop(S, Sbox, pr.start, pad, pr.L, [&](size_t iFull, size_t iBox)
+		{	InData[iBox] = phi1[iFull].conj() * phi2[iFull];
+		});
+		complexScalarFieldTilde n = J(In);
+		complexScalarFieldTilde Kn = clone(n);
+		multRealKernel(Sbox, kernel.data(), Kn->data());
+		Kn = O(Kn);
+		double pairFactor = (pr.i==pr.j ? 1. : 2.); //account for (j,i) pair
+		EXX += (pairFactor*prefac*w*w) * dot(n,Kn).real();
+		//Gradient:
+		if(HC)
+		{	const complexScalarField E_In = Jdag(Kn);
+			const complex* E_InData = E_In->data();
+			for(int i: {pr.i, pr.j})
+				if(!gradI[i])
+				{	gradI[i] = complexScalarFieldData::alloc(gInfo);
+					gradI[i]->zero();
+				}
+			complex* grad1 = gradI[pr.i]->data();
+			complex* grad2 = gradI[pr.j]->data();
+			const double gradScale = pairFactor*prefac*w;
+			boxRegionLoop(S, Sbox, pr.start, pad, pr.L, [&](size_t iFull, size_t iBox)
+			{	complex E = gradScale * E_InData[iBox];
+				grad1[iFull] += E.conj() * phi2[iFull];
+				grad2[iFull] += E * phi1[iFull];
+			});
+		}
+	}
+	mpiUtil->allReduce(EXX, MPIUtil::ReduceSum, true);
+	watchPairs.stop();
+	
+	//Collect gradient and rotate back from localized orbitals:
+	if(HC)
+	{	ColumnBundle HCloc = Cloc.similar();
+		HCloc.zero();
+		for(int i=0; i<nOcc; i++)
+			if(gradI[i])
+				HCloc.accumColumn(i,0, Idag(gradI[i]));
+		HCloc.allReduce(MPIUtil::ReduceSum);
+		if(e.eInfo.isMine(q))
+		{	ColumnBundle& HCq = (*HC)[q];
+			ColumnBundle HCocc = HCq.getSub(0, nOcc);
+			HCocc += HCloc * dagger(U);
+			HCq.setSub(0, HCocc);
+			//Unoccupied bands (if any) with full-cell pair densities:
+			//(factor of 2 accounts for both (u,i) and (i,u) orderings, as in the delocalized calc)
+			for(int u=nOcc; u<e.eInfo.nBands; u++)
+			{	complexScalarField Ipsiu = I(C[q].getColumn(u,0)), grad_Ipsiu;
+				for(int i=0; i<nOcc; i++)
+				{	complexScalarFieldTilde n = J(conj(Iphi[i]) * Ipsiu);
+					complexScalarFieldTilde Kn = O((*e.coulomb)(n, vector3<>(), omega));
+					grad_Ipsiu += (2.*prefac*w) * Jdag(Kn) * Iphi[i];
+				}
+				HCq.accumColumn(u,0, Idag(grad_Ipsiu));
+			}
+		}
+	}
+	return true;
+}
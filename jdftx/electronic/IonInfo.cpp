@@ -173,6 +173,30 @@ double IonInfo::ionicEnergyAndGrad(IonicGradient& forces) const
 {	const ElecInfo &eInfo = e->eInfo;
 	const ElecVars &eVars = e->eVars;
 	
+	//--------- Forces due to nonlocal pseudopotential contributions (computed first to overlap their reduction) ---------
+	IonicGradient forcesNL; forcesNL.init(*this);
+	if(eInfo.hasU) //Include DFT+U contribution if any:
+		rhoAtom_forces(eVars.F, eVars.C, eVars.U_rhoAtom, forcesNL);
+	augmentDensityGridGrad(eVars.Vscloc, &forcesNL);
+	for(int q=eInfo.qStart; q<eInfo.qStop; q++)
+	{	const QuantumNumber& qnum = e->eInfo.qnums[q];
+		//Collect gradients with respect to VdagCq (not including fillings and state weight):
+		std::vector<matrix> HVdagCq(species.size()); 
+		EnlAndGrad(qnum, eVars.F[q], eVars.VdagC[q], HVdagCq);
+		augmentDensitySphericalGrad(qnum, eVars.F[q], eVars.VdagC[q], HVdagCq);
+		//Propagate to atomic positions:
+		for(unsigned sp=0; sp<species.size(); sp++) if(HVdagCq[sp])
+		{	matrix grad_CdagOCq = -(eVars.Hsub_eigs[q] * eVars.F[q]); //gradient of energy w.r.t overlap matrix
+			species[sp]->accumNonlocalForces(eVars.C[q], eVars.VdagC[q][sp], HVdagCq[sp]*eVars.F[q], grad_CdagOCq, forcesNL[sp]);
+		}
+	}
+	//Start accumulating contributions over processes (completed after the local part below):
+	std::vector<double> forcesNLbuf;
+	for(const auto& force: forcesNL)
+		forcesNLbuf.insert(forcesNLbuf.end(), (const double*)force.data(), (const double*)(force.data()+force.size()));
+	MPIUtil::Request forcesNLrequest;
+	mpiUtil->iallReduce(forcesNLbuf.data(), forcesNLbuf.size(), MPIUtil::ReduceSum, forcesNLrequest);
+	
 	//---------- Forces from pair potential terms (Ewald etc.) ---------
 	IonicGradient forcesPairPot; forcesPairPot.init(*this);
 	pairPotentialsAndGrad(0, &forcesPairPot);
@@ -217,25 +241,13 @@ double IonInfo::ionicEnergyAndGrad(IonicGradient& forces) const
 	if(shouldPrintForceComponents)
 		forcesLoc.print(*e, globalLog, "forceLoc");
 	
-	//--------- Forces due to nonlocal pseudopotential contributions ---------
-	IonicGradient forcesNL; forcesNL.init(*this);
-	if(eInfo.hasU) //Include DFT+U contribution if any:
-		rhoAtom_forces(eVars.F, eVars.C, eVars.U_rhoAtom, forcesNL);
-	augmentDensityGridGrad(eVars.Vscloc, &forcesNL);
-	for(int q=eInfo.qStart; q<eInfo.qStop; q++)
-	{	const QuantumNumber& qnum = e->eInfo.qnums[q];
-		//Collect gradients with respect to VdagCq (not including fillings and state weight):
-		std::vector<matrix> HVdagCq(species.size()); 
-		EnlAndGrad(qnum, eVars.F[q], eVars.VdagC[q], HVdagCq);
-		augmentDensitySphericalGrad(qnum, eVars.F[q], eVars.VdagC[q], HVdagCq);
-		//Propagate to atomic positions:
-		for(unsigned sp=0; sp<species.size(); sp++) if(HVdagCq[sp])
-		{	matrix grad_CdagOCq = -(eVars.Hsub_eigs[q] * eVars.F[q]); //gradient of energy w.r.t overlap matrix
-			species[sp]->accumNonlocalForces(eVars.C[q], eVars.VdagC[q][sp], HVdagCq[sp]*eVars.F[q], grad_CdagOCq, forcesNL[sp]);
-		}
+	//--------- Finish reduction of nonlocal forces ---------
+	mpiUtil->wait(forcesNLrequest);
+	const double* forcesNLbufPtr = forcesNLbuf.data();
+	for(auto& force: forcesNL)
+	{	std::copy(forcesNLbufPtr, forcesNLbufPtr+3*force.size(), (double*)force.data());
+		forcesNLbufPtr += 3*force.size();
 	}
-	for(auto& force: forcesNL) //Accumulate contributions over processes
-		mpiUtil->allReduce((double*)force.data(), 3*force.size(), MPIUtil::ReduceSum);
 	e->symm.symmetrize(forcesNL);
 	forces += forcesNL;
 	if(shouldPrintForceComponents)
@@ -244,6 +256,113 @@ double IonInfo::ionicEnergyAndGrad(IonicGradient& forces) const
 	return relevantFreeEnergy(*e);
 }
 
+bool IonInfo::analyticStressSupported(string& reason) const
+{	const ElecVars& eVars = e->eVars;
+	if(eVars.fluidSolver) { reason = "fluid solvation"; return false; }
+	if(e->exCorr.exxFactor()) { reason = "exact exchange"; return false; }
+	if(e->exCorr.orbitalDep) { reason = "orbital-dependent exchange-correlation"; return false; }
+	if(e->coulombParams.geometry!=CoulombParams::Periodic || e->coulombParams.embed) { reason = "Coulomb truncation"; return false; }
+	if(e->coulombParams.Efield.length_squared()) { reason = "electric field"; return false; }
+	if(eVars.Vexternal.size() || eVars.rhoExternal) { reason = "external potentials / charges"; return false; }
+	if(nChargeball) { reason = "chargeballs"; return false; }
+	if(e->eInfo.hasU) { reason = "DFT+U"; return false; }
+	if(e->eInfo.isNoncollinear()) { reason = "noncollinear spin"; return false; }
+	return true;
+}
+
+matrix3<> IonInfo::strainDerivative() const
+{	static StopWatch watch("strainDerivative"); watch.start();
+	const ElecInfo &eInfo = e->eInfo;
+	const ElecVars &eVars = e->eVars;
+	const GridInfo &gInfo = e->gInfo;
+	const matrix3<> id(1.,1.,1.);
+	//Note: all terms below are derivatives w.r.t strain at fixed wavefunction coefficients C,
+	//with the change in overlap (orthonormality constraint) accounted for by a Lagrange multiplier term
+	
+	//---------- Pair potential terms (Ewald etc.) ---------
+	matrix3<> E_RRT;
+	pairPotentialsAndGrad(0, 0, &E_RRT);
+	
+	//---------- Local terms: electrostatics and exchange-correlation ---------
+	const ScalarFieldTilde nTilde = J(eVars.get_nTot());
+	//--- long-ranged electron-ion interaction (point nuclear charges, which scale as 1/detR):
+	ScalarFieldTilde rhoIonPoint, VlocTmp, nChargeballTmp, nCoreTmp, tauCoreTmp;
+	initZero(rhoIonPoint, gInfo);
+	initZero(VlocTmp, gInfo);
+	for(auto sp: species)
+		sp->updateLocal(VlocTmp, rhoIonPoint, nChargeballTmp, nCoreTmp, tauCoreTmp);
+	E_RRT += e->coulomb->latticeGradient(nTilde, rhoIonPoint) - dot(nTilde, O((*e->coulomb)(rhoIonPoint))) * id;
+	//--- Hartree:
+	E_RRT += 0.5 * e->coulomb->latticeGradient(nTilde, nTilde);
+	//--- Exchange-correlation (at fixed density on the grid, including partial core):
+	ScalarFieldArray Vxc(eVars.n.size()), Vtau;
+	e->exCorr(eVars.get_nXC(), &Vxc, false, &eVars.tau, &Vtau, &E_RRT);
+	ScalarField VxcAvg = (Vxc.size()==1) ? Vxc[0] : 0.5*(Vxc[0]+Vxc[1]); //spin-avgd potential
+	ScalarFieldTilde ccgrad_nCore, ccgrad_tauCore;
+	if(nCore)
+	{	ScalarField VxcCore, VtauCore;
+		matrix3<> E_RRTcore;
+		e->exCorr(nCore, &VxcCore, false, &tauCore, &VtauCore, &E_RRTcore);
+		E_RRT -= E_RRTcore; //Exc_core = -Exc(nCore)
+		ccgrad_nCore = J(VxcAvg - VxcCore);
+		if(e->exCorr.needsKEdensity())
+		{	ScalarField VtauAvg = (Vtau.size()==1) ? Vtau[0] : 0.5*(Vtau[0]+Vtau[1]);
+			if(VtauAvg) ccgrad_tauCore = J(VtauAvg - VtauCore);
+		}
+	}
+	//--- short-ranged pseudopotential and changes in partial core densities:
+	for(auto sp: species)
+		E_RRT += sp->getLocalStress(nTilde, ccgrad_nCore, ccgrad_tauCore);
+	//--- Pulay correction (actual basis count fixed, but per unit volume changes):
+	{	double dEtot_dnG = 0.0;
+		for(auto sp: species)
+			dEtot_dnG += sp->atpos.size() * sp->dE_dnG;
+		double nbasisAvg = 0.0;
+		for(int q=eInfo.qStart; q<eInfo.qStop; q++)
+			nbasisAvg += 0.5*eInfo.qnums[q].weight * e->basis[q].nbasis;
+		mpiUtil->allReduce(nbasisAvg, MPIUtil::ReduceSum);
+		E_RRT += (dEtot_dnG * nbasisAvg / gInfo.detR) * id;
+	}
+	
+	//---------- Band-structure terms (distributed over states) ---------
+	matrix3<> E_RRTq;
+	augmentDensityGridGrad(eVars.Vscloc);
+	for(int q=eInfo.qStart; q<eInfo.qStop; q++)
+	{	const QuantumNumber& qnum = eInfo.qnums[q];
+		const ColumnBundle& Cq = eVars.C[q];
+		const diagMatrix& Fq = eVars.F[q];
+		matrix grad_CdagOCq = -(eVars.Hsub_eigs[q] * Fq); //gradient of energy w.r.t overlap matrix
+		//Orthonormality constraint: overlap scales as detR
+		E_RRTq += (qnum.weight * gInfo.detR * trace(grad_CdagOCq * (Cq^Cq)).real()) * id;
+		//Kinetic energy (and orbital KE density for meta-GGAs):
+		ColumnBundle DC[3];
+		for(int a=0; a<3; a++) DC[a] = D(Cq, a);
+		bool needTau = Vtau.size() && Vtau[qnum.index()];
+		matrix3<> T, Ttau;
+		for(int a=0; a<3; a++)
+			for(int b=a; b<3; b++)
+			{	T(a,b) = T(b,a) = gInfo.detR * qnum.weight * traceinner(Fq, DC[a], DC[b]).real();
+				if(needTau) Ttau(a,b) = Ttau(b,a) = gInfo.dV * qnum.weight * traceinner(Fq, DC[a], Idag_DiagV_I(DC[b], Vtau)).real();
+			}
+		E_RRTq += 0.5*trace(T)*id - T - Ttau;
+		//Nonlocal pseudopotential and augmentation via projectors:
+		std::vector<matrix> HVdagCq(species.size());
+		EnlAndGrad(qnum, Fq, eVars.VdagC[q], HVdagCq);
+		augmentDensitySphericalGrad(qnum, Fq, eVars.VdagC[q], HVdagCq);
+		for(unsigned sp=0; sp<species.size(); sp++) if(HVdagCq[sp])
+			species[sp]->accumNonlocalStress(Cq, eVars.VdagC[q][sp], HVdagCq[sp]*Fq, grad_CdagOCq, E_RRTq);
+	}
+	//Augmentation via grid (each process handles a share of G-vectors):
+	for(auto sp: species)
+		sp->augmentDensityGridStress(eVars.Vscloc, E_RRTq);
+	mpiUtil->allReduce(&E_RRTq(0,0), 9, MPIUtil::ReduceSum);
+	E_RRT += E_RRTq;
+	
+	e->symm.symmetrize(E_RRT);
+	watch.stop();
+	return E_RRT;
+}
+
 double IonInfo::EnlAndGrad(const QuantumNumber& qnum, const diagMatrix& Fq, const std::vector<matrix>& VdagCq, std::vector<matrix>& HVdagCq) const
 {	double Enlq = 0.0;
 	for(unsigned sp=0; sp<species.size(); sp++)
@@ -434,7 +553,7 @@ ColumnBundle IonInfo::getAtomicOrbitals(int q, bool applyO, int extraCols) const
 }
 
 
-void IonInfo::pairPotentialsAndGrad(Energies* ener, IonicGradient* forces) const
+void IonInfo::pairPotentialsAndGrad(Energies* ener, IonicGradient* forces, matrix3<>* E_RRT) const
 {
 	//Obtain the list of atomic positions and charges:
 	std::vector<Atom> atoms;
@@ -444,12 +563,12 @@ void IonInfo::pairPotentialsAndGrad(Energies* ener, IonicGradient* forces) const
 			atoms.push_back(Atom(sp.Z, pos, vector3<>(0.,0.,0.), sp.atomicNumber, spIndex));
 	}
 	//Compute Ewald sum and gradients (this also moves each Atom::pos into fundamental zone)
-	double Eewald = e->coulomb->energyAndGrad(atoms);
+	double Eewald = e->coulomb->energyAndGrad(atoms, E_RRT);
 	//Compute optional pair-potential terms:
 	double EvdW = 0.;
 	if(vdWenable)
 	{	double scaleFac = e->vanDerWaals->getScaleFactor(e->exCorr.getName(), vdWscale);
-		EvdW = e->vanDerWaals->energyAndGrad(atoms, scaleFac); //vanDerWaals energy+force
+		EvdW = e->vanDerWaals->energyAndGrad(atoms, scaleFac, E_RRT); //vanDerWaals energy+force(+stress)
 	}
 	//Store energies and/or forces if requested:
 	if(ener)
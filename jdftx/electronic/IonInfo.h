@@ -51,6 +51,7 @@ class IonInfo
 public:
 	std::vector< std::shared_ptr<SpeciesInfo> > species; //!< list of ionic species
 	std::vector<string> pspFilenamePatterns; //!< list of wildcards for pseudopotential sets
+	string pspCacheDir; //!< directory for binary cache of processed pseudopotential data (disabled if empty)
 	
 	CoordsType coordsType; //!< coordinate system for ionic positions etc.
 	ForcesOutputCoords forcesOutputCoords; //!< coordinate system to print forces in
@@ -79,6 +80,13 @@ public:
 
 	//! Return the total (free) energy and calculate the ionic gradient (forces)
 	double ionicEnergyAndGrad(IonicGradient& forces) const;
+	
+	//! Check whether the current calculation supports analytic stress (strainDerivative), and if not, set reason
+	bool analyticStressSupported(string& reason) const;
+	
+	//! Return the derivative of the total energy with respect to Cartesian strain of the lattice vectors,
+	//! i.e. dE/d(eps) for R -> (1+eps) R with eps symmetric (requires analyticStressSupported)
+	matrix3<> strainDerivative() const;
 
 	//! Return the non-local pseudopotential energy due to a single state.
 	//! Optionally accumulate the corresponding electronic gradient in HCq and ionic gradient in forces
@@ -125,8 +133,8 @@ public:
 private:
 	const Everything* e;
 	
-	//! Compute all pair-potential terms in the energy or forces (electrostatic, and optionally vdW)
-	void pairPotentialsAndGrad(class Energies* ener=0, IonicGradient* forces=0) const;
+	//! Compute all pair-potential terms in the energy, forces or strain derivative (electrostatic, and optionally vdW)
+	void pairPotentialsAndGrad(class Energies* ener=0, IonicGradient* forces=0, matrix3<>* E_RRT=0) const;
 };
 
 //! @}
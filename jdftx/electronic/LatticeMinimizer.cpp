@@ -201,10 +201,24 @@ double LatticeMinimizer::compute(LatticeGradient* grad, LatticeGradient* Kgrad)
 
 void LatticeMinimizer::calculateStress()
 {	matrix3<> E_strain;
-	for(size_t i=0; i<strainBasis.size(); i++)
-		E_strain += strainBasis[i]*centralDifference(strainBasis[i]);
-	e.gInfo.R = Rorig + Rorig*strain;
-	updateLatticeDependent(e);
+	string reason;
+	if(!e.cntrl.stressFiniteDifference && e.iInfo.analyticStressSupported(reason))
+	{	//Convert derivative w.r.t Cartesian strain to that along each strain basis direction:
+		//R = Rorig (1 + strain + h direction) => Cartesian strain R (1+strain)^-1 direction R^-1 per unit h
+		const matrix3<> E_RRT = e.iInfo.strainDerivative();
+		const matrix3<> RinvStrain = e.gInfo.R * inv(matrix3<>(1.,1.,1.) + strain);
+		for(size_t i=0; i<strainBasis.size(); i++)
+			E_strain += strainBasis[i]*dot(E_RRT, RinvStrain * strainBasis[i] * e.gInfo.invR);
+	}
+	else
+	{	if(e.cntrl.stressFiniteDifference) logPrintf("(finite difference) ");
+		else logPrintf("(finite difference; analytic stress unsupported with %s) ", reason.c_str());
+		logFlush();
+		for(size_t i=0; i<strainBasis.size(); i++)
+			E_strain += strainBasis[i]*centralDifference(strainBasis[i]);
+		e.gInfo.R = Rorig + Rorig*strain;
+		updateLatticeDependent(e);
+	}
 	e.iInfo.stress = E_strain * (1./e.gInfo.detR);
 }
 
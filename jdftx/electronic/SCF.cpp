@@ -21,6 +21,7 @@ along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
 #include <electronic/ElecMinimizer.h>
 #include <electronic/Everything.h>
 #include <core/ScalarFieldIO.h>
+#include <core/Checkpoint.h>
 #include <fluid/FluidSolver.h>
 #include <queue>
 
@@ -63,7 +64,8 @@ SCF::SCF(Everything& e): Pulay<SCFvariable>(e.scfParams), e(e), kerkerMix(e.gInf
 	
 	//Load history if available:
 	if(sp.historyFilename.length())
-	{	loadState(sp.historyFilename.c_str());
+	{	Checkpoint::verify(sp.historyFilename);
+		loadState(sp.historyFilename.c_str());
 		sp.historyFilename.clear(); //make sure it doesn't get loaded again on subsequent SCFs (eg. in an ionic loop)
 	}
 }
@@ -92,6 +94,10 @@ void SCF::minimize()
 	double eMinThreshold = e.elecMinParams.energyDiffThreshold;
 	int eMinIterations = e.elecMinParams.nIterations;
 
+	//Start in single precision if requested (promoted in cycle once eigenvalues settle):
+	if(e.cntrl.mixedPrecisionThreshold)
+		setMixedPrecision(e, true);
+	
 	//Compute energy for the initial guess
 	double E = eVars.elecEnergyAndGrad(e.ener, 0, 0, true); mpiUtil->bcast(E); //Compute energy (and ensure consistency to machine precision)
 	
@@ -99,6 +105,8 @@ void SCF::minimize()
 	std::vector<string> extraNames(1, "deigs");
 	std::vector<double> extraThresh(1, sp.eigDiffThreshold);
 	Pulay<SCFvariable>::minimize(E, extraNames, extraThresh);
+	if(setMixedPrecision(e, false)) //stopped before promotion: final energy in double precision
+		eVars.elecEnergyAndGrad(e.ener, 0, 0, true);
 	e.iInfo.augmentDensityGridGrad(e.eVars.Vscloc); //to make sure grid projections are compatible with final Vscloc
 	
 	//Restore electronic minimize params that were modified above:
@@ -134,6 +142,13 @@ double SCF::cycle(double dEprev, std::vector<double>& extraValues)
 	mpiUtil->bcast(E); //ensure consistency to machine precision
 
 	extraValues[0] = eigDiffRMS(eigsPrev, e.eVars.Hsub_eigs);
+	
+	//Promote to double precision once eigenvalues settle:
+	if(extraValues[0] < e.cntrl.mixedPrecisionThreshold && setMixedPrecision(e, false))
+	{	logPrintf("MixedPrecision: |deigs| = %le below threshold; switching to double precision.\n", extraValues[0]);
+		E = e.eVars.elecEnergyAndGrad(e.ener);
+		mpiUtil->bcast(E);
+	}
 	return E;
 }
 
@@ -148,7 +163,23 @@ void SCF::report(int iter)
 	if(e.dump.count(std::make_pair(DumpFreq_Electronic,DumpState)) && e.dump.checkInterval(DumpFreq_Electronic,iter))
 	{	string fname = e.dump.getFilename("scfHistory");
 		logPrintf("Dumping '%s' ... ", fname.c_str()); logFlush();
-		saveState(fname.c_str());
+		if(e.dump.checkpoint)
+		{	//Stage history in memory and write it in the background:
+			std::vector<char> data;
+			if(mpiUtil->isHead())
+			{	char* buf; size_t bufSize;
+				FILE* fp = open_memstream(&buf, &bufSize);
+				saveState(fp);
+				fclose(fp);
+				data.assign(buf, buf+bufSize);
+				free(buf);
+			}
+			e.dump.checkpoint->write(fname, std::move(data));
+		}
+		else
+		{	Checkpoint::invalidate(fname);
+			saveState(fname.c_str());
+		}
 		logPrintf("done\n"); logFlush();
 	}
 }
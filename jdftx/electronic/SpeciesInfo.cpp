@@ -131,6 +131,40 @@ void axpy(double alpha, const RadialFunctionR& X, RadialFunctionR& Y);
 
 const std::vector<string>& getPseudopotentialPrefixes(); //implemented in ion_species.cpp
 
+void SpeciesInfo::readPseudopotential(istream& is)
+{	switch(pspFormat)
+	{	case Fhi: readFhi(is); break;
+		case Uspp: readUspp(is); break;
+		case UPF: readUPF(is); break;
+	}
+}
+
+void SpeciesInfo::setupOpsi()
+{	if(Qint.size())
+	{	OpsiRadial = new std::vector<std::vector<RadialFunctionG> >(psiRadial.size());
+		const double dG = e->gInfo.dGradial;
+		const int nGridNL = int(ceil(e->gInfo.GmaxSphere/dG))+5;
+		logPrintf("  Transforming overlap'd orbitals to a uniform radial grid of dG=%lg with %d points.\n", dG, nGridNL);
+		for(int l=0; l<int(psiRadial.size()); l++)
+			for(size_t n=0; n<psiRadial[l].size(); n++)
+			{	const RadialFunctionR& psi = *(psiRadial[l][n].rFunc);
+				RadialFunctionR Opsi = psi;
+				if(Qint.size() && l<int(VnlRadial.size()))
+				{	std::vector<double> VdagPsi(VnlRadial[l].size());
+					for(size_t p=0; p<VnlRadial[l].size(); p++)
+						VdagPsi[p] = dot(*(VnlRadial[l][p].rFunc), psi);
+					complex* Qdata = Qint[l].data();
+					for(size_t p1=0; p1<VnlRadial[l].size(); p1++)
+						for(size_t p2=0; p2<VnlRadial[l].size(); p2++)
+							axpy(Qdata[Qint[l].index(p1,p2)].real()*VdagPsi[p2], *(VnlRadial[l][p1].rFunc), Opsi);
+				}
+				OpsiRadial->at(l).push_back(RadialFunctionG());
+				Opsi.transform(l, dG, nGridNL, OpsiRadial->at(l).back());
+			}
+	}
+	else OpsiRadial = &psiRadial; //psi == Opsi for norm-conserving PSP
+}
+
 void SpeciesInfo::setup(const Everything &everything)
 {	e = &everything;
 	if(!atpos.size()) return; //unused species
@@ -146,10 +180,9 @@ void SpeciesInfo::setup(const Everything &everything)
 	}
 	if(!ifs.is_open()) die("Can't open pseudopotential file '%s' for reading.\n", potfilename.c_str());
 	logPrintf("\nReading pseudopotential file '%s':\n",potfilenameFull.c_str());
-	switch(pspFormat)
-	{	case Fhi: readFhi(ifs); break;
-		case Uspp: readUspp(ifs); break;
-		case UPF: readUPF(ifs); break;
+	if(!readCached(ifs, potfilenameFull)) //use binary cache of processed data if enabled (see SpeciesInfo_cache.cpp)
+	{	readPseudopotential(ifs);
+		setupOpsi();
 	}
 	
 	//Add citation for recognized sources:
@@ -160,31 +193,6 @@ void SpeciesInfo::setup(const Everything &everything)
 		Citations::add("Pseudopotentials",
 			"M Schlipf and F Gygi, Comput. Phys. Commun. 196, 36 (2015)");
 	
-	//Initialize Opsi if needed:
-	if(Qint.size())
-	{	OpsiRadial = new std::vector<std::vector<RadialFunctionG> >(psiRadial.size());
-		const double dG = e->gInfo.dGradial;
-		const int nGridNL = int(ceil(e->gInfo.GmaxSphere/dG))+5;
-		logPrintf("  Transforming overlap'd orbitals to a uniform radial grid of dG=%lg with %d points.\n", dG, nGridNL);
-		for(int l=0; l<int(psiRadial.size()); l++)
-			for(size_t n=0; n<psiRadial[l].size(); n++)
-			{	const RadialFunctionR& psi = *(psiRadial[l][n].rFunc);
-				RadialFunctionR Opsi = psi;
-				if(Qint.size() && l<int(VnlRadial.size()))
-				{	std::vector<double> VdagPsi(VnlRadial[l].size());
-					for(size_t p=0; p<VnlRadial[l].size(); p++)
-						VdagPsi[p] = dot(*(VnlRadial[l][p].rFunc), psi);
-					complex* Qdata = Qint[l].data();
-					for(size_t p1=0; p1<VnlRadial[l].size(); p1++)
-						for(size_t p2=0; p2<VnlRadial[l].size(); p2++)
-							axpy(Qdata[Qint[l].index(p1,p2)].real()*VdagPsi[p2], *(VnlRadial[l][p1].rFunc), Opsi);
-				}
-				OpsiRadial->at(l).push_back(RadialFunctionG());
-				Opsi.transform(l, dG, nGridNL, OpsiRadial->at(l).back());
-			}
-	}
-	else OpsiRadial = &psiRadial; //psi == Opsi for norm-conserving PSP
-	
 	//Estimate eigenvalues (if not read from file):
 	estimateAtomEigs();
 	
@@ -411,6 +419,12 @@ void SpeciesInfo::populationAnalysis(const std::vector<matrix>& RhoAll) const
 	}
 }
 
+//Extend radial functions (with angular momentum) to specified sample count, in parallel over channels:
+void updateGmax_sub(size_t iStart, size_t iStop, std::pair<RadialFunctionG*,int>* funcs, int nSamples)
+{	for(size_t i=iStart; i<iStop; i++)
+		funcs[i].first->updateGmax(funcs[i].second, nSamples);
+}
+
 void SpeciesInfo::updateLatticeDependent()
 {	const GridInfo& gInfo = e->gInfo;
 	bool Rchanged = (Rprev != gInfo.R);
@@ -419,10 +433,9 @@ void SpeciesInfo::updateLatticeDependent()
 	//Change radial function extents if R has changed:
 	if(Rchanged)
 	{	int nGridLoc = int(ceil(gInfo.GmaxGrid/gInfo.dGradial))+5;
-		VlocRadial.updateGmax(0, nGridLoc);
-		nCoreRadial.updateGmax(0, nGridLoc);
-		tauCoreRadial.updateGmax(0, nGridLoc);
-		for(auto& Qijl: Qradial) Qijl.second.updateGmax(Qijl.first.l, nGridLoc);
+		std::vector<std::pair<RadialFunctionG*,int>> funcs = { {&VlocRadial,0}, {&nCoreRadial,0}, {&tauCoreRadial,0} };
+		for(auto& Qijl: Qradial) funcs.push_back(std::make_pair(&Qijl.second, Qijl.first.l));
+		threadLaunch(updateGmax_sub, funcs.size(), funcs.data(), nGridLoc);
 		cachedV.clear(); //clear any cached projectors
 	}
 	
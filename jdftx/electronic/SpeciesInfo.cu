@@ -47,6 +47,27 @@ void Vnl_gpu(int nbasis, int atomStride, int nAtoms, int l, int m, vector3<> k,
 }
 
 
+//Calculate strain derivative of non-local pseudopotential projector
+template<int l, int m> __global__
+void VnlPrime_kernel(int nbasis, int atomStride, int nAtoms, vector3<> k, const vector3<int>* iGarr,
+	const matrix3<> G, const vector3<>* pos, const RadialFunctionG VnlRadial, const matrix3<> strain, complex* V)
+{	int n = kernelIndex1D();
+	if(n<nbasis) VnlPrime_calc<l,m>(n, atomStride, nAtoms, k, iGarr, G, pos, VnlRadial, strain, V);
+}
+template<int l, int m>
+void VnlPrime_gpu(int nbasis, int atomStride, int nAtoms, vector3<> k, const vector3<int>* iGarr,
+	const matrix3<> G, const vector3<>* pos, const RadialFunctionG& VnlRadial, const matrix3<> strain, complex* V)
+{	GpuLaunchConfig1D glc(VnlPrime_kernel<l,m>, nbasis);
+	VnlPrime_kernel<l,m><<<glc.nBlocks,glc.nPerBlock>>>(nbasis, atomStride, nAtoms, k, iGarr, G, pos, VnlRadial, strain, V);
+	gpuErrorCheck();
+}
+void VnlPrime_gpu(int nbasis, int atomStride, int nAtoms, int l, int m, vector3<> k, const vector3<int>* iGarr,
+	const matrix3<> G, const vector3<>* pos, const RadialFunctionG& VnlRadial, const matrix3<> strain, complex* V)
+{
+	SwitchTemplate_lm(l,m, VnlPrime_gpu, (nbasis, atomStride, nAtoms, k, iGarr, G, pos, VnlRadial, strain, V) )
+}
+
+
 //Augment electron density by spherical functions
 template<int Nlm> __global__ void nAugment_kernel(int zBlock, const vector3<int> S, const matrix3<> G, int iGstart, int iGstop,
 	int nCoeff, double dGinv, const double* nRadial, const vector3<> atpos, complex* n)
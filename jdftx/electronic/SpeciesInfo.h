@@ -142,6 +142,16 @@ public:
 	//! Propagate gradient with respect to atomic projections (in E_VdagC, along with additional overlap contributions from grad_CdagOC) to forces:
 	void accumNonlocalForces(const ColumnBundle& Cq, const matrix& VdagC, const matrix& E_VdagC, const matrix& grad_CdagOCq, std::vector<vector3<> >& forces) const;
 	
+	//Lattice derivative (stress) functions, analogous to the force functions above; all derivatives are w.r.t Cartesian strain:
+	std::shared_ptr<ColumnBundle> getVprime(const ColumnBundle& Cq, const matrix3<>& strain) const; //!< derivative of getV() along a symmetric Cartesian strain direction (not cached)
+	//! Return the strain derivative of local energy terms (short-ranged part of Vlocps and nCore/tauCore) given gradients as in getLocalForces.
+	//! The long-ranged Coulomb part (through rhoIon) is handled separately in IonInfo.
+	matrix3<> getLocalStress(const ScalarFieldTilde& ccgrad_Vlocps, const ScalarFieldTilde& ccgrad_nCore, const ScalarFieldTilde& ccgrad_tauCore) const;
+	//! Accumulate strain derivative of nonlocal energy through the projectors (same inputs as accumNonlocalForces)
+	void accumNonlocalStress(const ColumnBundle& Cq, const matrix& VdagC, const matrix& E_VdagC, const matrix& grad_CdagOCq, matrix3<>& E_RRT) const;
+	//! Accumulate strain derivative of energy through the grid augmentation of density (call after augmentDensityGridGrad; each process handles its share of G-vectors)
+	void augmentDensityGridStress(const ScalarFieldArray& E_n, matrix3<>& E_RRT) const;
+	
 	//! Spin-angle helper functions:
 	static matrix getYlmToSpinAngleMatrix(int l, int j2); //!< Get the ((2l+1)*2)x(j2+1) matrix that transforms the Ylm+spin to the spin-angle functions, where j2=2*j with j = l+/-0.5
 	static matrix getYlmOverlapMatrix(int l, int j2); //!< Get the ((2l+1)*2)x((2l+1)*2) overlap matrix of the spin-spherical harmonics for total angular momentum j (note j2=2*j)
@@ -211,6 +221,12 @@ private:
 	void readFhi(istream&); // Implemented in SpeciesInfo_readFhi.cpp
 	void readUspp(istream&); //Implemented in SpeciesInfo_readUspp.cpp
 	void readUPF(istream&); //Implemented in SpeciesInfo_readUPF.cpp
+	void readPseudopotential(istream&); //!< read pseudopotential in pspFormat using one of the above
+	void setupOpsi(); //!< initialize OpsiRadial (after reading pseudopotential)
+	bool readCached(istream&, string potfilenameFull); //!< read and set up pseudopotential via binary cache of processed data, if enabled (implemented in SpeciesInfo_cache.cpp)
+	uint64_t cacheKey(const string& pspContents) const; //!< hash of pseudopotential contents and all parameters that affect processed data
+	bool loadCache(const string& fname, uint64_t key, string& logText); //!< load processed data from binary cache, if valid
+	void saveCache(const string& fname, uint64_t key, const string& logText) const; //!< save processed data to binary cache
 	void setupPulay();
 	
 	//Following implemented in SpeciesInfo_atomFillings.cpp
@@ -175,6 +175,24 @@ void SpeciesInfo::augmentDensityGridGrad(const ScalarFieldArray& E_n, std::vecto
 	watch.stop();
 }
 
+void SpeciesInfo::augmentDensityGridStress(const ScalarFieldArray& E_n, matrix3<>& E_RRT) const
+{	static StopWatch watch("augmentDensityGridStress"); watch.start();
+	augmentDensityGrid_COMMON_INIT
+	const GridInfo &gInfo = e->gInfo;
+	double dGinv = 1./gInfo.dGradial;
+	matrix nAugTot = nAug; nAugTot.allReduce(MPIUtil::ReduceSum);
+	matrix nAugRadial = QradialMat * nAugTot; //transform from radial functions to spline coeffs
+	const double* nAugRadialData = (const double*)nAugRadial.data();
+	for(unsigned s=0; s<E_n.size(); s++)
+	{	ScalarFieldTilde ccE_n = Idag(E_n[s]);
+		for(unsigned atom=0; atom<atpos.size(); atom++)
+		{	int atomOffs = nCoeff * Nlm * (atom + atpos.size()*s);
+			nAugmentStress(Nlm, gInfo.S, gInfo.G, gInfo.iGstart, gInfo.iGstop, nCoeff, dGinv, nAugRadialData+atomOffs, atpos[atom], ccE_n->data(), &E_RRT);
+		}
+	}
+	watch.stop();
+}
+
 void SpeciesInfo::augmentDensitySphericalGrad(const QuantumNumber& qnum, const diagMatrix& Fq, const matrix& VdagCq, matrix& HVdagCq) const
 {	static StopWatch watch("augmentDensitySphericalGrad"); watch.start();
 	augmentDensity_COMMON_INIT
@@ -0,0 +1,297 @@
+/*-------------------------------------------------------------------
+Copyright 2017 Ravishankar Sundararaman
+
+This file is part of JDFTx.
+
+JDFTx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+JDFTx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
+-------------------------------------------------------------------*/
+
+#include <electronic/SpeciesInfo.h>
+#include <electronic/Everything.h>
+#include <core/Util.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <iterator>
+
+//Binary cache file layout: header of nHeaderWords 64-bit words (magic, version, byte-order marker, key, payload size, payload checksum),
+//followed by the payload of processed species data in native byte order (cache files are not meant to be portable)
+static const char cacheMagic[8] = { 'J', 'D', 'F', 'T', 'x', 'P', 'S', 'P' };
+static const uint64_t cacheVersion = 1; //increment whenever the processed data or its layout changes
+static const uint64_t cacheByteOrder = 0x0102030405060708ULL;
+static const int nHeaderWords = 6;
+
+//Serialize processed data to a byte buffer:
+struct CacheWriter
+{	std::vector<char> buf;
+
+	void put(const void* data, size_t n) { buf.insert(buf.end(), (const char*)data, (const char*)data+n); }
+	template<typename T> void put(const T& x) { put(&x, sizeof(T)); }
+	template<typename T> void put(const std::vector<T>& v) { put(uint64_t(v.size())); put(v.data(), v.size()*sizeof(T)); }
+	template<typename T> void put(const std::vector<std::vector<T>>& v) { put(uint64_t(v.size())); for(const std::vector<T>& vi: v) put(vi); }
+	void put(const string& s) { put(uint64_t(s.length())); put(s.data(), s.length()); }
+	void put(const matrix& m) { put(int32_t(m.nRows())); put(int32_t(m.nCols())); put(m.data(), m.nData()*sizeof(complex)); }
+	void put(const RadialFunctionR& f) { put(f.r); put(f.dr); put(f.f); }
+	void put(const RadialFunctionG& f)
+	{	put(f.dGinv); put(f.coeff); put(f.samples);
+		put(uint8_t(bool(f.rFunc))); if(f.rFunc) put(*f.rFunc);
+	}
+};
+
+//Deserialize processed data from a (memory-mapped) byte range; ok is cleared on any overrun:
+struct CacheReader
+{	const char* pos; const char* end; bool ok;
+	CacheReader(const char* pos, const char* end) : pos(pos), end(end), ok(true) {}
+
+	const char* take(size_t n)
+	{	if(!ok || size_t(end-pos) < n) { ok = false; return 0; }
+		const char* result = pos; pos += n; return result;
+	}
+	void get(void* data, size_t n) { const char* src = take(n); if(src) memcpy(data, src, n); }
+	template<typename T> void get(T& x) { get(&x, sizeof(T)); }
+	template<typename T> void get(std::vector<T>& v)
+	{	uint64_t n=0; get(n);
+		if(!ok || n > size_t(end-pos)/sizeof(T)) { ok = false; return; }
+		v.resize(n); get(v.data(), n*sizeof(T));
+	}
+	template<typename T> void get(std::vector<std::vector<T>>& v)
+	{	uint64_t n=0; get(n);
+		if(!ok || n > size_t(end-pos)) { ok = false; return; }
+		v.resize(n); for(std::vector<T>& vi: v) get(vi);
+	}
+	void get(string& s) { uint64_t n=0; get(n); const char* src = take(n); if(src) s.assign(src, n); }
+	void get(matrix& m)
+	{	int32_t nRows=0, nCols=0; get(nRows); get(nCols);
+		if(!ok || nRows<0 || nCols<0) { ok = false; return; }
+		m = matrix();
+		if(nRows*nCols) { m.init(nRows, nCols); get(m.data(), m.nData()*sizeof(complex)); }
+	}
+	void get(RadialFunctionR& f) { get(f.r); get(f.dr); get(f.f); }
+	void get(RadialFunctionG& f)
+	{	double dGinv=0.; std::vector<double> coeff; get(dGinv); get(coeff); get(f.samples);
+		uint8_t hasRfunc=0; get(hasRfunc);
+		if(hasRfunc) { f.rFunc = new RadialFunctionR; get(*f.rFunc); }
+		if(ok && coeff.size()) f.set(coeff, dGinv);
+	}
+};
+
+//Processed data of a vector of vectors of radial functions:
+inline void putRadial(CacheWriter& cw, const std::vector<std::vector<RadialFunctionG>>& v)
+{	cw.put(uint64_t(v.size()));
+	for(const std::vector<RadialFunctionG>& vi: v)
+	{	cw.put(uint64_t(vi.size()));
+		for(const RadialFunctionG& f: vi) cw.put(f);
+	}
+}
+inline void getRadial(CacheReader& cr, std::vector<std::vector<RadialFunctionG>>& v)
+{	uint64_t n=0; cr.get(n);
+	if(!cr.ok || n > size_t(cr.end-cr.pos)) { cr.ok = false; return; }
+	v.resize(n);
+	for(std::vector<RadialFunctionG>& vi: v)
+	{	uint64_t ni=0; cr.get(ni);
+		if(!cr.ok || ni > size_t(cr.end-cr.pos)) { cr.ok = false; return; }
+		vi.resize(ni);
+		for(RadialFunctionG& f: vi) cr.get(f);
+	}
+}
+
+
+#ifdef __GLIBC__
+//Log stream that writes through to a target stream while recording the text written (uses glibc's fopencookie):
+struct LogTee
+{	FILE* target;
+	string text;
+	LogTee(FILE* target) : target(target) {}
+	
+	static ssize_t write(void* cookie, const char* buf, size_t size)
+	{	LogTee& tee = *((LogTee*)cookie);
+		tee.text.append(buf, size);
+		return fwrite(buf, 1, size, tee.target);
+	}
+};
+#endif
+
+
+bool SpeciesInfo::readCached(istream& is, string potfilenameFull)
+{	const string& cacheDir = e->iInfo.pspCacheDir;
+	if(!cacheDir.length() || tauCorePlot) return false; //cache disabled (or side-effects of processing requested)
+
+	//Read contents and determine cache filename:
+	string contents((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+	uint64_t key = cacheKey(contents);
+	size_t slashPos = potfilenameFull.find_last_of('/');
+	string baseName = (slashPos==string::npos) ? potfilenameFull : potfilenameFull.substr(slashPos+1);
+	char keyHex[17]; sprintf(keyHex, "%016" PRIx64, key);
+	string cacheFilename = cacheDir + "/" + baseName + "." + keyHex + ".pspcache";
+
+	//Load from cache if possible:
+	string logText;
+	if(loadCache(cacheFilename, key, logText))
+	{	logPrintf("%s", logText.c_str());
+		logPrintf("  Loaded processed pseudopotential data from cache '%s'.\n", cacheFilename.c_str());
+		return true;
+	}
+
+	//Otherwise process the pseudopotential, recording log output for replay from cache later.
+	//The log is tee'd (rather than redirected) so that any die() during processing still reaches the original log.
+	//(Log replay is skipped on platforms without fopencookie: the cache then stores no log text.)
+	#ifdef __GLIBC__
+	LogTee tee(globalLog);
+	cookie_io_functions_t teeFuncs = { 0, LogTee::write, 0, 0 };
+	FILE* teeLog = fopencookie(&tee, "w", teeFuncs);
+	if(teeLog)
+	{	setvbuf(teeLog, 0, _IONBF, 0); //pass-through immediately
+		globalLog = teeLog;
+	}
+	#endif
+	istringstream iss(contents);
+	readPseudopotential(iss);
+	setupOpsi();
+	#ifdef __GLIBC__
+	if(teeLog)
+	{	globalLog = tee.target;
+		fclose(teeLog);
+		logText = tee.text;
+	}
+	#endif
+	if(mpiUtil->isHead()) saveCache(cacheFilename, key, logText);
+	return true;
+}
+
+
+uint64_t SpeciesInfo::cacheKey(const string& pspContents) const
+{	//Parameters that affect the processed data (see readFhi, readUspp, readUPF, setCore and setupOpsi):
+	const double dG = e->gInfo.dGradial;
+	int nGridLoc = int(ceil(e->gInfo.GmaxGrid/dG))+5;
+	int nGridNL = int(ceil(e->gInfo.GmaxSphere/dG))+5;
+	bool needTau = e->exCorr.needsKEdensity();
+	for(auto ec: e->exCorrDiff)
+		needTau |= ec->needsKEdensity();
+	bool ignoreCore = e->exCorr.orbitalDep && e->exCorr.orbitalDep->ignore_nCore();
+	CacheWriter cw;
+	cw.put(cacheVersion);
+	cw.put(int32_t(pspFormat));
+	cw.put(dG); cw.put(int32_t(nGridLoc)); cw.put(int32_t(nGridNL));
+	cw.put(RadialFunctionR::transformTol);
+	cw.put(tauCore_rCut); cw.put(uint8_t(needTau)); cw.put(uint8_t(ignoreCore));
+	cw.put(pspContents);
+	uint64_t key = fnv1aInit;
+	fnv1a(key, cw.buf.data(), cw.buf.size());
+	return key;
+}
+
+
+bool SpeciesInfo::loadCache(const string& fname, uint64_t key, string& logText)
+{	//Map file:
+	int fd = open(fname.c_str(), O_RDONLY);
+	if(fd < 0) return false; //not yet cached
+	struct stat st; fstat(fd, &st);
+	size_t mappedSize = st.st_size;
+	if(mappedSize < 8*nHeaderWords) { close(fd); return false; }
+	void* mappedPtr = mmap(0, mappedSize, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if(mappedPtr == MAP_FAILED) return false;
+	const char* mapped = (const char*)mappedPtr;
+
+	//Check header and payload checksum:
+	uint64_t header[nHeaderWords-1];
+	memcpy(header, mapped+8, sizeof(header));
+	bool valid = !memcmp(mapped, cacheMagic, 8)
+		&& header[0]==cacheVersion && header[1]==cacheByteOrder && header[2]==key
+		&& header[3]==mappedSize-8*nHeaderWords;
+	if(valid)
+	{	uint64_t checksum = fnv1aInit;
+		fnv1a(checksum, mapped+8*nHeaderWords, header[3]);
+		valid = (checksum == header[4]);
+	}
+	if(!valid)
+	{	munmap(mappedPtr, mappedSize);
+		logPrintf("  Ignoring invalid or outdated pseudopotential cache '%s'.\n", fname.c_str());
+		return false;
+	}
+
+	//Read payload:
+	CacheReader cr(mapped+8*nHeaderWords, mapped+mappedSize);
+	cr.get(logText);
+	cr.get(Z); cr.get(atomicNumber); cr.get(coreRadius);
+	cr.get(VlocRadial); cr.get(nCoreRadial); cr.get(tauCoreRadial);
+	getRadial(cr, VnlRadial);
+	uint64_t nMnl=0; cr.get(nMnl); if(nMnl <= mappedSize) { Mnl.resize(nMnl); for(matrix& M: Mnl) cr.get(M); } else cr.ok = false;
+	uint64_t nQint=0; cr.get(nQint); if(nQint <= mappedSize) { Qint.resize(nQint); for(matrix& Q: Qint) cr.get(Q); } else cr.ok = false;
+	uint64_t nQradial=0; cr.get(nQradial);
+	for(uint64_t iQ=0; iQ<nQradial && cr.ok; iQ++)
+	{	int32_t indices[5]; cr.get(indices);
+		QijIndex qIndex = { indices[0], indices[1], indices[2], indices[3], indices[4] };
+		cr.get(Qradial[qIndex]);
+	}
+	getRadial(cr, psiRadial);
+	if(Qint.size())
+	{	OpsiRadial = new std::vector<std::vector<RadialFunctionG> >();
+		getRadial(cr, *OpsiRadial);
+	}
+	else OpsiRadial = &psiRadial;
+	cr.get(atomEigs);
+	cr.get(Vnl2j); cr.get(psi2j);
+	munmap(mappedPtr, mappedSize);
+	if(!cr.ok) die("  Pseudopotential cache '%s' is inconsistent with its header.\n", fname.c_str()); //partially loaded, so cannot fall back
+	return true;
+}
+
+
+void SpeciesInfo::saveCache(const string& fname, uint64_t key, const string& logText) const
+{	//Serialize payload:
+	CacheWriter cw;
+	cw.put(logText);
+	cw.put(Z); cw.put(atomicNumber); cw.put(coreRadius);
+	cw.put(VlocRadial); cw.put(nCoreRadial); cw.put(tauCoreRadial);
+	putRadial(cw, VnlRadial);
+	cw.put(uint64_t(Mnl.size())); for(const matrix& M: Mnl) cw.put(M);
+	cw.put(uint64_t(Qint.size())); for(const matrix& Q: Qint) cw.put(Q);
+	cw.put(uint64_t(Qradial.size()));
+	for(const auto& Qijl: Qradial)
+	{	const QijIndex& q = Qijl.first;
+		int32_t indices[5] = { q.l1, q.p1, q.l2, q.p2, q.l };
+		cw.put(indices);
+		cw.put(Qijl.second);
+	}
+	putRadial(cw, psiRadial);
+	if(Qint.size()) putRadial(cw, *OpsiRadial);
+	cw.put(atomEigs);
+	cw.put(Vnl2j); cw.put(psi2j);
+
+	//Header:
+	uint64_t header[nHeaderWords-1] = { cacheVersion, cacheByteOrder, key, cw.buf.size(), fnv1aInit };
+	fnv1a(header[4], cw.buf.data(), cw.buf.size());
+
+	//Write to a temporary file and rename into place (so that concurrent runs never see partial files):
+	mkdir(e->iInfo.pspCacheDir.c_str(), 0755); //ignore failure (typically because it exists)
+	char tmpSuffix[32]; sprintf(tmpSuffix, ".%d.tmp", int(getpid()));
+	string tmpFilename = fname + tmpSuffix;
+	FILE* fp = fopen(tmpFilename.c_str(), "wb");
+	if(!fp)
+	{	logPrintf("  WARNING: could not write pseudopotential cache '%s'.\n", fname.c_str());
+		return;
+	}
+	bool ok = (fwrite(cacheMagic, 1, 8, fp) == 8)
+		&& (fwrite(header, sizeof(uint64_t), nHeaderWords-1, fp) == size_t(nHeaderWords-1))
+		&& (fwrite(cw.buf.data(), 1, cw.buf.size(), fp) == cw.buf.size());
+	ok &= (fclose(fp) == 0);
+	if(!ok || rename(tmpFilename.c_str(), fname.c_str()) != 0)
+	{	unlink(tmpFilename.c_str());
+		logPrintf("  WARNING: could not write pseudopotential cache '%s'.\n", fname.c_str());
+		return;
+	}
+	logPrintf("  Saved processed pseudopotential data to cache '%s'.\n", fname.c_str());
+}
@@ -22,6 +22,7 @@ along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
 #include <electronic/Everything.h>
 #include <electronic/ColumnBundle.h>
 #include <core/matrix.h>
+#include <core/LoopMacros.h>
 
 //------- primary SpeciesInfo functions involved in simple energy and gradient calculations (with norm-conserving pseudopotentials) -------
 
@@ -231,6 +232,47 @@ std::vector< vector3<double> > SpeciesInfo::getLocalForces(const ScalarFieldTild
 	return forces;
 }
 
+//Strain derivative of local terms at one G-vector (see getLocalStress):
+inline void getLocalStress_calc(size_t i, const vector3<int>& iG, const vector3<int>& S, const matrix3<>& G,
+	const complex* ccgrad_Vlocps, const complex* ccgrad_nCore, const complex* ccgrad_tauCore,
+	int nAtoms, const vector3<>* atpos, const RadialFunctionG& VlocRadial,
+	const RadialFunctionG& nCoreRadial, const RadialFunctionG& tauCoreRadial, matrix3<>& E_RRT)
+{	vector3<> Gvec = iG * G; //Cartesian wave-vector
+	double Gmag = Gvec.length();
+	double weight = (iG[2]==0||2*iG[2]==S[2]) ? 1 : 2; //weight of half-space point
+	complex SG = weight * getSG_calc(iG, nAtoms, atpos);
+	matrix3<> GGbyG = Gmag ? (1./Gmag)*outer(Gvec,Gvec) : matrix3<>(); //|G| -> |G| - GGbyG:strain
+	//Short-ranged part of local potential (1/detR cancels volume factor in the energy):
+	E_RRT -= ((ccgrad_Vlocps[i].conj() * SG).real() * VlocRadial.deriv(Gmag)) * GGbyG;
+	//Partial core (also includes change in 1/detR):
+	if(ccgrad_nCore)
+		E_RRT -= (ccgrad_nCore[i].conj() * SG).real() * (nCoreRadial.deriv(Gmag) * GGbyG + nCoreRadial(Gmag) * matrix3<>(1.,1.,1.));
+	if(ccgrad_tauCore)
+		E_RRT -= (ccgrad_tauCore[i].conj() * SG).real() * (tauCoreRadial.deriv(Gmag) * GGbyG + tauCoreRadial(Gmag) * matrix3<>(1.,1.,1.));
+}
+void getLocalStress_sub(size_t iStart, size_t iStop, const vector3<int> S, const matrix3<> G,
+	const complex* ccgrad_Vlocps, const complex* ccgrad_nCore, const complex* ccgrad_tauCore,
+	int nAtoms, const vector3<>* atpos, const RadialFunctionG* VlocRadial,
+	const RadialFunctionG* nCoreRadial, const RadialFunctionG* tauCoreRadial, matrix3<>* E_RRT, std::mutex* m)
+{	matrix3<> E_RRTlocal;
+	THREAD_halfGspaceLoop( getLocalStress_calc(i, iG, S, G, ccgrad_Vlocps, ccgrad_nCore, ccgrad_tauCore,
+		nAtoms, atpos, *VlocRadial, *nCoreRadial, *tauCoreRadial, E_RRTlocal); )
+	m->lock(); *E_RRT += E_RRTlocal; m->unlock();
+}
+
+matrix3<> SpeciesInfo::getLocalStress(const ScalarFieldTilde& ccgrad_Vlocps, const ScalarFieldTilde& ccgrad_nCore, const ScalarFieldTilde& ccgrad_tauCore) const
+{	matrix3<> E_RRT;
+	if(!atpos.size()) return E_RRT; //unused species
+	const GridInfo& gInfo = e->gInfo;
+	const complex* ccgrad_nCoreData = (nCoreRadial && ccgrad_nCore) ? ccgrad_nCore->data() : 0;
+	const complex* ccgrad_tauCoreData = (tauCoreRadial && ccgrad_tauCore) ? ccgrad_tauCore->data() : 0;
+	std::mutex m;
+	threadLaunch(getLocalStress_sub, gInfo.nG, gInfo.S, gInfo.G,
+		ccgrad_Vlocps->data(), ccgrad_nCoreData, ccgrad_tauCoreData, int(atpos.size()), atpos.data(),
+		&VlocRadial, &nCoreRadial, &tauCoreRadial, &E_RRT, &m);
+	return E_RRT;
+}
+
 void SpeciesInfo::accumNonlocalForces(const ColumnBundle& Cq, const matrix& VdagC, const matrix& E_VdagC, const matrix& grad_CdagOCq, std::vector<vector3<> >& forces) const
 {	matrix DVdagC[3]; //cartesian gradient of VdagC
 	{	auto V = getV(Cq);
@@ -253,6 +295,45 @@ void SpeciesInfo::accumNonlocalForces(const ColumnBundle& Cq, const matrix& Vdag
 	}
 }
 
+void SpeciesInfo::accumNonlocalStress(const ColumnBundle& Cq, const matrix& VdagC, const matrix& E_VdagC, const matrix& grad_CdagOCq, matrix3<>& E_RRT) const
+{	int nProj = MnlAll.nRows();
+	matrix E_VdagCtot = E_VdagC;
+	if(QintAll) //Contribution via overlap augmentation
+	{	for(unsigned atom=0; atom<atpos.size(); atom++)
+		{	matrix atomVdagC = VdagC(atom*nProj,(atom+1)*nProj, 0,E_VdagC.nCols());
+			matrix E_atomVdagC = E_VdagC(atom*nProj,(atom+1)*nProj, 0,E_VdagC.nCols());
+			E_VdagCtot.set(atom*nProj,(atom+1)*nProj, 0,E_VdagC.nCols(), E_atomVdagC + QintAll * atomVdagC * grad_CdagOCq);
+		}
+	}
+	//Loop over independent components of symmetric strain:
+	for(int a=0; a<3; a++)
+		for(int b=a; b<3; b++)
+		{	matrix3<> strain; strain(a,b) += 0.5; strain(b,a) += 0.5;
+			auto Vprime = getVprime(Cq, strain);
+			double E_ab = 2.*Cq.qnum->weight * trace(E_VdagCtot * dagger((*Vprime)^Cq)).real();
+			E_RRT(a,b) += E_ab;
+			if(b>a) E_RRT(b,a) += E_ab;
+		}
+}
+
+std::shared_ptr<ColumnBundle> SpeciesInfo::getVprime(const ColumnBundle& Cq, const matrix3<>& strain) const
+{	const QuantumNumber& qnum = *(Cq.qnum);
+	const Basis& basis = *(Cq.basis);
+	int nProj = MnlAll.nRows() / e->eInfo.spinorLength();
+	if(!nProj) return 0; //purely local psp
+	std::shared_ptr<ColumnBundle> Vprime = std::make_shared<ColumnBundle>(nProj*atpos.size(), basis.nbasis, &basis, &qnum, isGpuEnabled()); //not a spinor regardless of spin type
+	int iProj = 0;
+	for(int l=0; l<int(VnlRadial.size()); l++)
+		for(unsigned p=0; p<VnlRadial[l].size(); p++)
+			for(int m=-l; m<=l; m++)
+			{	size_t offs = iProj * basis.nbasis;
+				size_t atomStride = nProj * basis.nbasis;
+				callPref(VnlPrime)(basis.nbasis, atomStride, atpos.size(), l, m, qnum.k, basis.iGarr.dataPref(), basis.gInfo->G, atposManaged.dataPref(), VnlRadial[l][p], strain, Vprime->dataPref()+offs);
+				iProj++;
+			}
+	return Vprime;
+}
+
 std::shared_ptr<ColumnBundle> SpeciesInfo::getV(const ColumnBundle& Cq, matrix* M) const
 {	const QuantumNumber& qnum = *(Cq.qnum);
 	const Basis& basis = *(Cq.basis);
@@ -36,6 +36,16 @@ void Vnl(int nbasis, int atomStride, int nAtoms, int l, int m, const vector3<> k
 {	SwitchTemplate_lm(l,m, Vnl, (nbasis, atomStride, nAtoms, k, iGarr, G, pos, VnlRadial, V) )
 }
 
+template<int l, int m>
+void VnlPrime(int nbasis, int atomStride, int nAtoms, const vector3<> k, const vector3<int>* iGarr,
+	const matrix3<> G, const vector3<>* pos, const RadialFunctionG& VnlRadial, const matrix3<> strain, complex* V)
+{	threadedLoop(VnlPrime_calc<l,m>, nbasis, atomStride, nAtoms, k, iGarr, G, pos, VnlRadial, strain, V);
+}
+void VnlPrime(int nbasis, int atomStride, int nAtoms, int l, int m, const vector3<> k, const vector3<int>* iGarr,
+	const matrix3<> G, const vector3<>* pos, const RadialFunctionG& VnlRadial, const matrix3<> strain, complex* V)
+{	SwitchTemplate_lm(l,m, VnlPrime, (nbasis, atomStride, nAtoms, k, iGarr, G, pos, VnlRadial, strain, V) )
+}
+
 //Augment electron density by spherical functions
 template<int Nlm> void nAugment_sub(size_t diStart, size_t diStop, const vector3<int> S, const matrix3<>& G, int iGstart,
 	int nCoeff, double dGinv, const double* nRadial, const vector3<>& atpos, complex* n)
@@ -54,6 +64,62 @@ void nAugment(int Nlm, const vector3<int> S, const matrix3<>& G, int iGstart, in
 	SwitchTemplate_Nlm(Nlm, nAugment, (S, G, iGstart, iGstop, nCoeff, dGinv, nRadial, atpos, n) )
 }
 
+//Strain derivative of augmentation energy (CPU only):
+struct nAugmentStressFunctor
+{	vector3<> qhat; double q;
+	int nCoeff; double dGinv; const double* nRadial;
+	complex E_n; //conjugate gradient w.r.t density, times the structure factor and half-space weight
+	matrix3<> E_RRT;
+	
+	nAugmentStressFunctor(const vector3<>& qvec, int nCoeff, double dGinv, const double* nRadial, const complex& E_n)
+	: nCoeff(nCoeff), dGinv(dGinv), nRadial(nRadial), E_n(E_n)
+	{	q = qvec.length();
+		qhat = qvec * (q ? 1.0/q : 0.0); //the unit vector along qvec (set qhat to 0 for q=0 (doesn't matter))
+	}
+	
+	template<int lm> void operator()(const StaticLoopYlmTag<lm>&)
+	{	//Compute phase (-i)^l (l is the angular momentum at loop end):
+		complex mIota(0,-1), phase(1,0);
+		int l = 0;
+		for(; l*(l+2) < lm; l++) phase *= mIota;
+		double Gindex = q * dGinv;
+		if(Gindex >= nCoeff-5) return;
+		double c = (phase * E_n).real();
+		double Q = QuinticSpline::value(nRadial+lm*nCoeff, Gindex);
+		double Q_q = dGinv * QuinticSpline::deriv(nRadial+lm*nCoeff, Gindex);
+		double Y = Ylm<lm>(qhat);
+		vector3<> P = YlmPrime<lm>(qhat);
+		//q -> (1-strain)q and an overall 1/detR in nRadial:
+		E_RRT -= c * ( ((q*Q_q - l*Q)*Y) * outer(qhat,qhat)
+			+ (0.5*Q) * (outer(qhat,P) + outer(P,qhat))
+			+ (Q*Y) * matrix3<>(1.,1.,1.) );
+	}
+};
+template<int Nlm> void nAugmentStress_calc(size_t i, const vector3<int>& iG, const vector3<int>& S, const matrix3<>& G,
+	int nCoeff, double dGinv, const double* nRadial, const vector3<>& atpos, const complex* ccE_n, matrix3<>& E_RRT)
+{	int dotPrefac = (iG[2]==0||2*iG[2]==S[2]) ? 1 : 2;
+	nAugmentStressFunctor functor(iG*G, nCoeff, dGinv, nRadial, dotPrefac * ccE_n[i].conj() * cis((-2*M_PI)*dot(atpos,iG)));
+	staticLoopYlm<Nlm>(&functor);
+	E_RRT += functor.E_RRT;
+}
+template<int Nlm> void nAugmentStress_sub(size_t diStart, size_t diStop, const vector3<int> S, const matrix3<>& G, int iGstart,
+	int nCoeff, double dGinv, const double* nRadial, const vector3<>& atpos, const complex* ccE_n, matrix3<>* E_RRT, std::mutex* m)
+{	size_t iStart = iGstart + diStart;
+	size_t iStop = iGstart + diStop;
+	matrix3<> E_RRTlocal;
+	THREAD_halfGspaceLoop( (nAugmentStress_calc<Nlm>)(i, iG, S, G, nCoeff, dGinv, nRadial, atpos, ccE_n, E_RRTlocal); )
+	m->lock(); *E_RRT += E_RRTlocal; m->unlock();
+}
+template<int Nlm> void nAugmentStress(const vector3<int> S, const matrix3<>& G, int iGstart, int iGstop,
+	int nCoeff, double dGinv, const double* nRadial, const vector3<>& atpos, const complex* ccE_n, matrix3<>* E_RRT)
+{	std::mutex m;
+	threadLaunch(nAugmentStress_sub<Nlm>, iGstop-iGstart, S, G, iGstart, nCoeff, dGinv, nRadial, atpos, ccE_n, E_RRT, &m);
+}
+void nAugmentStress(int Nlm, const vector3<int> S, const matrix3<>& G, int iGstart, int iGstop,
+	int nCoeff, double dGinv, const double* nRadial, const vector3<>& atpos, const complex* ccE_n, matrix3<>* E_RRT)
+{	SwitchTemplate_Nlm(Nlm, nAugmentStress, (S, G, iGstart, iGstop, nCoeff, dGinv, nRadial, atpos, ccE_n, E_RRT) )
+}
+
 //Function for initializing the index arrays used by nAugmentGrad
 void setNagIndex_sub(size_t diStart, size_t diStop, const vector3<int> S, const matrix3<> G, int iGstart, double dGinv, uint64_t* nagIndex)
 {	size_t iStart = iGstart + diStart;
@@ -51,6 +51,30 @@ void Vnl_gpu(int nbasis, int atomStride, int nAtoms, int l, int m, const vector3
 	const matrix3<> G, const vector3<>* pos, const RadialFunctionG& VnlRadial, complex* Vnl);
 #endif
 
+//! Compute derivative of Vnl along a symmetric Cartesian strain direction (k+G -> (1-strain)(k+G))
+template<int l, int m> __hostanddev__
+void VnlPrime_calc(int n, int atomStride, int nAtoms, const vector3<>& k, const vector3<int>* iGarr,
+	const matrix3<>& G, const vector3<>* pos, const RadialFunctionG& VnlRadial, const matrix3<>& strain, complex* Vnl)
+{
+	vector3<> kpG = k + iGarr[n]; //k+G in reciprocal lattice coordinates:
+	vector3<> qvec = kpG * G; //k+G in cartesian coordinates
+	double q = qvec.length();
+	vector3<> qhat = qvec * (q ? 1.0/q : 0.0); //the unit vector along qvec (set qhat to 0 for q=0 (doesn't matter))
+	vector3<> strain_qhat = strain * qhat;
+	double f = VnlRadial(q), f_q = VnlRadial.deriv(q);
+	double prefac = -( (q*f_q - l*f) * Ylm<l,m>(qhat) * dot(qhat, strain_qhat)
+		+ f * dot(YlmPrime<l,m>(qhat), strain_qhat) ); //prefactor to structure factor
+	//Loop over columns (multiple atoms at same l,m):
+	for(int atom=0; atom<nAtoms; atom++)
+		Vnl[atom*atomStride+n] = prefac * cis((-2*M_PI)*dot(pos[atom],kpG));
+}
+void VnlPrime(int nbasis, int atomStride, int nAtoms, int l, int m, const vector3<> k, const vector3<int>* iGarr,
+	const matrix3<> G, const vector3<>* pos, const RadialFunctionG& VnlRadial, const matrix3<> strain, complex* Vnl);
+#ifdef GPU_ENABLED
+void VnlPrime_gpu(int nbasis, int atomStride, int nAtoms, int l, int m, const vector3<> k, const vector3<int>* iGarr,
+	const matrix3<> G, const vector3<>* pos, const RadialFunctionG& VnlRadial, const matrix3<> strain, complex* Vnl);
+#endif
+
 
 //! Perform the loop:
 //!   for(lm=0; lm < Nlm; lm++) (*f)(tag< lm >);
@@ -185,6 +209,12 @@ void nAugmentGrad_gpu(int Nlm, const vector3<int> S, const matrix3<>& G,
 	const uint64_t* nagIndex, const size_t* nagIndexPtr);
 #endif
 
+//! Accumulate derivative of augmentation energy w.r.t Cartesian strain (CPU only).
+//! ccE_n is the conjugate gradient w.r.t density (as in nAugmentGrad); each process handles G-vectors in [iGstart,iGstop)
+void nAugmentStress(int Nlm, const vector3<int> S, const matrix3<>& G, int iGstart, int iGstop,
+	int nCoeff, double dGinv, const double* nRadial, const vector3<>& atpos, const complex* ccE_n, matrix3<>* E_RRT);
+
+
 
 //!Get structure factor for a specific iG, given a list of atoms
 __hostanddev__ complex getSG_calc(const vector3<int>& iG, const int& nAtoms, const vector3<>* atpos)
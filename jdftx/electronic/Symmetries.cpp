@@ -154,9 +154,9 @@ std::vector<QuantumNumber> Symmetries::reduceKmesh(const std::vector<QuantumNumb
 //Symmetrize scalar fields:
 void Symmetries::symmetrize(ScalarField& x) const
 {	if(sym.size()==1) return; // No symmetries, nothing to do
-	complexScalarFieldTilde xTilde = J(Complex(x));
+	ScalarFieldTilde xTilde = J(x); //real-to-complex transforms suffice since symmetrization preserves Hermiticity in G-space
 	symmetrize(xTilde);
-	x = Real(I(xTilde));
+	x = I(xTilde);
 }
 void Symmetries::symmetrize(ScalarFieldTilde& x) const
 {	if(sym.size()==1) return; // No symmetries, nothing to do
@@ -183,6 +183,17 @@ void Symmetries::symmetrize(IonicGradient& f) const
 	}
 }
 
+void Symmetries::symmetrize(matrix3<>& T) const
+{	if(sym.size() <= 1) return;
+	const GridInfo& gInfo = e->gInfo;
+	matrix3<> Tsym;
+	for(const SpaceGroupOp& op: sym)
+	{	matrix3<> rotCart = gInfo.R * op.rot * gInfo.invR; //rotation in Cartesian coordinates
+		Tsym += rotCart * T * (~rotCart);
+	}
+	T = Tsym * (1./sym.size());
+}
+
 //Symmetrize Ylm-basis matrices:
 void Symmetries::symmetrizeSpherical(matrix& X, const SpeciesInfo* specie) const
 {	//Find index of specie (so as to access atom map)
@@ -198,16 +209,31 @@ void Symmetries::symmetrizeSpherical(matrix& X, const SpeciesInfo* specie) const
 	assert(X.nCols()==nTot);
 	if(!l || sym.size()==1) return; //symmetries do nothing
 	const std::vector<matrix>& sym_l = getSphericalMatrices(l, specie->isRelativistic());
-	matrix result;
+	//Each operation transforms atom blocks as result[atomMap(a),atomMap(b)] += D X[a,b] D^, with D = sym_l[iRot].
+	//Column-major X (nTot x nTot) is identical in memory to an orbCount x (nAtoms*nTot) matrix of row blocks,
+	//so that D can be applied to all atom blocks with a single matrix product (instead of dense nTot x nTot products):
+	int nBlockCols = nAtoms*nTot;
+	matrix result = zeroes(nTot, nTot);
+	complex* resultData = result.data();
+	matrix DX(nTot, nTot), DXDdag(nTot, nTot);
 	for(unsigned iRot=0; iRot<sym_l.size(); iRot++)
-	{	//Construct transformation matrix including atom maps:
-		matrix m = zeroes(nTot, nTot);
-		for(int atom=0; atom<nAtoms; atom++)
-		{	int atomOut = atomMap[sp][atom][iRot];
-			m.set(atomOut*orbCount,(atomOut+1)*orbCount, atom*orbCount,(atom+1)*orbCount, sym_l[iRot]);
+	{	const matrix& D = sym_l[iRot];
+		//Apply D to row blocks, and then to row blocks of the adjoint (i.e. column blocks):
+		eblas_zgemm(CblasNoTrans, CblasNoTrans, orbCount, nBlockCols, orbCount, 1., D.data(), orbCount, X.data(), orbCount, 0., DX.data(), orbCount);
+		DX = dagger(DX);
+		eblas_zgemm(CblasNoTrans, CblasNoTrans, orbCount, nBlockCols, orbCount, 1., D.data(), orbCount, DX.data(), orbCount, 0., DXDdag.data(), orbCount);
+		//DXDdag now contains the adjoint of the transformed matrix; accumulate its atom-permuted adjoint into result:
+		const complex* inData = DXDdag.data();
+		for(int atom2=0; atom2<nAtoms; atom2++)
+		{	int atom2out = atomMap[sp][atom2][iRot];
+			for(int atom1=0; atom1<nAtoms; atom1++)
+			{	int atom1out = atomMap[sp][atom1][iRot];
+				for(int j=0; j<orbCount; j++)
+					for(int i=0; i<orbCount; i++)
+						resultData[(atom1out*orbCount+i) + nTot*(atom2out*orbCount+j)]
+							+= inData[(atom2*orbCount+j) + nTot*(atom1*orbCount+i)].conj();
+			}
 		}
-		//Apply
-		result += m * X * dagger(m);
 	}
 	X = (1./sym_l.size()) * result;
 }
@@ -435,6 +461,9 @@ std::vector<SpaceGroupOp> Symmetries::findSpaceGroup(const std::vector< matrix3<
 	return spaceGroup;
 }
 
+typedef std::pair<int,complex> SymmIndexEntry; //index and phase of an entry in an orbit
+inline bool symmIndexEntryLess(const SymmIndexEntry& e1, const SymmIndexEntry& e2) { return e1.first < e2.first; }
+
 void Symmetries::initSymmIndex()
 {	const GridInfo& gInfo = e->gInfo;
 	if(sym.size()==1) return;
@@ -451,6 +480,7 @@ void Symmetries::initSymmIndex()
 		THREAD_fullGspaceLoop
 		(	if(!done[i])
 			{	std::set<int> orbit;
+				std::vector<SymmIndexEntry> entries; entries.reserve(sym.size());
 				//Loop over symmetry matrices:
 				for(const SpaceGroupOp& op: sym)
 				{	vector3<int> iG2 = iG * op.rot;
@@ -461,11 +491,17 @@ void Symmetries::initSymmIndex()
 						if(2*iG2[k]>S[k]) iG2[k]-=S[k];
 					}
 					int i2 = gInfo.fullGindex(iG2);
-					symmIndexPhaseVec.push_back(phase);
-					symmIndexVec.push_back(i2);
+					entries.push_back(std::make_pair(i2, phase));
 					done[i2] = true;
 					orbit.insert(i2);
 				}
+				//Store orbit sorted by index: improves locality of gather / scatter,
+				//and places repeated indices adjacently as required by eblas_symmetrize
+				std::stable_sort(entries.begin(), entries.end(), symmIndexEntryLess);
+				for(const SymmIndexEntry& entry: entries)
+				{	symmIndexVec.push_back(entry.first);
+					symmIndexPhaseVec.push_back(entry.second);
+				}
 				int multiplicity = sym.size()/orbit.size(); //number of times each point in orbit is covered
 				if(multiplicity * orbit.size() != sym.size())
 				{	die("\nSymmetry operations do not seem to form a group.\n"
@@ -484,6 +520,10 @@ void Symmetries::initSymmIndex()
 	memcpy(symmIndex.data(), &symmIndexVec[0], nSymmIndex*sizeof(int));
 	memcpy(symmMult.data(), &symmMultVec[0], symmMultVec.size()*sizeof(int));
 	memcpy(symmIndexPhase.data(), &symmIndexPhaseVec[0], nSymmIndex*sizeof(complex));
+	//Identical on all processes: keep one copy per node
+	symmIndex.share();
+	symmMult.share();
+	symmIndexPhase.share();
 }
 
 void Symmetries::sortSymmetries()
@@ -563,48 +603,62 @@ void Symmetries::checkSymmetries()
 	}
 }
 
-void Symmetries::initAtomMaps()
+bool Symmetries::updateAtomMaps()
+{	return initAtomMaps(false); //same matching (and tolerance) as initial setup, but report failure instead of quitting
+}
+
+bool Symmetries::initAtomMaps(bool quitOnError)
 {	const IonInfo& iInfo = e->iInfo;
-	if(shouldPrintMatrices) logPrintf("\nMapping of atoms according to symmetries:\n");
-	atomMap.resize(iInfo.species.size());
-	double datposSqSum = 0.; int nAtomsTot = 0; //counters for atom symmetrization statistics
+	std::vector<std::vector<std::vector<int> > > atomMapNew(iInfo.species.size());
+	std::vector<std::vector<vector3<> > > datpos(iInfo.species.size()); //Displacements to exactly symmetrize atpos
 	
 	for(unsigned sp = 0; sp < iInfo.species.size(); sp++)
 	{	const SpeciesInfo& spInfo = *(iInfo.species[sp]);
-		atomMap[sp].resize(spInfo.atpos.size());
+		atomMapNew[sp].resize(spInfo.atpos.size());
+		datpos[sp].resize(spInfo.atpos.size());
 		PeriodicLookup< vector3<> > plook(spInfo.atpos, (~e->gInfo.R) * e->gInfo.R);
-		std::vector<vector3<> > datpos(spInfo.atpos.size()); //Displacements to exactly symmetrize atpos
 		
 		for(size_t a1=0; a1<spInfo.atpos.size(); a1++)
-		{	if(shouldPrintMatrices) logPrintf("%s %3lu: ", spInfo.name.c_str(), a1);
-			atomMap[sp][a1].resize(sym.size());
-			
+		{	atomMapNew[sp][a1].resize(sym.size());
 			for(unsigned iRot = 0; iRot<sym.size(); iRot++)
 			{	vector3<> idealPos = sym[iRot].rot * spInfo.atpos[a1] + sym[iRot].a;
 				size_t a2 = plook.find(idealPos);
 				if(a2 == string::npos)
+				{	if(!quitOnError) return false;
 					die("Atom positions are marginally symmetric (errors comparable to detection threshold).\n"
 						"Use command symmetry-threshold to either increase tolerance and include marginal\n"
 						"symmetries, or reduce tolerance and exclude marginal symmetries, as appropriate.\n\n");
-				atomMap[sp][a1][iRot] = a2;
+				}
+				atomMapNew[sp][a1][iRot] = a2;
 				if(not spInfo.constraints[a1].isEquivalent(spInfo.constraints[a2], e->gInfo.R*sym[iRot].rot*inv(e->gInfo.R)))
+				{	if(!quitOnError) return false;
 					die("\nSpecies %s atoms %lu and %lu are related by symmetry "
 					"but have different move scale factors or inconsistent move constraints.\n\n",
 						spInfo.name.c_str(), a1, a2);
-				if(shouldPrintMatrices) logPrintf(" %3u", atomMap[sp][a1][iRot]);
+				}
 				
 				//Add contributions to symmetrization displacements:
 				vector3<> dat = idealPos - spInfo.atpos[a2];
 				for(int j=0; j<3; j++) dat[j] -= floor(0.5+dat[j]); //wrap to [-0.5,0.5)
-				datpos[a2] += (1./sym.size()) * dat;
+				datpos[sp][a2] += (1./sym.size()) * dat;
 			}
-			if(shouldPrintMatrices) logPrintf("\n");
 		}
-		
-		//Symmetrize atoms:
+	}
+	
+	//All atoms mapped: commit maps and symmetrize atoms
+	atomMap.swap(atomMapNew);
+	if(shouldPrintMatrices) logPrintf("\nMapping of atoms according to symmetries:\n");
+	double datposSqSum = 0.; int nAtomsTot = 0; //counters for atom symmetrization statistics
+	for(unsigned sp = 0; sp < iInfo.species.size(); sp++)
+	{	SpeciesInfo& spInfo = *(iInfo.species[sp]);
 		for(size_t a=0; a<spInfo.atpos.size(); a++)
-		{	((IonInfo&)e->iInfo).species[sp]->atpos[a] += datpos[a];
-			datposSqSum += (e->gInfo.R * datpos[a]).length_squared();
+		{	if(shouldPrintMatrices)
+			{	logPrintf("%s %3lu: ", spInfo.name.c_str(), a);
+				for(int a2: atomMap[sp][a]) logPrintf(" %3d", a2);
+				logPrintf("\n");
+			}
+			spInfo.atpos[a] += datpos[sp][a];
+			datposSqSum += (e->gInfo.R * datpos[sp][a]).length_squared();
 			nAtomsTot++;
 		}
 	}
@@ -612,4 +666,5 @@ void Symmetries::initAtomMaps()
 	//Print atom symmetrization statistics:
 	logPrintf("Applied RMS atom displacement %lg bohrs to make symmetries exact.\n", sqrt(datposSqSum/nAtomsTot));
 	logFlush();
+	return true;
 }
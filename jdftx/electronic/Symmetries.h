@@ -50,12 +50,14 @@ public:
 	void symmetrize(ScalarFieldTilde&) const; //!< symmetrize a scalar field
 	void symmetrize(complexScalarFieldTilde&) const; //!< symmetrize a scalar field
 	void symmetrize(struct IonicGradient&) const; //!< symmetrize forces
+	void symmetrize(matrix3<>&) const; //!< symmetrize a Cartesian rank-2 tensor (eg. stress)
 	void symmetrizeSpherical(matrix&, const class SpeciesInfo* specie) const; //!< symmetrize matrices in Ylm basis per atom of species sp (accounting for atom maps)
 	const std::vector<SpaceGroupOp>& getMatrices() const; //!< directly access the symmetry matrices (in lattice coords)
 	const std::vector<matrix>& getSphericalMatrices(int l, bool relativistic) const; //!< directly access the symmetry matrices (in Ylm or spin-angle basis at specified l, depending on relativistic)
 	const std::vector<int>& getKpointInvertList() const; //!< direct access to inversion property of symmetry group (see kpointInvertList)
 	const std::vector<std::vector<std::vector<int> > >& getAtomMap() const; //!< direct access to mapping of each atom under each symmetry matrix (index order species, atom, symmetry)
 	void printKmap(FILE* fp) const; //!< print the k-point map (cached in kmap)
+	bool updateAtomMaps(); //!< remap atoms (making symmetries exact) after arbitrary position changes; returns false (leaving maps and positions unchanged) if positions break any symmetry
 	
 	static matrix getSpinorRotation(const matrix3<>& rot); //calculate spinor rotation from Cartesian rotation matrix
 private:
@@ -83,14 +85,14 @@ private:
 	void checkSymmetries(); //!< check validity of manually specified symmetry matrices
 	
 	//Index map for scalar field (electron density, potential) symmetrization in reciprocal space
-	IndexArray symmIndex; //negative index corresponds to real-symmetry-folded part of G-space (which will be complex conjugated)
+	IndexArray symmIndex; //full G-space indices of each orbit (equivalence class), sorted within each orbit; orbits ordered by first index
 	ManagedArray<complex> symmIndexPhase; //phase factor for entry at each index
 	IndexArray symmMult; //multiplicity (how many times each element is repeated) in each equivalence class
 	void initSymmIndex();
 	
 	//Atom maps:
 	std::vector<std::vector<std::vector<int> > > atomMap;
-	void initAtomMaps();
+	bool initAtomMaps(bool quitOnError=true); //!< map atoms under each symmetry and symmetrize positions; if quitOnError is false, return false (changing nothing) on failure instead
 	
 	//Supercell handling (for phonon):
 	vector3<int> sup; //!< this is an exact supercell of some unit cell with this count and restrict space group to translations within that unit cell
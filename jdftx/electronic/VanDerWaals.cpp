@@ -134,7 +134,7 @@ VanDerWaals::VanDerWaals(const Everything& everything)
 	}
 }
 
-double VanDerWaals::energyAndGrad(std::vector<Atom>& atoms, const double scaleFac) const
+double VanDerWaals::energyAndGrad(std::vector<Atom>& atoms, const double scaleFac, matrix3<>* E_RRT) const
 {
 	//Truncate summation at 1/r^6 < 10^-16 => r ~ 100 bohrs
 	vector3<bool> isTruncated = e->coulombParams.isTruncated();
@@ -160,6 +160,10 @@ double VanDerWaals::energyAndGrad(std::vector<Atom>& atoms, const double scaleFa
 				double E_r, E = vdwPairEnergyAndGrad(r, C6, R0, E_r);
 				Etot -= 0.5 * scaleFac * E;
 				atoms[c1].force += scaleFac * E_r * (e->gInfo.RTR * x)/r;
+				if(E_RRT)
+				{	vector3<> rVec = e->gInfo.R * x; //Cartesian separation
+					*E_RRT -= (0.5 * scaleFac * E_r / r) * outer(rVec,rVec);
+				}
 			}
 		}
 	}
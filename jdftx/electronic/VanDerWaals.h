@@ -37,8 +37,9 @@ public:
 	const static int unitParticle = -1; //!< special atomic number used by some fluids: point particle with C6=1 J-nm^6/mol and R0=0
 	
 	//! Van der Waal correction energy for a collection of discrete atoms at fixed locations
-	//! Corresponding forces are accumulated to Atom::force for each atom
-	double energyAndGrad(std::vector<Atom>& atoms, const double scaleFac) const;
+	//! Corresponding forces are accumulated to Atom::force for each atom,
+	//! and the derivative w.r.t Cartesian strain is accumulated to E_RRT (if non-null)
+	double energyAndGrad(std::vector<Atom>& atoms, const double scaleFac, matrix3<>* E_RRT=0) const;
 	
 	//! Van der Waal correction to the interaction energy between the explicit atoms
 	//! (from IonInfo) and the continuous fields Ntilde with specified atomic numbers.
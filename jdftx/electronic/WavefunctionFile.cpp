@@ -0,0 +1,358 @@
+/*-------------------------------------------------------------------
+Copyright 2017 Ravishankar Sundararaman
+
+This file is part of JDFTx.
+
+JDFTx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+JDFTx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
+-------------------------------------------------------------------*/
+
+#include <electronic/WavefunctionFile.h>
+#include <electronic/ColumnBundle.h>
+#include <electronic/ElecInfo.h>
+#include <core/Util.h>
+#include <core/LatticeUtils.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef ZLIB_ENABLED
+#include <zlib.h>
+#endif
+
+static const char wfnsMagic[8] = { 'J', 'D', 'F', 'T', 'x', 'W', 'F', 'C' };
+static const int64_t wfnsVersion = 1;
+static const int nHeaderWords = 5; //magic, version, nStates, compression, blockBands
+static const int nStateWords = 8; //k[3], nBasis, nSpinor, nBands, iGoffset, iGbytes
+
+inline int nBlocks(int nBands, int blockBands) { return (nBands + blockBands - 1) / blockBands; }
+
+//Byte shuffle: group corresponding bytes of all 8-byte words together (improves compressibility of doubles)
+inline void shuffle(const char* in, char* out, size_t nWords)
+{	for(size_t w=0; w<nWords; w++)
+		for(int j=0; j<8; j++)
+			out[j*nWords+w] = in[w*8+j];
+}
+inline void unshuffle(const char* in, char* out, size_t nWords)
+{	for(size_t w=0; w<nWords; w++)
+		for(int j=0; j<8; j++)
+			out[w*8+j] = in[j*nWords+w];
+}
+
+//Encode a block of n complex numbers:
+static std::vector<char> encodeBlock(const complex* data, size_t n, WfnsCompression compression)
+{	std::vector<char> out;
+	switch(compression)
+	{	case WfnsCompressNone:
+		{	out.resize(n*sizeof(complex));
+			memcpy(out.data(), data, out.size());
+			convertToLE(out.data(), sizeof(double), 2*n);
+			break;
+		}
+		case WfnsCompressSingle:
+		{	out.resize(2*n*sizeof(float));
+			float* outData = (float*)out.data();
+			const double* inData = (const double*)data;
+			for(size_t i=0; i<2*n; i++) outData[i] = float(inData[i]);
+			convertToLE(out.data(), sizeof(float), 2*n);
+			break;
+		}
+		case WfnsCompressLossless:
+		{
+			#ifdef ZLIB_ENABLED
+			std::vector<char> in(n*sizeof(complex)), shuffled(n*sizeof(complex));
+			memcpy(in.data(), data, in.size());
+			convertToLE(in.data(), sizeof(double), 2*n);
+			shuffle(in.data(), shuffled.data(), 2*n);
+			uLongf outSize = compressBound(shuffled.size());
+			out.resize(outSize);
+			if(compress2((Bytef*)out.data(), &outSize, (const Bytef*)shuffled.data(), shuffled.size(), Z_BEST_SPEED) != Z_OK)
+				die_alone("Error compressing wavefunction block.\n");
+			out.resize(outSize);
+			#else
+			die_alone("Lossless wavefunction compression requires zlib (reconfigure with -D EnableZlib=yes).\n");
+			#endif
+			break;
+		}
+	}
+	return out;
+}
+
+//Read an 8-byte little-endian word from the mapped header:
+template<typename T> T getWord(const char* mapped, size_t iWord)
+{	T result;
+	memcpy(&result, mapped + iWord*8, 8);
+	convertFromLE(&result, 8, 1);
+	return result;
+}
+
+//Write an 8-byte little-endian word to the header:
+template<typename T> void setWord(std::vector<char>& header, size_t iWord, T value)
+{	convertToLE(&value, 8, 1);
+	memcpy(header.data() + iWord*8, &value, 8);
+}
+
+
+std::vector<char> WavefunctionFile::pack(const std::vector<ColumnBundle>& C, const ElecInfo& eInfo, const WfnsContainerParams& params)
+{	int nStates = eInfo.nStates;
+	int nBlocksPerState = nBlocks(eInfo.nBands, params.blockBands);
+	//Encode local blocks and collect metadata:
+	std::vector<double> kArr(3*nStates, 0.);
+	std::vector<long> stateInfo(3*nStates, 0); //nBasis, nSpinor, nBands
+	std::vector<long> blockBytes(nStates*nBlocksPerState, 0);
+	std::vector<std::vector<std::vector<char>>> blocks(nStates);
+	for(int q=eInfo.qStart; q<eInfo.qStop; q++)
+	{	const ColumnBundle& Cq = C[q];
+		assert(Cq.nCols() == eInfo.nBands);
+		for(int j=0; j<3; j++) kArr[3*q+j] = eInfo.qnums[q].k[j];
+		stateInfo[3*q+0] = Cq.basis->nbasis;
+		stateInfo[3*q+1] = Cq.spinorLength();
+		stateInfo[3*q+2] = Cq.nCols();
+		blocks[q].resize(nBlocksPerState);
+		for(int iBlock=0; iBlock<nBlocksPerState; iBlock++)
+		{	int b0 = iBlock*params.blockBands;
+			int nBandsBlock = std::min(params.blockBands, Cq.nCols()-b0);
+			blocks[q][iBlock] = encodeBlock(Cq.data()+b0*Cq.colLength(), nBandsBlock*Cq.colLength(), params.compression);
+			blockBytes[q*nBlocksPerState+iBlock] = blocks[q][iBlock].size();
+		}
+	}
+	mpiUtil->allReduce(kArr.data(), kArr.size(), MPIUtil::ReduceSum);
+	mpiUtil->allReduce(stateInfo.data(), stateInfo.size(), MPIUtil::ReduceSum);
+	mpiUtil->allReduce(blockBytes.data(), blockBytes.size(), MPIUtil::ReduceSum);
+	
+	//Create header and index (head only):
+	std::vector<char> data;
+	if(mpiUtil->isHead())
+	{	size_t nWords = nHeaderWords + nStates*(nStateWords + 2*nBlocksPerState);
+		data.resize(8*nWords);
+		memcpy(data.data(), wfnsMagic, 8);
+		setWord<int64_t>(data, 1, wfnsVersion);
+		setWord<int64_t>(data, 2, nStates);
+		setWord<int64_t>(data, 3, params.compression);
+		setWord<int64_t>(data, 4, params.blockBands);
+		size_t offset = data.size(); //location of data sections
+		size_t iWord = nHeaderWords;
+		for(int q=0; q<nStates; q++)
+		{	size_t iGbytes = 3*sizeof(int32_t)*stateInfo[3*q];
+			for(int j=0; j<3; j++) setWord<double>(data, iWord++, kArr[3*q+j]);
+			for(int j=0; j<3; j++) setWord<int64_t>(data, iWord++, stateInfo[3*q+j]);
+			setWord<int64_t>(data, iWord++, offset);
+			setWord<int64_t>(data, iWord++, iGbytes);
+			offset += iGbytes;
+			for(int iBlock=0; iBlock<nBlocksPerState; iBlock++)
+			{	setWord<int64_t>(data, iWord++, offset);
+				setWord<int64_t>(data, iWord++, blockBytes[q*nBlocksPerState+iBlock]);
+				offset += blockBytes[q*nBlocksPerState+iBlock];
+			}
+		}
+	}
+	
+	//Append local data sections (states are contiguous and in order across processes):
+	for(int q=eInfo.qStart; q<eInfo.qStop; q++)
+	{	const Basis& basis = *(C[q].basis);
+		size_t iGbytes = 3*sizeof(int32_t)*basis.nbasis;
+		size_t start = data.size();
+		data.resize(start + iGbytes);
+		int32_t* iGdata = (int32_t*)(data.data() + start);
+		const vector3<int>* iGarr = basis.iGarr.data();
+		for(size_t i=0; i<basis.nbasis; i++)
+			for(int j=0; j<3; j++)
+				*(iGdata++) = iGarr[i][j];
+		convertToLE(data.data() + start, sizeof(int32_t), 3*basis.nbasis);
+		for(const std::vector<char>& block: blocks[q])
+			data.insert(data.end(), block.begin(), block.end());
+	}
+	return data;
+}
+
+void WavefunctionFile::write(const std::vector<ColumnBundle>& C, const char* fname, const ElecInfo& eInfo, const WfnsContainerParams& params)
+{	std::vector<char> data = pack(C, eInfo, params);
+	//Compute offset of current process:
+	std::vector<long> nBytes(mpiUtil->nProcesses(), 0);
+	nBytes[mpiUtil->iProcess()] = data.size();
+	mpiUtil->allReduce(nBytes.data(), nBytes.size(), MPIUtil::ReduceSum);
+	long offset = 0;
+	for(int iSrc=0; iSrc<mpiUtil->iProcess(); iSrc++)
+		offset += nBytes[iSrc];
+	//Write to file:
+	MPIUtil::File fp; mpiUtil->fopenWrite(fp, fname);
+	mpiUtil->fseek(fp, offset, SEEK_SET);
+	mpiUtil->fwrite(data.data(), 1, data.size(), fp);
+	mpiUtil->fclose(fp);
+}
+
+
+bool WavefunctionFile::isContainer(const char* fname)
+{	FILE* fp = fopen(fname, "r");
+	if(!fp) return false;
+	char magic[8];
+	bool result = (fread(magic, 1, 8, fp)==8) && !memcmp(magic, wfnsMagic, 8);
+	fclose(fp);
+	return result;
+}
+
+WavefunctionFile::WavefunctionFile(const char* fname) : fname(fname)
+{	//Map file:
+	int fd = open(fname, O_RDONLY);
+	if(fd < 0) die("Error opening wavefunction container '%s' for reading.\n", fname);
+	struct stat st; fstat(fd, &st);
+	mappedSize = st.st_size;
+	void* mappedPtr = mmap(0, mappedSize, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if(mappedPtr == MAP_FAILED) die("Error mapping wavefunction container '%s'.\n", fname);
+	mapped = (const char*)mappedPtr;
+	
+	//Parse header:
+	if(mappedSize < 8*nHeaderWords || memcmp(mapped, wfnsMagic, 8))
+		die("File '%s' is not a wavefunction container.\n", fname);
+	if(getWord<int64_t>(mapped, 1) != wfnsVersion)
+		die("Unsupported wavefunction container version %ld in '%s'.\n", long(getWord<int64_t>(mapped, 1)), fname);
+	int nStatesFile = getWord<int64_t>(mapped, 2);
+	compression = WfnsCompression(getWord<int64_t>(mapped, 3));
+	blockBands = getWord<int64_t>(mapped, 4);
+	
+	//Parse index:
+	states.resize(nStatesFile);
+	size_t iWord = nHeaderWords;
+	for(State& s: states)
+	{	if(8*(iWord+nStateWords) > mappedSize) die("Wavefunction container '%s' is truncated.\n", fname);
+		for(int j=0; j<3; j++) s.k[j] = getWord<double>(mapped, iWord++);
+		s.nBasis = getWord<int64_t>(mapped, iWord++);
+		s.nSpinor = getWord<int64_t>(mapped, iWord++);
+		s.nBands = getWord<int64_t>(mapped, iWord++);
+		s.iGoffset = getWord<int64_t>(mapped, iWord++);
+		iWord++; //iGbytes (implied by nBasis)
+		int nBlocksState = nBlocks(s.nBands, blockBands);
+		if(8*(iWord+2*nBlocksState) > mappedSize) die("Wavefunction container '%s' is truncated.\n", fname);
+		for(int iBlock=0; iBlock<nBlocksState; iBlock++)
+		{	s.blockOffset.push_back(getWord<int64_t>(mapped, iWord++));
+			s.blockBytes.push_back(getWord<int64_t>(mapped, iWord++));
+			if(s.blockOffset.back() + s.blockBytes.back() > mappedSize)
+				die("Wavefunction container '%s' is truncated.\n", fname);
+		}
+	}
+}
+
+WavefunctionFile::~WavefunctionFile()
+{	munmap((void*)mapped, mappedSize);
+}
+
+std::vector<vector3<int>> WavefunctionFile::getIG(int q) const
+{	const State& s = states[q];
+	std::vector<int32_t> iGdata(3*s.nBasis);
+	memcpy(iGdata.data(), mapped + s.iGoffset, iGdata.size()*sizeof(int32_t));
+	convertFromLE(iGdata.data(), sizeof(int32_t), iGdata.size());
+	std::vector<vector3<int>> iG(s.nBasis);
+	for(int i=0; i<s.nBasis; i++)
+		for(int j=0; j<3; j++)
+			iG[i][j] = iGdata[3*i+j];
+	return iG;
+}
+
+void WavefunctionFile::decodeBlock(int q, int iBlock, int nBandsBlock, std::vector<complex>& buf) const
+{	const State& s = states[q];
+	size_t n = size_t(nBandsBlock) * s.nBasis * s.nSpinor;
+	buf.resize(n);
+	const char* in = mapped + s.blockOffset[iBlock];
+	size_t inBytes = s.blockBytes[iBlock];
+	switch(compression)
+	{	case WfnsCompressNone:
+		{	if(inBytes != n*sizeof(complex)) die_alone("Corrupted block in wavefunction container '%s'.\n", fname.c_str());
+			memcpy(buf.data(), in, inBytes);
+			break;
+		}
+		case WfnsCompressSingle:
+		{	if(inBytes != 2*n*sizeof(float)) die_alone("Corrupted block in wavefunction container '%s'.\n", fname.c_str());
+			std::vector<float> inData(2*n);
+			memcpy(inData.data(), in, inBytes);
+			convertFromLE(inData.data(), sizeof(float), 2*n);
+			double* outData = (double*)buf.data();
+			for(size_t i=0; i<2*n; i++) outData[i] = inData[i];
+			return; //already in operating endianness
+		}
+		case WfnsCompressLossless:
+		{
+			#ifdef ZLIB_ENABLED
+			std::vector<char> shuffled(n*sizeof(complex));
+			uLongf outSize = shuffled.size();
+			if(uncompress((Bytef*)shuffled.data(), &outSize, (const Bytef*)in, inBytes) != Z_OK || outSize != shuffled.size())
+				die_alone("Corrupted block in wavefunction container '%s'.\n", fname.c_str());
+			unshuffle(shuffled.data(), (char*)buf.data(), 2*n);
+			#else
+			die_alone("Reading losslessly compressed wavefunctions requires zlib (reconfigure with -D EnableZlib=yes).\n");
+			#endif
+			break;
+		}
+		default: die_alone("Unknown compression mode in wavefunction container '%s'.\n", fname.c_str());
+	}
+	convertFromLE(buf.data(), sizeof(double), 2*n);
+}
+
+void WavefunctionFile::read(int q, ColumnBundle& Y, int bStart, int bStop, int colOffset) const
+{	const State& s = states[q];
+	if(bStart<0 || bStop>s.nBands || colOffset+bStop-bStart>Y.nCols())
+		die_alone("Invalid band range [%d,%d) requested from wavefunction container '%s'.\n", bStart, bStop, fname.c_str());
+	if(Y.spinorLength() != s.nSpinor)
+		die_alone("Spinor length of wavefunctions in '%s' does not match current calculation.\n", fname.c_str());
+	if(Y.qnum && (Y.qnum->k - s.k).length_squared() > symmThresholdSq)
+		die_alone("k-point [ %lg %lg %lg ] of state %d in '%s' does not match [ %lg %lg %lg ] in current calculation.\n",
+			s.k[0], s.k[1], s.k[2], q, fname.c_str(), Y.qnum->k[0], Y.qnum->k[1], Y.qnum->k[2]);
+	
+	//Map file basis to that of Y, if necessary:
+	const Basis& basis = *(Y.basis);
+	std::vector<vector3<int>> iG = getIG(q);
+	bool sameBasis = (int(basis.nbasis)==s.nBasis) && !memcmp(iG.data(), basis.iGarr.data(), s.nBasis*sizeof(vector3<int>));
+	std::vector<int> basisMap; //index into Y's basis for each basis function in file (-1 if absent)
+	if(!sameBasis)
+	{	const GridInfo& gInfo = *(basis.gInfo);
+		std::vector<int> boxToBasis(gInfo.nr, -1);
+		const int* index = basis.index.data();
+		for(size_t i=0; i<basis.nbasis; i++)
+			boxToBasis[index[i]] = i;
+		basisMap.assign(s.nBasis, -1);
+		for(int i=0; i<s.nBasis; i++)
+		{	bool inBox = true;
+			for(int j=0; j<3; j++)
+				if(2*abs(iG[i][j]) >= gInfo.S[j])
+					inBox = false;
+			if(inBox) basisMap[i] = boxToBasis[gInfo.fullGindex(iG[i])];
+		}
+		//Bases at the same k differ only in cutoff (or k-dependence), so they must share basis functions:
+		int nMapped = 0;
+		for(int i: basisMap) if(i >= 0) nMapped++;
+		if(!nMapped)
+			die_alone("Basis of state %d in '%s' has no G-vectors in common with current calculation.\n", q, fname.c_str());
+	}
+	
+	//Read blocks overlapping band range:
+	std::vector<complex> buf;
+	size_t colLengthFile = size_t(s.nBasis) * s.nSpinor;
+	for(int iBlock=bStart/blockBands; iBlock*blockBands<bStop; iBlock++)
+	{	int b0 = iBlock*blockBands;
+		int nBandsBlock = std::min(blockBands, s.nBands-b0);
+		decodeBlock(q, iBlock, nBandsBlock, buf);
+		for(int b=std::max(b0,bStart); b<std::min(b0+nBandsBlock,bStop); b++)
+		{	complex* dest = Y.data() + (colOffset+b-bStart)*Y.colLength();
+			const complex* src = buf.data() + (b-b0)*colLengthFile;
+			if(sameBasis)
+				memcpy(dest, src, colLengthFile*sizeof(complex));
+			else
+			{	memset(dest, 0, Y.colLength()*sizeof(complex));
+				for(int sp=0; sp<s.nSpinor; sp++)
+					for(int i=0; i<s.nBasis; i++)
+						if(basisMap[i] >= 0)
+							dest[sp*basis.nbasis + basisMap[i]] = src[sp*s.nBasis + i];
+			}
+		}
+	}
+}
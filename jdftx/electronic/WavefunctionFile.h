@@ -0,0 +1,104 @@
+/*-------------------------------------------------------------------
+Copyright 2017 Ravishankar Sundararaman
+
+This file is part of JDFTx.
+
+JDFTx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+JDFTx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
+-------------------------------------------------------------------*/
+
+#ifndef JDFTX_ELECTRONIC_WAVEFUNCTIONFILE_H
+#define JDFTX_ELECTRONIC_WAVEFUNCTIONFILE_H
+
+#include <core/string.h>
+#include <core/vector3.h>
+#include <stdint.h>
+#include <vector>
+
+class ColumnBundle;
+class ElecInfo;
+
+//! @addtogroup Output
+//! @{
+//! @file WavefunctionFile.h Self-describing, chunked wavefunction container with lazy loading
+
+//! Compression of wavefunction blocks in the container
+enum WfnsCompression
+{	WfnsCompressNone, //!< store double-precision coefficients as is
+	WfnsCompressLossless, //!< byte-shuffle and deflate (requires zlib)
+	WfnsCompressSingle //!< store single-precision coefficients (relative error < 2^-24 per component)
+};
+
+//! Parameters controlling the wavefunction container output
+struct WfnsContainerParams
+{	WfnsCompression compression; //!< compression of each block
+	int blockBands; //!< number of bands per independently-readable block
+	WfnsContainerParams() : compression(WfnsCompressNone), blockBands(16) {}
+};
+
+//! Read-only access to a wavefunction container, mapped into memory so that
+//! only the blocks (k-point, band range) actually requested are read from disk.
+//! The container records the k-point, basis G-vectors and band count of each state,
+//! so that wavefunctions can be read into a different basis (Ecut) or number of bands
+//! without any external information. Layout (all little-endian, 8-byte header words):
+//! magic, version, nStates, compression, blockBands; then for each state:
+//! k[3], nBasis, nSpinor, nBands, iG offset, iG bytes; then (offset, bytes) for each band block;
+//! followed by the iG table (3 int32 per basis function) and data blocks of each state.
+class WavefunctionFile
+{
+public:
+	//! Properties of each state in the container
+	struct State
+	{	vector3<> k; //!< k-point in reciprocal lattice coordinates
+		int nBasis; //!< number of basis functions
+		int nSpinor; //!< number of spinor components
+		int nBands; //!< number of bands
+		size_t iGoffset; //!< location of basis G-vectors (3 int32 per basis function)
+		std::vector<size_t> blockOffset, blockBytes; //!< location of each band block
+	};
+	
+	WavefunctionFile(const char* fname); //!< map container and parse its index (not collective)
+	~WavefunctionFile();
+	static bool isContainer(const char* fname); //!< check whether fname is a wavefunction container
+	
+	int nStates() const { return states.size(); }
+	const State& state(int q) const { return states[q]; }
+	std::vector<vector3<int>> getIG(int q) const; //!< basis G-vectors of state q
+	WfnsCompression getCompression() const { return compression; }
+	
+	//! Read bands [bStart,bStop) of state q into columns starting at colOffset of Y,
+	//! mapping the coefficients by G-vector if the basis of Y differs from that in the file.
+	//! Only the blocks overlapping the requested band range are accessed.
+	void read(int q, ColumnBundle& Y, int bStart, int bStop, int colOffset=0) const;
+	
+	//! Pack the local portion of the container for wavefunctions C (collective).
+	//! The result from each process, concatenated in process order, constitutes the container.
+	static std::vector<char> pack(const std::vector<ColumnBundle>& C, const ElecInfo& eInfo, const WfnsContainerParams& params);
+	
+	//! Write wavefunctions C to a container file (collective)
+	static void write(const std::vector<ColumnBundle>& C, const char* fname, const ElecInfo& eInfo, const WfnsContainerParams& params);
+	
+private:
+	string fname;
+	const char* mapped; //!< memory-mapped file contents
+	size_t mappedSize; //!< size of mapped file
+	WfnsCompression compression;
+	int blockBands;
+	std::vector<State> states;
+	
+	//! Decode one block of state q (band range [b0,b0+nBandsBlock)) into buf (nBandsBlock*nBasis*nSpinor complex)
+	void decodeBlock(int q, int iBlock, int nBandsBlock, std::vector<complex>& buf) const;
+};
+
+//! @}
+#endif //JDFTX_ELECTRONIC_WAVEFUNCTIONFILE_H
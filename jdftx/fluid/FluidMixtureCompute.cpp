@@ -274,80 +274,39 @@ double FluidMixture::operator()(const ScalarFieldArray& indep, ScalarFieldArray&
 	}
 	
 	//--------- Hard sphere mixture and bonding -------------
-	{	//Compute the FMT weighted densities:
-		ScalarFieldTilde n0tilde, n1tilde, n2tilde, n3tilde, n1vTilde, n2mTilde;
-		std::vector<ScalarField> n0mol(component.size(), 0); //partial n0 for molecules that need bonding corrections
+	{	//Collect the hard sphere sites and molecules that need bonding corrections:
 		std::vector<int> n0mult(component.size(), 0); //number of sites which contribute to n0 for each molecule
 		std::vector<std::map<double,int> > bond(component.size()); //sets of bonds for each molecule
-		bool bondsPresent = false; //whether bonds are present for any molecule
+		std::vector<int> iMolBonded(component.size(), -1); //index of partial n0 for molecules that need bonding corrections
+		int nMolBonded = 0;
+		for(unsigned ic=0; ic<component.size(); ic++)
+		{	bond[ic] = component[ic]->molecule.getBonds();
+			if(bond[ic].size()) iMolBonded[ic] = nMolBonded++;
+		}
+		FMTweightedDensities w(gInfo, nMolBonded);
+		bool spheresPresent = false; //whether there is at least one sphere in the mixture
 		for(unsigned ic=0; ic<component.size(); ic++)
 		{	const FluidComponent& c = *component[ic];
-			bond[ic] = c.molecule.getBonds();
-			ScalarFieldTilde n0molTilde;
 			for(unsigned i=0; i<c.molecule.sites.size(); i++)
 			{	const Molecule::Site& s = *(c.molecule.sites[i]);
 				if(s.Rhs)
-				{	const ScalarFieldTilde& Nsite = Ntilde[c.offsetDensity+i];
-					n0mult[ic] += s.positions.size();
-					n0molTilde += s.w0  * Nsite;
-					n1tilde    += s.w1  * Nsite;
-					n2tilde    += s.w2  * Nsite;
-					n3tilde    += s.w3  * Nsite;
-					n1vTilde   += s.w1v * Nsite;
-					n2mTilde   += s.w2m * Nsite;
+				{	n0mult[ic] += s.positions.size();
+					w.addSite(s, Ntilde[c.offsetDensity+i], Phi_Ntilde[c.offsetDensity+i], iMolBonded[ic]);
+					spheresPresent = true;
 				}
 			}
-			if(n0molTilde) n0tilde += n0molTilde;
-			if(bond[ic].size())
-			{	n0mol[ic] = I(n0molTilde);
-				bondsPresent = true;
-			}
 		}
-		if(n0tilde) //at least one sphere in the mixture
-		{	ScalarField n0 = I(n0tilde); n0tilde=0;
-			ScalarField n1 = I(n1tilde); n1tilde=0;
-			ScalarField n2 = I(n2tilde); n2tilde=0;
-			ScalarField Phi_n0, Phi_n1, Phi_n2; ScalarFieldTilde Phi_n3tilde, Phi_n1vTilde, Phi_n2mTilde;
+		if(spheresPresent)
+		{	//Compute the FMT weighted densities:
+			w.compute();
 			//Compute the sphere mixture free energy:
-			Phi["MixedFMT"] += T * PhiFMT(n0, n1, n2, n3tilde, n1vTilde, n2mTilde,
-				Phi_n0, Phi_n1, Phi_n2, Phi_n3tilde, Phi_n1vTilde, Phi_n2mTilde);
+			Phi["MixedFMT"] += T * PhiFMT(w);
 			//Bonding corrections if required
-			if(bondsPresent)
-			{	for(unsigned ic=0; ic<component.size(); ic++)
-				{	const FluidComponent& c = *component[ic];
-					ScalarField Phi_n0mol;
-					for(const auto& b: bond[ic])
-						Phi["Bonding"] += T * PhiBond(b.first, b.second*1./n0mult[ic],
-							n0mol[ic], n2, n3tilde, Phi_n0mol, Phi_n2, Phi_n3tilde);
-					if(Phi_n0mol)
-					{	//Propagate gradient w.r.t n0mol[ic] to the site densities:
-						ScalarFieldTilde Phi_n0molTilde = Idag(Phi_n0mol);
-						for(unsigned i=0; i<c.molecule.sites.size(); i++)
-						{	const Molecule::Site& s = *(c.molecule.sites[i]);
-							if(s.Rhs)
-								Phi_Ntilde[c.offsetDensity+i] += T * (s.w0  * Phi_n0molTilde);
-						}
-					}
-				}
-			}
+			for(unsigned ic=0; ic<component.size(); ic++)
+				for(const auto& b: bond[ic])
+					Phi["Bonding"] += T * PhiBond(b.first, b.second*1./n0mult[ic], iMolBonded[ic], w);
 			//Accumulate gradients w.r.t weighted densities to site densities:
-			ScalarFieldTilde Phi_n0tilde = Idag(Phi_n0); Phi_n0=0;
-			ScalarFieldTilde Phi_n1tilde = Idag(Phi_n1); Phi_n1=0;
-			ScalarFieldTilde Phi_n2tilde = Idag(Phi_n2); Phi_n2=0;
-			for(const FluidComponent* c: component)
-			{	for(unsigned i=0; i<c->molecule.sites.size(); i++)
-				{	const Molecule::Site& s = *(c->molecule.sites[i]);
-					if(s.Rhs)
-					{	ScalarFieldTilde& Phi_Nsite = Phi_Ntilde[c->offsetDensity+i];
-						Phi_Nsite += T * (s.w0  * Phi_n0tilde);
-						Phi_Nsite += T * (s.w1  * Phi_n1tilde);
-						Phi_Nsite += T * (s.w2  * Phi_n2tilde);
-						Phi_Nsite += T * (s.w3  * Phi_n3tilde);
-						Phi_Nsite += T * (s.w1v * Phi_n1vTilde);
-						Phi_Nsite += T * (s.w2m * Phi_n2mTilde);
-					}
-				}
-			}
+			w.propagateGradient(T);
 		}
 	}
 
@@ -133,7 +133,10 @@ struct FluidSolverParams
 	bool linearDielectric; //!< If true, work in the linear dielectric response limit
 	bool linearScreening; //!< If true, work in the linearized Poisson-Boltzman limit for the ions
 	bool nonlinearSCF; //!< whether to use an SCF method for nonlinear PCMs
+	bool nonlinearNewton; //!< whether to use an inexact Newton-Krylov method for nonlinear PCMs
+	int nonlinearNewtonInner; //!< maximum linear CG iterations per Newton step for nonlinear PCMs
 	double screenOverride; //! overrides screening factor with this value
+	bool multigrid; //!< whether to precondition LinearPCM and SaLSA solves with geometric multigrid
 	PulayParams scfParams; //!< parameters controlling Pulay mixing for SCF version of nonlinear PCM
 	
 	//For Explicit Fluid JDFT alone:
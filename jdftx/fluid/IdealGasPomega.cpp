@@ -19,6 +19,58 @@ along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <fluid/IdealGasPomega.h>
 #include <fluid/Euler.h>
+#include <core/Thread.h>
+#include <algorithm>
+#include <atomic>
+#include <numeric>
+
+//Run func(o, iThread) for each orientation in [oStart,oStop), dynamically load-balanced over threads:
+template<typename Func> void orientationLoop_sub(size_t iThread, size_t nThreads, std::atomic<int>* oNext, int oStop, const Func* func)
+{	for(int o=(*oNext)++; o<oStop; o=(*oNext)++) (*func)(o, int(iThread));
+}
+template<typename Func> void orientationLoop(int nThreads, int oStart, int oStop, const Func& func)
+{	std::atomic<int> oNext(oStart);
+	threadLaunch(nThreads, orientationLoop_sub<Func>, 0, &oNext, oStop, &func);
+}
+
+//Accumulate thread-local fields (null entries treated as zero) into the first thread's array:
+void sumThreads(std::vector<ScalarFieldArray>& x)
+{	for(size_t t=1; t<x.size(); t++)
+		for(size_t k=0; k<x[0].size(); k++)
+			if(x[t][k])
+			{	if(x[0][k]) x[0][k] += x[t][k];
+				else std::swap(x[0][k], x[t][k]);
+			}
+}
+
+//Sum fields (null entries treated as zero) and scalars over MPI processes,
+//packing them into as few reductions as possible (one, unless the fields exceed ~64 MB):
+void allReduceFused(const std::vector<ScalarField*>& x, const std::vector<double*>& scalars, const GridInfo& gInfo)
+{	for(ScalarField* xi: x) nullToZero(*xi, gInfo);
+	if(mpiUtil->nProcesses() == 1) return;
+	size_t nFieldsMax = std::max(size_t(1), (size_t(64)<<20) / (gInfo.nr*sizeof(double)));
+	size_t iStart = 0;
+	do
+	{	size_t iStop = std::min(x.size(), iStart+nFieldsMax);
+		size_t nScalars = iStart ? 0 : scalars.size(); //scalars travel with the first chunk
+		ManagedArray<double> buf; buf.init((iStop-iStart)*gInfo.nr + nScalars, isGpuEnabled());
+		for(size_t i=iStart; i<iStop; i++)
+			callPref(eblas_copy)(buf.dataPref()+(i-iStart)*gInfo.nr, (*x[i])->dataPref(), gInfo.nr);
+		if(nScalars)
+		{	double* bufScalars = buf.data() + (iStop-iStart)*gInfo.nr;
+			for(size_t j=0; j<nScalars; j++) bufScalars[j] = *(scalars[j]);
+		}
+		buf.allReduce(MPIUtil::ReduceSum);
+		for(size_t i=iStart; i<iStop; i++)
+			callPref(eblas_copy)((*x[i])->dataPref(), buf.dataPref()+(i-iStart)*gInfo.nr, gInfo.nr);
+		if(nScalars)
+		{	const double* bufScalars = buf.data() + (iStop-iStart)*gInfo.nr;
+			for(size_t j=0; j<nScalars; j++) *(scalars[j]) = bufScalars[j];
+		}
+		iStart = iStop;
+	}
+	while(iStart < x.size());
+}
 
 IdealGasPomega::IdealGasPomega(const FluidMixture* fluidMixture, const FluidComponent* comp, const SO3quad& quad, const TranslationOperator& trans, unsigned nIndepOverride)
 : IdealGas(nIndepOverride ? nIndepOverride : quad.nOrientations(), fluidMixture, comp), quad(quad), trans(trans), pMol(molecule.getDipole())
@@ -43,6 +95,17 @@ void IdealGasPomega::convertGradients_o(int o, const matrix3<>& rot, const Scala
 }
 
 
+int IdealGasPomega::nOrientationThreads() const
+{
+	#ifdef GPU_ENABLED
+	return 1; //GPU operators must be called from a single thread
+	#else
+	//Thread over orientations only when that keeps all cores busy; otherwise thread within field operations:
+	int nLocal = oStop - oStart;
+	return (shouldThreadOperators() && nLocal>=nProcsAvailable) ? nProcsAvailable : 1;
+	#endif
+}
+
 void IdealGasPomega::initState(const ScalarField* Vex, ScalarField* indep, double scale, double Elo, double Ehi) const
 {	for(int k=0; k<nIndep; k++) indep[k]=0;
 	ScalarFieldArray Veff(molecule.sites.size()); nullToZero(Veff, gInfo);
@@ -50,8 +113,10 @@ void IdealGasPomega::initState(const ScalarField* Vex, ScalarField* indep, doubl
 	{	Veff[i] += V[i];
 		Veff[i] += Vex[i];
 	}
-	double Emin=+DBL_MAX, Emax=-DBL_MAX, Emean=0.0;
-	for(int o=oStart; o<oStop; o++)
+	int nThreads = nOrientationThreads();
+	std::vector<ScalarFieldArray> indepThread(nThreads, ScalarFieldArray(nIndep)); //thread-local state (only touched entries allocated)
+	std::vector<double> EminThread(nThreads, +DBL_MAX), EmaxThread(nThreads, -DBL_MAX), EmeanThread(nThreads, 0.);
+	orientationLoop(nThreads, oStart, oStop, [&](int o, int iThread)
 	{	matrix3<> rot = matrixFromEuler(quad.euler(o));
 		ScalarField Emolecule;
 		//Sum the potentials collected over sites for each orientation:
@@ -59,51 +124,67 @@ void IdealGasPomega::initState(const ScalarField* Vex, ScalarField* indep, doubl
 			for(vector3<> pos: molecule.sites[i]->positions)
 				trans.taxpy(-(rot*pos), 1., Veff[i], Emolecule);
 		//Accumulate stats and cap:
-		Emean += quad.weight(o) * sum(Emolecule)/gInfo.nr;
+		EmeanThread[iThread] += quad.weight(o) * sum(Emolecule)/gInfo.nr;
 		double Emin_o, Emax_o;
 		callPref(eblas_capMinMax)(gInfo.nr, Emolecule->dataPref(), Emin_o, Emax_o, Elo, Ehi);
-		if(Emin_o<Emin) Emin=Emin_o;
-		if(Emax_o>Emax) Emax=Emax_o;
+		if(Emin_o<EminThread[iThread]) EminThread[iThread]=Emin_o;
+		if(Emax_o>EmaxThread[iThread]) EmaxThread[iThread]=Emax_o;
 		//Set contributions to the state (with appropriate scale factor):
-		initState_o(o, rot, scale, Emolecule, indep);
-	}
+		initState_o(o, rot, scale, Emolecule, indepThread[iThread].data());
+	});
+	sumThreads(indepThread);
+	for(int k=0; k<nIndep; k++) indep[k] = indepThread[0][k];
+	double Emin = *std::min_element(EminThread.begin(), EminThread.end());
+	double Emax = *std::max_element(EmaxThread.begin(), EmaxThread.end());
+	double Emean = std::accumulate(EmeanThread.begin(), EmeanThread.end(), 0.);
 	//MPI collect:
-	for(int k=0; k<nIndep; k++) { nullToZero(indep[k],gInfo); indep[k]->allReduce(MPIUtil::ReduceSum); }
+	std::vector<ScalarField*> indepPtr(nIndep);
+	for(int k=0; k<nIndep; k++) indepPtr[k] = &indep[k];
+	allReduceFused(indepPtr, {&Emean}, gInfo);
 	mpiUtil->allReduce(Emin, MPIUtil::ReduceMin);
 	mpiUtil->allReduce(Emax, MPIUtil::ReduceMax);
-	mpiUtil->allReduce(Emean, MPIUtil::ReduceSum);
 	//Print stats:
 	logPrintf("\tIdealGas%s[%s] single molecule energy: min = %le, max = %le, mean = %le\n",
 		   representationName().c_str(), molecule.name.c_str(), Emin, Emax, Emean);
 }
 
 void IdealGasPomega::getDensities(const ScalarField* indep, ScalarField* N, vector3<>& P0) const
-{	for(unsigned i=0; i<molecule.sites.size(); i++) N[i]=0;
+{	int nSites = molecule.sites.size();
 	double& S = ((IdealGasPomega*)this)->S;
-	S=0.0;
-	VectorField P;
-	//Loop over orientations:
-	for(int o=oStart; o<oStop; o++)
-	{	matrix3<> rot = matrixFromEuler(quad.euler(o));
+	bool polar = pMol.length_squared();
+	//Loop over orientations, with thread-local accumulation:
+	int nThreads = nOrientationThreads();
+	std::vector<ScalarFieldArray> NP(nThreads, ScalarFieldArray(nSites+3)); //site densities followed by polarization density per thread
+	std::vector<double> Sthread(nThreads, 0.);
+	orientationLoop(nThreads, oStart, oStop, [&](int o, int iThread)
+	{	ScalarFieldArray& NPt = NP[iThread];
+		matrix3<> rot = matrixFromEuler(quad.euler(o));
 		ScalarField logPomega_o; getDensities_o(o, rot, indep,logPomega_o);
 		ScalarField N_o = (quad.weight(o) * Nbulk) * exp(logPomega_o); //contribution form this orientation
 		//Accumulate N_o to each site density with appropriate translations:
-		for(unsigned i=0; i<molecule.sites.size(); i++)
+		for(int i=0; i<nSites; i++)
 			for(vector3<> pos: molecule.sites[i]->positions)
-				trans.taxpy(rot*pos, 1., N_o, N[i]);
+				trans.taxpy(rot*pos, 1., N_o, NPt[i]);
 		//Accumulate contributions to the entropy:
-		S += gInfo.dV*dot(N_o, logPomega_o);
+		Sthread[iThread] += gInfo.dV*dot(N_o, logPomega_o);
 		//Accumulate the polarization density:
-		if(pMol.length_squared()) P += (rot * pMol) * N_o;
-	}
-	//MPI collect:
-	for(unsigned i=0; i<molecule.sites.size(); i++) { nullToZero(N[i],gInfo); N[i]->allReduce(MPIUtil::ReduceSum); }
-	mpiUtil->allReduce(S, MPIUtil::ReduceSum);
-	if(pMol.length_squared()) for(int k=0; k<3; k++) { nullToZero(P[k],gInfo); P[k]->allReduce(MPIUtil::ReduceSum); }
+		if(polar)
+		{	vector3<> p = rot * pMol;
+			for(int k=0; k<3; k++) NPt[nSites+k] += p[k] * N_o;
+		}
+	});
+	sumThreads(NP);
+	S = std::accumulate(Sthread.begin(), Sthread.end(), 0.);
+	//MPI collect (all sites, polarization components and entropy in one reduction):
+	std::vector<ScalarField*> NPptr;
+	for(int i=0; i<nSites+(polar ? 3 : 0); i++) NPptr.push_back(&NP[0][i]);
+	allReduceFused(NPptr, {&S}, gInfo);
+	for(int i=0; i<nSites; i++) N[i] = NP[0][i];
 	//Compute and cache dipole correlation correction:
 	IdealGasPomega* cache = ((IdealGasPomega*)this);
-	if(pMol.length_squared())
-	{	P0 = sumComponents(P) / gInfo.nr;
+	if(polar)
+	{	VectorField P; for(int k=0; k<3; k++) P[k] = NP[0][nSites+k];
+		P0 = sumComponents(P) / gInfo.nr;
 		cache->Ecorr_P = I(molecule.mfKernel*(molecule.mfKernel*(corrPrefac*J(P))));
 		cache->Ecorr = 0.5*gInfo.dV*dot(cache->Ecorr_P, P);
 	}
@@ -133,9 +214,10 @@ double IdealGasPomega::compute(const ScalarField* indep, const ScalarField* N, S
 }
 
 void IdealGasPomega::convertGradients(const ScalarField* indep, const ScalarField* N, const ScalarField* Phi_N, const vector3<>& Phi_P0, ScalarField* Phi_indep, const double Nscale) const
-{	for(int k=0; k<nIndep; k++) Phi_indep[k]=0;
-	//Loop over orientations:
-	for(int o=oStart; o<oStop; o++)
+{	//Loop over orientations, with thread-local accumulation:
+	int nThreads = nOrientationThreads();
+	std::vector<ScalarFieldArray> Phi_indepThread(nThreads, ScalarFieldArray(nIndep)); //only touched entries allocated
+	orientationLoop(nThreads, oStart, oStop, [&](int o, int iThread)
 	{	matrix3<> rot = matrixFromEuler(quad.euler(o));
 		ScalarField logPomega_o; getDensities_o(o, rot, indep, logPomega_o);
 		ScalarField N_o = (quad.weight(o) * Nbulk * Nscale) * exp(logPomega_o);
@@ -149,8 +231,12 @@ void IdealGasPomega::convertGradients(const ScalarField* indep, const ScalarFiel
 		//Collect the contribution from Phi_P0 and Ecorr_P:
 		if(pMol.length_squared()) Phi_N_o += dot(rot * pMol, Nscale*Ecorr_P) + dot(rot * pMol, Phi_P0);
 		//Propagate Phi_N_o to Phi_logPomega_o and then to Phi_indep:
-		convertGradients_o(o, rot, N_o*Phi_N_o, Phi_indep);
-	}
-	for(int k=0; k<nIndep; k++) { nullToZero(Phi_indep[k],gInfo); Phi_indep[k]->allReduce(MPIUtil::ReduceSum); }
+		convertGradients_o(o, rot, N_o*Phi_N_o, Phi_indepThread[iThread].data());
+	});
+	sumThreads(Phi_indepThread);
+	for(int k=0; k<nIndep; k++) Phi_indep[k] = Phi_indepThread[0][k];
+	//MPI collect:
+	std::vector<ScalarField*> Phi_indepPtr(nIndep);
+	for(int k=0; k<nIndep; k++) Phi_indepPtr[k] = &Phi_indep[k];
+	allReduceFused(Phi_indepPtr, {}, gInfo);
 }
-
@@ -47,6 +47,7 @@ protected:
 	const TranslationOperator& trans; //!< translation operator for orientation integral
 	vector3<> pMol; //!< molecule dipole moment in reference frame
 	int oStart, oStop; //!< portion of orientation loop handled by current process
+	int nOrientationThreads() const; //!< number of threads to distribute the local orientation loop over
 	
 	virtual string representationName() const;
 	
@@ -23,11 +23,13 @@ along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
 #include <core/VectorField.h>
 #include <core/ScalarFieldIO.h>
 #include <core/Thread.h>
+#include <core/Multigrid.h>
 
 LinearPCM::LinearPCM(const Everything& e, const FluidSolverParams& fsp)
 : PCM(e, fsp)
 {
 	assert(!useGummel()); //Non-variational energy: cannot use Gummel loop!
+	if(fsp.multigrid) multigrid = std::make_shared<Multigrid>(gInfo);
 }
 
 LinearPCM::~LinearPCM()
@@ -47,7 +49,8 @@ ScalarFieldTilde LinearPCM::hessian(const ScalarFieldTilde& phiTilde) const
 }
 
 ScalarFieldTilde LinearPCM::precondition(const ScalarFieldTilde& rTilde) const
-{	return Kkernel*(J(epsInv*I(Kkernel*rTilde)));
+{	if(multigrid) return multigrid->precondition(rTilde);
+	return Kkernel*(J(epsInv*I(Kkernel*rTilde)));
 }
 
 //Initialize Kkernel to square-root of the inverse kinetic operator
@@ -77,6 +80,7 @@ void LinearPCM::updatePreconditioner(const ScalarField& epsilon, const ScalarFie
 	double epsMean = sum(epsilon) / gInfo.nr;
 	double kappaSqMean = (kappaSq ? sum(kappaSq) : 0.) / gInfo.nr;
 	Kkernel.init(0, 0.02, gInfo.GmaxGrid, setPreconditionerKernel, epsMean, sqrt(kappaSqMean/epsMean));
+	if(multigrid) multigrid->setCoefficients(epsilon, kappaSq);
 }
 
 void LinearPCM::override(const ScalarField& epsilon, const ScalarField& kappaSq)
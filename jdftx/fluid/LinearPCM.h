@@ -46,6 +46,7 @@ protected:
 	double get_Adiel_and_grad_internal(ScalarFieldTilde& grad_rhoExplicitTilde, ScalarFieldTilde& grad_nCavityTilde, IonicGradient* extraForces, bool electricOnly) const;
 private:
 	RadialFunctionG Kkernel; ScalarField epsInv; // for preconditioner
+	std::shared_ptr<class Multigrid> multigrid; //multigrid preconditioner (if enabled)
 	void updatePreconditioner(const ScalarField& epsilon, const ScalarField& kappaSq);
 	
 	//Optionally override epsilon and kappaSq (when used as the inner solver in NonlinearPCM's SCF):
@@ -20,6 +20,7 @@ along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
 #include <fluid/MixedFMT.h>
 #include <fluid/MixedFMT_internal.h>
 #include <core/VectorField.h>
+#include <core/ScalarFieldArray.h>
 
 //Compute the tensor weighted density (threaded/gpu):
 inline void tensorKernel_sub(size_t iStart, size_t iStop, vector3<int> S, const matrix3<> G,
@@ -71,41 +72,230 @@ void phiFMT_gpu(int N, double* phiArr,
 #endif
 
 
-double PhiFMT(const ScalarField& n0, const ScalarField& n1, const ScalarField& n2,
-	const ScalarFieldTilde& n3tilde, const ScalarFieldTilde& n1vTilde, const ScalarFieldTilde& n2mTilde,
-	ScalarField& grad_n0, ScalarField& grad_n1, ScalarField& grad_n2,
-	ScalarFieldTilde& grad_n3tilde, ScalarFieldTilde& grad_n1vTilde, ScalarFieldTilde& grad_n2mTilde)
+//Layout of fields in the batched transforms of FMTweightedDensities:
+enum FMTcomponent
+{	FMT_n0, FMT_n1, FMT_n2, FMT_n3,
+	FMT_n1v, //3 components
+	FMT_n2v = FMT_n1v+3, //3 components
+	FMT_n2m = FMT_n2v+3, //5 components
+	FMT_n0mol = FMT_n2m+5 //one per bonded molecule
+};
+
+FMTweightedDensities::FMTweightedDensities(const GridInfo& gInfo, int nMolBonded)
+: n0mol(nMolBonded), grad_n0mol(nMolBonded), gInfo(gInfo), nMolBonded(nMolBonded)
 {
-	const GridInfo& gInfo = n0->gInfo;
-	ScalarField n3 = I(n3tilde);
-	VectorField n1v = I(gradient(n1vTilde));
-	VectorField n2v = I(gradient(-n3tilde));
-	TensorField n2m = I(tensorKernel(n2mTilde));
+}
+
+void FMTweightedDensities::addSite(const Molecule::Site& s, const ScalarFieldTilde& N, ScalarFieldTilde& Phi_N, int iMol)
+{	assert(iMol < nMolBonded);
+	Site site = { &s, &N, &Phi_N, iMol };
+	sites.push_back(site);
+}
+
+#ifndef GPU_ENABLED
+//Compute all weighted densities in reciprocal space in a single pass:
+inline void fmtWeights_calc(size_t i, const vector3<int>& iG, bool nyq, const matrix3<>& G,
+	const std::vector<FMTweightedDensities::Site>& sites, const std::vector<const complex*>& Ndata, complex** nTilde, int nMolBonded)
+{	vector3<> Gvec = iG*G;
+	double Gmag = Gvec.length();
+	complex n0, n1, n2, n3, n1v, n2m; //kernel-weighted site densities (default zero)
+	for(int m=0; m<nMolBonded; m++) nTilde[FMT_n0mol+m][i] = 0.;
+	for(size_t iSite=0; iSite<sites.size(); iSite++)
+	{	const FMTweightedDensities::Site& site = sites[iSite];
+		const Molecule::Site& s = *(site.s);
+		complex N = Ndata[iSite][i];
+		complex w0N = s.w0(Gmag) * N;
+		n0 += w0N;
+		if(site.iMol >= 0) nTilde[FMT_n0mol+site.iMol][i] += w0N;
+		n1  += s.w1(Gmag)  * N;
+		n2  += s.w2(Gmag)  * N;
+		n3  += s.w3(Gmag)  * N;
+		n1v += s.w1v(Gmag) * N;
+		n2m += s.w2m(Gmag) * N;
+	}
+	nTilde[FMT_n0][i] = n0;
+	nTilde[FMT_n1][i] = n1;
+	nTilde[FMT_n2][i] = n2;
+	nTilde[FMT_n3][i] = n3;
+	//Vector weights (gradients, zeroing nyquist frequencies):
+	complex iota(0.0, nyq ? 0.0 : 1.0);
+	for(int k=0; k<3; k++)
+	{	nTilde[FMT_n1v+k][i] = Gvec[k] * (iota*n1v);
+		nTilde[FMT_n2v+k][i] = Gvec[k] * (-iota*n3);
+	}
+	//Tensor weight:
+	tensor3<complex*> n2mTilde(nTilde[FMT_n2m], nTilde[FMT_n2m+1], nTilde[FMT_n2m+2], nTilde[FMT_n2m+3], nTilde[FMT_n2m+4]);
+	nTilde[FMT_n2m][i] = n2m; //input to tensorKernel_calc (overwritten by its output)
+	tensorKernel_calc(i, iG, nyq, G, nTilde[FMT_n2m], n2mTilde);
+}
+void fmtWeights_sub(size_t iStart, size_t iStop, vector3<int> S, const matrix3<> G,
+	const std::vector<FMTweightedDensities::Site>* sites, const std::vector<const complex*>* Ndata, std::vector<complex*>* nTilde, int nMolBonded)
+{	THREAD_halfGspaceLoop( fmtWeights_calc(i, iG, IS_NYQUIST, G, *sites, *Ndata, nTilde->data(), nMolBonded); )
+}
+
+//Propagate gradients w.r.t all weighted densities in reciprocal space to the sites in a single pass:
+inline void fmtWeights_grad_calc(size_t i, const vector3<int>& iG, bool nyq, const matrix3<>& G,
+	const std::vector<FMTweightedDensities::Site>& sites, const complex*const* grad_nTilde, const std::vector<complex*>& Phi_Ndata, double scale)
+{	vector3<> Gvec = iG*G;
+	double Gmag = Gvec.length();
+	complex iota(0.0, nyq ? 0.0 : 1.0);
+	//Collect gradients w.r.t the kernel-weighted site densities (adjoints of gradient and tensorKernel):
+	complex grad_n1v = -iota * (Gvec[0]*grad_nTilde[FMT_n1v][i] + Gvec[1]*grad_nTilde[FMT_n1v+1][i] + Gvec[2]*grad_nTilde[FMT_n1v+2][i]);
+	complex grad_n3 = grad_nTilde[FMT_n3][i]
+		+ iota * (Gvec[0]*grad_nTilde[FMT_n2v][i] + Gvec[1]*grad_nTilde[FMT_n2v+1][i] + Gvec[2]*grad_nTilde[FMT_n2v+2][i]);
+	complex grad_n2m;
+	tensor3<const complex*> grad_n2mTilde(grad_nTilde[FMT_n2m]+i, grad_nTilde[FMT_n2m+1]+i,
+		grad_nTilde[FMT_n2m+2]+i, grad_nTilde[FMT_n2m+3]+i, grad_nTilde[FMT_n2m+4]+i);
+	tensorKernel_grad_calc(0, iG, nyq, G, grad_n2mTilde, &grad_n2m);
+	//Accumulate to sites:
+	for(size_t iSite=0; iSite<sites.size(); iSite++)
+	{	const FMTweightedDensities::Site& site = sites[iSite];
+		const Molecule::Site& s = *(site.s);
+		complex grad_n0 = grad_nTilde[FMT_n0][i];
+		if(site.iMol >= 0) grad_n0 += grad_nTilde[FMT_n0mol+site.iMol][i];
+		Phi_Ndata[iSite][i] += scale * (s.w0(Gmag) * grad_n0
+			+ s.w1(Gmag) * grad_nTilde[FMT_n1][i]
+			+ s.w2(Gmag) * grad_nTilde[FMT_n2][i]
+			+ s.w3(Gmag) * grad_n3
+			+ s.w1v(Gmag) * grad_n1v
+			+ s.w2m(Gmag) * grad_n2m );
+	}
+}
+void fmtWeights_grad_sub(size_t iStart, size_t iStop, vector3<int> S, const matrix3<> G,
+	const std::vector<FMTweightedDensities::Site>* sites, const std::vector<const complex*>* grad_nTilde, const std::vector<complex*>* Phi_Ndata, double scale)
+{	THREAD_halfGspaceLoop( fmtWeights_grad_calc(i, iG, IS_NYQUIST, G, *sites, grad_nTilde->data(), *Phi_Ndata, scale); )
+}
+#endif
 
-	ScalarField grad_n3; VectorField grad_n1v, grad_n2v; TensorField grad_n2m;
+void FMTweightedDensities::compute()
+{	int nComponents = FMT_n0mol + nMolBonded;
+	ScalarFieldTildeArray nTilde(nComponents);
+	#ifdef GPU_ENABLED
+	{	//Accumulate kernel inputs site by site, and then apply the derivative kernels:
+		ScalarFieldTilde n1vTilde, n2mTilde;
+		for(const Site& site: sites)
+		{	const Molecule::Site& s = *(site.s);
+			const ScalarFieldTilde& N = *(site.N);
+			ScalarFieldTilde w0N = s.w0 * N;
+			if(site.iMol >= 0) nTilde[FMT_n0mol+site.iMol] += w0N;
+			nTilde[FMT_n0] += w0N;
+			nTilde[FMT_n1] += s.w1 * N;
+			nTilde[FMT_n2] += s.w2 * N;
+			nTilde[FMT_n3] += s.w3 * N;
+			n1vTilde += s.w1v * N;
+			n2mTilde += s.w2m * N;
+		}
+		VectorFieldTilde n1vTildeVec = gradient(n1vTilde);
+		VectorFieldTilde n2vTildeVec = gradient(-nTilde[FMT_n3]);
+		TensorFieldTilde n2mTildeTensor = tensorKernel(n2mTilde);
+		for(int k=0; k<3; k++)
+		{	nTilde[FMT_n1v+k] = n1vTildeVec[k];
+			nTilde[FMT_n2v+k] = n2vTildeVec[k];
+		}
+		for(int k=0; k<5; k++)
+			nTilde[FMT_n2m+k] = n2mTildeTensor[k];
+	}
+	#else
+	{	//Single pass over G-space for all weights of all sites:
+		for(ScalarFieldTilde& x: nTilde) x = ScalarFieldTildeData::alloc(gInfo);
+		std::vector<const complex*> Ndata; for(const Site& site: sites) Ndata.push_back((*site.N)->data());
+		std::vector<complex*> nTildeData; for(ScalarFieldTilde& x: nTilde) nTildeData.push_back(x->data());
+		threadLaunch(fmtWeights_sub, gInfo.nG, gInfo.S, gInfo.G, &sites, &Ndata, &nTildeData, nMolBonded);
+	}
+	#endif
+	//Batched transform to real space:
+	ScalarFieldArray n = I(std::move(nTilde));
+	n0 = n[FMT_n0]; n1 = n[FMT_n1]; n2 = n[FMT_n2]; n3 = n[FMT_n3];
+	for(int k=0; k<3; k++)
+	{	n1v[k] = n[FMT_n1v+k];
+		n2v[k] = n[FMT_n2v+k];
+	}
+	for(int k=0; k<5; k++)
+		n2m[k] = n[FMT_n2m+k];
+	for(int m=0; m<nMolBonded; m++)
+		n0mol[m] = n[FMT_n0mol+m];
+	//Reset gradients:
+	grad_n0=0; grad_n1=0; grad_n2=0; grad_n3=0; grad_n1v=0; grad_n2v=0; grad_n2m=0;
 	nullToZero(grad_n0, gInfo); nullToZero(grad_n1, gInfo); nullToZero(grad_n2, gInfo); nullToZero(grad_n3, gInfo);
 	nullToZero(grad_n1v, gInfo); nullToZero(grad_n2v, gInfo); nullToZero(grad_n2m, gInfo);
+	for(ScalarField& g: grad_n0mol) { g=0; nullToZero(g, gInfo); }
+}
 
+void FMTweightedDensities::propagateGradient(double scale)
+{	//Weighted densities no longer needed (clean up):
+	n0=0; n1=0; n2=0; n3=0; n1v=0; n2v=0; n2m=0;
+	for(ScalarField& x: n0mol) x=0;
+	//Batched transform of gradients to reciprocal space:
+	int nComponents = FMT_n0mol + nMolBonded;
+	ScalarFieldArray grad_n(nComponents);
+	grad_n[FMT_n0] = grad_n0; grad_n[FMT_n1] = grad_n1; grad_n[FMT_n2] = grad_n2; grad_n[FMT_n3] = grad_n3;
+	for(int k=0; k<3; k++)
+	{	grad_n[FMT_n1v+k] = grad_n1v[k];
+		grad_n[FMT_n2v+k] = grad_n2v[k];
+	}
+	for(int k=0; k<5; k++)
+		grad_n[FMT_n2m+k] = grad_n2m[k];
+	for(int m=0; m<nMolBonded; m++)
+		grad_n[FMT_n0mol+m] = grad_n0mol[m];
+	grad_n0=0; grad_n1=0; grad_n2=0; grad_n3=0; grad_n1v=0; grad_n2v=0; grad_n2m=0;
+	for(ScalarField& g: grad_n0mol) g=0;
+	ScalarFieldTildeArray grad_nTilde = Idag(grad_n); grad_n.clear();
+	#ifdef GPU_ENABLED
+	{	//Apply adjoint derivative kernels, and then the site kernels:
+		VectorFieldTilde grad_n1vTildeVec, grad_n2vTildeVec; TensorFieldTilde grad_n2mTildeTensor;
+		for(int k=0; k<3; k++)
+		{	grad_n1vTildeVec[k] = grad_nTilde[FMT_n1v+k];
+			grad_n2vTildeVec[k] = grad_nTilde[FMT_n2v+k];
+		}
+		for(int k=0; k<5; k++)
+			grad_n2mTildeTensor[k] = grad_nTilde[FMT_n2m+k];
+		ScalarFieldTilde grad_n1vIn = -divergence(grad_n1vTildeVec);
+		ScalarFieldTilde grad_n3In = grad_nTilde[FMT_n3] + divergence(grad_n2vTildeVec);
+		ScalarFieldTilde grad_n2mIn = tensorKernel_grad(grad_n2mTildeTensor);
+		for(const Site& site: sites)
+		{	const Molecule::Site& s = *(site.s);
+			ScalarFieldTilde& Phi_N = *(site.Phi_N);
+			ScalarFieldTilde grad_n0In = grad_nTilde[FMT_n0];
+			if(site.iMol >= 0) grad_n0In = grad_n0In + grad_nTilde[FMT_n0mol+site.iMol];
+			Phi_N += scale * (s.w0 * grad_n0In);
+			Phi_N += scale * (s.w1 * grad_nTilde[FMT_n1]);
+			Phi_N += scale * (s.w2 * grad_nTilde[FMT_n2]);
+			Phi_N += scale * (s.w3 * grad_n3In);
+			Phi_N += scale * (s.w1v * grad_n1vIn);
+			Phi_N += scale * (s.w2m * grad_n2mIn);
+		}
+	}
+	#else
+	{	//Single pass over G-space for all weights of all sites:
+		std::vector<const complex*> gradData; for(const ScalarFieldTilde& x: grad_nTilde) gradData.push_back(x->data());
+		std::vector<complex*> Phi_Ndata;
+		for(const Site& site: sites)
+		{	nullToZero(*site.Phi_N, gInfo);
+			Phi_Ndata.push_back((*site.Phi_N)->data());
+		}
+		threadLaunch(fmtWeights_grad_sub, gInfo.nG, gInfo.S, gInfo.G, &sites, &gradData, &Phi_Ndata, scale);
+	}
+	#endif
+}
+
+
+double PhiFMT(FMTweightedDensities& w)
+{	const GridInfo& gInfo = w.n0->gInfo;
 	double result;
 	#ifdef GPU_ENABLED
 	{	ScalarField phiArr(ScalarFieldData::alloc(gInfo, true));
 		phiFMT_gpu(gInfo.nr, phiArr->dataGpu(),
-			n0->dataGpu(), n1->dataGpu(), n2->dataGpu(), n3->dataGpu(), n1v.const_dataGpu(), n2v.const_dataGpu(), n2m.const_dataGpu(),
-			grad_n0->dataGpu(), grad_n1->dataGpu(), grad_n2->dataGpu(), grad_n3->dataGpu(),
-			grad_n1v.dataGpu(), grad_n2v.dataGpu(), grad_n2m.dataGpu());
+			w.n0->dataGpu(), w.n1->dataGpu(), w.n2->dataGpu(), w.n3->dataGpu(), w.n1v.const_dataGpu(), w.n2v.const_dataGpu(), w.n2m.const_dataGpu(),
+			w.grad_n0->dataGpu(), w.grad_n1->dataGpu(), w.grad_n2->dataGpu(), w.grad_n3->dataGpu(),
+			w.grad_n1v.dataGpu(), w.grad_n2v.dataGpu(), w.grad_n2m.dataGpu());
 		result = gInfo.dV * sum(phiArr);
 	}
 	#else
 	result = gInfo.dV*threadedAccumulate(phiFMT_calc, gInfo.nr,
-			n0->data(), n1->data(), n2->data(), n3->data(), n1v.const_data(), n2v.const_data(), n2m.const_data(),
-			grad_n0->data(), grad_n1->data(), grad_n2->data(), grad_n3->data(),
-			grad_n1v.data(), grad_n2v.data(), grad_n2m.data());
+			w.n0->data(), w.n1->data(), w.n2->data(), w.n3->data(), w.n1v.const_data(), w.n2v.const_data(), w.n2m.const_data(),
+			w.grad_n0->data(), w.grad_n1->data(), w.grad_n2->data(), w.grad_n3->data(),
+			w.grad_n1v.data(), w.grad_n2v.data(), w.grad_n2m.data());
 	#endif
-	n3=0; n1v=0; n2v=0; n2m=0; //no longer need these weighted densities (clean up)
-
-	grad_n2mTilde += tensorKernel_grad(Idag(grad_n2m)); grad_n2m=0;
-	grad_n1vTilde -= divergence(Idag(grad_n1v)); grad_n1v=0;
-	grad_n3tilde += ( Idag(grad_n3) + divergence(Idag(grad_n2v)) ); grad_n3=0; grad_n2v=0;
 	return result;
 }
 
@@ -126,33 +316,22 @@ void phiBond_gpu(int N, double Rhm, double scale, double* phiArr,
 	double *grad_n0arr, double *grad_n2arr, double *grad_n3arr, vector3<double*> grad_n2vArr);
 #endif
 
-double PhiBond(double Rhm, double scale, const ScalarField& n0mol, const ScalarField& n2, const ScalarFieldTilde& n3tilde,
-	ScalarField& grad_n0mol, ScalarField& grad_n2, ScalarFieldTilde& grad_n3tilde)
+double PhiBond(double Rhm, double scale, int iMol, FMTweightedDensities& w)
 {
+	const ScalarField& n0mol = w.n0mol[iMol];
+	ScalarField& grad_n0mol = w.grad_n0mol[iMol];
 	const GridInfo& gInfo = n0mol->gInfo;
-	//Compute n3 and n2v in real space from n3tilde:
-	ScalarField n3 = I(n3tilde);
-	VectorField n2v = I(gradient(-n3tilde));
-	//Bonding correction and gradient:
-	ScalarField grad_n3; VectorField grad_n2v;
-	nullToZero(grad_n0mol, gInfo);
-	nullToZero(grad_n2, gInfo);
-	nullToZero(grad_n3, gInfo);
-	nullToZero(grad_n2v, gInfo);
 	#ifdef GPU_ENABLED
 	ScalarField phiArr(ScalarFieldData::alloc(gInfo, true));
 	phiBond_gpu(gInfo.nr, Rhm, scale, phiArr->dataGpu(),
-		n0mol->dataGpu(), n2->dataGpu(), n3->dataGpu(), n2v.const_dataGpu(),
-		grad_n0mol->dataGpu(), grad_n2->dataGpu(), grad_n3->dataGpu(), grad_n2v.dataGpu());
+		n0mol->dataGpu(), w.n2->dataGpu(), w.n3->dataGpu(), w.n2v.const_dataGpu(),
+		grad_n0mol->dataGpu(), w.grad_n2->dataGpu(), w.grad_n3->dataGpu(), w.grad_n2v.dataGpu());
 	double result = gInfo.dV * sum(phiArr);
 	#else
 	double result = gInfo.dV * threadedAccumulate(phiBond_calc, gInfo.nr, Rhm, scale,
-			n0mol->data(), n2->data(), n3->data(), n2v.const_data(),
-			grad_n0mol->data(), grad_n2->data(), grad_n3->data(), grad_n2v.data());
+			n0mol->data(), w.n2->data(), w.n3->data(), w.n2v.const_data(),
+			grad_n0mol->data(), w.grad_n2->data(), w.grad_n3->data(), w.grad_n2v.data());
 	#endif
-	n3=0; n2v=0; //no longer need these weighted densities (clean up)
-	//Propagate grad_n2v and grad_n3 to grad_n3tilde:
-	grad_n3tilde += ( Idag(grad_n3) + divergence(Idag(grad_n2v)) );
 	return result;
 }
 
@@ -21,22 +21,58 @@ along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
 #define JDFTX_FLUID_MIXEDFMT_H
 
 #include <core/Operators.h>
+#include <core/VectorField.h>
+#include <fluid/Molecule.h>
 
 //! @addtogroup ClassicalDFT
 //! @{
 
 //!@file MixedFMT.h Sphere mixture functional via (optionally soft) Fundamental Measure Theory
 
-//! Returns the `White-Bear mark II' mixed sphere free energy/T given the weighted densities n*
-//! and accumulates the gradients in grad_n*. Note that n1v and n2m are scalar
-//! weighted densities, from which the vector and tensor weighted densities are obtained
-//! internally by a gradient and traceless tensor second derivative respectively.
-//! n2v is obtained as the negative gradient of n3. This is why n3, n1v and n2m
-//! are passed in reciprocal space: they need fourier space processing for gradients etc.
-double PhiFMT(const ScalarField& n0, const ScalarField& n1, const ScalarField& n2,
-	const ScalarFieldTilde& n3tilde, const ScalarFieldTilde& n1vTilde, const ScalarFieldTilde& n2mTilde,
-	ScalarField& grad_n0, ScalarField& grad_n1, ScalarField& grad_n2,
-	ScalarFieldTilde& grad_n3tilde, ScalarFieldTilde& grad_n1vTilde, ScalarFieldTilde& grad_n2mTilde);
+//! Fused evaluation of the FMT weighted densities of a hard sphere mixture.
+//! The scalar, vector and tensor weighted densities (and the partial n0 of bonded molecules)
+//! for all sphere radii are computed from the site densities in a single pass over G-space,
+//! and transformed to real space together in one batched FFT. The gradients w.r.t. the
+//! weighted densities, accumulated in grad_* by PhiFMT() and PhiBond(), are propagated back
+//! to the site densities by the same batch in reverse (batched FFT and a single pass over G).
+struct FMTweightedDensities
+{	ScalarField n0, n1, n2, n3; //!< scalar weighted densities
+	VectorField n1v, n2v; //!< vector weighted densities
+	TensorField n2m; //!< symmetric traceless tensor weighted density
+	std::vector<ScalarField> n0mol; //!< partial n0 for each bonded molecule
+	ScalarField grad_n0, grad_n1, grad_n2, grad_n3; //!< gradients w.r.t scalar weighted densities
+	VectorField grad_n1v, grad_n2v; //!< gradients w.r.t vector weighted densities
+	TensorField grad_n2m; //!< gradient w.r.t tensor weighted density
+	std::vector<ScalarField> grad_n0mol; //!< gradients w.r.t partial n0 of bonded molecules
+	
+	FMTweightedDensities(const GridInfo& gInfo, int nMolBonded=0);
+	
+	//! Add a hard sphere site with density N, whose gradient will be accumulated to Phi_N.
+	//! If iMol is non-negative, the site also contributes to n0mol[iMol].
+	void addSite(const Molecule::Site& s, const ScalarFieldTilde& N, ScalarFieldTilde& Phi_N, int iMol=-1);
+	
+	//! Compute all the weighted densities, and reset their gradients to zero
+	void compute();
+	
+	//! Propagate the accumulated gradients (times scale) to Phi_N of each site
+	void propagateGradient(double scale);
+	
+	//! Site contributing to weighted densities
+	struct Site
+	{	const Molecule::Site* s;
+		const ScalarFieldTilde* N;
+		ScalarFieldTilde* Phi_N;
+		int iMol;
+	};
+private:
+	const GridInfo& gInfo;
+	int nMolBonded;
+	std::vector<Site> sites;
+};
+
+//! Returns the `White-Bear mark II' mixed sphere free energy/T given the weighted densities
+//! and accumulates the gradients in w.grad_n*.
+double PhiFMT(FMTweightedDensities& w);
 
 //! Returns the free energy density/T and accumulates derivatives
 //! corresponding to PhiFMT() for the uniform fluid
@@ -47,12 +83,10 @@ double phiFMTuniform(double n0, double n1, double n2, double n3,
 //! Bonding correction for tangentially bonded hard spheres
 //! Rhm = Ra Rb /(Ra+Rb) is the harmonic sum of the sphere radii
 //! scale is a scale factor for the correction (ratio of bond multiplicity to number of hard sphere sites in molecule)
-//! n0mol is the suitably weighted partial measure-0 weighted density of this molecule
-//! n2 and n3 are the usual FMT weighted densities.
-//! Returns the free energy/T of bonding and accumulates gradients in grad_n*
-//! Note that n3 is in fourier space for faster computation of n2v = -gradient n3
-double PhiBond(double Rhm, double scale, const ScalarField& n0mol, const ScalarField& n2, const ScalarFieldTilde& n3tilde,
-	ScalarField& grad_n0mol, ScalarField& grad_n2, ScalarFieldTilde& grad_n3tilde);
+//! w.n0mol[iMol] is the suitably weighted partial measure-0 weighted density of this molecule
+//! and w.n2, w.n3 and w.n2v are the usual FMT weighted densities.
+//! Returns the free energy/T of bonding and accumulates gradients in w.grad_n*
+double PhiBond(double Rhm, double scale, int iMol, FMTweightedDensities& w);
 
 //! Returns the free energy density/T and accumulates derivatives
 //! corresponding to PhiBond() for the uniform fluid
@@ -73,6 +73,8 @@ NonlinearPCM::NonlinearPCM(const Everything& e, const FluidSolverParams& fsp)
 		screeningEval = 0;
 	}
 	
+	if(fsp.nonlinearSCF && fsp.nonlinearNewton)
+		die("NonlinearPCM cannot use both the SCF and Newton-Krylov solvers.\n");
 	if(fsp.nonlinearSCF)
 	{	//Initialize lookup tables for SCF version:
 		//--- Dielectric lookup table
@@ -270,6 +272,8 @@ void NonlinearPCM::minimizeFluid()
 	{	clearState();
 		Pulay<ScalarFieldTilde>::minimize(compute(0,0));
 	}
+	else if(fsp.nonlinearNewton)
+		minimizeNewton();
 	else
 		Minimizable<ScalarFieldMuEps>::minimize(e.fluidMinParams);
 }
@@ -297,19 +301,21 @@ void NonlinearPCM::step(const ScalarFieldMuEps& dir, double alpha)
 double NonlinearPCM::compute(ScalarFieldMuEps* grad, ScalarFieldMuEps* Kgrad)
 {	ScalarFieldMuEps gradUnused;
 	double E = (*this)(state, grad ? *grad : gradUnused);
-	//Compute preconditioned gradient:
-	if(Kgrad)
-	{	const ScalarFieldMuEps& in = grad ? *grad : gradUnused;
-		double dielPrefac = 1./(gInfo.dV * dielectricEval->NT);
-		double ionsPrefac = screeningEval ? 1./(gInfo.dV * screeningEval->NT) : 0.;
-		setMuEps(*Kgrad,
-			ionsPrefac * I(preconditioner*J(getMuPlus(in))),
-			ionsPrefac * I(preconditioner*J(getMuMinus(in))),
-			dielPrefac * getEps(in));
-	}
+	if(Kgrad) *Kgrad = precondition(grad ? *grad : gradUnused); //Compute preconditioned gradient
 	return E;
 }
 
+ScalarFieldMuEps NonlinearPCM::precondition(const ScalarFieldMuEps& in) const
+{	ScalarFieldMuEps out;
+	double dielPrefac = 1./(gInfo.dV * dielectricEval->NT);
+	double ionsPrefac = screeningEval ? 1./(gInfo.dV * screeningEval->NT) : 0.;
+	setMuEps(out,
+		ionsPrefac * I(preconditioner*J(getMuPlus(in))),
+		ionsPrefac * I(preconditioner*J(getMuMinus(in))),
+		dielPrefac * getEps(in));
+	return out;
+}
+
 
 void NonlinearPCM::dumpDensities(const char* filenamePattern) const
 {	PCM::dumpDensities(filenamePattern);
@@ -401,3 +407,172 @@ void NonlinearPCM::phiToState(bool setState)
 	else
 		linearPCM->override(epsilon, kappaSq);
 }
+
+//--------- Newton-Krylov solver ---------
+
+//! Linear solve for a Newton step of NonlinearPCM, with analytic Hessian-vector products about the current state:
+//! the directional derivative of each step of NonlinearPCM::operator(), using second derivatives of the local
+//! Screening and Dielectric functions and the linear response of the bound charge and its potential
+struct NonlinearPCMnewtonStep : public LinearSolvable<ScalarFieldMuEps>
+{	const NonlinearPCM& pcm;
+	const GridInfo& gInfo;
+	const ScalarFieldMuEps& x; //!< state about which Hessian is evaluated
+	ScalarField phi; VectorField Dphi; //!< total electrostatic potential (fluid + explicit) and its gradient at x
+	double mu0, Qexp, Adiel_mu0; //!< neutrality constraint, explicit charge and derivative w.r.t mu0 at x (ionic screening only)
+	ScalarField mu0_muPlus, mu0_muMinus; //!< gradients of neutrality constraint at x
+	ScalarField rho_muPlus, rho_muMinus; //!< derivatives of ionic bound charge w.r.t mu+mu0 at x
+	
+	NonlinearPCMnewtonStep(const NonlinearPCM& pcm, const ScalarFieldMuEps& x)
+	: pcm(pcm), gInfo(pcm.gInfo), x(x), mu0(0.), Qexp(0.), Adiel_mu0(0.)
+	{	nullToZero(state, gInfo);
+		//Bound charge at x (as in NonlinearPCM::operator()):
+		ScalarFieldTilde rhoFluidTilde;
+		ScalarField Adiel_muPlus, Adiel_muMinus;
+		if(pcm.screeningEval)
+		{	const ScalarField& muPlus = getMuPlus(x);
+			const ScalarField& muMinus = getMuMinus(x);
+			Qexp = integral(pcm.rhoExplicitTilde);
+			mu0 = pcm.screeningEval->neutralityConstraint(muPlus, muMinus, pcm.shape, Qexp, &mu0_muPlus, &mu0_muMinus);
+			ScalarField Aout, rhoIon;
+			initZero(Aout, gInfo); initZero(rhoIon, gInfo);
+			initZero(Adiel_muPlus, gInfo); initZero(Adiel_muMinus, gInfo);
+			callPref(pcm.screeningEval->freeEnergy)(gInfo.nr, mu0, muPlus->dataPref(), muMinus->dataPref(), pcm.shape->dataPref(),
+				rhoIon->dataPref(), Aout->dataPref(), Adiel_muPlus->dataPref(), Adiel_muMinus->dataPref(), 0);
+			rhoFluidTilde += J(rhoIon);
+			//Charge response (unit A_rho):
+			ScalarField unit; nullToZero(unit, gInfo); unit += 1.;
+			initZero(rho_muPlus, gInfo); initZero(rho_muMinus, gInfo);
+			callPref(pcm.screeningEval->convertDerivative)(gInfo.nr, mu0, muPlus->dataPref(), muMinus->dataPref(), pcm.shape->dataPref(),
+				unit->dataPref(), rho_muPlus->dataPref(), rho_muMinus->dataPref(), 0);
+		}
+		{	const VectorField eps = getEps(x);
+			ScalarField Aout; VectorField p, Adiel_eps;
+			initZero(Aout, gInfo); nullToZero(p, gInfo); nullToZero(Adiel_eps, gInfo);
+			callPref(pcm.dielectricEval->freeEnergy)(gInfo.nr, eps.const_dataPref(), pcm.shape->dataPref(),
+				p.dataPref(), Aout->dataPref(), Adiel_eps.dataPref(), 0);
+			rhoFluidTilde -= divergence(J(p));
+		}
+		//Potential and derivative w.r.t mu0 at x:
+		ScalarFieldTilde phiTilde = pcm.coulomb(rhoFluidTilde) + pcm.coulomb(pcm.rhoExplicitTilde);
+		phi = I(phiTilde);
+		Dphi = I(gradient(phiTilde));
+		if(pcm.screeningEval)
+		{	callPref(pcm.screeningEval->convertDerivative)(gInfo.nr, mu0, getMuPlus(x)->dataPref(), getMuMinus(x)->dataPref(), pcm.shape->dataPref(),
+				phi->dataPref(), Adiel_muPlus->dataPref(), Adiel_muMinus->dataPref(), 0);
+			Adiel_mu0 = integral(Adiel_muPlus) + integral(Adiel_muMinus);
+		}
+	}
+	
+	ScalarFieldMuEps hessian(const ScalarFieldMuEps& v) const
+	{	const VectorField eps = getEps(x);
+		const VectorField deps = getEps(v);
+		const ScalarField& dmuPlus = getMuPlus(v);
+		const ScalarField& dmuMinus = getMuMinus(v);
+		//Change in bound charge and potential:
+		ScalarFieldTilde drhoFluidTilde;
+		double dmu0 = 0.;
+		if(pcm.screeningEval)
+		{	dmu0 = integral(mu0_muPlus*dmuPlus) + integral(mu0_muMinus*dmuMinus);
+			drhoFluidTilde += J(rho_muPlus*(dmuPlus+dmu0) + rho_muMinus*(dmuMinus+dmu0));
+		}
+		VectorField dp; nullToZero(dp, gInfo);
+		callPref(pcm.dielectricEval->convertDerivative)(gInfo.nr, eps.const_dataPref(), pcm.shape->dataPref(), deps.const_dataPref(), dp.dataPref(), 0); //dp/deps is symmetric
+		drhoFluidTilde -= divergence(J(dp));
+		ScalarFieldTilde dphiTilde = pcm.coulomb(drhoFluidTilde);
+		//Dielectric:
+		VectorField H_eps; nullToZero(H_eps, gInfo);
+		callPref(pcm.dielectricEval->hessian)(gInfo.nr, eps.const_dataPref(), pcm.shape->dataPref(), Dphi.const_dataPref(), deps.const_dataPref(), H_eps.dataPref());
+		{	VectorField dDphi = I(gradient(dphiTilde));
+			callPref(pcm.dielectricEval->convertDerivative)(gInfo.nr, eps.const_dataPref(), pcm.shape->dataPref(), dDphi.const_dataPref(), H_eps.dataPref(), 0);
+		}
+		//Screening:
+		ScalarField H_muPlus, H_muMinus;
+		initZero(H_muPlus, gInfo); initZero(H_muMinus, gInfo);
+		if(pcm.screeningEval)
+		{	const ScalarField& muPlus = getMuPlus(x);
+			const ScalarField& muMinus = getMuMinus(x);
+			callPref(pcm.screeningEval->hessian)(gInfo.nr, mu0, dmu0, muPlus->dataPref(), muMinus->dataPref(), pcm.shape->dataPref(), phi->dataPref(),
+				dmuPlus->dataPref(), dmuMinus->dataPref(), H_muPlus->dataPref(), H_muMinus->dataPref());
+			ScalarField dphi = I(dphiTilde);
+			callPref(pcm.screeningEval->convertDerivative)(gInfo.nr, mu0, muPlus->dataPref(), muMinus->dataPref(), pcm.shape->dataPref(),
+				dphi->dataPref(), H_muPlus->dataPref(), H_muMinus->dataPref(), 0);
+			//Propagate through neutrality constraint:
+			double dAdiel_mu0 = integral(H_muPlus) + integral(H_muMinus);
+			ScalarField dmu0_muPlus, dmu0_muMinus;
+			pcm.screeningEval->neutralityConstraintDeriv(muPlus, muMinus, pcm.shape, Qexp, dmuPlus, dmuMinus, dmu0_muPlus, dmu0_muMinus);
+			H_muPlus += dAdiel_mu0 * mu0_muPlus;
+			H_muMinus += dAdiel_mu0 * mu0_muMinus;
+			if(dmu0_muPlus) H_muPlus += Adiel_mu0 * dmu0_muPlus;
+			if(dmu0_muMinus) H_muMinus += Adiel_mu0 * dmu0_muMinus;
+		}
+		ScalarFieldMuEps Hv;
+		setMuEps(Hv, H_muPlus, H_muMinus, H_eps);
+		Hv *= gInfo.dV; //as in NonlinearPCM::operator()
+		return Hv;
+	}
+	
+	ScalarFieldMuEps precondition(const ScalarFieldMuEps& v) const
+	{	return pcm.precondition(v);
+	}
+};
+
+void NonlinearPCM::minimizeNewton()
+{	const MinimizeParams& p = e.fluidMinParams;
+	MinimizeParams pInner = p; //parameters for linear solve of each Newton step
+	pInner.nIterations = fsp.nonlinearNewtonInner;
+	pInner.fpLog = fsp.verboseLog ? p.fpLog : nullLog;
+	pInner.linePrefix = "\tNewtonStep: ";
+	
+	ScalarFieldMuEps g, Kg;
+	double A = compute(&g, &Kg);
+	EdiffCheck ediffCheck(p.nEnergyDiff, p.energyDiffThreshold);
+	ediffCheck.checkConvergence(A);
+	double alpha = 0.; int nInner = 0;
+	for(int iter=0; !killFlag; iter++)
+	{	double knorm = sqrt(fabs(::dot(g,Kg))/p.nDim);
+		fprintf(p.fpLog, "%sNewton: %3d  %s: ", p.linePrefix, iter, p.energyLabel);
+		fprintf(p.fpLog, p.energyFormat, A);
+		fprintf(p.fpLog, "  |grad|_K: %10.3le  alpha: %10.3le  nInner: %3d  t[s]: %9.2lf\n", knorm, alpha, nInner, clock_sec());
+		fflush(p.fpLog);
+		//Check convergence:
+		if(knorm < p.knormThreshold)
+		{	fprintf(p.fpLog, "%sConverged (|grad|_K<%le).\n", p.linePrefix, p.knormThreshold); fflush(p.fpLog);
+			return;
+		}
+		if(iter && ediffCheck.checkConvergence(A))
+		{	fprintf(p.fpLog, "%sConverged (|Delta %s|<%le for %d iters).\n", p.linePrefix, p.energyLabel, p.energyDiffThreshold, p.nEnergyDiff); fflush(p.fpLog);
+			return;
+		}
+		if(iter >= p.nIterations) break;
+		
+		//Inexact Newton step: solve Hessian * dir = -grad to relative tolerance eta (Eisenstat-Walker type forcing):
+		NonlinearPCMnewtonStep newtonStep(*this, state);
+		pInner.knormThreshold = std::min(0.5, sqrt(knorm)) * knorm;
+		nInner = newtonStep.solve(-g, pInner);
+		
+		//Backtracking line search along Newton direction with Armijo sufficient-decrease condition (full step is accepted near convergence):
+		const double armijo = 1e-4; //fraction of linearized decrease required
+		double gDotDir = ::dot(g, newtonStep.state); //directional derivative of A at alpha = 0
+		ScalarFieldMuEps stateOrig = clone(state);
+		const double Aorig = A;
+		alpha = 1.;
+		for(int iAlpha=0; ; iAlpha++)
+		{	if(gDotDir < 0.) //else not a descent direction (inexact solve of an indefinite Hessian)
+			{	state = clone(stateOrig);
+				::axpy(alpha, newtonStep.state, state);
+				A = compute(&g, &Kg);
+				if(std::isfinite(A) && A <= Aorig + armijo*alpha*gDotDir)
+					break; //sufficient decrease
+			}
+			if(gDotDir >= 0. || iAlpha == p.nAlphaAdjustMax)
+			{	//Newton step failed: fall back to nonlinear CG from last good state
+				fprintf(p.fpLog, "%sNewton step failed; continuing with nonlinear CG.\n", p.linePrefix); fflush(p.fpLog);
+				state = stateOrig;
+				Minimizable<ScalarFieldMuEps>::minimize(p);
+				return;
+			}
+			alpha *= 0.5;
+		}
+	}
+	fprintf(p.fpLog, "%sNone of the convergence criteria satisfied after %d iterations.\n", p.linePrefix, p.nIterations); fflush(p.fpLog);
+}
@@ -49,7 +49,7 @@ public:
 	void loadState(const char* filename); //!< Load state from file
 	void saveState(const char* filename) const; //!< Save state to file
 	void dumpDensities(const char* filenamePattern) const;
-	void minimizeFluid(); //!< Converge using nonlinear conjugate gradients
+	void minimizeFluid(); //!< Converge using nonlinear conjugate gradients, Pulay-mixed SCF or Newton-Krylov (depending on FluidSolverParams)
 
 	//! Compute gradient and free energy (with optional outputs)
 	double operator()(const ScalarFieldMuEps& state, ScalarFieldMuEps& Adiel_state, ScalarFieldTilde* Adiel_rhoExplicitTilde=0, ScalarFieldTilde* Adiel_nCavityTilde=0, bool electricOnly=false) const;
@@ -70,6 +70,10 @@ private:
 	std::shared_ptr<RealKernel> metric; //!< Pulay metric for SCF version
 	RadialFunctionG gLookup, xLookup; //!< lookup tables for transcendental solutions involved in the dielectric and ionic SCF method
 	std::shared_ptr<class LinearPCM> linearPCM;
+	
+	friend struct NonlinearPCMnewtonStep;
+	void minimizeNewton(); //!< Converge using inexact Newton-Krylov steps (preconditioned linear CG with analytic Hessian-vector products)
+	ScalarFieldMuEps precondition(const ScalarFieldMuEps&) const; //!< Apply preconditioner used by minimizer and Newton versions
 
 protected:
 	//Interface for Pulay<ScalarFieldTilde>
@@ -176,6 +176,15 @@ namespace NonlinearPCMeval
 	{	threadLaunch(ScreeningConvertDerivative_sub, N, mu0, muPlus, muMinus, s, A_rho, A_muPlus, A_muMinus, A_s, *this);
 	}
 	
+	void ScreeningHessian_sub(size_t iStart, size_t iStop, double mu0, double dmu0, const double* muPlus, const double* muMinus, const double* s, const double* A_rho,
+		const double* dmuPlus, const double* dmuMinus, double* H_muPlus, double* H_muMinus, const Screening& eval)
+	{	for(size_t i=iStart; i<iStop; i++) eval.hessian_calc(i, mu0, dmu0, muPlus, muMinus, s, A_rho, dmuPlus, dmuMinus, H_muPlus, H_muMinus);
+	}
+	void Screening::hessian(size_t N, double mu0, double dmu0, const double* muPlus, const double* muMinus, const double* s, const double* A_rho,
+		const double* dmuPlus, const double* dmuMinus, double* H_muPlus, double* H_muMinus) const
+	{	threadLaunch(ScreeningHessian_sub, N, mu0, dmu0, muPlus, muMinus, s, A_rho, dmuPlus, dmuMinus, H_muPlus, H_muMinus, *this);
+	}
+	
 	void ScreeningPhiToState_sub(size_t iStart, size_t iStop, const double* phi, const double* s, const RadialFunctionG& xLookup, bool setState, double* muPlus, double* muMinus, double* kappaSq, const Screening& eval)
 	{	for(size_t i=iStart; i<iStop; i++) eval.phiToState_calc(i, phi, s, xLookup, setState, muPlus, muMinus, kappaSq);
 	}
@@ -212,6 +221,13 @@ namespace NonlinearPCMeval
 	{	threadLaunch(DielectricConvertDerivative_sub, N, eps, s, A_p, A_eps, A_s, *this);
 	}
 	
+	void DielectricHessian_sub(size_t iStart, size_t iStop, vector3<const double*> eps, const double* s, vector3<const double*> A_p, vector3<const double*> deps, vector3<double*> H_eps, const Dielectric& eval)
+	{	for(size_t i=iStart; i<iStop; i++) eval.hessian_calc(i, eps, s, A_p, deps, H_eps);
+	}
+	void Dielectric::hessian(size_t N, vector3<const double*> eps, const double* s, vector3<const double*> A_p, vector3<const double*> deps, vector3<double*> H_eps) const
+	{	threadLaunch(DielectricHessian_sub, N, eps, s, A_p, deps, H_eps, *this);
+	}
+	
 	void DielectricPhiToState_sub(size_t iStart, size_t iStop, vector3<const double*> Dphi, const double* s, const RadialFunctionG& gLookup, bool setState, vector3<double*> eps, double* epsilon, const Dielectric& eval)
 	{	for(size_t i=iStart; i<iStop; i++) eval.phiToState_calc(i, Dphi, s, gLookup, setState, eps, epsilon);
 	}
@@ -122,6 +122,18 @@ namespace NonlinearPCMeval
 		gpuErrorCheck();
 	}
 	
+	__global__
+	void ScreeningHessian_kernel(size_t N, double mu0, double dmu0, const double* muPlus, const double* muMinus, const double* s, const double* A_rho,
+		const double* dmuPlus, const double* dmuMinus, double* H_muPlus, double* H_muMinus, const Screening eval)
+	{	int i = kernelIndex1D(); if(i<N) eval.hessian_calc(i, mu0, dmu0, muPlus, muMinus, s, A_rho, dmuPlus, dmuMinus, H_muPlus, H_muMinus);
+	}
+	void Screening::hessian_gpu(size_t N, double mu0, double dmu0, const double* muPlus, const double* muMinus, const double* s, const double* A_rho,
+		const double* dmuPlus, const double* dmuMinus, double* H_muPlus, double* H_muMinus) const
+	{	GpuLaunchConfig1D glc(ScreeningHessian_kernel, N);
+		ScreeningHessian_kernel<<<glc.nBlocks,glc.nPerBlock>>>(N, mu0, dmu0, muPlus, muMinus, s, A_rho, dmuPlus, dmuMinus, H_muPlus, H_muMinus, *this);
+		gpuErrorCheck();
+	}
+	
 	__global__
 	void ScreeningPhiToState_kernel(size_t N, const double* phi, const double* s, const RadialFunctionG xLookup, bool setState, double* muPlus, double* muMinus, double* kappaSq, const Screening eval)
 	{	int i = kernelIndex1D(); if(i<N) eval.phiToState_calc(i, phi, s, xLookup, setState, muPlus, muMinus, kappaSq);
@@ -152,6 +164,16 @@ namespace NonlinearPCMeval
 		gpuErrorCheck();
 	}
 
+	__global__
+	void DielectricHessian_kernel(size_t N, vector3<const double*> eps, const double* s, vector3<const double*> A_p, vector3<const double*> deps, vector3<double*> H_eps, const Dielectric eval)
+	{	int i = kernelIndex1D(); if(i<N) eval.hessian_calc(i, eps, s, A_p, deps, H_eps);
+	}
+	void Dielectric::hessian_gpu(size_t N, vector3<const double*> eps, const double* s, vector3<const double*> A_p, vector3<const double*> deps, vector3<double*> H_eps) const
+	{	GpuLaunchConfig1D glc(DielectricHessian_kernel, N);
+		DielectricHessian_kernel<<<glc.nBlocks,glc.nPerBlock>>>(N, eps, s, A_p, deps, H_eps, *this);
+		gpuErrorCheck();
+	}
+	
 	__global__
 	void DielectricPhiToState_kernel(size_t N, vector3<const double*> Dphi, const double* s, const RadialFunctionG gLookup, bool setState, vector3<double*> eps, double* epsilon, const Dielectric eval)
 	{	int i = kernelIndex1D(); if(i<N) eval.phiToState_calc(i, Dphi, s, gLookup, setState, eps, epsilon);
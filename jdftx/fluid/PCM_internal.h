@@ -236,6 +236,37 @@ namespace NonlinearPCMeval
 				return mu0;
 			}
 		}
+		
+		//! Directional derivative (along dmuPlus, dmuMinus at fixed shape and Qexp) of the neutrality Lagrange multiplier mu0,
+		//! returned, and of its gradients mu0_muPlus and mu0_muMinus from neutralityConstraint(), output in dmu0_muPlus and dmu0_muMinus
+		inline double neutralityConstraintDeriv(const ScalarField& muPlus, const ScalarField& muMinus, const ScalarField& shape, double Qexp,
+			const ScalarField& dmuPlus, const ScalarField& dmuMinus, ScalarField& dmu0_muPlus, ScalarField& dmu0_muMinus)
+		{
+			if(linear)
+			{	double Qsum = NZ * 2.*integral(shape);
+				dmu0_muPlus = 0; dmu0_muMinus = 0; //gradients of mu0 are independent of mu
+				return -(NZ/Qsum) * integral(shape*(dmuPlus+dmuMinus));
+			}
+			else
+			{	ScalarField sEtaPlus  = shape * exp(muPlus);
+				ScalarField sEtaMinus = shape * exp(-muMinus);
+				double Qplus  = +NZ * integral(sEtaPlus);
+				double Qminus = -NZ * integral(sEtaMinus);
+				double disc = sqrt(Qexp*Qexp - 4.*Qplus*Qminus);
+				//With y = exp(mu0), the constraint Qplus y + Qminus / y + Qexp = 0 has derivative disc w.r.t. mu0:
+				double y = exp(neutralityConstraint(muPlus, muMinus, shape, Qexp));
+				double mu0_Qplus = -y/disc, mu0_Qminus = -1./(y*disc);
+				double dQplus = NZ * integral(sEtaPlus*dmuPlus);
+				double dQminus = NZ * integral(sEtaMinus*dmuMinus);
+				double dmu0 = mu0_Qplus*dQplus + mu0_Qminus*dQminus;
+				double ddisc = y*dQplus - dQminus/y - Qexp*dmu0;
+				double dmu0_Qplus = -y*(dmu0*disc - ddisc)/(disc*disc);
+				double dmu0_Qminus = (dmu0*disc + ddisc)/(y*disc*disc);
+				dmu0_muPlus  = NZ * sEtaPlus  * (dmu0_Qplus  + mu0_Qplus*dmuPlus);
+				dmu0_muMinus = NZ * sEtaMinus * (dmu0_Qminus - mu0_Qminus*dmuMinus);
+				return dmu0;
+			}
+		}
 		#endif
 		
 		//! Hard sphere free energy per particle and derivative, where x is total packing fraction
@@ -254,6 +285,26 @@ namespace NonlinearPCMeval
 			return f;
 		}
 		
+		//! Hard sphere free energy per particle with first and second derivatives
+		__hostanddev__ double fHS(double xIn, double& f_xIn, double& f_xIn_xIn) const
+		{	double x = xIn, x_xIn = 1., x_xIn_xIn = 0.;
+			if(xIn > 0.5) //soft packing: remap [0.5,infty) on to [0.5,1)
+			{	double xInInv = 1./xIn;
+				x = 1.-0.25*xInInv;
+				x_xIn = 0.25*xInInv*xInInv;
+				x_xIn_xIn = -0.5*xInInv*xInInv*xInInv;
+			}
+			double den = 1./(1-x), den0 = 1./(1-x0);
+			double comb = (x-x0)*den*den0, comb_x = den*den, comb_xx = 2.*den*den*den;
+			double prefac = (2./x0);
+			double f = prefac * comb*comb;
+			double f_x = prefac * 2.*comb*comb_x;
+			double f_xx = prefac * 2.*(comb_x*comb_x + comb*comb_xx);
+			f_xIn = f_x * x_xIn;
+			f_xIn_xIn = f_xx * x_xIn*x_xIn + f_x * x_xIn_xIn;
+			return f;
+		}
+		
 		//! Compute the nonlinear functions in the free energy and charge density prior to scaling by shape function
 		//! Note that each mu here is mu(r) + mu0, i.e. after imposing charge neutrality constraint
 		__hostanddev__ void compute(double muPlus, double muMinus, double& F, double& F_muPlus, double& F_muMinus, double& Rho, double& Rho_muPlus, double& Rho_muMinus) const
@@ -278,6 +329,27 @@ namespace NonlinearPCMeval
 			}
 		}
 		
+		//! Second derivatives of the functions in compute() (the mixed derivative of Rho vanishes)
+		__hostanddev__ void compute2(double muPlus, double muMinus, double& F_muPlus2, double& F_muPlusMinus, double& F_muMinus2, double& Rho_muPlus2, double& Rho_muMinus2) const
+		{	if(linear)
+			{	F_muPlus2 = NT;
+				F_muPlusMinus = 0.;
+				F_muMinus2 = NT;
+				Rho_muPlus2 = 0.;
+				Rho_muMinus2 = 0.;
+			}
+			else
+			{	double etaPlus = exp(muPlus), etaMinus=exp(-muMinus);
+				double xPlus = x0plus*etaPlus, xMinus = x0minus*etaMinus; //contributions to packing fraction
+				double f_x, f_xx; fHS(xPlus+xMinus, f_x, f_xx); //hard sphere free energy derivatives
+				F_muPlus2 = NT * (etaPlus*(muPlus+1.) + f_x*xPlus + f_xx*xPlus*xPlus);
+				F_muPlusMinus = -NT * f_xx*xPlus*xMinus;
+				F_muMinus2 = NT * (etaMinus*(1.-muMinus) + f_x*xMinus + f_xx*xMinus*xMinus);
+				Rho_muPlus2 = NZ * etaPlus;
+				Rho_muMinus2 = -NZ * etaMinus;
+			}
+		}
+		
 		//! Given shape function s and potential mu, compute induced charge rho, free energy density A and accumulate its derivatives
 		__hostanddev__ void freeEnergy_calc(size_t i, double mu0, const double* muPlus, const double* muMinus, const double* s, double* rho, double* A, double* A_muPlus, double* A_muMinus, double* A_s) const
 		{	double F, F_muPlus, F_muMinus, Rho, Rho_muPlus, Rho_muMinus;
@@ -306,6 +378,23 @@ namespace NonlinearPCMeval
 		void convertDerivative_gpu(size_t N, double mu0, const double* muPlus, const double* muMinus, const double* s, const double* A_rho, double* A_muPlus, double* A_muMinus, double* A_s) const;
 		#endif
 		
+		//! Accumulate second derivatives of the free energy density and of rho (contracted with A_rho) applied to
+		//! changes dmu + dmu0 of each mu (where dmu0 is the corresponding change of the neutrality constraint) to H_mu
+		__hostanddev__ void hessian_calc(size_t i, double mu0, double dmu0, const double* muPlus, const double* muMinus, const double* s, const double* A_rho,
+			const double* dmuPlus, const double* dmuMinus, double* H_muPlus, double* H_muMinus) const
+		{	double F_muPlus2, F_muPlusMinus, F_muMinus2, Rho_muPlus2, Rho_muMinus2;
+			compute2(muPlus[i]+mu0, muMinus[i]+mu0, F_muPlus2, F_muPlusMinus, F_muMinus2, Rho_muPlus2, Rho_muMinus2);
+			double duPlus = dmuPlus[i]+dmu0, duMinus = dmuMinus[i]+dmu0;
+			H_muPlus[i] += s[i] * ((F_muPlus2 + Rho_muPlus2*A_rho[i])*duPlus + F_muPlusMinus*duMinus);
+			H_muMinus[i] += s[i] * (F_muPlusMinus*duPlus + (F_muMinus2 + Rho_muMinus2*A_rho[i])*duMinus);
+		}
+		void hessian(size_t N, double mu0, double dmu0, const double* muPlus, const double* muMinus, const double* s, const double* A_rho,
+			const double* dmuPlus, const double* dmuMinus, double* H_muPlus, double* H_muMinus) const;
+		#ifdef GPU_ENABLED
+		void hessian_gpu(size_t N, double mu0, double dmu0, const double* muPlus, const double* muMinus, const double* s, const double* A_rho,
+			const double* dmuPlus, const double* dmuMinus, double* H_muPlus, double* H_muMinus) const;
+		#endif
+		
 		//! Root function used for finding packing fraction x at a given dimensionless potential V = Z phi / T
 		__hostanddev__ double rootFunc(double x, double V) const
 		{	double f_x; fHS(x, f_x); //hard sphere potential
@@ -388,6 +477,16 @@ namespace NonlinearPCMeval
 			}
 		}
 		
+		//! Second derivative of frac (from calcFunctions) with respect to epsSqHlf
+		__hostanddev__ double calcFrac_epsSqHlf2(double eps) const
+		{	if(linear) return 0.;
+			double epsSq = eps*eps;
+			if(eps < 1e-1) //Use series expansion
+				return 16.0/945 + epsSq*(-24.0/4725 + epsSq*(96.0/93555));
+			double c = eps/tanh(eps), q = pow(eps/sinh(eps),2);
+			return (3.*(c+q) + 2.*q*c - 8.)/(epsSq*epsSq*epsSq);
+		}
+		
 		//! Compute the nonlinear functions in the free energy and effective susceptibility (p/eps) prior to scaling by shape function
 		__hostanddev__ void compute(double epsSqHlf, double& F, double& F_epsSqHlf, double& ChiEff, double& ChiEff_epsSqHlf) const
 		{	double epsSq = 2.*epsSqHlf, eps = sqrt(epsSq);
@@ -403,6 +502,21 @@ namespace NonlinearPCMeval
 			ChiEff_epsSqHlf = Np * frac_epsSqHlf * (1.-X*alpha);
 		}
 		
+		//! First and second derivatives of the functions in compute() with respect to epsSqHlf
+		__hostanddev__ void compute2(double epsSqHlf, double& F_epsSqHlf, double& F_epsSqHlf2, double& ChiEff_epsSqHlf, double& ChiEff_epsSqHlf2) const
+		{	double epsSq = 2.*epsSqHlf, eps = sqrt(epsSq);
+			double frac, frac_epsSqHlf, logsinch;
+			calcFunctions(eps, frac, frac_epsSqHlf, logsinch);
+			double frac_epsSqHlf2 = calcFrac_epsSqHlf2(eps);
+			double screen = 1 - alpha*frac, screen_epsSqHlf = -alpha*frac_epsSqHlf;
+			double B = frac + X*screen + epsSq*frac_epsSqHlf*(1.-X*alpha); //F_epsSqHlf = NT B screen (see compute)
+			double B_epsSqHlf = frac_epsSqHlf + X*screen_epsSqHlf + (2.*frac_epsSqHlf + epsSq*frac_epsSqHlf2)*(1.-X*alpha);
+			F_epsSqHlf = NT * B * screen;
+			F_epsSqHlf2 = NT * (B_epsSqHlf*screen + B*screen_epsSqHlf);
+			ChiEff_epsSqHlf = Np * frac_epsSqHlf * (1.-X*alpha);
+			ChiEff_epsSqHlf2 = Np * frac_epsSqHlf2 * (1.-X*alpha);
+		}
+		
 		//! Given shape function s and gradient of phi eps, compute polarization p, free energy density A and accumulate its derivatives
 		__hostanddev__ void freeEnergy_calc(size_t i, vector3<const double*> eps, const double* s, vector3<double*> p, double* A, vector3<double*> A_eps, double* A_s) const
 		{	vector3<> epsVec = loadVector(eps, i);
@@ -435,6 +549,23 @@ namespace NonlinearPCMeval
 		void convertDerivative_gpu(size_t N, vector3<const double*> eps, const double* s, vector3<const double*> A_p, vector3<double*> A_eps, double* A_s) const;
 		#endif
 		
+		//! Accumulate second derivatives of the free energy density and of p (contracted with A_p) applied to deps to H_eps
+		__hostanddev__ void hessian_calc(size_t i, vector3<const double*> eps, const double* s, vector3<const double*> A_p, vector3<const double*> deps, vector3<double*> H_eps) const
+		{	vector3<> epsVec = loadVector(eps, i);
+			vector3<> depsVec = loadVector(deps, i);
+			vector3<> A_pVec = loadVector(A_p, i);
+			double F_epsSqHlf, F_epsSqHlf2, ChiEff_epsSqHlf, ChiEff_epsSqHlf2;
+			compute2(0.5*epsVec.length_squared(), F_epsSqHlf, F_epsSqHlf2, ChiEff_epsSqHlf, ChiEff_epsSqHlf2);
+			double epsDotDeps = dot(epsVec, depsVec), epsDotA_p = dot(epsVec, A_pVec);
+			accumVector(s[i]*( F_epsSqHlf*depsVec + (F_epsSqHlf2*epsDotDeps)*epsVec //free energy
+				+ ChiEff_epsSqHlf*(epsDotDeps*A_pVec + epsDotA_p*depsVec + dot(depsVec,A_pVec)*epsVec) //polarization
+				+ (ChiEff_epsSqHlf2*epsDotDeps*epsDotA_p)*epsVec ), H_eps, i);
+		}
+		void hessian(size_t N, vector3<const double*> eps, const double* s, vector3<const double*> A_p, vector3<const double*> deps, vector3<double*> H_eps) const;
+		#ifdef GPU_ENABLED
+		void hessian_gpu(size_t N, vector3<const double*> eps, const double* s, vector3<const double*> A_p, vector3<const double*> deps, vector3<double*> H_eps) const;
+		#endif
+		
 		//! Calculate x = pMol E / T given eps
 		__hostanddev__ double x_from_eps(double eps) const
 		{	double frac, frac_epsSqHlf, logsinch;
@@ -24,6 +24,7 @@ along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
 #include <core/SphericalHarmonics.h>
 #include <fluid/SaLSA.h>
 #include <fluid/PCM_internal.h>
+#include <core/Multigrid.h>
 #include <gsl/gsl_linalg.h>
 #include <cstring>
 
@@ -165,6 +166,7 @@ SaLSA::SaLSA(const Everything& e, const FluidSolverParams& fsp)
 		KkernelSamples[i] = (diagH>GzeroTol) ? 1./sqrt(diagH) : 0.;
 	}
 	Kkernel.init(0, KkernelSamples, dG);
+	if(fsp.multigrid) multigrid = std::make_shared<Multigrid>(gInfo);
 	
 	//MPI division:
 	TaskDivision(response.size(), mpiUtil).myRange(rStart, rStop);
@@ -195,7 +197,8 @@ ScalarFieldTilde SaLSA::hessian(const ScalarFieldTilde& phiTilde) const
 }
 
 ScalarFieldTilde SaLSA::precondition(const ScalarFieldTilde& rTilde) const
-{	return Kkernel*(J(epsInv*I(Kkernel*rTilde)));
+{	if(multigrid) return multigrid->precondition(rTilde);
+	return Kkernel*(J(epsInv*I(Kkernel*rTilde)));
 }
 
 double SaLSA::sync(double x) const
@@ -218,6 +221,7 @@ void SaLSA::set_internal(const ScalarFieldTilde& rhoExplicitTilde, const ScalarF
 	
 	//Update the inhomogeneity factor of the preconditioner
 	epsInv = inv(1. + (epsBulk-1.)*shape);
+	if(multigrid) multigrid->setCoefficients(1. + (epsBulk-1.)*shape, k2factor ? k2factor*shape : ScalarField());
 	
 	//Initialize the state if it hasn't been loaded:
 	if(!state) nullToZero(state, gInfo);
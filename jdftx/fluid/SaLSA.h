@@ -53,6 +53,7 @@ private:
 	int rStart, rStop; //MPI division of response array
 	RadialFunctionG nFluid; //electron density model for the fluid
 	RadialFunctionG Kkernel; ScalarField epsInv; //for preconditioner
+	std::shared_ptr<class Multigrid> multigrid; //multigrid preconditioner for the local dielectric limit (if enabled)
 	ScalarFieldArray siteShape; //shape functions for sites
 };
 
@@ -25,6 +25,7 @@ along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
 #include <electronic/LatticeMinimizer.h>
 #include <electronic/Vibrations.h>
 #include <electronic/IonDynamics.h>
+#include <electronic/Batch.h>
 #include <fluid/FluidSolver.h>
 #include <core/Util.h>
 #include <commands/parser.h>
@@ -40,17 +41,25 @@ int main(int argc, char** argv)
 	ElecVars& eVars = e.eVars;
 	parse(readInputFile(inputFilename), e, printDefaults);
 	if(dryRun) eVars.skipWfnsInit = true;
+	if(e.batch) e.batch->splitProcesses(); //before setup, so that all setup is local to each group of processes
 	e.setup();
 	Citations::print();
 	if(dryRun)
 	{	logPrintf("Dry run successful: commands are valid and initialization succeeded.\n");
+		if(e.batch) e.batch->mergeProcesses();
 		finalizeSystem();
 		return 0;
 	}
 	else logPrintf("Initialization completed successfully at t[s]: %9.2lf\n\n", clock_sec());
 	logFlush();
 	
-	if(e.cntrl.dumpOnly)
+	if(e.batch)
+	{	//Evaluate many structures reusing this setup (bypasses ionic minimization and final dump)
+		e.batch->calculate();
+		finalizeSystem();
+		return 0;
+	}
+	else if(e.cntrl.dumpOnly)
 	{	//Single energy calculation so that all dependent quantities have been initialized:
 		logPrintf("\n----------- Energy evaluation at fixed state -------------\n"); logFlush();
 		eVars.elecEnergyAndGrad(e.ener, 0, 0, true); //calculate Hsub so that eigenvalues are available (used by many dumps)
@@ -0,0 +1,161 @@
+/*-------------------------------------------------------------------
+Copyright 2017 Ravishankar Sundararaman
+
+This file is part of JDFTx.
+
+JDFTx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+JDFTx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
+-------------------------------------------------------------------*/
+
+#include <opt/FluidLibrary/JDFTxFluid.h>
+#include <electronic/Everything.h>
+#include <electronic/ColumnBundle.h>
+#include <fluid/FluidSolver.h>
+#include <commands/parser.h>
+#include <core/Thread.h>
+#include <fftw3.h>
+#include <mutex>
+
+//! Fluid solver instance: an independent (fluid-only) JDFTx calculation
+struct JDFTxFluid
+{	Everything e;
+};
+
+//Split commands (one per line, with '#' comments and '\' continuations) into command / argument pairs:
+static void splitCommands(const char* commands, std::vector< std::pair<string,string> >& input)
+{	if(!commands) return;
+	istringstream iss((string(commands)));
+	string line, fullLine;
+	while(getline(iss, line))
+	{	size_t commentPos = line.find('#');
+		if(commentPos != string::npos) line.erase(commentPos);
+		trim(line);
+		if(line.length() && line[line.length()-1]=='\\')
+		{	fullLine += line.substr(0, line.length()-1) + " "; //continued on next line
+			continue;
+		}
+		fullLine += line;
+		trim(fullLine);
+		if(fullLine.length())
+		{	size_t cmdEnd = fullLine.find_first_of(" \t");
+			string cmd = fullLine.substr(0, cmdEnd);
+			string args = (cmdEnd==string::npos) ? string() : fullLine.substr(cmdEnd);
+			trim(args);
+			input.push_back(std::make_pair(cmd, args));
+		}
+		fullLine.clear();
+	}
+}
+
+JDFTxFluid* jdftxFluidCreate(const double* R, const int* S, const char* commands, const char* logFilename)
+{	//Initialize environment and print banner (once per process):
+	static std::once_flag initFlag;
+	std::call_once(initFlag, [logFilename]()
+	{	if(logFilename && *logFilename)
+		{	globalLog = fopen(logFilename, "w");
+			if(!globalLog)
+			{	globalLog = stdout;
+				logPrintf("WARNING: Could not open log file '%s' for writing, using standard output.\n", logFilename);
+			}
+		}
+		const char* execName = "N/A (Running as a library providing fluid solvers)";
+		initSystem(1, (char**)&execName);
+		Citations::add("JDFTx fluid embedding interface",
+			"K. Mathew, R. Sundararaman, K. Letchworth-Weaver, T.A. Arias and R.G. Hennig (under preparation)");
+	});
+	
+	//Prepare input (lattice and grid from caller, fluid specification from commands):
+	std::vector< std::pair<string,string> > input;
+	char buf[1024];
+	sprintf(buf, "%.15lf %.15lf %.15lf  %.15lf %.15lf %.15lf  %.15lf %.15lf %.15lf",
+		R[0], R[1], R[2], R[3], R[4], R[5], R[6], R[7], R[8]);
+	input.push_back(std::make_pair(string("lattice"), string(buf)));
+	sprintf(buf, "%d %d %d", S[0], S[1], S[2]);
+	input.push_back(std::make_pair(string("fftbox"), string(buf)));
+	input.push_back(std::make_pair(string("elec-cutoff"), string("0")));
+	input.push_back(std::make_pair(string("symmetries"), string("none")));
+	splitCommands(commands, input);
+	
+	//Initialize system:
+	JDFTxFluid* fluid = new JDFTxFluid;
+	Everything& e = fluid->e;
+	parse(input, e);
+	if(e.eVars.fluidParams.fluidType == FluidNone) die("No fluid model specified in commands for jdftxFluidCreate.\n");
+	if(e.iInfo.ionWidthMethod == IonInfo::IonWidthEcut)
+	{	logPrintf("JDFTx fluid interface does not have access to the energy cutoff:\n"
+			"\tUsing FFTbox to determine nuclear width instead.\n");
+		e.iInfo.ionWidthMethod = IonInfo::IonWidthFFTbox;
+	}
+	e.setup();
+	Citations::print();
+	return fluid;
+}
+
+void jdftxFluidDestroy(JDFTxFluid* fluid)
+{	delete fluid;
+}
+
+double jdftxFluidIonWidth(const JDFTxFluid* fluid)
+{	return fluid->e.iInfo.ionWidth;
+}
+
+//Forward transform (J) of a caller-owned real-space array, read in place if possible (r2c transforms preserve input)
+static ScalarFieldTilde Jexternal(const GridInfo& gInfo, const double* in)
+{
+	#ifndef GPU_ENABLED
+	if(fftw_alignment_of((double*)in) == 0) //new-array execution requires same alignment as the planned arrays
+	{	ScalarFieldTilde out(ScalarFieldTildeData::alloc(gInfo));
+		int nThreads = shouldThreadOperators() ? nProcsAvailable : 1;
+		fftw_execute_dft_r2c(gInfo.getPlan(GridInfo::PlanRtoC, nThreads), (double*)in, (fftw_complex*)out->data(false));
+		return out *= (1./gInfo.nr);
+	}
+	#endif
+	ScalarField inCopy(ScalarFieldData::alloc(gInfo));
+	eblas_copy(inCopy->data(), in, gInfo.nr);
+	return J(inCopy);
+}
+
+//Inverse transform (I) into a caller-owned real-space array, written in place if possible (destroys input)
+static void Iexternal(ScalarFieldTilde&& in, double* out)
+{	const GridInfo& gInfo = in->gInfo;
+	#ifndef GPU_ENABLED
+	if(fftw_alignment_of(out) == 0) //new-array execution requires same alignment as the planned arrays
+	{	int nThreads = shouldThreadOperators() ? nProcsAvailable : 1;
+		fftw_execute_dft_c2r(gInfo.getPlan(GridInfo::PlanCtoR, nThreads), (fftw_complex*)in->data(), out);
+		return;
+	}
+	#endif
+	eblas_copy(out, I((ScalarFieldTilde&&)in)->data(), gInfo.nr);
+}
+
+double jdftxFluidMinimize(JDFTxFluid* fluid, const double* nCavity, const double* rhoExplicit,
+	double* Adiel_nCavity, double* Adiel_rhoExplicit)
+{	Everything& e = fluid->e;
+	FluidSolver& fluidSolver = *(e.eVars.fluidSolver);
+	
+	//Set inputs:
+	ScalarFieldTilde rhoExplicitTilde = Jexternal(e.gInfo, rhoExplicit);
+	if(!fluidSolver.k2factor) rhoExplicitTilde->setGzero(0.); //No screening => apply neutralizing background charge
+	fluidSolver.set(rhoExplicitTilde, Jexternal(e.gInfo, nCavity));
+	
+	//Minimize, starting from the state of the previous call:
+	logPrintf("\n---------------------- Fluid Minimization -----------------------\n");
+	fluidSolver.minimizeFluid();
+	
+	//Retrieve energy and gradients:
+	ScalarFieldTilde A_rhoExplicitTilde, A_nCavityTilde;
+	double A = fluidSolver.get_Adiel_and_grad(&A_rhoExplicitTilde, &A_nCavityTilde);
+	if(Adiel_nCavity) Iexternal((ScalarFieldTilde&&)A_nCavityTilde, Adiel_nCavity);
+	if(Adiel_rhoExplicit) Iexternal((ScalarFieldTilde&&)A_rhoExplicitTilde, Adiel_rhoExplicit);
+	return A;
+}
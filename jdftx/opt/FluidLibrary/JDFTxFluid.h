@@ -0,0 +1,70 @@
+/*-------------------------------------------------------------------
+Copyright 2017 Ravishankar Sundararaman
+
+This file is part of JDFTx.
+
+JDFTx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+JDFTx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
+-------------------------------------------------------------------*/
+
+#ifndef JDFTX_OPT_FLUIDLIBRARY_JDFTXFLUID_H
+#define JDFTX_OPT_FLUIDLIBRARY_JDFTXFLUID_H
+
+//! @file JDFTxFluid.h C/C++ API for embedding the JDFTx fluid (solvation) models in other electronic structure codes
+//!
+//! Each JDFTxFluid object is an independent fluid solver on its own lattice and FFT grid;
+//! any number of them may coexist in a process. The fluid state is retained between calls
+//! to jdftxFluidMinimize, so that each minimization is warm-started from the previous solution
+//! (as in a self-consistency loop of the calling code).
+//!
+//! All quantities are in atomic units (Hartrees, bohrs). Real-space arrays are in JDFTx order, i.e.
+//! index = i2 + S[2]*(i1 + S[1]*i0) for grid point (i0,i1,i2) along the three lattice directions
+//! (codes with the first index fastest should reverse the order of the lattice vectors and sample counts).
+//! These arrays are owned by the caller and are accessed in place (without intermediate copies)
+//! whenever their alignment is compatible with the FFT library; otherwise they are copied internally.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct JDFTxFluid JDFTxFluid; //!< opaque handle to a fluid solver instance
+
+//! Create a fluid solver instance.
+//! @param R (in, 3x3 row-major matrix) Lattice vectors in columns, in bohrs (as in the lattice command)
+//! @param S (in, 3 integers) FFT grid sample counts along each lattice direction
+//! @param commands (in, string) JDFTx input commands specifying the fluid (one per line; '#' comments and '\' continuations allowed)
+//! @param logFilename (in, string) Log file for JDFTx output: used only by the first instance; null or empty for standard output
+//! @return New solver instance (free using jdftxFluidDestroy)
+JDFTxFluid* jdftxFluidCreate(const double* R, const int* S, const char* commands, const char* logFilename);
+
+//! Free a fluid solver instance created by jdftxFluidCreate
+void jdftxFluidDestroy(JDFTxFluid* fluid);
+
+//! Get the recommended gaussian width of nuclear charges in rhoExplicit for this fluid model (in bohrs)
+double jdftxFluidIonWidth(const JDFTxFluid* fluid);
+
+//! Minimize the fluid (warm-started from the previous call) and return the free energy and its derivatives.
+//! @param fluid (in/out) Solver instance
+//! @param nCavity (in, real-space scalar field) Electron density involved in cavity determination
+//! @param rhoExplicit (in, real-space scalar field) Total charge density of electronic system (valence electrons + nuclei)
+//! @param Adiel_nCavity (out, real-space scalar field, optional) Functional derivative of the free energy with respect to nCavity
+//! @param Adiel_rhoExplicit (out, real-space scalar field, optional) Functional derivative of the free energy with respect to rhoExplicit
+//! @return Fluid free energy (including coupling to the electronic system)
+double jdftxFluidMinimize(JDFTxFluid* fluid, const double* nCavity, const double* rhoExplicit,
+	double* Adiel_nCavity, double* Adiel_rhoExplicit);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // JDFTX_OPT_FLUIDLIBRARY_JDFTXFLUID_H
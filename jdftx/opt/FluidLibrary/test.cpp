@@ -0,0 +1,65 @@
+/*-------------------------------------------------------------------
+Copyright 2017 Ravishankar Sundararaman
+
+This file is part of JDFTx.
+
+JDFTx is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+JDFTx is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with JDFTx.  If not, see <http://www.gnu.org/licenses/>.
+-------------------------------------------------------------------*/
+
+// Test the fluid embedding library: two independent solvers,
+// each minimized repeatedly as in an SCF loop of the calling code
+
+#include <opt/FluidLibrary/JDFTxFluid.h>
+#include <cstdio>
+#include <cmath>
+#include <vector>
+
+//Create a test "molecule" (with a slight dipole, scaled by dipoleScale):
+void makeMolecule(int S, double h, double ionWidth, double dipoleScale, std::vector<double>& n, std::vector<double>& rho)
+{	double elWidth = 2*ionWidth; //width for some arbitrary electron density
+	double elPrefac = 1./(elWidth*sqrt(2*M_PI));
+	double ionPrefac = -1./(ionWidth*sqrt(2*M_PI));
+	int i=0;
+	for(int i0=-S/2; i0<S-S/2; i0++)
+		for(int i1=-S/2; i1<S-S/2; i1++)
+			for(int i2=-S/2; i2<S-S/2; i2++)
+			{	double rEl = h*sqrt(i0*i0 + i1*i1 + i2*i2);
+				double rIon = h*sqrt((i0-dipoleScale)*(i0-dipoleScale) + i1*i1 + i2*i2);
+				double rhoEl = elPrefac * exp(-0.5*pow(rEl/elWidth,2));
+				double rhoIon = ionPrefac * exp(-0.5*pow(rIon/ionWidth,2));
+				n[i] = rhoEl;
+				rho[i] = rhoEl + rhoIon;
+				i++;
+			}
+}
+
+int main()
+{	const int S = 28; const double L = 20.; //grid and cubic box size in bohrs
+	double R[9] = { L, 0., 0.,  0., L, 0.,  0., 0., L };
+	int Sarr[3] = { S, S, S };
+	JDFTxFluid* fluid1 = jdftxFluidCreate(R, Sarr, "fluid LinearPCM\npcm-variant GLSSA13\nfluid-solvent H2O\n", "FLULOG");
+	JDFTxFluid* fluid2 = jdftxFluidCreate(R, Sarr, "fluid LinearPCM\nfluid-solvent CH3CN\n", 0);
+	
+	int nData = S*S*S;
+	std::vector<double> n(nData), rho(nData), A_n(nData), A_rho(nData);
+	for(int iter=0; iter<3; iter++)
+	{	for(JDFTxFluid* fluid: { fluid1, fluid2 })
+		{	makeMolecule(S, L/S, jdftxFluidIonWidth(fluid), 1.+0.1*iter, n, rho);
+			double A = jdftxFluidMinimize(fluid, n.data(), rho.data(), A_n.data(), A_rho.data());
+			printf("iter %d: Adiel = %lg Eh\n", iter, A);
+		}
+	}
+	jdftxFluidDestroy(fluid1);
+	jdftxFluidDestroy(fluid2);
+}
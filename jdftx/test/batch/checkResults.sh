@@ -0,0 +1,16 @@
+#!/bin/bash
+
+echo "4"  #number of checks
+
+#Structures evaluated in one batch run should match separate runs:
+function batchEnergy()
+{	awk -v name="$1" '/^# Structure/ { current = $3 } current==name && / = / { print $3 }' batch.batch
+}
+function singleEnergy()
+{	awk '/IonicMinimize: Iter/ { E = $5 } END { print E }' $1.out
+}
+echo "$(singleEnergy singleA) $(batchEnergy A)" | awk '{ print $2-$1, "0 1e-6 Batch - single energy A [Eh]" }'
+echo "$(singleEnergy singleB) $(batchEnergy B)" | awk '{ print $2-$1, "0 1e-6 Batch - single energy B [Eh]" }'
+paste <(grep '^force' singleB.force) <(awk '/^# Structure/ { current = $3 } current=="B" && /^force/' batch.batch) \
+	| awk '{ for(j=3; j<=5; j++) { d = $j-$(j+6); if(d<0) d=-d; if(d>dMax) dMax=d } } END { print dMax, "0 1e-5 Max batch - single force B [Eh/a0]" }'
+awk '/^# Structure .* skipped:/ { n++ } END { print n+0, "1 0 Number of skipped structures" }' batch.batch
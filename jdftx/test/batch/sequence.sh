@@ -0,0 +1,3 @@
+#!/bin/bash
+export runs="singleA singleB batch"
+export nProcs="4"
@@ -0,0 +1,9 @@
+#!/bin/bash
+
+echo "2"  #number of checks
+
+#Exchange on a 2x2x2 sub-mesh of k-point differences should stay close to the full 4x4x4 result:
+awk '/^Downsampling exchange pair sums by \[2 2 2\]/ { n++ } END { print n+0, "1 0 Downsampled exchange active" }' downsampled.out
+Efull="$(awk '/IonicMinimize: Iter/ { E = $5 } END { print E }' full.out)"
+Edown="$(awk '/IonicMinimize: Iter/ { E = $5 } END { print E }' downsampled.out)"
+echo "$Efull $Edown" | awk '{ print $2-$1, "0 2e-3 Downsampled - full energy [Eh]" }'
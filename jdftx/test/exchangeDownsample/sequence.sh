@@ -0,0 +1,3 @@
+#!/bin/bash
+export runs="full downsampled"
+export nProcs="4"
@@ -0,0 +1,16 @@
+#!/bin/bash
+
+echo "5"  #number of checks
+
+#Localized exchange with negligible truncation should reproduce the standard evaluation:
+Edeloc="$(awk '/IonicMinimize: Iter/ { E = $5 } END { print E }' delocalized.out)"
+Eloc="$(awk '/IonicMinimize: Iter/ { E = $5 } END { print E }' localized.out)"
+echo "$Edeloc -17.2 0.5 Delocalized energy [Eh]"
+echo "$Edeloc $Eloc" | awk '{ print $2-$1, "0 1e-6 Localized - delocalized energy [Eh]" }'
+paste delocalized.force localized.force | awk '/^force/ { for(j=3; j<=5; j++) { d = $j-$(j+6); if(d<0) d=-d; if(d>dMax) dMax=d } } END { print dMax, "0 1e-5 Max localized - delocalized force [Eh/a0]" }'
+
+#Eigenvalues (binary doubles, 4 occupied and 2 empty bands) including the HOMO-LUMO gap:
+paste <(od -A n -v -t f8 -w8 delocalized.eigenvals) <(od -A n -v -t f8 -w8 localized.eigenvals) \
+	| awk '{ d = $1-$2; if(d<0) d=-d; if(d>dMax) dMax=d } END { print dMax, "0 1e-5 Max localized - delocalized eigenvalue [Eh]" }'
+paste <(od -A n -v -t f8 -w8 delocalized.eigenvals) <(od -A n -v -t f8 -w8 localized.eigenvals) \
+	| awk 'NR==4 { homo1=$1; homo2=$2 } NR==5 { print ($2-homo2)-($1-homo1), "0 1e-5 Localized - delocalized HOMO-LUMO gap [Eh]" }'
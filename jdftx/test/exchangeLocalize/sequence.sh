@@ -0,0 +1,3 @@
+#!/bin/bash
+export runs="delocalized localized"
+export nProcs="2"
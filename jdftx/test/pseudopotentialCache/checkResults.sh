@@ -0,0 +1,10 @@
+#!/bin/bash
+
+echo "3"  #number of checks
+
+#The second run should load the cache written by the first, and reproduce its energy exactly:
+awk '/Loaded processed pseudopotential data from cache/ { n++ } END { print n+0, "0 0 Cache loads in cold run" }' cold.out
+awk '/Loaded processed pseudopotential data from cache/ { n++ } END { print n+0, "1 0 Cache loads in cached run" }' cached.out
+Ecold="$(awk '/IonicMinimize: Iter/ { E = $5 } END { print E }' cold.out)"
+Ecached="$(awk '/IonicMinimize: Iter/ { E = $5 } END { print E }' cached.out)"
+echo "$Ecold $Ecached" | awk '{ print $2-$1, "0 1e-10 Cached - cold energy [Eh]" }'
@@ -0,0 +1,3 @@
+#!/bin/bash
+export runs="cold cached"
+export nProcs="2"
@@ -0,0 +1,9 @@
+#!/bin/bash
+
+echo "2"  #number of checks
+
+#Largest stress component (ensures that the comparison below is not trivial):
+awk 'NR>1 { for(j=1; j<=3; j++) { s = ($j<0 ? -$j : $j); if(s>sMax) sMax=s } } END { print sMax, "1e-2 9.9e-3 Largest stress component [Eh/a0^3]" }' analytic.stress
+
+#Analytic vs fourth-order finite difference stress (at the same converged electronic state):
+paste analytic.stress finiteDifference.stress | awk 'NR>1 { for(j=1; j<=3; j++) { d = $j-$(j+3); if(d<0) d=-d; if(d>dMax) dMax=d } } END { print dMax, "0 1e-6 Max analytic - FD stress [Eh/a0^3]" }'
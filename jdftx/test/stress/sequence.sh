@@ -0,0 +1,3 @@
+#!/bin/bash
+export runs="analytic finiteDifference"
+export nProcs="4"
@@ -198,11 +198,11 @@ bool WannierMinimizer::Kpoint::operator==(const WannierMinimizer::Kpoint& other)
 	return true;
 }
 
-ColumnBundle WannierMinimizer::getWfns(const WannierMinimizer::Kpoint& kpoint, int iSpin) const
-{	ColumnBundle ret(nBands, basis.nbasis*nSpinor, &basis, &kpoint, isGpuEnabled());
-	ret.zero();
-	axpyWfns(1., matrix(), kpoint, iSpin, ret);
-	return ret;
+std::shared_ptr<const ColumnBundle> WannierMinimizer::getWfns(const WannierMinimizer::Kpoint& kpoint, int iSpin) const
+{	int q = kpoint.iReduced + iSpin*qCount;
+	const ColumnBundle& Cin = e.eInfo.isMine(q) ? e.eVars.C[q] : Cother[q];
+	assert(Cin);
+	return wfnsCache.get(*(transformMap.find(kpoint)->second), Cin, &kpoint);
 }
 
 #define axpyWfns_COMMON(result) \
@@ -337,16 +337,59 @@ ColumnBundle WannierMinimizer::trialWfns(const WannierMinimizer::Kpoint& kpoint)
 }
 
 matrix WannierMinimizer::overlap(const ColumnBundle& C1, const ColumnBundle& C2) const
+{	matrix ret = C1.basis->gInfo->detR * (C1 ^ C2);
+	augmentOverlap(ret, C1, C2);
+	return ret;
+}
+
+std::vector<matrix> WannierMinimizer::overlap(const ColumnBundle& C1, const std::vector< std::shared_ptr<const ColumnBundle> >& C2arr) const
+{	static StopWatch watch("WannierMinimizer::overlapBatch"); watch.start();
+	const GridInfo& gInfo = *(C1.basis->gInfo);
+	const IonInfo& iInfo = *(C1.basis->iInfo);
+	//Plane-wave part for all C2 together:
+	int nColsTot = 0;
+	for(const auto& C2: C2arr)
+	{	assert(C2->colLength() == C1.colLength());
+		nColsTot += C2->nCols();
+	}
+	matrix retAll;
+	{	ColumnBundle C2all(nColsTot, C1.colLength(), C1.basis, C1.qnum, isGpuEnabled());
+		int colStart = 0;
+		for(const auto& C2: C2arr)
+		{	C2all.setSub(colStart, *C2);
+			colStart += C2->nCols();
+		}
+		retAll = gInfo.detR * (C1 ^ C2all);
+	}
+	//Projections of C1 (shared by all the augmentations):
+	std::vector<matrix> VdagC1(iInfo.species.size());
+	for(unsigned sp=0; sp<iInfo.species.size(); sp++)
+		if(iInfo.species[sp]->Qint.size())
+			VdagC1[sp] = (*iInfo.species[sp]->getV(C1)) ^ C1;
+	//Split and augment:
+	std::vector<matrix> ret(C2arr.size());
+	int colStart = 0;
+	for(unsigned i=0; i<C2arr.size(); i++)
+	{	int colStop = colStart + C2arr[i]->nCols();
+		ret[i] = retAll(0,C1.nCols(), colStart,colStop);
+		augmentOverlap(ret[i], C1, *C2arr[i], &VdagC1);
+		colStart = colStop;
+	}
+	watch.stop();
+	return ret;
+}
+
+void WannierMinimizer::augmentOverlap(matrix& ret, const ColumnBundle& C1, const ColumnBundle& C2, const std::vector<matrix>* VdagC1arr) const
 {	const GridInfo& gInfo = *(C1.basis->gInfo);
 	const IonInfo& iInfo = *(C1.basis->iInfo);
-	matrix ret = gInfo.detR * (C1 ^ C2);
 	//k-point difference:
 	vector3<> dkVec = C2.qnum->k - C1.qnum->k;
 	double dk = sqrt(gInfo.GGT.metric_length_squared(dkVec));
 	vector3<> dkHat = gInfo.GT * dkVec * (dk ? 1.0/dk : 0.0); //the unit Vector along dkVec (set dkHat to 0 for dk=0 (doesn't matter))
 	//Augment at each species:
-	for(const auto& sp: iInfo.species) if(sp->Qint.size())
-	{	//Create the Q matrix appropriate for current k-point difference:
+	for(unsigned iSp=0; iSp<iInfo.species.size(); iSp++) if(iInfo.species[iSp]->Qint.size())
+	{	const auto& sp = iInfo.species[iSp];
+		//Create the Q matrix appropriate for current k-point difference:
 		matrix Qk = zeroes(sp->QintAll.nRows(), sp->QintAll.nCols());
 		complex* QkData = Qk.data();
 		int i1 = 0;
@@ -379,9 +422,8 @@ matrix WannierMinimizer::overlap(const ColumnBundle& C1, const ColumnBundle& C2)
 		for(vector3<> x: sp->atpos)
 			phaseArr.push_back(cis(-2*M_PI*dot(dkVec,x)));
 		//Augment the overlap
-		matrix VdagC1 = (*sp->getV(C1)) ^ C1;
+		matrix VdagC1 = VdagC1arr ? VdagC1arr->at(iSp) : (*sp->getV(C1)) ^ C1;
 		matrix VdagC2 = (*sp->getV(C2)) ^ C2;
 		ret += dagger(VdagC1) * (tiledBlockMatrix(Qk, sp->atpos.size(),&phaseArr) * VdagC2);
 	}
-	return ret;
 }
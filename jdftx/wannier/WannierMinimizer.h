@@ -136,9 +136,10 @@ protected:
 	bool isMine_q(int ik, int iSpin) const { return e.eInfo.isMine(kMesh[ik].point.iReduced + iSpin*qCount); }
 	int whose_q(int ik, int iSpin) const { return e.eInfo.whose(kMesh[ik].point.iReduced + iSpin*qCount); }
 	
-	//! Get the wavefunctions for a particular k-point in the common basis
-	ColumnBundle getWfns(const Kpoint& kpoint, int iSpin) const;
+	//! Get the wavefunctions for a particular k-point in the common basis (cached: see wfnsCache)
+	std::shared_ptr<const ColumnBundle> getWfns(const Kpoint& kpoint, int iSpin) const;
 	std::vector<ColumnBundle> Cother; //!< wavefunctions from another process
+	ColumnBundleTransform::Cache wfnsCache; //!< results of getWfns (must be cleared whenever Cother changes)
 	
 	//! Like getWfns, but accumulate instead of setting, and with optional transformation matrix: result += alpha * wfns * A
 	void axpyWfns(double alpha, const matrix& A, const Kpoint& kpoint, int iSpin, ColumnBundle& result) const;
@@ -154,6 +155,13 @@ protected:
 	//! (Note that the augmentation in the O() from electronic/ColumnBundle.h assumes both sides have same k-point)
 	matrix overlap(const ColumnBundle& C1, const ColumnBundle& C2) const;
 	
+	//! Overlaps of C1 with each of C2arr, with the plane-wave part computed as a single matrix multiply
+	//! against all of C2arr, and the projections of C1 shared between the augmentations (all in the common basis)
+	std::vector<matrix> overlap(const ColumnBundle& C1, const std::vector< std::shared_ptr<const ColumnBundle> >& C2arr) const;
+	
+	//! Add ultrasoft augmentation to overlap ret between C1 and C2 at different k-points (optionally with precomputed projections of C1)
+	void augmentOverlap(matrix& ret, const ColumnBundle& C1, const ColumnBundle& C2, const std::vector<matrix>* VdagC1=0) const;
+	
 	//! Dump a named matrix variable to file, optionally zeroing out the real parts
 	void dumpMatrix(const matrix& H, string varName, bool realPartOnly, int iSpin) const;
 	
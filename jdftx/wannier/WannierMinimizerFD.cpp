@@ -165,29 +165,53 @@ WannierMinimizerFD::WannierMinimizerFD(const Everything& e, const Wannier& wanni
 
 void WannierMinimizerFD::initialize(int iSpin)
 {
+	//Determine the halo of states that need to be exchanged for the finite difference neighbours:
+	int nProcesses = mpiUtil->nProcesses(), iProcess = mpiUtil->iProcess();
+	std::vector< std::set<int> > qRecv(nProcesses); //states needed from each other process
+	std::vector< std::set<int> > qSend(nProcesses); //states needed by each other process from this one
+	for(size_t ik=0; ik<kMesh.size(); ik++)
+	{	int ikProcess = whose_q(ik,iSpin);
+		for(const Edge& edge: edges[ik])
+		{	int q = edge.point.iReduced + iSpin*qCount;
+			int qProcess = e.eInfo.whose(q);
+			if(ikProcess == qProcess) continue; //no communication needed
+			if(ikProcess == iProcess) qRecv[qProcess].insert(q);
+			if(qProcess == iProcess) qSend[ikProcess].insert(q);
+		}
+	}
+	
 	//Compute the overlap matrices for current spin:
-	for(int jProcess=0; jProcess<mpiUtil->nProcesses(); jProcess++)
-	{	//Send/recv wavefunctions to other processes:
+	for(int jProcess=0; jProcess<nProcesses; jProcess++)
+	{	//Send/recv halo wavefunctions (only the states required by each process):
 		Cother.assign(e.eInfo.nStates, ColumnBundle());
-		if(jProcess == mpiUtil->iProcess()) //send
-		{	for(int q=e.eInfo.qStart; q<e.eInfo.qStop; q++)
-				((ColumnBundle&)e.eVars.C[q]).bcast(jProcess);
+		if(jProcess == iProcess) //send
+		{	for(int kProcess=0; kProcess<nProcesses; kProcess++)
+				for(int q: qSend[kProcess])
+					e.eVars.C[q].send(kProcess);
 		}
 		else //recv
-		{	for(int q=e.eInfo.qStartOther(jProcess); q<e.eInfo.qStopOther(jProcess); q++)
+		{	for(int q: qRecv[jProcess])
 			{	Cother[q].init(nBands, e.basis[q].nbasis*nSpinor, &e.basis[q], &e.eInfo.qnums[q]);
-				Cother[q].bcast(jProcess);
+				Cother[q].recv(jProcess);
 			}
 		}
 		
+		//Overlaps of each local k-point with all its neighbours from jProcess in one batch
+		//(unfolded neighbour wavefunctions are reused between adjacent k-points via wfnsCache):
 		for(size_t ik=0; ik<kMesh.size(); ik++) if(isMine_q(ik,iSpin))
-		{	KmeshEntry& ke = kMesh[ik];
-			ColumnBundle Ci = getWfns(ke.point, iSpin); //Bloch functions at ik
-			//Overlap with neighbours:
+		{	std::vector<Edge*> edgesBatch;
+			std::vector< std::shared_ptr<const ColumnBundle> > Cj;
 			for(Edge& edge: edges[ik])
 				if(whose_q(edge.ik,iSpin)==jProcess)
-					edge.M0 = overlap(Ci, getWfns(edge.point, iSpin));
+				{	edgesBatch.push_back(&edge);
+					Cj.push_back(getWfns(edge.point, iSpin));
+				}
+			if(!edgesBatch.size()) continue;
+			std::vector<matrix> M0 = overlap(*getWfns(kMesh[ik].point, iSpin), Cj); //Bloch functions at ik with neighbours
+			for(unsigned j=0; j<edgesBatch.size(); j++)
+				edgesBatch[j]->M0 = M0[j];
 		}
+		wfnsCache.clear(); //cached entries may refer to Cother
 	}
 	Cother.clear();
 	
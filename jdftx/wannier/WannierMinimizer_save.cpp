@@ -212,7 +212,7 @@ void WannierMinimizer::saveMLWF(int iSpin)
 		}
 		else
 		{	//Determine from trial orbitals:
-			matrix CdagG = getWfns(ke.point, iSpin) ^ trialWfns(ke.point);
+			matrix CdagG = (*getWfns(ke.point, iSpin)) ^ trialWfns(ke.point);
 			int nNew = nCenters - nFrozen; //number of new centers
 			//--- Pick up best linear combination of remaining bands (if any)
 			if(nFree > 0)
@@ -278,6 +278,7 @@ void WannierMinimizer::saveMLWF(int iSpin)
 	
 	//Sub-class specific initialization:
 	initialize(iSpin);
+	wfnsCache.clear(); //unfolded wavefunctions (reused from above in initialize) no longer needed
 	
 	//Minimize:
 	double Omega = minimize(wannier.minParams);